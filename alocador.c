@@ -0,0 +1,616 @@
+/* Alocação de registradores por varredura linear (alocador.c) */
+
+#include "globals.h"
+#include "alocador.h"
+#include "vida.h"
+#include "arena.h"
+
+#include <string.h>
+
+#define INFINITO INT32_MAX
+#define BITS 64
+
+/* Na ordem de preferência: primeiro os que uma chamada destrói, que não
+   precisam ser salvos no prólogo */
+#define NALOCAVEIS  11
+#define NDESTRUIDOS 6
+static const RegX64 alocaveis[NALOCAVEIS] = {RSI, RDI, R8, R9, R10, R11, RBX, R12, R13, R14, R15};
+
+/* Vetor de pedaços da arena que dobra de tamanho */
+typedef struct {
+    Pedaco **v;
+    int n, cap;
+} ListaPedacos;
+
+typedef struct {
+    const CodigoIR *c;
+    const FuncaoCfg *f;
+    const PedidoAlocacao *p;
+    Alocacao *a;
+    ListaPedacos fila;       /* heap pelo início */
+    ListaPedacos ativos, inativos;
+    Movimento *mov;
+    uint32_t nmov, capMov;
+} Alocador;
+
+static void acrescentar(ListaPedacos *l, Pedaco *p) {
+    if (l->n == l->cap) {
+        int cap = l->cap ? l->cap * 2 : 32;
+        Pedaco **novo = (Pedaco **)arenaAlloc(cap * sizeof(Pedaco *));
+        if (l->n > 0) memcpy(novo, l->v, l->n * sizeof(Pedaco *));
+        l->v = novo;
+        l->cap = cap;
+    }
+    l->v[l->n++] = p;
+}
+
+/* ---------------------- Pedaços ---------------------- */
+
+static Pedaco *novoPedaco(int32_t virtual) {
+    Pedaco *p = (Pedaco *)arenaAlloc(sizeof(Pedaco));
+    p->virtual = virtual;
+    p->divisao = -1;
+    p->reg = SEM_REG;
+    p->dica = SEM_REG;
+    return p;
+}
+
+static void novaFaixa(Pedaco *p, int32_t de, int32_t ate) {
+    if (p->nfaixas == p->capFaixas) {
+        int cap = p->capFaixas ? p->capFaixas * 2 : 4;
+        Faixa *novo = (Faixa *)arenaAlloc(cap * sizeof(Faixa));
+        if (p->nfaixas > 0) memcpy(novo, p->faixas, p->nfaixas * sizeof(Faixa));
+        p->faixas = novo;
+        p->capFaixas = cap;
+    }
+    p->faixas[p->nfaixas].de = de;
+    p->faixas[p->nfaixas++].ate = ate;
+}
+
+static void novoUso(Pedaco *p, int32_t pos) {
+    if (p->nusos > 0 && p->usos[p->nusos - 1] == pos) return;
+    if (p->nusos == p->capUsos) {
+        int cap = p->capUsos ? p->capUsos * 2 : 4;
+        int32_t *novo = (int32_t *)arenaAlloc(cap * sizeof(int32_t));
+        if (p->nusos > 0) memcpy(novo, p->usos, p->nusos * sizeof(int32_t));
+        p->usos = novo;
+        p->capUsos = cap;
+    }
+    p->usos[p->nusos++] = pos;
+}
+
+static int32_t inicio(const Pedaco *p) {
+    return p->faixas[0].de;
+}
+
+static int32_t fim(const Pedaco *p) {
+    return p->faixas[p->nfaixas - 1].ate;
+}
+
+static int cobre(const Pedaco *p, int32_t pos) {
+    for (int k = 0; k < p->nfaixas && p->faixas[k].de <= pos; k++)
+        if (pos < p->faixas[k].ate) return TRUE;
+    return FALSE;
+}
+
+/* Primeira posição coberta pelos dois, ou INFINITO */
+static int32_t intersecao(const Pedaco *a, const Pedaco *b) {
+    int i = 0, j = 0;
+
+    while (i < a->nfaixas && j < b->nfaixas) {
+        int32_t de = a->faixas[i].de > b->faixas[j].de ? a->faixas[i].de : b->faixas[j].de;
+        int32_t ate = a->faixas[i].ate < b->faixas[j].ate ? a->faixas[i].ate : b->faixas[j].ate;
+
+        if (de < ate) return de;
+        if (a->faixas[i].ate < b->faixas[j].ate) i++;
+        else j++;
+    }
+    return INFINITO;
+}
+
+static int32_t proximoUso(const Pedaco *p, int32_t pos) {
+    for (int k = 0; k < p->nusos; k++)
+        if (p->usos[k] >= pos) return p->usos[k];
+    return INFINITO;
+}
+
+/* As divisões caem no começo de uma quádrupla, onde entram os movimentos */
+static int32_t quadDe(int32_t pos) {
+    return pos & ~3;
+}
+
+/* Divide p em corte (depois do início): p fica com [.., corte) e o pedaço
+   novo, que vem logo depois na lista do virtual, com o resto; NULL se
+   nada de p vem depois de corte */
+static Pedaco *dividir(Alocador *al, Pedaco *p, int32_t corte) {
+    Pedaco *novo;
+    int k = 0, u = 0;
+
+    while (k < p->nfaixas && p->faixas[k].ate <= corte) k++;
+    if (k == p->nfaixas) return NULL;
+
+    novo = novoPedaco(p->virtual);
+    novo->dica = p->dica;
+    novo->divisao = corte;
+    if (p->faixas[k].de < corte) {
+        novaFaixa(novo, corte, p->faixas[k].ate);
+        p->faixas[k].ate = corte;
+        k++;
+    }
+    for (int j = k; j < p->nfaixas; j++) novaFaixa(novo, p->faixas[j].de, p->faixas[j].ate);
+    p->nfaixas = k;
+    while (u < p->nusos && p->usos[u] < corte) u++;
+    for (int j = u; j < p->nusos; j++) novoUso(novo, p->usos[j]);
+    p->nusos = u;
+
+    novo->proximo = p->proximo;
+    p->proximo = novo;
+    al->a->divisoes++;
+    return novo;
+}
+
+/* ---------------------- Fila pelo início ---------------------- */
+
+static int antes(const Pedaco *a, const Pedaco *b) {
+    if (inicio(a) != inicio(b)) return inicio(a) < inicio(b);
+    return a->virtual < b->virtual;
+}
+
+static void enfileirar(Alocador *al, Pedaco *p) {
+    ListaPedacos *h = &al->fila;
+    int k;
+
+    acrescentar(h, p);
+    for (k = h->n - 1; k > 0 && antes(p, h->v[(k - 1) / 2]); k = (k - 1) / 2) h->v[k] = h->v[(k - 1) / 2];
+    h->v[k] = p;
+}
+
+static Pedaco *desenfileirar(Alocador *al) {
+    ListaPedacos *h = &al->fila;
+    Pedaco *topo = h->v[0], *ultimo = h->v[--h->n];
+    int k = 0;
+
+    for (;;) {
+        int f = 2 * k + 1;
+        if (f >= h->n) break;
+        if (f + 1 < h->n && antes(h->v[f + 1], h->v[f])) f++;
+        if (!antes(h->v[f], ultimo)) break;
+        h->v[k] = h->v[f];
+        k = f;
+    }
+    if (h->n > 0) h->v[k] = ultimo;
+    return topo;
+}
+
+/* ---------------------- Intervalos ---------------------- */
+
+/* Durante a construção, as faixas e os usos de cada virtual vêm de trás
+   para a frente e ficam em ordem decrescente; a faixa mais antiga é a
+   última */
+static void cobrirFaixa(Pedaco *p, int32_t de, int32_t ate) {
+    Faixa *u = p->nfaixas > 0 ? &p->faixas[p->nfaixas - 1] : NULL;
+
+    if (u != NULL && u->de <= ate) {
+        if (de < u->de) u->de = de;
+        if (ate > u->ate) u->ate = ate;
+    } else {
+        novaFaixa(p, de, ate);
+    }
+}
+
+/* Uma definição em pos começa a faixa; sem leitura depois, é uma faixa
+   de uma posição */
+static void definir(Pedaco *p, int32_t pos) {
+    if (p->nfaixas > 0 && p->faixas[p->nfaixas - 1].de <= pos) p->faixas[p->nfaixas - 1].de = pos;
+    else novaFaixa(p, pos, pos + 1);
+    novoUso(p, pos);
+}
+
+static void ler(Pedaco *p, int32_t inicioBloco, int32_t pos) {
+    cobrirFaixa(p, inicioBloco, pos + 1);
+    novoUso(p, pos);
+}
+
+static Pedaco *pedacoDe(Alocador *al, int32_t v) {
+    if (al->a->pedacos[v] == NULL) al->a->pedacos[v] = novoPedaco(v);
+    return al->a->pedacos[v];
+}
+
+static void inverter(Pedaco *p) {
+    for (int i = 0, j = p->nfaixas - 1; i < j; i++, j--) {
+        Faixa f = p->faixas[i];
+        p->faixas[i] = p->faixas[j];
+        p->faixas[j] = f;
+    }
+    for (int i = 0, j = p->nusos - 1; i < j; i++, j--) {
+        int32_t u = p->usos[i];
+        p->usos[i] = p->usos[j];
+        p->usos[j] = u;
+    }
+}
+
+/* Blocos de trás para a frente: os vivos na saída cobrem o bloco todo,
+   uma definição corta a faixa e uma leitura a estende até o início do
+   bloco */
+static void construirIntervalos(Alocador *al) {
+    const CodigoIR *c = al->c;
+    const FuncaoCfg *f = al->f;
+    const PedidoAlocacao *p = al->p;
+    int palavras = palavrasVida(c);
+    const uint64_t *vivos = vivosNaSaida(c, f);
+
+    for (int b = f->nblocos - 1; b >= 0; b--) {
+        const BlocoBasico *bb = &f->blocos[b];
+        const uint64_t *out = &vivos[(size_t)b * palavras];
+        int32_t de = POS_LEITURA(bb->inicio);
+
+        for (int w = 0; w < palavras; w++)
+            for (uint64_t m = out[w]; m != 0; m &= m - 1)
+                cobrirFaixa(pedacoDe(al, w * BITS + __builtin_ctzll(m)), de, POS_LEITURA(bb->fim));
+        for (uint32_t i = bb->fim; i-- > bb->inicio;) {
+            const Quad *q = &c->quads[i];
+
+            if (defineR((OpIR)q->op) && q->r.tipo == OPR_TEMP) definir(pedacoDe(al, q->r.v), POS_ESCRITA(i));
+            if (q->op == IR_FUNC)
+                for (int32_t v = 0; v < p->nentrada; v++) definir(pedacoDe(al, v), POS_ESCRITA(i));
+            if (!leOperandos((OpIR)q->op)) continue;
+            if (q->a.tipo == OPR_TEMP) ler(pedacoDe(al, q->a.v), de, POS_LEITURA(i));
+            if (q->b.tipo == OPR_TEMP) ler(pedacoDe(al, q->b.v), de, POS_LEITURA(i));
+        }
+    }
+
+    /* um argumento vive do param à call, no mesmo bloco */
+    for (uint32_t i = 0; i < c->n; i++) {
+        Pedaco *a;
+
+        if (c->quads[i].op != IR_ARG || p->argumento[i] < 0) continue;
+        a = pedacoDe(al, p->argumento[i]);
+        novaFaixa(a, POS_ESCRITA(i), POS_LEITURA(p->chamada[i]) + 1);
+        novoUso(a, POS_LEITURA(p->chamada[i]));
+        novoUso(a, POS_ESCRITA(i));
+    }
+
+    for (int32_t v = 0; v < p->nvirtuais; v++) {
+        Pedaco *pd = al->a->pedacos[v];
+        if (pd == NULL) continue;
+        inverter(pd);
+        pd->dica = p->dica[v];
+        al->a->presentes++;
+    }
+}
+
+/* As chamadas, nos registradores que elas destroem */
+static void fixarChamadas(Alocador *al) {
+    Pedaco *fixo[NDESTRUIDOS];
+
+    for (int r = 0; r < NDESTRUIDOS; r++) {
+        fixo[r] = novoPedaco(-1);
+        fixo[r]->reg = (uint8_t)alocaveis[r];
+    }
+    for (uint32_t i = 0; i < al->c->n; i++) {
+        if (al->c->quads[i].op != IR_CALL) continue;
+        for (int r = 0; r < NDESTRUIDOS; r++) novaFaixa(fixo[r], POS_CHAMADA(i), POS_CHAMADA(i) + 1);
+    }
+    if (fixo[0]->nfaixas == 0) return;
+    for (int r = 0; r < NDESTRUIDOS; r++) acrescentar(&al->inativos, fixo[r]);
+}
+
+/* ---------------------- Varredura ---------------------- */
+
+static void remover(ListaPedacos *l, int k) {
+    l->v[k] = l->v[--l->n];
+}
+
+/* Ativos são os que cobrem pos; inativos, os que estão num buraco */
+static void avancar(Alocador *al, int32_t pos) {
+    for (int k = 0; k < al->ativos.n;) {
+        Pedaco *p = al->ativos.v[k];
+        if (fim(p) <= pos) {
+            remover(&al->ativos, k);
+        } else if (!cobre(p, pos)) {
+            remover(&al->ativos, k);
+            acrescentar(&al->inativos, p);
+        } else {
+            k++;
+        }
+    }
+    for (int k = 0; k < al->inativos.n;) {
+        Pedaco *p = al->inativos.v[k];
+        if (fim(p) <= pos) {
+            remover(&al->inativos, k);
+        } else if (cobre(p, pos)) {
+            remover(&al->inativos, k);
+            acrescentar(&al->ativos, p);
+        } else {
+            k++;
+        }
+    }
+}
+
+/* O resto de p depois de corte volta à fila */
+static void devolver(Alocador *al, Pedaco *p, int32_t corte) {
+    Pedaco *resto;
+
+    if (corte <= inicio(p)) return;
+    resto = dividir(al, p, corte);
+    if (resto != NULL) enfileirar(al, resto);
+}
+
+/* Um registrador livre por todo o intervalo (o primeiro na ordem de
+   preferência, ou a dica) ou, se não há, o livre por mais tempo, com o
+   resto do intervalo de volta à fila */
+static int alocarLivre(Alocador *al, Pedaco *atual) {
+    int32_t livreAte[16];
+    int32_t ate = fim(atual);
+    int escolhido = -1;
+
+    for (int r = 0; r < 16; r++) livreAte[r] = 0;
+    for (int r = 0; r < NALOCAVEIS; r++) livreAte[alocaveis[r]] = INFINITO;
+    for (int k = 0; k < al->ativos.n; k++) livreAte[al->ativos.v[k]->reg] = 0;
+    for (int k = 0; k < al->inativos.n; k++) {
+        Pedaco *p = al->inativos.v[k];
+        int32_t x = intersecao(p, atual);
+        if (x < livreAte[p->reg]) livreAte[p->reg] = x;
+    }
+
+    if (atual->dica != SEM_REG && livreAte[atual->dica] >= ate) {
+        escolhido = atual->dica;
+    } else {
+        for (int r = 0; r < NALOCAVEIS && escolhido < 0; r++)
+            if (livreAte[alocaveis[r]] >= ate) escolhido = alocaveis[r];
+    }
+    if (escolhido < 0) {
+        int32_t melhor = -1;
+        for (int r = 0; r < NALOCAVEIS; r++) {
+            if (livreAte[alocaveis[r]] > melhor) {
+                melhor = livreAte[alocaveis[r]];
+                escolhido = alocaveis[r];
+            }
+        }
+        if (quadDe(melhor) <= inicio(atual)) return FALSE;
+        devolver(al, atual, quadDe(melhor));
+    }
+    atual->reg = (uint8_t)escolhido;
+    return TRUE;
+}
+
+/* O pedaço p, que tinha o registrador, vai para a pilha a partir de pos;
+   o que vem depois do próximo uso volta à fila */
+static void derramar(Alocador *al, Pedaco *p, int32_t pos) {
+    Pedaco *resto = p;
+    int32_t uso;
+
+    if (quadDe(pos) > inicio(p)) resto = dividir(al, p, quadDe(pos));
+    if (resto == NULL) return;
+    resto->reg = SEM_REG;
+    uso = proximoUso(resto, (pos > inicio(resto) ? pos : inicio(resto)) + 1);
+    if (uso != INFINITO && quadDe(uso) > pos) devolver(al, resto, quadDe(uso));
+}
+
+/* Sem registrador livre: vai para a pilha quem é usado mais tarde, o
+   atual ou os que ocupam o registrador cujo próximo uso está mais longe */
+static void alocarBloqueado(Alocador *al, Pedaco *atual) {
+    int32_t usoEm[16], bloqueioEm[16];
+    int32_t pos = inicio(atual), primeiro, melhor = -1;
+    int escolhido = -1;
+
+    for (int r = 0; r < NALOCAVEIS; r++) usoEm[alocaveis[r]] = bloqueioEm[alocaveis[r]] = INFINITO;
+    for (int k = 0; k < al->ativos.n; k++) {
+        Pedaco *p = al->ativos.v[k];
+        if (p->virtual < 0) {
+            usoEm[p->reg] = bloqueioEm[p->reg] = 0;
+        } else {
+            int32_t u = proximoUso(p, pos);
+            if (u < usoEm[p->reg]) usoEm[p->reg] = u;
+        }
+    }
+    for (int k = 0; k < al->inativos.n; k++) {
+        Pedaco *p = al->inativos.v[k];
+        int32_t x = intersecao(p, atual);
+
+        if (x == INFINITO) continue;
+        if (p->virtual < 0) {
+            if (x < bloqueioEm[p->reg]) bloqueioEm[p->reg] = x;
+            if (x < usoEm[p->reg]) usoEm[p->reg] = x;
+        } else {
+            int32_t u = proximoUso(p, pos);
+            if (u < usoEm[p->reg]) usoEm[p->reg] = u;
+        }
+    }
+
+    /* um registrador bloqueado por uma chamada logo no início não serve */
+    for (int r = 0; r < NALOCAVEIS; r++) {
+        RegX64 reg = alocaveis[r];
+        if (bloqueioEm[reg] != INFINITO && quadDe(bloqueioEm[reg]) <= pos) continue;
+        if (usoEm[reg] > melhor) {
+            melhor = usoEm[reg];
+            escolhido = reg;
+        }
+    }
+
+    primeiro = proximoUso(atual, pos);
+    if (escolhido < 0 || primeiro > melhor) {
+        atual->reg = SEM_REG;
+        if (primeiro != INFINITO) devolver(al, atual, quadDe(primeiro));
+        return;
+    }
+
+    atual->reg = (uint8_t)escolhido;
+    if (bloqueioEm[escolhido] < fim(atual)) devolver(al, atual, quadDe(bloqueioEm[escolhido]));
+    for (int k = 0; k < al->ativos.n;) {
+        Pedaco *p = al->ativos.v[k];
+        if (p->virtual >= 0 && p->reg == escolhido) {
+            remover(&al->ativos, k);
+            derramar(al, p, pos);
+        } else {
+            k++;
+        }
+    }
+    for (int k = 0; k < al->inativos.n;) {
+        Pedaco *p = al->inativos.v[k];
+        if (p->virtual >= 0 && p->reg == escolhido && intersecao(p, atual) != INFINITO) {
+            remover(&al->inativos, k);
+            derramar(al, p, pos);
+        } else {
+            k++;
+        }
+    }
+}
+
+static void varrer(Alocador *al) {
+    for (int32_t v = 0; v < al->a->nvirtuais; v++)
+        if (al->a->pedacos[v] != NULL) enfileirar(al, al->a->pedacos[v]);
+    fixarChamadas(al);
+
+    while (al->fila.n > 0) {
+        Pedaco *atual = desenfileirar(al);
+
+        avancar(al, inicio(atual));
+        if (!alocarLivre(al, atual)) alocarBloqueado(al, atual);
+        if (atual->reg != SEM_REG) acrescentar(&al->ativos, atual);
+    }
+}
+
+/* ---------------------- Movimentos ---------------------- */
+
+static void mover(Alocador *al, uint32_t quad, LadoMovimento lado, int32_t v, uint8_t de, uint8_t para) {
+    Movimento *m;
+
+    if (de == para) return;
+    if (al->nmov == al->capMov) {
+        uint32_t cap = al->capMov ? al->capMov * 2 : 64;
+        Movimento *novo = (Movimento *)arenaAlloc(cap * sizeof(Movimento));
+        if (al->nmov > 0) memcpy(novo, al->mov, al->nmov * sizeof(Movimento));
+        al->mov = novo;
+        al->capMov = cap;
+    }
+    m = &al->mov[al->nmov++];
+    m->quad = quad;
+    m->lado = (uint8_t)lado;
+    m->virtual = v;
+    m->de = de;
+    m->para = para;
+}
+
+static const Pedaco *pedacoEm(const Alocacao *a, int32_t v, int32_t pos) {
+    const Pedaco *p = a->pedacos[v];
+    while (p->proximo != NULL && p->proximo->divisao <= pos) p = p->proximo;
+    return p;
+}
+
+uint8_t registradorEm(const Alocacao *a, int32_t v, int32_t pos) {
+    if (a->pedacos[v] == NULL) return SEM_REG;
+    return pedacoEm(a, v, pos)->reg;
+}
+
+int vivoEm(const Alocacao *a, int32_t v, int32_t pos) {
+    for (const Pedaco *p = a->pedacos[v]; p != NULL; p = p->proximo)
+        if (cobre(p, pos)) return TRUE;
+    return FALSE;
+}
+
+/* Divisões no meio de um bloco, onde o virtual está vivo; as do início
+   de um bloco ficam para as arestas */
+static void moverDivisoes(Alocador *al, const uint8_t *inicioDeBloco) {
+    for (int32_t v = 0; v < al->a->nvirtuais; v++) {
+        for (const Pedaco *p = al->a->pedacos[v]; p != NULL && p->proximo != NULL; p = p->proximo) {
+            const Pedaco *q = p->proximo;
+            uint32_t quad = (uint32_t)(q->divisao / 4);
+
+            if (inicioDeBloco[quad] || !cobre(q, q->divisao)) continue;
+            mover(al, quad, MOV_ANTES, v, p->reg, q->reg);
+        }
+    }
+}
+
+/* Os virtuais vivos na entrada de s (só temporários: um argumento não
+   passa de um bloco) vão do lugar no fim de b para o lugar no início de s */
+static void moverAresta(Alocador *al, int b, int s, uint32_t quad, LadoMovimento lado) {
+    const BlocoBasico *bb = &al->f->blocos[b], *bs = &al->f->blocos[s];
+
+    for (int32_t v = 0; v < al->c->ntemps; v++) {
+        if (al->a->pedacos[v] == NULL || !vivoEm(al->a, v, POS_LEITURA(bs->inicio))) continue;
+        mover(al, quad, lado, v, registradorEm(al->a, v, POS_LEITURA(bb->fim) - 1),
+              registradorEm(al->a, v, POS_LEITURA(bs->inicio)));
+    }
+}
+
+static void resolverArestas(Alocador *al) {
+    const FuncaoCfg *f = al->f;
+
+    for (int b = 0; b < f->nblocos; b++) {
+        const BlocoBasico *bb = &f->blocos[b];
+        uint32_t ultima;
+
+        if (bb->fim == bb->inicio) continue;
+        ultima = bb->fim - 1;
+        switch ((OpIR)al->c->quads[ultima].op) {
+        case IR_GOTO:
+            moverAresta(al, b, bb->succ[0], ultima, MOV_FIM);
+            break;
+        case IR_IFFALSE:
+            moverAresta(al, b, bb->succ[0], ultima, MOV_DEPOIS);
+            if (bb->nsucc == 1) moverAresta(al, b, bb->succ[0], ultima, MOV_DESVIO);
+            else if (f->blocos[bb->succ[1]].npred == 1)
+                moverAresta(al, b, bb->succ[1], f->blocos[bb->succ[1]].inicio, MOV_DEPOIS);
+            else moverAresta(al, b, bb->succ[1], ultima, MOV_DESVIO);
+            break;
+        case IR_RETURN: case IR_ENDFUNC:
+            break;
+        default:
+            moverAresta(al, b, bb->succ[0], f->blocos[bb->succ[0]].inicio, MOV_FIM);
+            break;
+        }
+    }
+}
+
+/* Pela quádrupla e pelo lado, na ordem em que foram criados (contagem,
+   que é estável) */
+static void ordenarMovimentos(Alocador *al) {
+    uint32_t nchaves = 4 * al->c->n + 1;
+    uint32_t *conta = (uint32_t *)arenaAlloc((nchaves + 1) * sizeof(uint32_t));
+    Movimento *ordenados = (Movimento *)arenaAlloc((al->nmov + 1) * sizeof(Movimento));
+
+    for (uint32_t i = 0; i < al->nmov; i++) conta[4 * al->mov[i].quad + al->mov[i].lado + 1]++;
+    for (uint32_t k = 0; k < nchaves; k++) conta[k + 1] += conta[k];
+    for (uint32_t i = 0; i < al->nmov; i++) ordenados[conta[4 * al->mov[i].quad + al->mov[i].lado]++] = al->mov[i];
+    al->mov = ordenados;
+}
+
+/* ---------------------- Alocação ---------------------- */
+
+Alocacao *alocarRegistradores(const CodigoIR *trecho, const FuncaoCfg *f, const PedidoAlocacao *p) {
+    Alocador al;
+    Alocacao *a = (Alocacao *)arenaAlloc(sizeof(Alocacao));
+    uint8_t *inicioDeBloco;
+
+    memset(&al, 0, sizeof(al));
+    al.c = trecho;
+    al.f = f;
+    al.p = p;
+    al.a = a;
+    a->nvirtuais = p->nvirtuais;
+    a->pedacos = (Pedaco **)arenaAlloc((p->nvirtuais + 1) * sizeof(Pedaco *));
+    a->naPilha = (uint8_t *)arenaAlloc(p->nvirtuais + 1);
+
+    construirIntervalos(&al);
+    if (!p->tudoNaPilha) {
+        varrer(&al);
+        inicioDeBloco = (uint8_t *)arenaAlloc(trecho->n + 1);
+        for (int b = 0; b < f->nblocos; b++) inicioDeBloco[f->blocos[b].inicio] = 1;
+        moverDivisoes(&al, inicioDeBloco);
+        resolverArestas(&al);
+        ordenarMovimentos(&al);
+    }
+
+    for (int32_t v = 0; v < a->nvirtuais; v++) {
+        for (const Pedaco *pd = a->pedacos[v]; pd != NULL; pd = pd->proximo) {
+            if (pd->reg == SEM_REG) a->naPilha[v] = TRUE;
+            else a->usados |= 1u << pd->reg;
+        }
+        a->derramados += a->naPilha[v];
+    }
+    a->movimentos = al.mov;
+    a->nmovimentos = al.nmov;
+    return a;
+}
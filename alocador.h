@@ -0,0 +1,115 @@
+/* alocador.h - Alocação de registradores por varredura linear */
+
+#ifndef ALOCADOR_H
+#define ALOCADOR_H
+
+#include "globals.h"
+#include "ir.h"
+#include "cfg.h"
+#include "x64.h"
+
+#include <stdint.h>
+
+/*
+ * Alocação de Wimmer e Mössenböck (varredura linear com divisão de
+ * intervalos) sobre um trecho com uma função, em que as escalares locais
+ * já são temporários (x64.c). Os registradores virtuais são esses
+ * temporários e, depois deles, um por argumento escalar de chamada, vivo
+ * do param até a call.
+ *
+ * Cada quádrupla i tem quatro posições: a leitura dos operandos, a
+ * chamada (os registradores que ela destrói), a escrita do resultado e
+ * uma livre. A vida de um virtual é uma lista de faixas [de, ate) de
+ * posições, montada com a vivência na saída dos blocos (vida.h), com os
+ * buracos entre uma leitura e a próxima definição. As chamadas viram
+ * faixas fixas nos registradores que o System V deixa para quem chama,
+ * então o que está vivo sobre uma chamada fica num registrador salvo
+ * pela função (rbx, r12-r15) ou na pilha. Os argumentos e os parâmetros
+ * preferem o registrador de argumento do seu slot.
+ *
+ * Os intervalos são percorridos pelo início. Um registrador livre só por
+ * uma parte do intervalo fica com o começo, e o resto volta à fila; sem
+ * registrador livre, vai para a pilha o intervalo (o atual ou um dos
+ * ativos) cujo próximo uso está mais longe, dividido antes desse uso,
+ * que volta à fila. Cada pedaço está num registrador ou no lugar do
+ * virtual na pilha (um por virtual). As divisões no meio de um bloco
+ * viram movimentos ali; nas arestas entre blocos, os movimentos acertam
+ * o lugar de cada virtual vivo (fim do bloco, início do sucessor ou um
+ * trampolim no desvio de um if_false).
+ *
+ * rax, rcx e rdx ficam de fora: são os de trabalho da seleção (divisão,
+ * deslocamento, índices e movimentos em ciclo).
+ */
+
+/* Posições da quádrupla i */
+#define POS_LEITURA(i) (4 * (int32_t)(i))
+#define POS_CHAMADA(i) (4 * (int32_t)(i) + 1)
+#define POS_ESCRITA(i) (4 * (int32_t)(i) + 2)
+
+typedef struct {
+    int32_t de, ate;         /* posições [de, ate) */
+} Faixa;
+
+/* Um intervalo, ou um pedaço dele depois de uma divisão */
+typedef struct Pedaco {
+    Faixa *faixas;           /* em ordem */
+    int nfaixas, capFaixas;
+    int32_t *usos;           /* posições de leitura e escrita, em ordem */
+    int nusos, capUsos;
+    int32_t divisao;         /* posição da divisão que criou o pedaço; -1 no primeiro */
+    int32_t virtual;         /* -1: chamadas, fixo no registrador */
+    uint8_t reg;             /* RegX64; SEM_REG: na pilha */
+    uint8_t dica;            /* registrador preferido, ou SEM_REG */
+    struct Pedaco *proximo;  /* pedaço seguinte do mesmo virtual */
+} Pedaco;
+
+/* Onde fica um movimento, em relação à quádrupla */
+typedef enum {
+    MOV_ANTES,               /* antes dela: divisão no meio de um bloco */
+    MOV_FIM,                 /* fim do bloco anterior: antes do goto, ou antes do label na sequência */
+    MOV_DEPOIS,              /* depois do label (único predecessor) ou do if_false (sequência) */
+    MOV_DESVIO               /* no desvio do if_false, num trampolim */
+} LadoMovimento;
+
+/* Os movimentos de uma mesma quádrupla e lado são paralelos */
+typedef struct {
+    uint32_t quad;
+    uint8_t lado;            /* LadoMovimento */
+    uint8_t de, para;        /* RegX64; SEM_REG: o lugar do virtual na pilha */
+    int32_t virtual;
+} Movimento;
+
+typedef struct {
+    int nvirtuais;           /* temporários do trecho e, depois, os argumentos */
+    int nentrada;            /* virtuais 0 .. nentrada-1: definidos no func (parâmetros e locais) */
+    const int32_t *argumento;  /* por quádrupla param: virtual do argumento, ou -1 (array) */
+    const uint32_t *chamada;   /* por quádrupla param: a call que o consome */
+    const uint8_t *dica;       /* por virtual: registrador preferido, ou SEM_REG */
+    int tudoNaPilha;         /* linha de base: nenhum virtual em registrador */
+} PedidoAlocacao;
+
+typedef struct {
+    Pedaco **pedacos;        /* por virtual: o primeiro pedaço, NULL se não aparece */
+    int nvirtuais;
+    uint8_t *naPilha;        /* por virtual: algum pedaço na pilha */
+    Movimento *movimentos;   /* por quádrupla e lado */
+    uint32_t nmovimentos;
+    uint32_t usados;         /* máscara dos registradores usados (1 << RegX64) */
+    int presentes;           /* virtuais que aparecem */
+    int derramados;          /* virtuais com algum pedaço na pilha */
+    int divisoes;
+} Alocacao;
+
+/* Registradores da função trecho, com o grafo f (memória da arena) */
+Alocacao *alocarRegistradores(const CodigoIR *trecho, const FuncaoCfg *f, const PedidoAlocacao *p);
+
+/* Registrador do virtual v na posição pos; SEM_REG se está na pilha */
+uint8_t registradorEm(const Alocacao *a, int32_t v, int32_t pos);
+
+/* Verdadeiro se v está vivo na posição pos */
+int vivoEm(const Alocacao *a, int32_t v, int32_t pos);
+
+/* Registradores que uma chamada preserva (System V) */
+#define SALVO_PELA_FUNCAO(r) ((r) == RBX || (r) == RBP || (r) >= R12)
+
+#endif
@@ -3,233 +3,228 @@
 #include "globals.h"
 #include "symtab.h"
 #include "util.h"
-#include "analyze.h"
+#include "analyse.h"
+#include "nomes.h"
+#include "arena.h"
+#include "ast.h"
+#include "sessao.h"
 
 #include <stdlib.h>
 #include <string.h>
 
-static char *currentScope = "global";
-static int location = 0;
-static int hasMain = 0;  /* Flag para verificar se main existe */
-
-/* Lista temporária para rastrear símbolos declarados e metadados */
-typedef struct SymbolRec {
-    char *name;
-    char *scope;
-    ExpType type;
-
-    int isFunction;     /* 1 se for função, 0 caso contrário */
-    int paramCount;     /* quantidade de parâmetros se isFunction=1 */
-
-    struct SymbolRec *next;
-} SymbolRec;
-
-static SymbolRec *symbolList = NULL;
-
-/* Adiciona símbolo à lista */
-static void addSymbolEx(char *name, char *scope, ExpType type, int isFunction, int paramCount) {
-    SymbolRec *rec = (SymbolRec *)malloc(sizeof(SymbolRec));
-    rec->name = copyString(name);
-    rec->scope = copyString(scope);
-    rec->type = type;
-    rec->isFunction = isFunction;
-    rec->paramCount = paramCount;
-    rec->next = symbolList;
-    symbolList = rec;
-}
+/* Estado da análise na sessão corrente (globals.h) */
 
-static void addSymbol(char *name, char *scope, ExpType type) {
-    addSymbolEx(name, scope, type, 0, 0);
-}
+/* Nomes internados usados pela análise: todos os nomes e escopos
+   comparados aqui são representantes de nomes.h, comparados por identidade */
+#define nomeGlobal (sessaoAtual->analise.nomeGlobal)
+#define nomeMain   (sessaoAtual->analise.nomeMain)
+#define nomeInput  (sessaoAtual->analise.nomeInput)
+#define nomeOutput (sessaoAtual->analise.nomeOutput)
 
-static SymbolRec* findSymbolRecInScope(const char *name, const char *scope) {
-    SymbolRec *rec = symbolList;
-    while (rec != NULL) {
-        if (strcmp(rec->name, name) == 0 && strcmp(rec->scope, scope) == 0)
-            return rec;
-        rec = rec->next;
-    }
-    return NULL;
-}
+/* Árvore em análise */
+#define arvore (sessaoAtual->analise.arvore)
 
-static SymbolRec* findSymbolRecVisible(const char *name, const char *scope) {
-    /* procura no escopo atual, senão no global */
-    SymbolRec *rec = symbolList;
-    while (rec != NULL) {
-        if (strcmp(rec->name, name) == 0) {
-            if (strcmp(rec->scope, scope) == 0 || strcmp(rec->scope, "global") == 0)
-                return rec;
-        }
-        rec = rec->next;
-    }
-    return NULL;
-}
+#define currentScope (sessaoAtual->analise.currentScope)
+#define location     (sessaoAtual->analise.location)
+#define hasMain      (sessaoAtual->analise.hasMain)  /* Flag para verificar se main existe */
 
-static int symbolExistsInScope(char *name, char *scope) {
-    return findSymbolRecInScope(name, scope) != NULL;
-}
+/* Declaração de cada nó, indexada por nó: a resolvida nos usos (AssignK,
+   IdK, ArrIdK) e nas chamadas, e a criada nas declarações */
+#define simbolos (sessaoAtual->analise.simbolos)
+
+/* Corpo da função em análise: divide o escopo com os parâmetros */
+#define corpoFuncao (sessaoAtual->analise.corpoFuncao)
 
 /* ===== Helpers para contagem de parâmetros/argumentos ===== */
 
-static int countParams(TreeNode *paramsNode) {
+static int countParams(No paramsNode) {
     int count = 0;
-    TreeNode *p = paramsNode;
+    No p = paramsNode;
 
-    if (p == NULL) return 0;
+    if (p == NENHUM) return 0;
 
     /* caso típico de main(void): um ParamK "vazio" */
-    if (p->nodekind == StmtK && p->kind.stmt == ParamK) {
-        if (p->attr.name == NULL && p->type == Void) {
+    if (arvore->nos[p].nodekind == StmtK && arvore->nos[p].kind == ParamK) {
+        if (nomeNo(arvore, p) == NULL && arvore->nos[p].type == Void) {
             return 0;
         }
     }
 
-    while (p != NULL) {
-        if (p->nodekind == StmtK && p->kind.stmt == ParamK) {
-            if (p->attr.name != NULL) count++;
+    while (p != NENHUM) {
+        if (arvore->nos[p].nodekind == StmtK && arvore->nos[p].kind == ParamK) {
+            if (nomeNo(arvore, p) != NULL) count++;
         }
-        p = p->sibling;
+        p = arvore->nos[p].sibling;
     }
     return count;
 }
 
-static int countArgs(TreeNode *argsNode) {
+static int countArgs(No argsNode) {
     int count = 0;
-    TreeNode *a = argsNode;
-    while (a != NULL) {
+    No a = argsNode;
+    while (a != NENHUM) {
         count++;
-        a = a->sibling;
+        a = arvore->nos[a].sibling;
     }
     return count;
 }
 
+static SymbolRec *insertFunction(char *name, int lineno, ExpType type, int paramCount) {
+    SymbolRec *s = st_insert(name, lineno, location++, type, nomeGlobal);
+    s->isFunction = 1;
+    s->paramCount = paramCount;
+    return s;
+}
+
 /* Inserir funções built-in (input e output) */
 static void insertBuiltins(void) {
     /* input(): retorna int, 0 params */
-    st_insert("input", 0, location++, Integer, "global");
-    addSymbolEx("input", "global", Integer, 1, 0);
+    insertFunction(nomeInput, 0, Integer, 0);
 
     /* output(x): retorna void, 1 param */
-    st_insert("output", 0, location++, Void, "global");
-    addSymbolEx("output", "global", Void, 1, 1);
+    insertFunction(nomeOutput, 0, Void, 1);
 }
 
-/* Percorre a árvore em pré-ordem inserindo identificadores na tabela */
-static void traverse(TreeNode *t, void (*preProc)(TreeNode *),
-                    void (*postProc)(TreeNode *)) {
-    if (t != NULL) {
-        preProc(t);
-        for (int i = 0; i < MAXCHILDREN; i++)
-            traverse(t->child[i], preProc, postProc);
-        postProc(t);
-        traverse(t->sibling, preProc, postProc);
+/* Percorre a subárvore de t em pré-ordem inserindo identificadores na
+   tabela. Os nós estão em pré-ordem no vetor, então o percurso só avança
+   nele. */
+static void traverseNo(No t, void (*preProc)(No),
+                       void (*postProc)(No)) {
+    preProc(t);
+    for (int i = 0; i < arvore->nos[t].nfilhos; i++) {
+        No f = filhoNo(arvore, t, i);
+        while (f != NENHUM) {
+            traverseNo(f, preProc, postProc);
+            f = arvore->nos[f].sibling;
+        }
     }
+    postProc(t);
 }
 
-/* Pós-processamento para resetar escopo */
-static void afterNode(TreeNode *t) {
-    if (t != NULL && t->nodekind == StmtK && t->kind.stmt == FunDeclK) {
-        currentScope = "global";
+/* t e os seus irmãos */
+static void traverse(No t, void (*preProc)(No),
+                    void (*postProc)(No)) {
+    while (t != NENHUM) {
+        traverseNo(t, preProc, postProc);
+        t = arvore->nos[t].sibling;
     }
 }
 
-/* preProc para typeCheck (entra no escopo da função) */
-static void enterScopeForTypeCheck(TreeNode *t) {
-    if (t != NULL && t->nodekind == StmtK && t->kind.stmt == FunDeclK) {
-        currentScope = t->attr.name;
+static void nullProc(No t) {
+    (void)t;
+}
+
+/* Pós-processamento: fecha o escopo da função ou do bloco */
+static void afterNode(No t) {
+    if (arvore->nos[t].nodekind != StmtK) return;
+    if (arvore->nos[t].kind == FunDeclK) {
+        st_exit_scope();
+        currentScope = nomeGlobal;
+    } else if (arvore->nos[t].kind == CompoundK && t != corpoFuncao) {
+        st_exit_scope();
     }
 }
 
 /* Insere identificadores na tabela de símbolos */
-static void insertNode(TreeNode *t) {
-    switch (t->nodekind) {
+static void insertNode(No t) {
+    NoAst *n = &arvore->nos[t];
+
+    switch (n->nodekind) {
     case StmtK:
-        switch (t->kind.stmt) {
+        switch (n->kind) {
 
         case FunDeclK: {
-            if (symbolExistsInScope(t->attr.name, "global")) {
+            /* parâmetros e corpo ficam num escopo próprio, fechado em afterNode */
+            corpoFuncao = filhoNo(arvore, t, 1);
+
+            if (st_lookup_current(nomeNo(arvore, t)) != NULL) {
                 fprintf(listing,
                         "\nERRO SEMANTICO: funcao '%s' redeclarada - LINHA: %d\n",
-                        t->attr.name, t->lineno);
+                        nomeNo(arvore, t), n->lineno);
                 Error = TRUE;
+                st_enter_scope();
+                currentScope = nomeNo(arvore, t);
                 return;
             }
 
-            int nParams = countParams(t->child[0]);
+            int nParams = countParams(filhoNo(arvore, t, 0));
 
-            if (strcmp(t->attr.name, "main") == 0) {
+            if (nomeNo(arvore, t) == nomeMain) {
                 hasMain = 1;
 
-                if (t->type != Void) {
+                if (n->type != Void) {
                     fprintf(listing,
                             "\nERRO SEMANTICO: funcao 'main' deve retornar 'void', nao '%s' - LINHA: %d\n",
-                            t->type == Integer ? "int" : "outro tipo",
-                            t->lineno);
+                            n->type == Integer ? "int" : "outro tipo",
+                            n->lineno);
                     Error = TRUE;
                 }
 
                 if (nParams != 0) {
                     fprintf(listing,
                             "\nERRO SEMANTICO: funcao 'main' deve ser 'main(void)' (0 parametros), nao %d - LINHA: %d\n",
-                            nParams, t->lineno);
+                            nParams, n->lineno);
                     Error = TRUE;
                 }
             }
 
-            st_insert(t->attr.name, t->lineno, location++, t->type, "global");
-            addSymbolEx(t->attr.name, "global", t->type, 1, nParams);
+            simbolos[t] = insertFunction(nomeNo(arvore, t), n->lineno, n->type, nParams);
 
-            currentScope = t->attr.name;
+            st_enter_scope();
+            currentScope = nomeNo(arvore, t);
             break;
         }
 
         case VarDeclK:
-            if (symbolExistsInScope(t->attr.name, currentScope)) {
+            if (st_lookup_current(nomeNo(arvore, t)) != NULL) {
                 fprintf(listing,
                         "\nERRO SEMANTICO: variavel '%s' ja declarada no escopo '%s' - LINHA: %d\n",
-                        t->attr.name, currentScope, t->lineno);
+                        nomeNo(arvore, t), currentScope, n->lineno);
                 Error = TRUE;
                 return;
             }
-            st_insert(t->attr.name, t->lineno, location++, t->type, currentScope);
-            addSymbol(t->attr.name, currentScope, t->type);
+            simbolos[t] = st_insert(nomeNo(arvore, t), n->lineno, location++, n->type, currentScope);
             break;
 
         case ParamK:
-            if (t->attr.name != NULL) {
-                if (symbolExistsInScope(t->attr.name, currentScope)) {
+            if (nomeNo(arvore, t) != NULL) {
+                if (st_lookup_current(nomeNo(arvore, t)) != NULL) {
                     fprintf(listing,
                             "\nERRO SEMANTICO: parametro '%s' ja declarado na funcao '%s' - LINHA: %d\n",
-                            t->attr.name, currentScope, t->lineno);
+                            nomeNo(arvore, t), currentScope, n->lineno);
                     Error = TRUE;
                     return;
                 }
-                st_insert(t->attr.name, t->lineno, location++, t->type, currentScope);
-                addSymbol(t->attr.name, currentScope, t->type);
+                simbolos[t] = st_insert(nomeNo(arvore, t), n->lineno, location++, n->type, currentScope);
             }
             break;
 
+        case CompoundK:
+            if (t != corpoFuncao) st_enter_scope();
+            break;
+
         case AssignK: {
-            SymbolRec *rec = findSymbolRecVisible(t->attr.name, currentScope);
+            SymbolRec *rec = st_lookup(nomeNo(arvore, t));
 
+            simbolos[t] = rec;
             if (rec == NULL) {
                 fprintf(listing,
                         "\nERRO SEMANTICO: identificador '%s' nao declarado - LINHA: %d\n",
-                        t->attr.name, t->lineno);
+                        nomeNo(arvore, t), n->lineno);
                 Error = TRUE;
             }
             /* (1) não pode atribuir em função */
             else if (rec->isFunction) {
                 fprintf(listing,
                         "\nERRO SEMANTICO: atribuicao a funcao '%s' - LINHA: %d\n",
-                        t->attr.name, t->lineno);
+                        nomeNo(arvore, t), n->lineno);
                 Error = TRUE;
             }
             /* (2) não pode atribuir em array sem indice: v = 5; */
-            else if (rec->type == IntegerArray) {
+            else if (rec->type == IntegerArray && filhoNo(arvore, t, 0) == NENHUM) {
                 fprintf(listing,
                         "\nERRO SEMANTICO: atribuicao de indice ao array '%s' (use '%s[i] = ...') - LINHA: %d\n",
-                        t->attr.name, t->attr.name, t->lineno);
+                        nomeNo(arvore, t), nomeNo(arvore, t), n->lineno);
                 Error = TRUE;
             }
             break;
@@ -241,19 +236,21 @@ static void insertNode(TreeNode *t) {
         break;
 
     case ExpK:
-        switch (t->kind.exp) {
+        switch (n->kind) {
         case IdK:
         case ArrIdK: {
-            SymbolRec *rec = findSymbolRecVisible(t->attr.name, currentScope);
+            SymbolRec *rec = st_lookup(nomeNo(arvore, t));
+
+            simbolos[t] = rec;
             if (rec == NULL) {
                 fprintf(listing,
                         "\nERRO SEMANTICO: identificador '%s' nao declarado - LINHA: %d\n",
-                        t->attr.name, t->lineno);
+                        nomeNo(arvore, t), n->lineno);
                 Error = TRUE;
             } else {
-                st_insert(t->attr.name, t->lineno, 0, rec->type,
-                          (strcmp(rec->scope, "global") == 0 ? "global" : currentScope));
-                t->type = rec->type;
+                st_add_line(rec, n->lineno);
+                /* v[i] é um elemento: inteiro */
+                n->type = n->kind == ArrIdK ? Integer : rec->type;
             }
             break;
         }
@@ -267,39 +264,47 @@ static void insertNode(TreeNode *t) {
     }
 }
 
+/* Tipo do i-ésimo filho; Void se ele não existe (nos[NENHUM] é zerado) */
+static ExpType tipoFilho(No t, int i) {
+    return (ExpType)arvore->nos[filhoNo(arvore, t, i)].type;
+}
+
 /* Verifica tipos na árvore */
-static void checkNode(TreeNode *t) {
-    switch (t->nodekind) {
+static void checkNode(No t) {
+    NoAst *n = &arvore->nos[t];
+
+    switch (n->nodekind) {
     case ExpK:
-        switch (t->kind.exp) {
-        case OpK:
-            if (t->child[0] != NULL && t->child[1] != NULL) {
-                if (t->child[0]->type != Void && t->child[1]->type != Void) {
-                    if ((t->child[0]->type != Integer && t->child[0]->type != Boolean) ||
-                        (t->child[1]->type != Integer && t->child[1]->type != Boolean)) {
-                        fprintf(listing,
-                                "\nERRO SEMANTICO: operacao com tipo invalido - LINHA: %d\n",
-                                t->lineno);
-                        Error = TRUE;
-                    }
+        switch (n->kind) {
+        case OpK: {
+            TokenType op = opNo(arvore, t);
+
+            if (tipoFilho(t, 0) != Void && tipoFilho(t, 1) != Void) {
+                if ((tipoFilho(t, 0) != Integer && tipoFilho(t, 0) != Boolean) ||
+                    (tipoFilho(t, 1) != Integer && tipoFilho(t, 1) != Boolean)) {
+                    fprintf(listing,
+                            "\nERRO SEMANTICO: operacao com tipo invalido - LINHA: %d\n",
+                            n->lineno);
+                    Error = TRUE;
                 }
             }
 
-            if ((t->attr.op == EQ) || (t->attr.op == NE) ||
-                (t->attr.op == LT) || (t->attr.op == LE) ||
-                (t->attr.op == GT) || (t->attr.op == GE))
-                t->type = Boolean;
+            if ((op == EQ) || (op == NE) ||
+                (op == LT) || (op == LE) ||
+                (op == GT) || (op == GE))
+                n->type = Boolean;
             else
-                t->type = Integer;
+                n->type = Integer;
             break;
+        }
 
         case ConstK:
-            t->type = Integer;
+            n->type = Integer;
             break;
 
         case IdK:
         case ArrIdK:
-            if (t->type == Void) t->type = Integer;
+            if (n->type == Void) n->type = Integer;
             break;
 
         default:
@@ -308,30 +313,30 @@ static void checkNode(TreeNode *t) {
         break;
 
     case StmtK:
-        switch (t->kind.stmt) {
+        switch (n->kind) {
 
         case AssignK: {
             /* redundância de segurança: repete as regras aqui também */
-            SymbolRec *rec = findSymbolRecVisible(t->attr.name, currentScope);
+            SymbolRec *rec = simbolos[t];
             if (rec != NULL) {
                 if (rec->isFunction) {
                     fprintf(listing,
                             "\nERRO SEMANTICO: atribuicao a funcao '%s' - LINHA: %d\n",
-                            t->attr.name, t->lineno);
+                            nomeNo(arvore, t), n->lineno);
                     Error = TRUE;
-                } else if (rec->type == IntegerArray) {
+                } else if (rec->type == IntegerArray && filhoNo(arvore, t, 0) == NENHUM) {
                     fprintf(listing,
                             "\nERRO SEMANTICO: atribuicao de indice ao array '%s' (use '%s[i] = ...') - LINHA: %d\n",
-                            t->attr.name, t->attr.name, t->lineno);
+                            nomeNo(arvore, t), nomeNo(arvore, t), n->lineno);
                     Error = TRUE;
                 }
             }
 
-            if (t->child[1] != NULL && t->child[1]->type != Void) {
-                if (t->child[1]->type != Integer && t->child[1]->type != Boolean) {
+            if (tipoFilho(t, 1) != Void) {
+                if (tipoFilho(t, 1) != Integer && tipoFilho(t, 1) != Boolean) {
                     fprintf(listing,
                             "\nERRO SEMANTICO: atribuicao com tipo invalido - LINHA: %d\n",
-                            t->lineno);
+                            n->lineno);
                     Error = TRUE;
                 }
             }
@@ -339,49 +344,51 @@ static void checkNode(TreeNode *t) {
         }
 
         case IfK:
-            if (t->child[0] != NULL && t->child[0]->type != Void) {
-                if (t->child[0]->type != Boolean && t->child[0]->type != Integer) {
+            if (tipoFilho(t, 0) != Void) {
+                if (tipoFilho(t, 0) != Boolean && tipoFilho(t, 0) != Integer) {
                     fprintf(listing,
                             "\nERRO SEMANTICO: condicao do if deve ser booleana - LINHA: %d\n",
-                            t->lineno);
+                            n->lineno);
                     Error = TRUE;
                 }
             }
             break;
 
         case WhileK:
-            if (t->child[0] != NULL && t->child[0]->type != Void) {
-                if (t->child[0]->type != Boolean && t->child[0]->type != Integer) {
+            if (tipoFilho(t, 0) != Void) {
+                if (tipoFilho(t, 0) != Boolean && tipoFilho(t, 0) != Integer) {
                     fprintf(listing,
                             "\nERRO SEMANTICO: condicao do while deve ser booleana - LINHA: %d\n",
-                            t->lineno);
+                            n->lineno);
                     Error = TRUE;
                 }
             }
             break;
 
         case CallK: {
-            SymbolRec *f = findSymbolRecInScope(t->attr.name, "global");
+            SymbolRec *f = st_lookup_global(nomeNo(arvore, t));
             if (f == NULL || !f->isFunction) {
                 fprintf(listing,
                         "\nERRO SEMANTICO: chamada para funcao nao declarada '%s' - LINHA: %d\n",
-                        t->attr.name, t->lineno);
+                        nomeNo(arvore, t), n->lineno);
                 Error = TRUE;
-                t->type = Integer;
+                n->type = Integer;
                 break;
             }
 
-            int got = countArgs(t->child[0]);
+            simbolos[t] = f;
+
+            int got = countArgs(filhoNo(arvore, t, 0));
             int expected = f->paramCount;
 
             if (got != expected) {
                 fprintf(listing,
                         "\nERRO SEMANTICO: chamada da funcao '%s' com %d argumento(s), esperado %d - LINHA: %d\n",
-                        t->attr.name, got, expected, t->lineno);
+                        nomeNo(arvore, t), got, expected, n->lineno);
                 Error = TRUE;
             }
 
-            t->type = f->type;
+            n->type = f->type;
             break;
         }
 
@@ -395,26 +402,51 @@ static void checkNode(TreeNode *t) {
     }
 }
 
-void buildSymtab(TreeNode *syntaxTree) {
-    symbolList = NULL;
+/* Interna os nomes fixos da linguagem */
+static void internarNomesFixos(void) {
+    nomeGlobal = internar("global");
+    nomeMain = internar("main");
+    nomeInput = internar("input");
+    nomeOutput = internar("output");
+}
+
+void buildSymtab(ArvoreCompacta *a) {
+    arvore = a;
+    internarNomesFixos();
+    simbolos = (SymbolRec **)arenaAlloc(arvore->nnos * sizeof(SymbolRec *));
+    corpoFuncao = NENHUM;
     hasMain = 0;
     location = 0;
-    currentScope = "global";
+    currentScope = nomeGlobal;
 
     insertBuiltins();
-    traverse(syntaxTree, insertNode, afterNode);
+    traverse(arvore->raiz, insertNode, afterNode);
 
-    currentScope = "global";
+    currentScope = nomeGlobal;
 
     if (!hasMain) {
         fprintf(listing,
                 "\nERRO SEMANTICO: programa deve conter uma funcao 'void main(void)'\n");
         Error = TRUE;
     }
+    st_congelar();
+}
+
+/* As declarações globais são verificadas de forma independente: checkNode
+   só consulta a tabela e só altera os nós da própria declaração */
+static void verificarDeclaracao(int i, void *ctx) {
+    traverseNo(((No *)ctx)[i], nullProc, checkNode);
+}
+
+SymbolRec *simboloNo(No t) {
+    return simbolos[t];
 }
 
-void typeCheck(TreeNode *syntaxTree) {
-    currentScope = "global";
-    traverse(syntaxTree, enterScopeForTypeCheck, checkNode);
-    currentScope = "global";
+void typeCheck(ArvoreCompacta *a) {
+    No *decls;
+    int n;
+
+    arvore = a;
+    decls = declaracoesGlobais(arvore, &n);
+    paraCadaParalelo(n, verificarDeclaracao, decls);
 }
\ No newline at end of file
@@ -4,11 +4,17 @@
 #define ANALYZE_H
 
 #include "globals.h"
+#include "ast.h"
+#include "symtab.h"
 
 /* Constrói a tabela de símbolos */
-void buildSymtab(TreeNode *syntaxTree);
+void buildSymtab(ArvoreCompacta *arvore);
 
 /* Verifica tipos na árvore */
-void typeCheck(TreeNode *syntaxTree);
+void typeCheck(ArvoreCompacta *arvore);
+
+/* Declaração do nó após a análise: a declarada (FunDeclK, VarDeclK,
+   ParamK), a usada (AssignK, IdK, ArrIdK) ou a chamada (CallK) */
+SymbolRec *simboloNo(No t);
 
 #endif
\ No newline at end of file
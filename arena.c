@@ -0,0 +1,134 @@
+/*Alocador por região da compilação (arena.c)*/
+
+#include "globals.h"
+#include "arena.h"
+#include "sessao.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+#define ALINHAMENTO 16
+#define BLOCO_INICIAL (64 * 1024)
+#define BLOCO_MAXIMO (4 * 1024 * 1024)
+
+typedef struct BlocoArena {
+    struct BlocoArena *anterior;
+    size_t tamanho;
+    size_t usado;
+    /* os dados seguem o cabeçalho, alinhados */
+} BlocoArena;
+
+#define CABECALHO ((sizeof(BlocoArena) + ALINHAMENTO - 1) & ~(size_t)(ALINHAMENTO - 1))
+
+/* Arena da sessão corrente (globals.h); proximoTamanho 0 = BLOCO_INICIAL */
+#define blocoAtual      (sessaoAtual->arena.blocoAtual)
+#define proximoTamanho  (sessaoAtual->arena.proximoTamanho)
+#define chamadasMalloc  (sessaoAtual->arena.chamadasMalloc)
+#define bytesPedidos    (sessaoAtual->arena.bytesPedidos)
+#define bytesReservados (sessaoAtual->arena.bytesReservados)
+
+static void semMemoria(void) {
+    fprintf(stderr, "Erro: sem memoria\n");
+    abortarSessao(CM_ERRO_MEMORIA);
+}
+
+#ifdef SEM_ARENA
+
+void *arenaAlloc(size_t n) {
+    void *p = calloc(1, n ? n : 1);
+    if (p == NULL) semMemoria();
+    chamadasMalloc++;
+    bytesPedidos += n;
+    bytesReservados += n;
+    return p;
+}
+
+#else
+
+/* Novo bloco com pelo menos n bytes livres; os blocos dobram até BLOCO_MAXIMO */
+static void novoBloco(size_t n) {
+    size_t padrao = proximoTamanho ? proximoTamanho : BLOCO_INICIAL;
+    size_t tamanho = padrao;
+    BlocoArena *b;
+
+    if (tamanho < n) tamanho = n;
+    b = (BlocoArena *)calloc(1, CABECALHO + tamanho);
+    if (b == NULL) semMemoria();
+    chamadasMalloc++;
+    bytesReservados += CABECALHO + tamanho;
+
+    b->tamanho = tamanho;
+    b->usado = 0;
+    b->anterior = blocoAtual;
+    blocoAtual = b;
+    proximoTamanho = padrao < BLOCO_MAXIMO ? padrao * 2 : padrao;
+}
+
+void *arenaAlloc(size_t n) {
+    size_t alinhado = (n + ALINHAMENTO - 1) & ~(size_t)(ALINHAMENTO - 1);
+    void *p;
+
+    if (blocoAtual == NULL || blocoAtual->tamanho - blocoAtual->usado < alinhado)
+        novoBloco(alinhado);
+    p = (char *)blocoAtual + CABECALHO + blocoAtual->usado;
+    blocoAtual->usado += alinhado;
+    bytesPedidos += n;
+    return p;
+}
+
+#endif
+
+void liberarArena(void) {
+    while (blocoAtual != NULL) {
+        BlocoArena *anterior = blocoAtual->anterior;
+        free(blocoAtual);
+        blocoAtual = anterior;
+    }
+    proximoTamanho = 0;
+}
+
+void juntarArena(CompilerSession *filha) {
+    CompilerSession *pai = sessaoAtual;
+    BlocoArena *ultimo, *primeiro;
+    long chamadas;
+    size_t pedidos, reservados;
+
+    sessaoAtual = filha;
+    ultimo = blocoAtual;
+    chamadas = chamadasMalloc;
+    pedidos = bytesPedidos;
+    reservados = bytesReservados;
+    blocoAtual = NULL;
+    sessaoAtual = pai;
+
+    chamadasMalloc += chamadas;
+    bytesPedidos += pedidos;
+    bytesReservados += reservados;
+    if (ultimo == NULL) return;
+    /* a cadeia da filha entra logo atrás do bloco em uso */
+    for (primeiro = ultimo; primeiro->anterior != NULL; primeiro = primeiro->anterior)
+        ;
+    if (blocoAtual == NULL) {
+        blocoAtual = ultimo;
+    } else {
+        primeiro->anterior = blocoAtual->anterior;
+        blocoAtual->anterior = ultimo;
+    }
+}
+
+void imprimirEstatisticasMemoria(FILE *f) {
+    fprintf(f, "memoria: %ld chamada(s) a malloc, %zu bytes pedidos, %zu bytes reservados",
+            chamadasMalloc, bytesPedidos, bytesReservados);
+#ifndef _WIN32
+    {
+        struct rusage uso;
+        if (getrusage(RUSAGE_SELF, &uso) == 0)
+            fprintf(f, ", pico RSS %ld KB", uso.ru_maxrss);
+    }
+#endif
+    fprintf(f, "\n");
+}
@@ -0,0 +1,31 @@
+/* arena.h - Alocador por região da compilação */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+/*
+ * Tudo o que vive até o fim da compilação (nós da AST, nomes internados,
+ * tabela de símbolos, temporários do cgen) sai da arena da sessão corrente
+ * (globals.h), que é liberada de uma vez quando a sessão é destruída. A
+ * memória devolvida é zerada e alinhada a 16 bytes. Compilando com
+ * -DSEM_ARENA cada pedido vira um malloc nunca liberado, para comparar
+ * com o comportamento anterior. Sem memória, a fase em execução termina
+ * com CM_ERRO_MEMORIA (sessao.h).
+ */
+
+void *arenaAlloc(size_t n);
+
+/* Libera toda a arena da sessão corrente (destruirSessao) */
+void liberarArena(void);
+
+/* Passa os blocos da sessão filha (sessao.c) para a arena da sessão
+   corrente, que os libera junto com os seus */
+void juntarArena(struct CompilerSession *filha);
+
+/* Chamadas a malloc e bytes pedidos pela sessão corrente, e pico de RSS */
+void imprimirEstatisticasMemoria(FILE *f);
+
+#endif
@@ -0,0 +1,131 @@
+/*
+ * Árvore sintática compacta (ast.c)
+ *
+ * Uma primeira passada conta nós, palavras de extra e nomes, para que os
+ * três vetores saiam da arena com o tamanho exato; a segunda numera os
+ * nós em pré-ordem e copia os campos.
+ */
+
+#include "globals.h"
+#include "ast.h"
+#include "arena.h"
+
+/* Palavras de payload guardadas em extra depois dos filhos */
+static int payloadNo(TreeNode *t) {
+    if (t->nodekind == ExpK) {
+        switch (t->kind.exp) {
+        case ConstK: return 0;
+        default: return 1;   /* OpK: operador; IdK, ArrIdK: nome */
+        }
+    }
+    switch (t->kind.stmt) {
+    case VarDeclK: return 2;
+    case AssignK:
+    case FunDeclK:
+    case ParamK:
+    case CallK: return 1;
+    default: return 0;
+    }
+}
+
+static int temNome(TreeNode *t) {
+    return payloadNo(t) > 0 && !(t->nodekind == ExpK && t->kind.exp == OpK);
+}
+
+static int filhosUsados(TreeNode *t) {
+    int n = MAXCHILDREN;
+    while (n > 0 && t->child[n - 1] == NULL) n--;
+    return n;
+}
+
+static void contar(TreeNode *t, ArvoreCompacta *a) {
+    for (; t != NULL; t = t->sibling) {
+        int n = filhosUsados(t);
+        a->nnos++;
+        a->nextra += n + payloadNo(t);
+        if (temNome(t)) a->nnomes++;
+        for (int i = 0; i < n; i++) contar(t->child[i], a);
+    }
+}
+
+/* Copia a lista de irmãos iniciada em t; devolve o índice do primeiro */
+static No copiar(TreeNode *t, ArvoreCompacta *a) {
+    No primeiro = NENHUM, anterior = NENHUM;
+
+    for (; t != NULL; t = t->sibling) {
+        No n = a->nnos++;
+        NoAst *p = &a->nos[n];
+        int nfilhos = filhosUsados(t);
+        uint32_t base;
+
+        p->nodekind = (uint8_t)t->nodekind;
+        p->kind = (uint8_t)(t->nodekind == StmtK ? (int)t->kind.stmt : (int)t->kind.exp);
+        p->type = (uint8_t)t->type;
+        p->nfilhos = (uint8_t)nfilhos;
+        p->lineno = t->lineno;
+        p->sibling = NENHUM;
+
+        if (t->nodekind == ExpK && t->kind.exp == ConstK) {
+            p->dados = (uint32_t)t->attr.val;
+        } else {
+            base = a->nextra;
+            a->nextra += nfilhos + payloadNo(t);
+            p->dados = base;
+            if (t->nodekind == ExpK && t->kind.exp == OpK) {
+                a->extra[base + nfilhos] = (uint32_t)t->attr.op;
+            } else if (temNome(t)) {
+                uint32_t k = 0;
+                if (t->attr.name != NULL) {
+                    k = a->nnomes++;
+                    a->nomes[k] = t->attr.name;
+                }
+                a->extra[base + nfilhos] = k;
+                if (t->nodekind == StmtK && t->kind.stmt == VarDeclK)
+                    a->extra[base + nfilhos + 1] = (uint32_t)t->arraySize;
+            }
+            /* os filhos vêm logo depois do nó, em ordem */
+            for (int i = 0; i < nfilhos; i++)
+                a->extra[base + i] = copiar(t->child[i], a);
+        }
+
+        if (anterior != NENHUM) a->nos[anterior].sibling = n;
+        else primeiro = n;
+        anterior = n;
+    }
+    return primeiro;
+}
+
+ArvoreCompacta *compactarArvore(TreeNode *t) {
+    ArvoreCompacta *a = (ArvoreCompacta *)arenaAlloc(sizeof(ArvoreCompacta));
+    ArvoreCompacta total = {0};
+
+    total.nnos = 1;
+    total.nnomes = 1;
+    contar(t, &total);
+
+    a->nos = (NoAst *)arenaAlloc(total.nnos * sizeof(NoAst));
+    a->extra = (uint32_t *)arenaAlloc((total.nextra + 1) * sizeof(uint32_t));
+    a->nomes = (char **)arenaAlloc(total.nnomes * sizeof(char *));
+    a->nnos = 1;
+    a->nextra = 0;
+    a->nnomes = 1;
+    a->raiz = copiar(t, a);
+    return a;
+}
+
+size_t bytesArvoreCompacta(const ArvoreCompacta *a) {
+    return sizeof(ArvoreCompacta) + a->nnos * sizeof(NoAst) +
+           a->nextra * sizeof(uint32_t) + a->nnomes * sizeof(char *);
+}
+
+No *declaracoesGlobais(const ArvoreCompacta *a, int *n) {
+    No *v;
+    int k = 0;
+
+    for (No t = a->raiz; t != NENHUM; t = a->nos[t].sibling) k++;
+    v = (No *)arenaAlloc((k + 1) * sizeof(No));
+    k = 0;
+    for (No t = a->raiz; t != NENHUM; t = a->nos[t].sibling) v[k++] = t;
+    *n = k;
+    return v;
+}
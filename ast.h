@@ -0,0 +1,83 @@
+/* ast.h - Árvore sintática compacta */
+
+#ifndef AST_H
+#define AST_H
+
+#include "globals.h"
+
+#include <stdint.h>
+
+/*
+ * O parser constrói TreeNodes ligados por ponteiros; compactarArvore()
+ * copia a árvore para um único vetor de nós de 16 bytes endereçados por
+ * índices de 32 bits. Os nós ficam em pré-ordem (nó, subárvores dos
+ * filhos, irmão), que é a ordem em que a análise, o cgen e o DOT os
+ * visitam: os percursos andam sempre para frente na memória.
+ *
+ * Filhos e dados específicos de cada tipo de nó ficam no vetor extra, a
+ * partir de dados: primeiro os nfilhos índices de filhos (os filhos nulos
+ * do final não são guardados), depois o payload do nó:
+ *   OpK                 operador (TokenType)
+ *   nós com nome        índice em nomes (0 = sem nome)
+ *   VarDeclK            índice do nome, tamanho do array
+ * Em ConstK não há payload: dados é o próprio valor.
+ */
+
+typedef uint32_t No;
+
+#define NENHUM ((No)0)       /* nos[0] não é usado */
+
+typedef struct {
+    uint8_t nodekind;        /* NodeKind */
+    uint8_t kind;            /* StmtKind ou ExpKind */
+    uint8_t type;            /* ExpType; a análise o atualiza */
+    uint8_t nfilhos;
+    int32_t lineno;
+    uint32_t dados;          /* início em extra, ou o valor de ConstK */
+    No sibling;
+} NoAst;
+
+typedef struct ArvoreCompacta {
+    NoAst *nos;
+    uint32_t *extra;
+    char **nomes;            /* nomes internados; nomes[0] == NULL */
+    uint32_t nnos;           /* inclui nos[0] */
+    uint32_t nextra;
+    uint32_t nnomes;
+    No raiz;                 /* NENHUM se o programa é vazio */
+} ArvoreCompacta;
+
+/* Copia a árvore do parser para a forma compacta (memória da arena) */
+ArvoreCompacta *compactarArvore(TreeNode *t);
+
+/* Bytes ocupados pelos vetores da árvore compacta */
+size_t bytesArvoreCompacta(const ArvoreCompacta *a);
+
+/* Declarações do nível global, em ordem (vetor na arena) */
+No *declaracoesGlobais(const ArvoreCompacta *a, int *n);
+
+static inline No filhoNo(const ArvoreCompacta *a, No n, int i) {
+    const NoAst *p = &a->nos[n];
+    return i < p->nfilhos ? a->extra[p->dados + i] : NENHUM;
+}
+
+static inline char *nomeNo(const ArvoreCompacta *a, No n) {
+    const NoAst *p = &a->nos[n];
+    return a->nomes[a->extra[p->dados + p->nfilhos]];
+}
+
+static inline TokenType opNo(const ArvoreCompacta *a, No n) {
+    const NoAst *p = &a->nos[n];
+    return (TokenType)a->extra[p->dados + p->nfilhos];
+}
+
+static inline int tamanhoArrayNo(const ArvoreCompacta *a, No n) {
+    const NoAst *p = &a->nos[n];
+    return (int)a->extra[p->dados + p->nfilhos + 1];
+}
+
+static inline int valorNo(const ArvoreCompacta *a, No n) {
+    return (int)a->nos[n].dados;
+}
+
+#endif
@@ -0,0 +1,1077 @@
+/*
+ * Micro-benchmarks e verificações do compilador C-
+ *
+ * Uso: cminus-bench scan <arquivo.cm> [MB]
+ *      cminus-bench difscan <arquivo.cm>...
+ *      cminus-bench ast <arquivo.cm> [nos]
+ *      cminus-bench symtab [simbolos]
+ *      cminus-bench temps [comandos] <arquivo.cm>...
+ *      cminus-bench valores [comandos] <arquivo.cm>...
+ *      cminus-bench vm <arquivo.cm>...
+ *      cminus-bench nativo <arquivo.cm>...
+ *      cminus-bench jit <arquivo.cm>...
+ */
+
+#define _GNU_SOURCE     /* fopencookie */
+
+#include "globals.h"
+#include "util.h"
+#include "scan.h"
+#include "scansimd.h"
+#include "parse.h"
+#include "ast.h"
+#include "arena.h"
+#include "symtab.h"
+#include "nomes.h"
+#include "sessao.h"
+#include "ir.h"
+#include "interp.h"
+#include "vm.h"
+#include "x64.h"
+#include "jit.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* Os benchmarks chamam os módulos diretamente, na sessão corrente */
+static FILE *saidaDescartada;
+
+/* Descarta a sessão corrente (fonte, arena e tabelas) e abre outra */
+static void novaSessao(void) {
+    destruirSessao(sessaoAtual);
+    sessaoAtual = criarSessao(saidaDescartada);
+    if (sessaoAtual == NULL) {
+        fprintf(stderr, "Erro: sem memoria\n");
+        exit(1);
+    }
+}
+
+static double agora(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Lê o arquivo e o repete até atingir alvo bytes; o buffer termina em '\0' */
+static char *replicarArquivo(const char *nome, long alvo, long *total) {
+    FILE *f = fopen(nome, "rb");
+    char *orig, *buf;
+    long n, t = 0;
+
+    if (f == NULL) {
+        fprintf(stderr, "Erro: Arquivo %s nao encontrado\n", nome);
+        exit(1);
+    }
+    fseek(f, 0, SEEK_END);
+    n = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    orig = (char *)malloc(n + 1);
+    if (orig == NULL || fread(orig, 1, n, f) != (size_t)n) {
+        fprintf(stderr, "Erro: falha ao ler %s\n", nome);
+        exit(1);
+    }
+    fclose(f);
+
+    if (alvo < n) alvo = n;
+    buf = (char *)malloc(alvo + n + 1);
+    if (buf == NULL) {
+        fprintf(stderr, "Erro: sem memoria\n");
+        exit(1);
+    }
+    while (t < alvo) {
+        memcpy(buf + t, orig, n);
+        t += n;
+    }
+    buf[t] = '\0';
+    free(orig);
+    *total = t;
+    return buf;
+}
+
+/* Sequência de tokens (token, fatia e linha) e diagnósticos de um scanner,
+   como texto, para comparação byte a byte */
+static char *listarTokens(TokenType (*scanner)(void), const char *buf, long n, size_t *tam) {
+    FILE *anterior = listing;
+    char *saida = NULL;
+    TokenType tok;
+
+    listing = open_memstream(&saida, tam);
+    usarFonteMemoria(buf, n);
+    Error = FALSE;
+    do {
+        tok = scanner();
+        fprintf(listing, "%d %ld %d %d\n", tok, inicioToken, tamanhoToken, linhaAtual);
+    } while (tok != ENDFILE);
+    fprintf(listing, "Error=%d\n", Error);
+    fclose(listing);
+    listing = anterior;
+    return saida;
+}
+
+/* Compara a referência com o scanner por tabela em todos os níveis de
+   kernel suportados; buf é copiado para cada alinhamento de 0 a 31 */
+static int compararScanners(const char *nome, const char *fonte, long n) {
+    static const char *nomes[] = {"escalar", "sse2", "avx2"};
+    char *area = (char *)malloc(n + 64);
+    int falhas = 0;
+
+    for (int desl = 0; desl < 32; desl++) {
+        char *buf = area + desl;
+        size_t tamRef, tam;
+        char *ref;
+
+        memcpy(buf, fonte, n);
+        buf[n] = '\0';
+        ref = listarTokens(getTokenReferencia, buf, n, &tamRef);
+        for (int nivel = SIMD_ESCALAR; nivel <= SIMD_AVX2; nivel++) {
+            char *saida;
+            if ((int)escolherKernelsScanner((NivelSimd)nivel) != nivel) continue;
+            saida = listarTokens(getToken, buf, n, &tam);
+            if (tam != tamRef || memcmp(saida, ref, tam) != 0) {
+                if (falhas++ == 0)
+                    fprintf(stderr, "difscan: %s diverge (kernel %s, alinhamento %d)\n",
+                            nome, nomes[nivel], desl);
+            }
+            free(saida);
+        }
+        free(ref);
+    }
+    escolherKernelsScanner(SIMD_AUTO);
+    free(area);
+    return falhas;
+}
+
+static unsigned semente = 12345;
+
+static int aleatorio(int limite) {
+    semente = semente * 1103515245u + 12345u;
+    return (int)((semente >> 16) % (unsigned)limite);
+}
+
+/* Entradas geradas que atravessam as bordas de 16/32 bytes dos kernels */
+static int compararGerados(void) {
+    static const char alfabeto[] = "ab zX09\n\t=!<>/*+-();,[]{}\r#";
+    char buf[512], nome[64];
+    int falhas = 0, n;
+
+    for (int caso = 0; caso < 300; caso++) {
+        n = aleatorio(200);
+        for (int i = 0; i < n; i++) buf[i] = alfabeto[aleatorio((int)sizeof(alfabeto) - 1)];
+        if (caso % 10 == 0 && n > 0) buf[aleatorio(n)] = '\0';   /* NUL no meio do fonte */
+        snprintf(nome, sizeof(nome), "aleatorio #%d", caso);
+        falhas += compararScanners(nome, buf, n);
+    }
+
+    for (int tam = 1; tam <= 70; tam++) {
+        n = 0;
+        for (int i = 0; i < tam; i++) buf[n++] = (i % 7 == 3) ? '\n' : ' ';
+        for (int i = 0; i < tam; i++) buf[n++] = (char)((i % 3 == 2) ? '0' + i % 10 : 'a' + i % 26);
+        n += snprintf(buf + n, sizeof(buf) - n, " /*");
+        for (int i = 0; i < tam; i++) buf[n++] = (i % 5 == 4) ? '\n' : (i % 9 == 8 ? '*' : 'c');
+        n += snprintf(buf + n, sizeof(buf) - n, "**/x%s", tam % 2 ? "/* aberto" : "");
+        snprintf(nome, sizeof(nome), "sequencias de %d", tam);
+        falhas += compararScanners(nome, buf, n);
+    }
+    return falhas;
+}
+
+static int difScan(int narq, char *arquivos[]) {
+    int falhas = 0;
+
+    for (int i = 0; i < narq; i++) {
+        long n;
+        char *buf = replicarArquivo(arquivos[i], 0, &n);
+        falhas += compararScanners(arquivos[i], buf, n);
+        free(buf);
+    }
+    falhas += compararGerados();
+
+    printf("difscan: %d arquivo(s) e entradas geradas, %s\n", narq,
+           falhas ? "DIVERGENCIAS" : "sequencias de tokens identicas");
+    return falhas ? 1 : 0;
+}
+
+static double medirScanner(TokenType (*scanner)(void), const char *buf, long n, long *ntokens) {
+    double t0;
+    long count = 0;
+
+    usarFonteMemoria(buf, n);
+    t0 = agora();
+    while (scanner() != ENDFILE) count++;
+    *ntokens = count + 1;
+    return agora() - t0;
+}
+
+static void benchScan(const char *arquivo, long mb) {
+    static const char *nomes[] = {"escalar", "sse2", "avx2"};
+    long n, tokRef, tok;
+    char *buf = replicarArquivo(arquivo, mb * 1024 * 1024, &n);
+    double tRef, t;
+
+    tRef = medirScanner(getTokenReferencia, buf, n, &tokRef);
+    printf("scan: %s replicado para %.1f MB, %ld tokens\n", arquivo, n / (1024.0 * 1024.0), tokRef);
+    printf("  %-16s %8.3f s  %8.2f Mtokens/s  %8.1f MB/s\n", "switch",
+           tRef, tokRef / tRef / 1e6, n / tRef / (1024.0 * 1024.0));
+
+    for (int nivel = SIMD_ESCALAR; nivel <= SIMD_AVX2; nivel++) {
+        char nome[32];
+        if ((int)escolherKernelsScanner((NivelSimd)nivel) != nivel) continue;
+        t = medirScanner(getToken, buf, n, &tok);
+        if (tok != tokRef) {
+            fprintf(stderr, "Erro: os scanners divergem em %s\n", arquivo);
+            exit(1);
+        }
+        snprintf(nome, sizeof(nome), "tabela/%s", nomes[nivel]);
+        printf("  %-16s %8.3f s  %8.2f Mtokens/s  %8.1f MB/s  %5.2fx\n", nome,
+               t, tok / t / 1e6, n / t / (1024.0 * 1024.0), tRef / t);
+    }
+    escolherKernelsScanner(SIMD_AUTO);
+    free(buf);
+}
+
+/* Percursos com o mesmo trabalho por nó e a mesma ordem de visita que
+   traverse() em analyse.c; o total confere que as duas árvores são iguais */
+static unsigned long percorrerPonteiros(TreeNode *t) {
+    unsigned long soma = 0;
+    for (; t != NULL; t = t->sibling) {
+        soma += (unsigned long)t->lineno * 31 + t->type * 7 + t->nodekind;
+        for (int i = 0; i < MAXCHILDREN; i++)
+            if (t->child[i] != NULL) soma += percorrerPonteiros(t->child[i]);
+    }
+    return soma;
+}
+
+static unsigned long percorrerCompacta(const ArvoreCompacta *a, No t) {
+    unsigned long soma = 0;
+    for (; t != NENHUM; t = a->nos[t].sibling) {
+        const NoAst *p = &a->nos[t];
+        soma += (unsigned long)p->lineno * 31 + p->type * 7 + p->nodekind;
+        for (int i = 0; i < p->nfilhos; i++)
+            if (filhoNo(a, t, i) != NENHUM) soma += percorrerCompacta(a, filhoNo(a, t, i));
+    }
+    return soma;
+}
+
+/* Passadas que não dependem da estrutura varrem o vetor em sequência */
+static unsigned long varrerCompacta(const ArvoreCompacta *a) {
+    unsigned long soma = 0;
+    for (No t = 1; t < a->nnos; t++)
+        soma += (unsigned long)a->nos[t].lineno * 31 + a->nos[t].type * 7 + a->nos[t].nodekind;
+    return soma;
+}
+
+static long contarNos(TreeNode *t) {
+    long n = 0;
+    for (; t != NULL; t = t->sibling) {
+        n++;
+        for (int i = 0; i < MAXCHILDREN; i++) n += contarNos(t->child[i]);
+    }
+    return n;
+}
+
+static TreeNode *analisarBuffer(const char *buf, long n) {
+    usarFonteMemoria(buf, n);
+    return parse();
+}
+
+static void benchAst(const char *arquivo, long alvo) {
+    const int repeticoes = 10;
+    long n, nos, copias;
+    char *buf = replicarArquivo(arquivo, 0, &n);
+    TreeNode *arvore;
+    ArvoreCompacta *compacta;
+    unsigned long somaP = 0, somaC = 0, somaV = 0;
+    double t0, tP = 1e30, tC = 1e30, tV = 1e30, tCompactar;
+    size_t bytesP, bytesC;
+
+    /* replica o fonte até a árvore ter pelo menos alvo nós */
+    nos = contarNos(analisarBuffer(buf, n));
+    free(buf);
+    novaSessao();
+    if (nos == 0) {
+        fprintf(stderr, "Erro: %s nao produziu nenhum no\n", arquivo);
+        exit(1);
+    }
+    copias = (alvo + nos - 1) / nos;
+    buf = replicarArquivo(arquivo, n * copias, &n);
+    arvore = analisarBuffer(buf, n);
+    if (Error) {
+        fprintf(stderr, "Erro: %s tem erros de sintaxe\n", arquivo);
+        exit(1);
+    }
+    nos = contarNos(arvore);
+
+    t0 = agora();
+    compacta = compactarArvore(arvore);
+    tCompactar = agora() - t0;
+
+    for (int r = 0; r < repeticoes; r++) {
+        double t;
+        t0 = agora();
+        somaP = percorrerPonteiros(arvore);
+        if ((t = agora() - t0) < tP) tP = t;
+        t0 = agora();
+        somaC = percorrerCompacta(compacta, compacta->raiz);
+        if ((t = agora() - t0) < tC) tC = t;
+        t0 = agora();
+        somaV = varrerCompacta(compacta);
+        if ((t = agora() - t0) < tV) tV = t;
+    }
+    if (somaP != somaC || somaC != somaV || (long)compacta->nnos - 1 != nos) {
+        fprintf(stderr, "Erro: as arvores divergem em %s\n", arquivo);
+        exit(1);
+    }
+
+    bytesP = (size_t)nos * sizeof(TreeNode);
+    bytesC = bytesArvoreCompacta(compacta);
+    printf("ast: %s replicado %ld vezes, %ld nos\n", arquivo, copias, nos);
+    printf("  %-22s %5zu bytes/no  %8.1f MB\n", "TreeNode (ponteiros)",
+           sizeof(TreeNode), bytesP / (1024.0 * 1024.0));
+    printf("  %-22s %5.1f bytes/no  %8.1f MB  (no %zu + extra %.1f + nomes %.1f)\n",
+           "compacta (indices)", (double)bytesC / nos, bytesC / (1024.0 * 1024.0),
+           sizeof(NoAst), compacta->nextra * sizeof(uint32_t) / (double)nos,
+           compacta->nnomes * sizeof(char *) / (double)nos);
+    printf("  compactar            %8.3f ms\n", tCompactar * 1e3);
+    printf("  percurso ponteiros   %8.3f ms  %6.1f ns/no\n", tP * 1e3, tP * 1e9 / nos);
+    printf("  percurso compacta    %8.3f ms  %6.1f ns/no  %5.2fx\n", tC * 1e3, tC * 1e9 / nos, tP / tC);
+    printf("  varredura compacta   %8.3f ms  %6.1f ns/no  %5.2fx\n", tV * 1e3, tV * 1e9 / nos, tP / tV);
+    free(buf);
+    novaSessao();
+}
+
+/* Nomes como os de programas reais: prefixos comuns e sufixos variados */
+static char **gerarNomes(long n, const char *prefixo) {
+    static const char *raizes[] = {"contador", "i", "valor", "tmp", "indiceVetor", "x", "soma", "aux"};
+    char **nomes = (char **)malloc(n * sizeof(char *));
+    char buf[64];
+
+    for (long i = 0; i < n; i++) {
+        snprintf(buf, sizeof(buf), "%s%s%ld", prefixo, raizes[i % 8], i / 8);
+        nomes[i] = internar(buf);
+    }
+    return nomes;
+}
+
+static void benchSymtab(long n) {
+    char **declarados = gerarNomes(n, "");
+    char **ausentes = gerarNomes(n, "nao");
+    char *escopo = internar("global");
+    long achados = 0;
+    double t0, tInsere, tBusca, tFalha, tLinhas, tEscopo;
+
+    t0 = agora();
+    for (long i = 0; i < n; i++) st_insert(declarados[i], (int)i, (int)i, Integer, escopo);
+    tInsere = agora() - t0;
+
+    t0 = agora();
+    for (long i = 0; i < n; i++) achados += st_lookup(declarados[(i * 7919) % n]) != NULL;
+    tBusca = agora() - t0;
+
+    t0 = agora();
+    for (long i = 0; i < n; i++) achados -= st_lookup(ausentes[i]) != NULL;
+    tFalha = agora() - t0;
+
+    /* cada símbolo aparece em 8 linhas */
+    t0 = agora();
+    for (int k = 0; k < 8; k++)
+        for (long i = 0; i < n; i++) st_add_line(st_lookup(declarados[i]), k);
+    tLinhas = agora() - t0;
+
+    /* um escopo aninhado oculta todos os nomes e depois é fechado */
+    t0 = agora();
+    st_enter_scope();
+    for (long i = 0; i < n; i++) st_insert(declarados[i], 0, 0, Integer, escopo);
+    st_exit_scope();
+    tEscopo = agora() - t0;
+
+    if (achados != n || st_lookup(declarados[0])->memloc != 0) {
+        fprintf(stderr, "Erro: a tabela de simbolos perdeu declaracoes\n");
+        exit(1);
+    }
+
+    printf("symtab: %ld simbolos\n", n);
+    printf("  insercao             %8.1f ms  %6.1f ns/simbolo\n", tInsere * 1e3, tInsere * 1e9 / n);
+    printf("  busca (presente)     %8.1f ms  %6.1f ns/simbolo\n", tBusca * 1e3, tBusca * 1e9 / n);
+    printf("  busca (ausente)      %8.1f ms  %6.1f ns/simbolo\n", tFalha * 1e3, tFalha * 1e9 / n);
+    printf("  8 usos por simbolo   %8.1f ms  %6.1f ns/uso\n", tLinhas * 1e3, tLinhas * 1e9 / (8.0 * n));
+    printf("  escopo aninhado      %8.1f ms  %6.1f ns/simbolo\n", tEscopo * 1e3, tEscopo * 1e9 / n);
+    free(declarados);
+    free(ausentes);
+    novaSessao();
+}
+
+/* ---------------- Temporários e instruções do código intermediário ---------------- */
+
+/* Expressão aleatória com até prof níveis de operadores */
+static int gerarExpressao(char *buf, int prof) {
+    static const char *folhas[] = {"a", "b", "c", "d", "p", "1", "2", "7"};
+    static const char *ops[] = {"+", "-", "*", "<", "=="};
+    int n;
+
+    if (prof == 0 || aleatorio(4) == 0) return sprintf(buf, "%s", folhas[aleatorio(8)]);
+    n = sprintf(buf, "(");
+    n += gerarExpressao(buf + n, prof - 1);
+    n += sprintf(buf + n, " %s ", ops[aleatorio(5)]);
+    n += gerarExpressao(buf + n, prof - 1);
+    return n + sprintf(buf + n, ")");
+}
+
+/* Uma função com comandos atribuições, ifs e whiles, e um main */
+static char *gerarPrograma(long comandos, long *tam) {
+    size_t cap = (size_t)comandos * 160 + 256;
+    char *buf = (char *)malloc(cap);
+    long n;
+
+    if (buf == NULL) {
+        fprintf(stderr, "Erro: sem memoria\n");
+        exit(1);
+    }
+    n = sprintf(buf, "int f(int p) {\n    int a; int b; int c; int d;\n    a = p; b = 1; c = 2; d = 3;\n");
+    for (long i = 0; i < comandos; i++) {
+        static const char *vars[] = {"a", "b", "c", "d"};
+        int tipo = aleatorio(10);
+
+        n += sprintf(buf + n, "    ");
+        if (tipo == 0) {
+            n += sprintf(buf + n, "if (");
+            n += gerarExpressao(buf + n, 2);
+            n += sprintf(buf + n, ") %s = ", vars[aleatorio(4)]);
+        } else if (tipo == 1) {
+            n += sprintf(buf + n, "while (%s < 0) %s = ", vars[aleatorio(4)], vars[aleatorio(4)]);
+        } else {
+            n += sprintf(buf + n, "%s = ", vars[aleatorio(4)]);
+        }
+        n += gerarExpressao(buf + n, 3);
+        n += sprintf(buf + n, ";\n");
+    }
+    n += sprintf(buf + n, "    return a + b + c + d;\n}\n\nvoid main(void) {\n    output(f(input()));\n}\n");
+    *tam = n;
+    return buf;
+}
+
+/* Código intermediário de buf, com ou sem as otimizações (NULL se o
+   programa tem erros) */
+static CodigoIR *traduzir(const char *buf, long n, int otimizar, double *t) {
+    double t0 = agora();
+
+    novaSessao();
+    sessaoAtual->otimizar = otimizar;
+    if (sessaoCarregarMemoria(sessaoAtual, buf, (size_t)n) != CM_OK || sessaoParse(sessaoAtual) != CM_OK ||
+        sessaoAnalisar(sessaoAtual) != CM_OK || sessaoGerarCodigo(sessaoAtual, saidaDescartada) != CM_OK)
+        return NULL;
+    *t = agora() - t0;
+    return sessaoAtual->ir;
+}
+
+static void medirTemps(const char *nome, const char *buf, long n) {
+    double t;
+
+    printf("  %-24s", nome);
+    for (int otimizar = 0; otimizar <= 1; otimizar++) {
+        CodigoIR *c = traduzir(buf, n, otimizar, &t);
+        if (c == NULL) {
+            printf("  (erros de compilacao)\n");
+            return;
+        }
+        printf("  %9u %7d %8.2f", c->n, c->ntemps, t * 1e3);
+    }
+    printf("\n");
+}
+
+static void benchTemps(long comandos, int narq, char *arquivos[]) {
+    char nome[64];
+    long n;
+    char *buf;
+
+    printf("temps: quadruplas, temporarios distintos e tempo de compilacao (ms)\n");
+    printf("  %-24s  %9s %7s %8s  %9s %7s %8s\n", "", "quads", "temps", "ms", "quads -O", "temps", "ms");
+    for (int i = 0; i < narq; i++) {
+        buf = replicarArquivo(arquivos[i], 0, &n);
+        medirTemps(arquivos[i], buf, n);
+        free(buf);
+    }
+    buf = gerarPrograma(comandos, &n);
+    snprintf(nome, sizeof(nome), "gerado (%ld comandos)", comandos);
+    medirTemps(nome, buf, n);
+    free(buf);
+    novaSessao();
+}
+
+/* ---------------- Numeração de valores ---------------- */
+
+/* Índice ou operando de um programa com arrays: as leituras se repetem
+   entre os comandos, como em sort() e minloc() */
+static int gerarLeitura(char *buf) {
+    static const char *arrays[] = {"w", "w", "u", "g"};
+    static const char *indices[] = {"i", "j", "i + 1", "0"};
+    static const char *escalares[] = {"a", "b", "i", "j"};
+
+    if (aleatorio(3) == 0) return sprintf(buf, "%s", escalares[aleatorio(4)]);
+    return sprintf(buf, "%s[%s]", arrays[aleatorio(4)], indices[aleatorio(4)]);
+}
+
+static int gerarOperacao(char *buf) {
+    static const char *ops[] = {"+", "-", "*", "<"};
+    int n = gerarLeitura(buf);
+
+    n += sprintf(buf + n, " %s ", ops[aleatorio(4)]);
+    return n + gerarLeitura(buf + n);
+}
+
+/* Uma função que recebe um array e tem um local, e um main que a chama
+   com um global; 1 em 8 comandos escreve num array */
+static char *gerarProgramaArrays(long comandos, long *tam) {
+    size_t cap = (size_t)comandos * 96 + 256;
+    char *buf = (char *)malloc(cap);
+    long n;
+
+    if (buf == NULL) {
+        fprintf(stderr, "Erro: sem memoria\n");
+        exit(1);
+    }
+    n = sprintf(buf, "int g[100];\n\nint f(int w[], int i, int j) {\n    int a; int b; int u[100];\n"
+                     "    a = 0; b = 1;\n");
+    for (long k = 0; k < comandos; k++) {
+        static const char *destinos[] = {"a", "b", "a", "b", "a", "b", "u[i]", "w[j]"};
+        int tipo = aleatorio(4);
+
+        n += sprintf(buf + n, "    ");
+        if (tipo == 0) {
+            n += sprintf(buf + n, "if (");
+            n += gerarOperacao(buf + n);
+            n += sprintf(buf + n, ") ");
+        }
+        n += sprintf(buf + n, "%s = ", destinos[aleatorio(8)]);
+        n += gerarOperacao(buf + n);
+        n += sprintf(buf + n, ";\n");
+    }
+    n += sprintf(buf + n, "    return a + b;\n}\n\nvoid main(void) {\n    output(f(g, input(), input()));\n}\n");
+    *tam = n;
+    return buf;
+}
+
+static int contarLeituras(const CodigoIR *c) {
+    int n = 0;
+    for (uint32_t i = 0; i < c->n; i++) n += c->quads[i].op == IR_LOAD;
+    return n;
+}
+
+static void medirValores(const char *nome, const char *buf, long n) {
+    double t;
+
+    printf("  %-24s", nome);
+    for (int otimizar = 1; otimizar <= 2; otimizar++) {
+        CodigoIR *c = traduzir(buf, n, otimizar, &t);
+        if (c == NULL) {
+            printf("  (erros de compilacao)\n");
+            return;
+        }
+        printf("  %9u %8d %7d %8.2f", c->n, contarLeituras(c), sessaoAtual->otimiza.reaproveitados, t * 1e3);
+    }
+    printf("\n");
+}
+
+static void benchValores(long comandos, int narq, char *arquivos[]) {
+    char nome[64];
+    long n;
+    char *buf;
+
+    printf("valores: quadruplas, leituras de arrays, valores reaproveitados e tempo (ms), com -O e -O2\n");
+    printf("  %-24s  %9s %8s %7s %8s  %9s %8s %7s %8s\n", "", "quads -O", "leituras", "reaprov", "ms",
+           "quads -O2", "leituras", "reaprov", "ms");
+    for (int i = 0; i < narq; i++) {
+        buf = replicarArquivo(arquivos[i], 0, &n);
+        medirValores(arquivos[i], buf, n);
+        free(buf);
+    }
+    buf = gerarProgramaArrays(comandos, &n);
+    snprintf(nome, sizeof(nome), "gerado (%ld comandos)", comandos);
+    medirValores(nome, buf, n);
+    free(buf);
+    novaSessao();
+}
+
+/* ---------------- Máquina virtual ---------------- */
+
+#define REPETICOES_VM 3
+
+/* Saída de uma execução, para comparar os executores */
+typedef struct {
+    char *texto;
+    size_t n;
+} Saida;
+
+static FILE *abrirSaida(Saida *s) {
+    FILE *f;
+
+    s->texto = NULL;
+    s->n = 0;
+    f = open_memstream(&s->texto, &s->n);
+    if (f == NULL) {
+        fprintf(stderr, "Erro: sem memoria\n");
+        exit(1);
+    }
+    return f;
+}
+
+/* Melhor tempo de REPETICOES_VM execuções de b (despacho por switch ou
+   goto computado), com a saída da última em s */
+static double medirBytecode(const Bytecode *b, FILE *entrada, int despachoSwitch, Saida *s, int *ok) {
+    double melhor = 0;
+
+    for (int k = 0; k < REPETICOES_VM; k++) {
+        FILE *f = abrirSaida(s);
+        double t0 = agora();
+        *ok = executarBytecode(b, entrada, f, despachoSwitch, NULL);
+        t0 = agora() - t0;
+        fclose(f);
+        if (k == 0 || t0 < melhor) melhor = t0;
+        if (k + 1 < REPETICOES_VM) free(s->texto);
+    }
+    return melhor;
+}
+
+/* A codificação binária de b, lida de volta, é igual a b */
+static int idaEVolta(const Bytecode *b) {
+    FILE *f = tmpfile();
+    Bytecode *lido;
+
+    if (f == NULL || !escreverBytecode(f, b)) return FALSE;
+    rewind(f);
+    lido = lerBytecode(f);
+    fclose(f);
+    return lido != NULL && lido->n == b->n && memcmp(lido->palavras, b->palavras, b->n * sizeof(uint32_t)) == 0;
+}
+
+static int mesmaSaida(const Saida *a, const Saida *b) {
+    return a->n == b->n && memcmp(a->texto, b->texto, a->n) == 0;
+}
+
+/* Interpretador da árvore contra o bytecode (sem -O e com -O2), em ns por
+   instrução executada do bytecode sem -O; devolve FALSE se as saídas
+   diferem */
+static int medirVm(const char *nome, const char *buf, long n, FILE *entrada) {
+    Saida arvore, sw, go, go2;
+    Bytecode *b;
+    long instrucoes, instrucoes2;
+    double t, tArvore = 0, tSwitch, tGoto, tGoto2;
+    int ok, iguais;
+
+    printf("  %-20s", nome);
+    if (traduzir(buf, n, 0, &t) == NULL || (b = montarBytecode(sessaoAtual->ir)) == NULL) {
+        printf("  (erros de compilacao)\n");
+        return FALSE;
+    }
+    for (int k = 0; k < REPETICOES_VM; k++) {
+        FILE *f = abrirSaida(&arvore);
+        double t0 = agora();
+        interpretar(sessaoAtual->arvore, entrada, f);
+        t0 = agora() - t0;
+        fclose(f);
+        if (k == 0 || t0 < tArvore) tArvore = t0;
+        if (k + 1 < REPETICOES_VM) free(arvore.texto);
+    }
+    {
+        FILE *f = abrirSaida(&sw);
+        executarBytecode(b, entrada, f, TRUE, &instrucoes);
+        fclose(f);
+        free(sw.texto);
+    }
+    tSwitch = medirBytecode(b, entrada, TRUE, &sw, &ok);
+    tGoto = medirBytecode(b, entrada, FALSE, &go, &ok);
+    iguais = idaEVolta(b) && mesmaSaida(&arvore, &sw) && mesmaSaida(&arvore, &go);
+
+    if (traduzir(buf, n, 2, &t) == NULL || (b = montarBytecode(sessaoAtual->ir)) == NULL) {
+        printf("  (erros de compilacao)\n");
+        return FALSE;
+    }
+    {
+        FILE *f = abrirSaida(&go2);
+        executarBytecode(b, entrada, f, TRUE, &instrucoes2);
+        fclose(f);
+        free(go2.texto);
+    }
+    tGoto2 = medirBytecode(b, entrada, FALSE, &go2, &ok);
+    iguais = iguais && idaEVolta(b) && mesmaSaida(&arvore, &go2);
+
+    printf(" %11ld %8.1f %8.1f %8.1f %6.2f %6.2f %6.2f %6.1fx  %11ld %8.1f %6.1fx%s\n",
+           instrucoes, tArvore * 1e3, tSwitch * 1e3, tGoto * 1e3,
+           tArvore * 1e9 / instrucoes, tSwitch * 1e9 / instrucoes, tGoto * 1e9 / instrucoes,
+           tArvore / tGoto, instrucoes2, tGoto2 * 1e3, tArvore / tGoto2,
+           iguais ? "" : "  SAIDAS DIFERENTES");
+    free(arvore.texto);
+    free(sw.texto);
+    free(go.texto);
+    free(go2.texto);
+    return iguais;
+}
+
+static int benchVm(int narq, char *arquivos[]) {
+    FILE *entrada = fopen("/dev/null", "r");
+    int falhas = 0;
+    long n;
+
+    printf("vm: tempo (ms, melhor de %d) do interpretador da arvore e do bytecode com despacho por switch\n"
+           "    e por goto computado, e ns por instrucao executada do bytecode sem -O\n", REPETICOES_VM);
+    printf("  %-20s %11s %8s %8s %8s %6s %6s %6s %7s  %11s %8s %7s\n", "", "instrucoes", "arvore", "switch",
+           "goto", "ns arv", "ns sw", "ns go", "arv/go", "instr -O2", "goto -O2", "arv/go");
+    for (int i = 0; i < narq; i++) {
+        char *buf = replicarArquivo(arquivos[i], 0, &n);
+        if (!medirVm(arquivos[i], buf, n, entrada)) falhas++;
+        free(buf);
+    }
+    if (entrada != NULL) fclose(entrada);
+    novaSessao();
+    return falhas > 0;
+}
+
+/* ---------------- Código nativo ---------------- */
+
+/* Programa vazio: o tempo de partida de um executável, descontado das medições */
+static const char programaVazio[] = "void main(void) { return; }\n";
+
+/* Escreve x em <nome>.s e liga com o runtime (runtime.c ou já compilado)
+   em <nome> */
+static int ligarNativo(const CodigoX64 *x, const char *nome, const char *runtime) {
+    char comando[256];
+    const char *cc = getenv("CC");
+    FILE *f;
+
+    snprintf(comando, sizeof comando, "%s.s", nome);
+    if ((f = fopen(comando, "w")) == NULL) return FALSE;
+    escreverGas(f, x);
+    fclose(f);
+    snprintf(comando, sizeof comando, "%s -o %s %s.s %s -pthread",
+             cc != NULL && cc[0] != '\0' ? cc : "cc", nome, nome, runtime);
+    return system(comando) == 0;
+}
+
+/* Executa <nome> (entrada vazia) com a saída em s; devolve o tempo total
+   e, em primeira, o do primeiro byte da saída (o total se não há saída) */
+static double executarNativo(const char *nome, Saida *s, double *primeira) {
+    char comando[256], bloco[4096];
+    FILE *f = abrirSaida(s);
+    double t0 = agora();
+    FILE *p;
+    size_t lidos;
+
+    snprintf(comando, sizeof comando, "./%s < /dev/null", nome);
+    *primeira = 0;
+    if ((p = popen(comando, "r")) != NULL) {
+        while ((lidos = fread(bloco, 1, sizeof bloco, p)) > 0) {
+            if (*primeira == 0) *primeira = agora() - t0;
+            fwrite(bloco, 1, lidos, f);
+        }
+        pclose(p);
+    }
+    t0 = agora() - t0;
+    fclose(f);
+    if (*primeira == 0) *primeira = t0;
+    return t0;
+}
+
+/* Melhor tempo de REPETICOES_VM execuções de <nome>, com a saída da
+   última em s */
+static double medirExecutavel(const char *nome, Saida *s) {
+    double melhor = 0, primeira;
+
+    for (int k = 0; k < REPETICOES_VM; k++) {
+        double t = executarNativo(nome, s, &primeira);
+        if (k == 0 || t < melhor) melhor = t;
+        if (k + 1 < REPETICOES_VM) free(s->texto);
+    }
+    return melhor;
+}
+
+/* Tudo no quadro contra os registradores alocados (com -O2), descontada a
+   partida; devolve FALSE se as saídas diferem da do interpretador */
+static int medirNativo(const char *nome, const char *buf, long n, FILE *entrada, double partida,
+                       double *tBase, double *tAlocado) {
+    Saida arvore, base, alocado;
+    CodigoX64 *xb, *xa;
+    double t;
+    int iguais;
+
+    printf("%s\n", nome);
+    if (traduzir(buf, n, 2, &t) == NULL || (xb = gerarX64(sessaoAtual->ir, FALSE)) == NULL ||
+        (xa = gerarX64(sessaoAtual->ir, TRUE)) == NULL) {
+        printf("  (erros de compilacao)\n");
+        return FALSE;
+    }
+    if (!ligarNativo(xb, "nativo_base", "runtime.c") || !ligarNativo(xa, "nativo_alocado", "runtime.c")) {
+        printf("  (falha ao ligar)\n");
+        return FALSE;
+    }
+    for (uint32_t i = 0; i < xa->nfuncoes; i++) {
+        const RegistradoresX64 *r = &xa->funcoes[i];
+        printf("  %-20s %8d %8d %8d %8d\n", sessaoAtual->ir->simbolos[r->funcao]->name,
+               r->virtuais, r->derramados, r->divisoes, r->salvos);
+    }
+    {
+        FILE *f = abrirSaida(&arvore);
+        interpretar(sessaoAtual->arvore, entrada, f);
+        fclose(f);
+    }
+    *tBase = medirExecutavel("nativo_base", &base) - partida;
+    *tAlocado = medirExecutavel("nativo_alocado", &alocado) - partida;
+    iguais = mesmaSaida(&arvore, &base) && mesmaSaida(&arvore, &alocado);
+    printf("  %-20s %8.2f ms (pilha) %8.2f ms (registradores) %6.2fx%s\n", "", *tBase * 1e3, *tAlocado * 1e3,
+           *tBase / *tAlocado, iguais ? "" : "  SAIDAS DIFERENTES");
+    free(arvore.texto);
+    free(base.texto);
+    free(alocado.texto);
+    return iguais;
+}
+
+static int benchNativo(int narq, char *arquivos[]) {
+    FILE *entrada = fopen("/dev/null", "r");
+    Saida vazio;
+    CodigoX64 *x;
+    double t, partida, tBase, tAlocado, somaBase = 0, somaAlocado = 0;
+    int falhas = 0;
+    long n;
+
+    if (traduzir(programaVazio, (long)strlen(programaVazio), 2, &t) == NULL ||
+        (x = gerarX64(sessaoAtual->ir, TRUE)) == NULL || !ligarNativo(x, "nativo_base", "runtime.c")) {
+        fprintf(stderr, "Erro: nao foi possivel ligar com runtime.c\n");
+        return 1;
+    }
+    partida = medirExecutavel("nativo_base", &vazio);
+    free(vazio.texto);
+
+    printf("nativo: virtuais, derramados (algum pedaco na pilha), divisoes e registradores salvos por funcao;\n"
+           "        tempo (ms, melhor de %d, sem os %.2f ms da partida) com tudo na pilha e com os registradores\n",
+           REPETICOES_VM, partida * 1e3);
+    printf("  %-20s %8s %8s %8s %8s\n", "", "virtuais", "pilha", "divisoes", "salvos");
+    for (int i = 0; i < narq; i++) {
+        char *buf = replicarArquivo(arquivos[i], 0, &n);
+        if (medirNativo(arquivos[i], buf, n, entrada, partida, &tBase, &tAlocado)) {
+            somaBase += tBase;
+            somaAlocado += tAlocado;
+        } else
+            falhas++;
+        free(buf);
+    }
+    if (somaAlocado > 0)
+        printf("total: %.2f ms (pilha) %.2f ms (registradores) %.2fx\n", somaBase * 1e3, somaAlocado * 1e3,
+               somaBase / somaAlocado);
+    remove("nativo_base");
+    remove("nativo_base.s");
+    remove("nativo_alocado");
+    remove("nativo_alocado.s");
+    if (entrada != NULL) fclose(entrada);
+    novaSessao();
+    return falhas > 0;
+}
+
+/* ---------------- JIT ---------------- */
+
+/* Saída do programa em memória que anota quando chega o primeiro byte */
+typedef struct {
+    FILE *texto;
+    double primeira;
+} Marcador;
+
+static ssize_t escreverMarcando(void *cookie, const char *buf, size_t n) {
+    Marcador *m = (Marcador *)cookie;
+
+    if (m->primeira == 0) m->primeira = agora();
+    return (ssize_t)fwrite(buf, 1, n, m->texto);
+}
+
+/* Do fonte à primeira saída do código em memória (jit.h), com -O2: os
+   tempos, contados do início, do código x86-64 pronto, do código montado
+   e da primeira saída; FALSE se algo falhou */
+static int latenciaJit(const char *buf, long n, FILE *entrada, Saida *s, double *selecao, double *montagem,
+                       double *primeira) {
+    cookie_io_functions_t funcoes = {NULL, escreverMarcando, NULL, NULL};
+    double t0 = agora(), t;
+    CodigoX64 *x;
+    CodigoJit *j;
+    Marcador m;
+    FILE *f;
+    int ok;
+
+    if (traduzir(buf, n, 2, &t) == NULL || (x = gerarX64(sessaoAtual->ir, TRUE)) == NULL) return FALSE;
+    *selecao = agora() - t0;
+    if ((j = montarJit(x)) == NULL) return FALSE;
+    *montagem = agora() - t0;
+
+    /* sem buffer: cada output() chega ao marcador na hora */
+    m.texto = abrirSaida(s);
+    m.primeira = 0;
+    if ((f = fopencookie(&m, "w", funcoes)) == NULL) {
+        fclose(m.texto);
+        liberarJit(j);
+        return FALSE;
+    }
+    setvbuf(f, NULL, _IONBF, 0);
+    ok = executarJit(j, entrada, f);
+    t = agora();
+    fclose(f);
+    fclose(m.texto);
+    liberarJit(j);
+    *primeira = (m.primeira > 0 ? m.primeira : t) - t0;
+    return ok;
+}
+
+/* O mesmo pelo assembly: .s escrito, ligado com o runtime já compilado
+   (as e ld) e executado */
+static int latenciaAot(const char *buf, long n, Saida *s, double *selecao, double *ligacao, double *primeira) {
+    double t0 = agora(), t;
+    CodigoX64 *x;
+
+    if (traduzir(buf, n, 2, &t) == NULL || (x = gerarX64(sessaoAtual->ir, TRUE)) == NULL) return FALSE;
+    *selecao = agora() - t0;
+    if (!ligarNativo(x, "nativo_aot", "nativo_runtime.o")) return FALSE;
+    *ligacao = agora() - t0;
+    executarNativo("nativo_aot", s, &t);
+    *primeira = *ligacao + t;
+    return TRUE;
+}
+
+/* Melhor de REPETICOES_VM de cada caminho; FALSE se as saídas diferem da
+   do interpretador */
+static int medirJit(const char *nome, const char *buf, long n, FILE *entrada) {
+    Saida arvore, jit, aot;
+    double t, jSelecao = 0, jMontagem = 0, jPrimeira = 0, aSelecao = 0, aLigacao = 0, aPrimeira = 0;
+    int iguais = TRUE;
+
+    printf("  %-20s", nome);
+    if (traduzir(buf, n, 0, &t) == NULL) {
+        printf("  (erros de compilacao)\n");
+        return FALSE;
+    }
+    {
+        FILE *f = abrirSaida(&arvore);
+        interpretar(sessaoAtual->arvore, entrada, f);
+        fclose(f);
+    }
+    for (int k = 0; k < REPETICOES_VM; k++) {
+        double selecao, montagem, primeira;
+
+        if (!latenciaJit(buf, n, entrada, &jit, &selecao, &montagem, &primeira)) {
+            printf("  (falha no jit)\n");
+            free(arvore.texto);
+            return FALSE;
+        }
+        iguais = iguais && mesmaSaida(&arvore, &jit);
+        free(jit.texto);
+        if (k == 0 || primeira < jPrimeira) {
+            jSelecao = selecao;
+            jMontagem = montagem;
+            jPrimeira = primeira;
+        }
+
+        if (!latenciaAot(buf, n, &aot, &selecao, &montagem, &primeira)) {
+            printf("  (falha ao ligar)\n");
+            free(arvore.texto);
+            return FALSE;
+        }
+        iguais = iguais && mesmaSaida(&arvore, &aot);
+        free(aot.texto);
+        if (k == 0 || primeira < aPrimeira) {
+            aSelecao = selecao;
+            aLigacao = montagem;
+            aPrimeira = primeira;
+        }
+    }
+    printf(" %8.2f %8.2f %8.2f   %8.2f %8.2f %8.2f %7.1fx%s\n", jSelecao * 1e3, jMontagem * 1e3, jPrimeira * 1e3,
+           aSelecao * 1e3, aLigacao * 1e3, aPrimeira * 1e3, aPrimeira / jPrimeira,
+           iguais ? "" : "  SAIDAS DIFERENTES");
+    free(arvore.texto);
+    return iguais;
+}
+
+static int benchJit(int narq, char *arquivos[]) {
+    FILE *entrada = fopen("/dev/null", "r");
+    const char *cc = getenv("CC");
+    char comando[256];
+    int falhas = 0;
+    long n;
+
+    /* o runtime é compilado uma vez: o caminho AOT mede só as e ld */
+    snprintf(comando, sizeof comando, "%s -c -O2 -o nativo_runtime.o runtime.c",
+             cc != NULL && cc[0] != '\0' ? cc : "cc");
+    if (system(comando) != 0) {
+        fprintf(stderr, "Erro: nao foi possivel compilar runtime.c\n");
+        return 1;
+    }
+    printf("jit: latencia (ms, melhor de %d, com -O2) do fonte a primeira saida, no codigo em memoria e pelo\n"
+           "     assembly ligado com o runtime; cada coluna conta do inicio: x86-64 selecionado, codigo pronto\n"
+           "     (montado em memoria ou .s escrito, montado e ligado) e primeira saida\n", REPETICOES_VM);
+    printf("  %-20s %8s %8s %8s   %8s %8s %8s %8s\n", "", "jit sel", "montado", "saida", "aot sel", "ligado",
+           "saida", "aot/jit");
+    for (int i = 0; i < narq; i++) {
+        char *buf = replicarArquivo(arquivos[i], 0, &n);
+        if (!medirJit(arquivos[i], buf, n, entrada)) falhas++;
+        free(buf);
+    }
+    remove("nativo_runtime.o");
+    remove("nativo_aot");
+    remove("nativo_aot.s");
+    if (entrada != NULL) fclose(entrada);
+    novaSessao();
+    return falhas > 0;
+}
+
+int main(int argc, char *argv[]) {
+    /* diagnósticos do compilador não interessam às medições */
+    saidaDescartada = fopen("/dev/null", "w");
+    if (saidaDescartada == NULL) saidaDescartada = stderr;
+    novaSessao();
+
+    if (argc >= 3 && strcmp(argv[1], "scan") == 0) {
+        benchScan(argv[2], argc >= 4 ? atol(argv[3]) : 100);
+        return 0;
+    }
+
+    if (argc >= 2 && strcmp(argv[1], "difscan") == 0)
+        return difScan(argc - 2, argv + 2);
+
+    if (argc >= 2 && strcmp(argv[1], "symtab") == 0) {
+        benchSymtab(argc >= 3 ? atol(argv[2]) : 1000000);
+        return 0;
+    }
+
+    if (argc >= 3 && strcmp(argv[1], "ast") == 0) {
+        benchAst(argv[2], argc >= 4 ? atol(argv[3]) : 1000000);
+        return 0;
+    }
+
+    if (argc >= 2 && strcmp(argv[1], "temps") == 0) {
+        long comandos = argc >= 3 && atol(argv[2]) > 0 ? atol(argv[2]) : 10000;
+        int primeiro = argc >= 3 && atol(argv[2]) > 0 ? 3 : 2;
+        benchTemps(comandos, argc - primeiro, argv + primeiro);
+        return 0;
+    }
+
+    if (argc >= 2 && strcmp(argv[1], "valores") == 0) {
+        long comandos = argc >= 3 && atol(argv[2]) > 0 ? atol(argv[2]) : 10000;
+        int primeiro = argc >= 3 && atol(argv[2]) > 0 ? 3 : 2;
+        benchValores(comandos, argc - primeiro, argv + primeiro);
+        return 0;
+    }
+
+    if (argc >= 3 && strcmp(argv[1], "vm") == 0)
+        return benchVm(argc - 2, argv + 2);
+
+    if (argc >= 3 && strcmp(argv[1], "nativo") == 0)
+        return benchNativo(argc - 2, argv + 2);
+
+    if (argc >= 3 && strcmp(argv[1], "jit") == 0)
+        return benchJit(argc - 2, argv + 2);
+
+    fprintf(stderr, "Uso: %s scan <arquivo.cm> [MB]\n", argv[0]);
+    fprintf(stderr, "     %s difscan <arquivo.cm>...\n", argv[0]);
+    fprintf(stderr, "     %s ast <arquivo.cm> [nos]\n", argv[0]);
+    fprintf(stderr, "     %s symtab [simbolos]\n", argv[0]);
+    fprintf(stderr, "     %s temps [comandos] <arquivo.cm>...\n", argv[0]);
+    fprintf(stderr, "     %s valores [comandos] <arquivo.cm>...\n", argv[0]);
+    fprintf(stderr, "     %s vm <arquivo.cm>...\n", argv[0]);
+    fprintf(stderr, "     %s nativo <arquivo.cm>...\n", argv[0]);
+    fprintf(stderr, "     %s jit <arquivo.cm>...\n", argv[0]);
+    return 1;
+}
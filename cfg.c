@@ -0,0 +1,359 @@
+/* Blocos básicos e grafo de fluxo de controle (cfg.c) */
+
+#include "globals.h"
+#include "cfg.h"
+#include "arena.h"
+#include "sessao.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#define BUFFER_DOT (1 << 20)
+
+/* ---------------------- Blocos e arestas ---------------------- */
+
+static int ehDesvio(OpIR op) {
+    return op == IR_GOTO || op == IR_IFFALSE || op == IR_RETURN;
+}
+
+/* Divide [inicio, fim] em blocos; devolve o bloco de cada label */
+static int *dividirBlocos(const CodigoIR *c, FuncaoCfg *f, int *primeiroLabel) {
+    const Quad *q = c->quads;
+    uint32_t n = f->fim - f->inicio + 1;
+    uint8_t *lider = (uint8_t *)arenaAlloc(n);
+    int minLabel = INT32_MAX, maxLabel = -1;
+    int *blocoDoLabel;
+    int b;
+
+    lider[0] = lider[n - 1] = 1;
+    for (uint32_t i = f->inicio; i < f->fim; i++) {
+        if (q[i].op == IR_LABEL) {
+            lider[i - f->inicio] = 1;
+            if (q[i].a.v < minLabel) minLabel = q[i].a.v;
+            if (q[i].a.v > maxLabel) maxLabel = q[i].a.v;
+        } else if (ehDesvio((OpIR)q[i].op)) {
+            lider[i + 1 - f->inicio] = 1;
+        }
+    }
+
+    f->nblocos = 0;
+    for (uint32_t i = 0; i < n; i++) f->nblocos += lider[i];
+    f->blocos = (BlocoBasico *)arenaAlloc(f->nblocos * sizeof(BlocoBasico));
+
+    b = -1;
+    for (uint32_t i = 0; i < n; i++) {
+        if (lider[i]) {
+            if (b >= 0) f->blocos[b].fim = f->inicio + i;
+            f->blocos[++b].inicio = f->inicio + i;
+        }
+    }
+    f->blocos[b].fim = f->fim + 1;
+
+    *primeiroLabel = minLabel;
+    blocoDoLabel = (int *)arenaAlloc((maxLabel >= minLabel ? maxLabel - minLabel + 1 : 1) * sizeof(int));
+    for (b = 0; b < f->nblocos; b++) {
+        const Quad *p = &q[f->blocos[b].inicio];
+        if (p->op == IR_LABEL) blocoDoLabel[p->a.v - minLabel] = b;
+    }
+    return blocoDoLabel;
+}
+
+static void ligarBlocos(const CodigoIR *c, FuncaoCfg *f, const int *blocoDoLabel, int primeiroLabel) {
+    int saida = f->nblocos - 1;
+    int *arestas;
+    int narestas = 0;
+
+    for (int b = 0; b < saida; b++) {
+        BlocoBasico *bb = &f->blocos[b];
+        const Quad *ultima = &c->quads[bb->fim - 1];
+
+        bb->nsucc = 1;
+        switch (ultima->op) {
+        case IR_GOTO:
+            bb->succ[0] = blocoDoLabel[ultima->a.v - primeiroLabel];
+            break;
+        case IR_IFFALSE:
+            bb->succ[0] = b + 1;
+            bb->succ[1] = blocoDoLabel[ultima->b.v - primeiroLabel];
+            if (bb->succ[1] != bb->succ[0]) bb->nsucc = 2;
+            break;
+        case IR_RETURN:
+            bb->succ[0] = saida;
+            break;
+        default:
+            bb->succ[0] = b + 1;
+            break;
+        }
+        for (int i = 0; i < bb->nsucc; i++) f->blocos[bb->succ[i]].npred++;
+        narestas += bb->nsucc;
+    }
+
+    arestas = (int *)arenaAlloc((narestas + 1) * sizeof(int));
+    for (int b = 0; b < f->nblocos; b++) {
+        f->blocos[b].pred = arestas;
+        arestas += f->blocos[b].npred;
+        f->blocos[b].npred = 0;
+    }
+    for (int b = 0; b < saida; b++) {
+        for (int i = 0; i < f->blocos[b].nsucc; i++) {
+            BlocoBasico *s = &f->blocos[f->blocos[b].succ[i]];
+            s->pred[s->npred++] = b;
+        }
+    }
+}
+
+/* ---------------------- Dominadores ---------------------- */
+
+/* Pós-ordem reversa a partir da entrada, com pilha explícita */
+static void ordenar(FuncaoCfg *f) {
+    int *pilha = (int *)arenaAlloc(f->nblocos * sizeof(int));
+    int *proximo = (int *)arenaAlloc(f->nblocos * sizeof(int));
+    int *posOrdem = (int *)arenaAlloc(f->nblocos * sizeof(int));
+    int topo = 0, n = 0;
+
+    for (int b = 0; b < f->nblocos; b++) f->blocos[b].rpo = -1;
+    f->blocos[0].rpo = 0;           /* visitado */
+    pilha[topo++] = 0;
+    while (topo > 0) {
+        int b = pilha[topo - 1];
+        BlocoBasico *bb = &f->blocos[b];
+
+        if (proximo[b] < bb->nsucc) {
+            int s = bb->succ[proximo[b]++];
+            if (f->blocos[s].rpo < 0) {
+                f->blocos[s].rpo = 0;
+                pilha[topo++] = s;
+            }
+        } else {
+            posOrdem[n++] = b;
+            topo--;
+        }
+    }
+
+    f->nordem = n;
+    f->ordem = (int *)arenaAlloc(n * sizeof(int));
+    for (int i = 0; i < n; i++) {
+        f->ordem[i] = posOrdem[n - 1 - i];
+        f->blocos[f->ordem[i]].rpo = i;
+    }
+}
+
+static int intersectar(const FuncaoCfg *f, int a, int b) {
+    while (a != b) {
+        while (f->blocos[a].rpo > f->blocos[b].rpo) a = f->blocos[a].idom;
+        while (f->blocos[b].rpo > f->blocos[a].rpo) b = f->blocos[b].idom;
+    }
+    return a;
+}
+
+static void calcularDominadores(FuncaoCfg *f) {
+    int mudou = TRUE;
+
+    for (int b = 0; b < f->nblocos; b++) {
+        f->blocos[b].idom = -1;
+        f->blocos[b].filhoDom = f->blocos[b].irmaoDom = -1;
+    }
+    f->blocos[0].idom = 0;
+    while (mudou) {
+        mudou = FALSE;
+        for (int i = 1; i < f->nordem; i++) {
+            BlocoBasico *bb = &f->blocos[f->ordem[i]];
+            int novo = -1;
+
+            for (int j = 0; j < bb->npred; j++) {
+                int p = bb->pred[j];
+                if (f->blocos[p].idom < 0) continue;    /* ainda não processado */
+                novo = novo < 0 ? p : intersectar(f, p, novo);
+            }
+            if (bb->idom != novo) {
+                bb->idom = novo;
+                mudou = TRUE;
+            }
+        }
+    }
+    f->blocos[0].idom = -1;
+
+    /* filhos em pós-ordem reversa */
+    for (int i = f->nordem - 1; i > 0; i--) {
+        BlocoBasico *bb = &f->blocos[f->ordem[i]];
+        bb->irmaoDom = f->blocos[bb->idom].filhoDom;
+        f->blocos[bb->idom].filhoDom = f->ordem[i];
+    }
+}
+
+int domina(const FuncaoCfg *f, int a, int b) {
+    if (f->blocos[b].rpo < 0) return FALSE;
+    while (b >= 0 && b != a) b = f->blocos[b].idom;
+    return b == a;
+}
+
+/* ---------------------- Laços ---------------------- */
+
+static void encontrarLacos(FuncaoCfg *f) {
+    int *pilha = (int *)arenaAlloc(f->nblocos * sizeof(int));
+    int *marca = (int *)arenaAlloc(f->nblocos * sizeof(int));    /* cabeça (rpo + 1) */
+
+    f->lacos = (Laco *)arenaAlloc(f->nblocos * sizeof(Laco));
+    f->nlacos = 0;
+    for (int b = 0; b < f->nblocos; b++) f->blocos[b].laco = -1;
+
+    for (int i = 0; i < f->nordem; i++) {
+        int h = f->ordem[i];
+        BlocoBasico *bh = &f->blocos[h];
+        int topo = 0, retorno = FALSE;
+        Laco *laco;
+
+        /* origens das arestas de retorno (h -> h não entra na pilha) */
+        marca[h] = i + 1;
+        for (int j = 0; j < bh->npred; j++) {
+            int p = bh->pred[j];
+            if (!domina(f, h, p)) continue;
+            retorno = TRUE;
+            if (marca[p] != i + 1) {
+                marca[p] = i + 1;
+                pilha[topo++] = p;
+            }
+        }
+        if (!retorno) continue;
+
+        laco = &f->lacos[f->nlacos];
+        laco->cabeca = h;
+        laco->pai = bh->laco;
+        laco->profundidade = laco->pai < 0 ? 1 : f->lacos[laco->pai].profundidade + 1;
+        laco->nblocos = 1;
+        bh->laco = f->nlacos;
+
+        /* corpo: de trás para frente a partir das arestas de retorno */
+        while (topo > 0) {
+            BlocoBasico *bb = &f->blocos[pilha[--topo]];
+
+            bb->laco = f->nlacos;
+            laco->nblocos++;
+            for (int j = 0; j < bb->npred; j++) {
+                int p = bb->pred[j];
+                if (f->blocos[p].rpo >= 0 && marca[p] != i + 1) {
+                    marca[p] = i + 1;
+                    pilha[topo++] = p;
+                }
+            }
+        }
+        f->nlacos++;
+    }
+}
+
+/* ---------------------- Construção ---------------------- */
+
+static void construirFuncao(int i, void *ctx) {
+    GrafoFluxo *g = (GrafoFluxo *)ctx;
+    FuncaoCfg *f = &g->funcoes[i];
+    int primeiroLabel;
+    int *blocoDoLabel;
+
+    blocoDoLabel = dividirBlocos(g->codigo, f, &primeiroLabel);
+    ligarBlocos(g->codigo, f, blocoDoLabel, primeiroLabel);
+    ordenar(f);
+    calcularDominadores(f);
+    encontrarLacos(f);
+}
+
+GrafoFluxo *construirCfg(const CodigoIR *c) {
+    GrafoFluxo *g = (GrafoFluxo *)arenaAlloc(sizeof(GrafoFluxo));
+    int n = 0;
+
+    g->codigo = c;
+    for (uint32_t i = 0; i < c->n; i++) n += c->quads[i].op == IR_FUNC;
+    g->funcoes = (FuncaoCfg *)arenaAlloc((n + 1) * sizeof(FuncaoCfg));
+    for (uint32_t i = 0; i < c->n; i++) {
+        if (c->quads[i].op == IR_FUNC) g->funcoes[g->nfuncoes].inicio = i;
+        else if (c->quads[i].op == IR_ENDFUNC) g->funcoes[g->nfuncoes++].fim = i;
+    }
+
+    /* cada função só escreve o próprio FuncaoCfg */
+    paraCadaParalelo(g->nfuncoes, construirFuncao, g);
+    return g;
+}
+
+/* ---------------------- DOT ---------------------- */
+
+static void printBlocoDot(FILE *f, const GrafoFluxo *g, int fn, int b) {
+    const FuncaoCfg *fc = &g->funcoes[fn];
+    const BlocoBasico *bb = &fc->blocos[b];
+
+    fprintf(f, "    f%d_b%d [label=\"B%d", fn, b, b);
+    if (b == 0) fprintf(f, " (entrada)");
+    else if (b == fc->nblocos - 1) fprintf(f, " (saida)");
+    if (bb->rpo < 0) fprintf(f, " (inalcancavel)");
+    if (bb->laco >= 0)
+        fprintf(f, "  laco %d, profundidade %d", bb->laco, profundidadeLaco(fc, b));
+    fprintf(f, "\\l");
+    for (uint32_t i = bb->inicio; i < bb->fim; i++) {
+        escreverQuad(f, g->codigo, &g->codigo->quads[i]);
+        fprintf(f, "\\l");
+    }
+    fprintf(f, "\"%s];\n", bb->laco >= 0 && fc->lacos[bb->laco].cabeca == b ? ", penwidth=2" : "");
+}
+
+static void printFuncaoDot(FILE *f, const GrafoFluxo *g, int fn) {
+    const FuncaoCfg *fc = &g->funcoes[fn];
+    const Quad *func = &g->codigo->quads[fc->inicio];
+
+    fprintf(f, "  subgraph cluster_f%d {\n", fn);
+    fprintf(f, "    label=\"%s\";\n", g->codigo->simbolos[func->a.v]->name);
+    for (int b = 0; b < fc->nblocos; b++) printBlocoDot(f, g, fn, b);
+
+    for (int b = 0; b < fc->nblocos; b++) {
+        const BlocoBasico *bb = &fc->blocos[b];
+
+        /* if_false: V na sequência, F no desvio; retornos de laço em vermelho */
+        for (int i = 0; i < bb->nsucc; i++) {
+            int s = bb->succ[i];
+            int condicional = g->codigo->quads[bb->fim - 1].op == IR_IFFALSE;
+            int retorno = domina(fc, s, b);
+
+            fprintf(f, "    f%d_b%d -> f%d_b%d", fn, b, fn, s);
+            if (condicional && retorno) fprintf(f, " [label=\"%s\", color=red]", i == 0 ? "V" : "F");
+            else if (condicional) fprintf(f, " [label=\"%s\"]", i == 0 ? "V" : "F");
+            else if (retorno) fprintf(f, " [color=red]");
+            fprintf(f, ";\n");
+        }
+        if (bb->idom >= 0)
+            fprintf(f, "    f%d_b%d -> f%d_b%d [style=dashed, color=gray, constraint=false];\n",
+                    fn, bb->idom, fn, b);
+    }
+    fprintf(f, "  }\n");
+}
+
+void printCfgDot(const GrafoFluxo *g, const char *dotFilename) {
+    FILE *f;
+
+    if (!Silencioso) {
+        fprintf(listing, "\n=== GERACAO DO CFG ===\n");
+        fprintf(listing, "Criando: %s\n", dotFilename);
+    }
+
+    f = fopen(dotFilename, "w");
+    if (f == NULL) {
+        fprintf(listing, "ERRO: Nao foi possivel criar arquivo %s\n", dotFilename);
+        fprintf(listing, "Verifique permissoes no diretorio atual\n\n");
+        return;
+    }
+    setvbuf(f, NULL, _IOFBF, BUFFER_DOT);
+
+    fprintf(f, "digraph CFG {\n");
+    fprintf(f, "  node [shape=box, fontname=\"Courier\", fontsize=10];\n");
+    fprintf(f, "  edge [fontname=\"Arial\", fontsize=10];\n\n");
+    for (int fn = 0; fn < g->nfuncoes; fn++) printFuncaoDot(f, g, fn);
+    fprintf(f, "}\n");
+    fclose(f);
+
+    if (!Silencioso) {
+        int blocos = 0, lacos = 0;
+
+        for (int fn = 0; fn < g->nfuncoes; fn++) {
+            blocos += g->funcoes[fn].nblocos;
+            lacos += g->funcoes[fn].nlacos;
+        }
+        fprintf(listing, "%d funcao(oes), %d bloco(s) basico(s), %d laco(s)\n", g->nfuncoes, blocos, lacos);
+        fprintf(listing, "Arquivo DOT: %s\n\n", dotFilename);
+    }
+}
@@ -0,0 +1,78 @@
+/* cfg.h - Blocos básicos e grafo de fluxo de controle */
+
+#ifndef CFG_H
+#define CFG_H
+
+#include "globals.h"
+#include "ir.h"
+
+/*
+ * Cada função do código intermediário (IR_FUNC .. IR_ENDFUNC) vira um
+ * grafo de blocos básicos. Um bloco começa no IR_FUNC, num label ou depois
+ * de um desvio (goto, if_false, return) e ocupa as quádruplas
+ * [inicio, fim). O bloco 0 é a entrada (func, params e vars); o último só
+ * tem o endfunc e é a saída, sucessor de todo return e do fim do corpo.
+ *
+ * Sucessores: succ[0] é a sequência (ou o alvo de um goto); num if_false,
+ * succ[1] é o alvo do desvio, tomado quando a condição é falsa.
+ *
+ * A árvore de dominadores vem do algoritmo iterativo de Cooper, Harvey e
+ * Kennedy sobre a pós-ordem reversa. Cada aresta b -> h em que h domina b
+ * fecha um laço natural com cabeça h; laços com a mesma cabeça são um só.
+ * Os laços são numerados na ordem das cabeças na pós-ordem reversa, então
+ * um laço aparece depois dos que o contêm.
+ */
+
+typedef struct {
+    uint32_t inicio, fim;    /* quádruplas [inicio, fim) */
+    int nsucc;
+    int succ[2];
+    int npred;
+    int *pred;
+    int rpo;                 /* posição na pós-ordem reversa; -1 se inalcançável */
+    int idom;                /* dominador imediato; -1 na entrada e nos inalcançáveis */
+    int filhoDom;            /* árvore de dominadores: primeiro filho ... */
+    int irmaoDom;            /* ... e o próximo irmão, ou -1 */
+    int laco;                /* laço mais interno que contém o bloco, ou -1 */
+} BlocoBasico;
+
+typedef struct {
+    int cabeca;
+    int pai;                 /* laço imediatamente externo, ou -1 */
+    int profundidade;        /* 1 nos laços mais externos */
+    int nblocos;             /* blocos do corpo, incluindo a cabeça */
+} Laco;
+
+typedef struct {
+    uint32_t inicio, fim;    /* o IR_FUNC e o IR_ENDFUNC */
+    BlocoBasico *blocos;
+    int nblocos;
+    int *ordem;              /* blocos alcançáveis, em pós-ordem reversa */
+    int nordem;
+    Laco *lacos;
+    int nlacos;
+} FuncaoCfg;
+
+typedef struct GrafoFluxo {
+    const CodigoIR *codigo;
+    FuncaoCfg *funcoes;
+    int nfuncoes;
+} GrafoFluxo;
+
+/* Grafos de todas as funções de c (memória da arena) */
+GrafoFluxo *construirCfg(const CodigoIR *c);
+
+/* Verdadeiro se o bloco a domina o bloco b */
+int domina(const FuncaoCfg *f, int a, int b);
+
+/* Quantos laços contêm o bloco b */
+static inline int profundidadeLaco(const FuncaoCfg *f, int b) {
+    int l = f->blocos[b].laco;
+    return l < 0 ? 0 : f->lacos[l].profundidade;
+}
+
+/* Grafo em formato DOT: um cluster por função, com as quádruplas de cada
+   bloco, as arestas de fluxo e, tracejada, a árvore de dominadores */
+void printCfgDot(const GrafoFluxo *g, const char *dotFilename);
+
+#endif
@@ -3,230 +3,327 @@
 #include "globals.h"
 #include "util.h"
 #include "cgen.h"
+#include "ast.h"
+#include "arena.h"
+#include "analyse.h"
+#include "sessao.h"
 
-static int tempCounter = 0;
-static int labelCounter = 0;
+/* Estado do gerador na sessão corrente (globals.h) */
+#define arvore       (sessaoAtual->cgen.arvore)
+#define tempCounter  (sessaoAtual->cgen.tempCounter)   /* primeiro temporário livre */
+#define maxTemps     (sessaoAtual->cgen.maxTemps)
+#define labelCounter (sessaoAtual->cgen.labelCounter)
+#define codigo       (sessaoAtual->cgen.codigo)     /* trecho em construção */
 
-/*Gera novo temporário*/
-static char *newTemp(void) {
-    static char temp[20];
-    sprintf(temp, "t%d", tempCounter++);
-    return copyString(temp);
+/* Temporários: cada um é lido uma única vez, pela operação que consome o
+   valor, e nenhum sobrevive ao comando que o criou. São alocados como uma
+   pilha: o valor consumido libera o seu temporário, e cada comando
+   recomeça do t0. O número de temporários é o da expressão mais funda. */
+static Operando newTemp(void) {
+    Operando t = operando(OPR_TEMP, tempCounter++);
+    if (tempCounter > maxTemps) maxTemps = tempCounter;
+    return t;
+}
+
+/* Libera o temporário de um valor já consumido (só o do topo da pilha;
+   os outros ficam presos até o fim do comando) */
+static void liberar(Operando o) {
+    if (o.tipo == OPR_TEMP && o.v == tempCounter - 1) tempCounter--;
+}
+
+/* Onde guardar o resultado de uma operação: no destino de uma atribuição
+   ou num temporário novo */
+static Operando resultado(Operando destino) {
+    return destino.tipo != OPR_NADA ? destino : newTemp();
 }
 
 /*Gera novo label*/
-static char *newLabel(void) {
-    static char label[20];
-    sprintf(label, "L%d", labelCounter++);
-    return copyString(label);
+static Operando newLabel(void) {
+    return operando(OPR_LABEL, labelCounter++);
+}
+
+/* Variável ou função declarada, usada ou chamada no nó */
+static Operando simbolo(No t) {
+    return operando(OPR_VAR, simboloNo(t)->memloc);
+}
+
+static void emitir(OpIR op, Operando r, Operando a, Operando b) {
+    irEmitir(codigo, op, r, a, b);
+}
+
+static OpIR opBinario(TokenType op) {
+    switch (op) {
+    case PLUS: return IR_ADD;
+    case MINUS: return IR_SUB;
+    case TIMES: return IR_MUL;
+    case OVER: return IR_DIV;
+    case SHL: return IR_SHL;
+    case LT: return IR_LT;
+    case LE: return IR_LE;
+    case GT: return IR_GT;
+    case GE: return IR_GE;
+    case EQ: return IR_EQ;
+    default: return IR_NE;
+    }
 }
 
-/*Emite label*/
-static void emitLabel(char *label) {
-    fprintf(listing, "%s:\n", label);
+static void cGenLista(No tree);
+static Operando cGenExp(No tree, Operando destino);
+
+/* Se a expressão tem uma chamada ou uma atribuição, que podem mudar uma
+   variável já usada como operando */
+static int temEfeito(No tree) {
+    if (tree == NENHUM) return FALSE;
+    if (arvore->nos[tree].nodekind == StmtK) return TRUE;
+    for (int i = 0; i < MAXCHILDREN; i++)
+        if (temEfeito(filhoNo(arvore, tree, i))) return TRUE;
+    return FALSE;
 }
 
-/*Emite goto*/
-static void emitGoto(char *label) {
-    fprintf(listing, "goto %s\n", label);
+/* Operando da esquerda de uma operação cuja direita é rhs: a variável é
+   lida antes da direita, então, se a direita pode mudá-la, o valor vai
+   para um temporário (g + f(), com f mudando g, soma o g de antes) */
+static Operando cGenEsquerda(No tree, No rhs) {
+    Operando t1 = cGenExp(tree, NADA);
+    Operando t2;
+
+    if (t1.tipo != OPR_VAR || !temEfeito(rhs)) return t1;
+    t2 = newTemp();
+    emitir(IR_COPY, t2, t1, NADA);
+    return t2;
 }
 
-/*Emite salto condicional*/
-static void emitIfFalse(char *cond, char *label) {
-    fprintf(listing, "if_false %s goto %s\n", cond, label);
+/* Atribuição; o valor é a variável (ou o valor guardado no array) */
+static Operando cGenAtribuicao(No tree) {
+    No lhs = filhoNo(arvore, tree, 0);
+    Operando t1, t2;
+
+    if (lhs != NENHUM && arvore->nos[lhs].kind == ArrIdK) {
+        /* Atribuição a array: arr[i] = expr */
+        t1 = cGenEsquerda(filhoNo(arvore, lhs, 0), filhoNo(arvore, tree, 1)); /* índice */
+        t2 = cGenExp(filhoNo(arvore, tree, 1), NADA); /* valor */
+        emitir(IR_STORE, simbolo(tree), t1, t2);
+        return t2;
+    }
+    /* Atribuição simples: var = expr, com a operação escrevendo direto na
+       variável (x = a + b, e não t = a + b; x = t) */
+    t1 = cGenExp(filhoNo(arvore, tree, 1), simbolo(tree));
+    if (t1.tipo != OPR_VAR || t1.v != simbolo(tree).v) {
+        emitir(IR_COPY, simbolo(tree), t1, NADA);
+        liberar(t1);
+    }
+    return simbolo(tree);
 }
 
-/* Geração de código para expressões - retorna temporário com resultado */
-static char *cGen(TreeNode *tree) {
-    if (tree == NULL) return NULL;
-    
-    char *t1, *t2, *t3;
-    char numStr[20];
-    
-    switch (tree->nodekind) {
-    case ExpK:
-        switch (tree->kind.exp) {
+/* Geração de código para expressões - retorna o operando com o resultado;
+   com destino, a operação da raiz escreve nele */
+static Operando cGenExp(No tree, Operando destino) {
+    if (tree == NENHUM) return NADA;
+
+    NoAst *n = &arvore->nos[tree];
+    Operando t1, t2, t3;
+
+    if (n->nodekind == ExpK) {
+        switch (n->kind) {
         case ConstK:
-            sprintf(numStr, "%d", tree->attr.val);
-            return copyString(numStr);
-            
+            return operando(OPR_CONST, valorNo(arvore, tree));
+
         case IdK:
-            return tree->attr.name;
-            
+            return simbolo(tree);
+
         case ArrIdK:
-            t1 = cGen(tree->child[0]); /* índice */
-            t2 = newTemp();
-            fprintf(listing, "%s = %s[%s]\n", t2, tree->attr.name, t1);
+            t1 = cGenExp(filhoNo(arvore, tree, 0), NADA); /* índice */
+            liberar(t1);
+            t2 = resultado(destino);
+            emitir(IR_LOAD, t2, simbolo(tree), t1);
             return t2;
-            
+
         case OpK:
-            t1 = cGen(tree->child[0]);
-            t2 = cGen(tree->child[1]);
-            t3 = newTemp();
-            
-            char *opStr;
-            switch (tree->attr.op) {
-            case PLUS: opStr = "+"; break;
-            case MINUS: opStr = "-"; break;
-            case TIMES: opStr = "*"; break;
-            case OVER: opStr = "/"; break;
-            case LT: opStr = "<"; break;
-            case LE: opStr = "<="; break;
-            case GT: opStr = ">"; break;
-            case GE: opStr = ">="; break;
-            case EQ: opStr = "=="; break;
-            case NE: opStr = "!="; break;
-            default: opStr = "?"; break;
-            }
-            
-            fprintf(listing, "%s = %s %s %s\n", t3, t1, opStr, t2);
+            t1 = cGenEsquerda(filhoNo(arvore, tree, 0), filhoNo(arvore, tree, 1));
+            t2 = cGenExp(filhoNo(arvore, tree, 1), NADA);
+            liberar(t2);
+            liberar(t1);
+            t3 = resultado(destino);
+            emitir(opBinario(opNo(arvore, tree)), t3, t1, t2);
             return t3;
-            
+
         default:
-            return NULL;
+            return NADA;
+        }
+    }
+
+    if (n->nodekind == StmtK && n->kind == AssignK)
+        return cGenAtribuicao(tree);
+
+    if (n->nodekind == StmtK && n->kind == CallK) {
+        /*Processa argumentos*/
+        int nargs = 0;
+        for (No arg = filhoNo(arvore, tree, 0); arg != NENHUM; arg = arvore->nos[arg].sibling) {
+            t1 = cGenExp(arg, NADA);
+            emitir(IR_ARG, NADA, t1, NADA);
+            liberar(t1);
+            nargs++;
         }
+
+        t2 = resultado(destino);
+        emitir(IR_CALL, t2, simbolo(tree), operando(OPR_CONST, nargs));
+        return t2;
+    }
+
+    return NADA;
+}
+
+/* Geração de código para um comando ou declaração */
+static void cGenStmt(No tree) {
+    NoAst *n = &arvore->nos[tree];
+    Operando t1;
+
+    tempCounter = 0;
+    if (n->nodekind != StmtK) {
+        cGenExp(tree, NADA);    /* expressão usada como comando */
+        return;
+    }
+
+    switch (n->kind) {
+    case AssignK:
+    case CallK:
+        cGenExp(tree, NADA);
         break;
-        
-    case StmtK:
-        switch (tree->kind.stmt) {
-        case AssignK:
-            if (tree->child[0] != NULL && tree->child[0]->kind.exp == ArrIdK) {
-                /* Atribuição a array: arr[i] = expr */
-                t1 = cGen(tree->child[0]->child[0]); /* índice */
-                t2 = cGen(tree->child[1]); /* valor */
-                fprintf(listing, "%s[%s] = %s\n", tree->attr.name, t1, t2);
-            } else {
-                /* Atribuição simples: var = expr */
-                t1 = cGen(tree->child[1]);
-                fprintf(listing, "%s = %s\n", tree->attr.name, t1);
-            }
-            break;
-            
-        case IfK:
-            {
-                char *labelElse = newLabel();
-                char *labelEnd = newLabel();
-                
-                t1 = cGen(tree->child[0]); /* condição */
-                emitIfFalse(t1, labelElse);
-                
-                /* Bloco then */
-                if (tree->child[1] != NULL)
-                    cGen(tree->child[1]);
-                
-                if (tree->child[2] != NULL) {
-                    emitGoto(labelEnd);
-                    emitLabel(labelElse);
-                    /* Bloco else */
-                    cGen(tree->child[2]);
-                    emitLabel(labelEnd);
-                } else {
-                    emitLabel(labelElse);
-                }
-            }
-            break;
-            
-        case WhileK:
-            {
-                char *labelStart = newLabel();
-                char *labelEnd = newLabel();
-                
-                emitLabel(labelStart);
-                t1 = cGen(tree->child[0]); /*condição */
-                emitIfFalse(t1, labelEnd);
-                
-                /* Corpo do loop*/
-                if (tree->child[1] != NULL)
-                    cGen(tree->child[1]);
-                
-                emitGoto(labelStart);
-                emitLabel(labelEnd);
-            }
-            break;
-            
-        case ReturnK:
-            if (tree->child[0] != NULL) {
-                t1 = cGen(tree->child[0]);
-                fprintf(listing, "return %s\n", t1);
-            } else {
-                fprintf(listing, "return\n");
-            }
-            break;
-            
-        case CallK:
-            {
-                /*Processa argumentos*/
-                TreeNode *arg = tree->child[0];
-                while (arg != NULL) {
-                    t1 = cGen(arg);
-                    fprintf(listing, "param %s\n", t1);
-                    arg = arg->sibling;
-                }
-                
-                t2 = newTemp();
-                fprintf(listing, "%s = call %s\n", t2, tree->attr.name);
-                return t2;
-            }
-            
-        case FunDeclK:
-            {
-                fprintf(listing, "\nfunc %s:\n", tree->attr.name);
-                
-                /*Parâmetros*/
-                TreeNode *param = tree->child[0];
-                while (param != NULL) {
-                    fprintf(listing, "param %s\n", param->attr.name);
-                    param = param->sibling;
-                }
-                
-                /*Corpo da função */
-                if (tree->child[1] != NULL)
-                    cGen(tree->child[1]);
-                
-                fprintf(listing, "endfunc %s\n", tree->attr.name);
-            }
-            break;
-            
-        case VarDeclK:
-            if (tree->type == IntegerArray) {
-                fprintf(listing, "var %s[%d]\n", tree->attr.name, tree->arraySize);
+
+    case IfK:
+        {
+            Operando labelElse = newLabel();
+            Operando labelEnd = newLabel();
+
+            t1 = cGenExp(filhoNo(arvore, tree, 0), NADA); /* condição */
+            emitir(IR_IFFALSE, NADA, t1, labelElse);
+
+            /* Bloco then */
+            cGenLista(filhoNo(arvore, tree, 1));
+
+            if (filhoNo(arvore, tree, 2) != NENHUM) {
+                emitir(IR_GOTO, NADA, labelEnd, NADA);
+                emitir(IR_LABEL, NADA, labelElse, NADA);
+                /* Bloco else */
+                cGenLista(filhoNo(arvore, tree, 2));
+                emitir(IR_LABEL, NADA, labelEnd, NADA);
             } else {
-                fprintf(listing, "var %s\n", tree->attr.name);
+                emitir(IR_LABEL, NADA, labelElse, NADA);
             }
-            break;
-            
-        case CompoundK:
-            if (tree->child[0] != NULL) /*declarações locais*/
-                cGen(tree->child[0]);
-            if (tree->child[1] != NULL) /*lista de statements*/
-                cGen(tree->child[1]);
-            break;
-            
-        default:
-            break;
         }
         break;
-        
+
+    case WhileK:
+        {
+            Operando labelStart = newLabel();
+            Operando labelEnd = newLabel();
+
+            emitir(IR_LABEL, NADA, labelStart, NADA);
+            t1 = cGenExp(filhoNo(arvore, tree, 0), NADA); /*condição */
+            emitir(IR_IFFALSE, NADA, t1, labelEnd);
+
+            /* Corpo do loop*/
+            cGenLista(filhoNo(arvore, tree, 1));
+
+            emitir(IR_GOTO, NADA, labelStart, NADA);
+            emitir(IR_LABEL, NADA, labelEnd, NADA);
+        }
+        break;
+
+    case ReturnK:
+        if (filhoNo(arvore, tree, 0) != NENHUM) {
+            t1 = cGenExp(filhoNo(arvore, tree, 0), NADA);
+            emitir(IR_RETURN, NADA, t1, NADA);
+        } else {
+            emitir(IR_RETURN, NADA, NADA, NADA);
+        }
+        break;
+
+    case FunDeclK:
+        emitir(IR_FUNC, NADA, simbolo(tree), NADA);
+
+        /*Parâmetros*/
+        for (No param = filhoNo(arvore, tree, 0); param != NENHUM; param = arvore->nos[param].sibling) {
+            if (nomeNo(arvore, param) == NULL) continue;     /* (void) */
+            emitir(IR_PARAM, NADA, simbolo(param),
+                   operando(OPR_CONST, arvore->nos[param].type == IntegerArray));
+        }
+
+        /*Corpo da função */
+        cGenLista(filhoNo(arvore, tree, 1));
+
+        emitir(IR_ENDFUNC, NADA, simbolo(tree), NADA);
+        break;
+
+    case VarDeclK:
+        if (n->type == IntegerArray)
+            emitir(IR_VAR, NADA, simbolo(tree), operando(OPR_CONST, tamanhoArrayNo(arvore, tree)));
+        else
+            emitir(IR_VAR, NADA, simbolo(tree), NADA);
+        break;
+
+    case CompoundK:
+        cGenLista(filhoNo(arvore, tree, 0)); /*declarações locais*/
+        cGenLista(filhoNo(arvore, tree, 1)); /*lista de statements*/
+        break;
+
     default:
         break;
     }
-    
-    /*Processa irmãos*/
-    if (tree->sibling != NULL) {
-        cGen(tree->sibling);
+}
+
+/* Comandos de uma lista (irmãos) */
+static void cGenLista(No tree) {
+    while (tree != NENHUM) {
+        cGenStmt(tree);
+        tree = arvore->nos[tree].sibling;
     }
-    
-    return NULL;
 }
 
-/*Gera código para árvore completa */
-void codeGen(TreeNode *syntaxTree) {
-    fprintf(listing, "\n>>> Codigo Intermediario (AST Linearizada) <<<\n\n");
+/* ---------------- Declarações globais (sessao.h) ----------------
+ * Cada declaração global vira um trecho com temporários e labels
+ * numerados a partir de 0, possivelmente numa sessão filha; irJuntar()
+ * renumera os trechos na ordem do programa. */
+
+typedef struct {
+    No *decls;
+    CodigoIR **trechos;
+    SymbolRec **simbolos;
+    int nsimbolos;
+} Declaracoes;
+
+static void gerarDeclaracao(int i, void *ctx) {
+    Declaracoes *d = (Declaracoes *)ctx;
+
+    codigo = novoIR(d->simbolos, d->nsimbolos);
     tempCounter = 0;
+    maxTemps = 0;
     labelCounter = 0;
-    
-    /* cGen já processa irmãos internamente, então só chamamos uma vez */
-    cGen(syntaxTree);
-    
+    cGenStmt(d->decls[i]);
+    codigo->ntemps = maxTemps;
+    codigo->nlabels = labelCounter;
+    d->trechos[i] = codigo;
+}
+
+CodigoIR *gerarIR(ArvoreCompacta *a) {
+    Declaracoes d;
+    CodigoIR *c;
+    int n;
+
+    arvore = a;
+    d.simbolos = st_declaracoes(&d.nsimbolos);
+    d.decls = declaracoesGlobais(arvore, &n);
+    d.trechos = (CodigoIR **)arenaAlloc((n + 1) * sizeof(CodigoIR *));
+    paraCadaParalelo(n, gerarDeclaracao, &d);
+
+    c = novoIR(d.simbolos, d.nsimbolos);
+    for (int i = 0; i < n; i++) irJuntar(c, d.trechos[i]);
+    return c;
+}
+
+/*Gera código para árvore completa */
+void codeGen(CodigoIR *c) {
+    fprintf(listing, "\n>>> Codigo Intermediario (AST Linearizada) <<<\n\n");
+    imprimirIR(listing, c);
     fprintf(listing, "\n>>> Fim do Codigo Intermediario <<<\n");
-}
\ No newline at end of file
+}
@@ -4,8 +4,13 @@
 #define CGEN_H
 
 #include "globals.h"
+#include "ast.h"
+#include "ir.h"
 
-/* Gera código intermediário */
-void codeGen(TreeNode *syntaxTree);
+/* Traduz a árvore analisada para código de três endereços */
+CodigoIR *gerarIR(ArvoreCompacta *arvore);
 
-#endif
\ No newline at end of file
+/* Imprime o código intermediário */
+void codeGen(CodigoIR *codigo);
+
+#endif
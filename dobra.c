@@ -0,0 +1,228 @@
+/* Dobra de constantes e simplificação algébrica (dobra.c) */
+
+#include "globals.h"
+#include "dobra.h"
+#include "ast.h"
+#include "arena.h"
+#include "analyse.h"
+#include "sessao.h"
+
+#include <stdint.h>
+
+/* Estado da dobra na sessão corrente (globals.h) */
+#define arvore       (sessaoAtual->dobra.arvore)
+#define economizadas (sessaoAtual->dobra.economizadas)
+
+static int ehExpressao(No t, ExpKind kind) {
+    return arvore->nos[t].nodekind == ExpK && arvore->nos[t].kind == kind;
+}
+
+/* Quádruplas que o cgen emite para uma expressão sem efeitos */
+static int instrucoes(No t) {
+    if (t == NENHUM || arvore->nos[t].nodekind != ExpK) return 0;
+    switch (arvore->nos[t].kind) {
+    case OpK:
+        return 1 + instrucoes(filhoNo(arvore, t, 0)) + instrucoes(filhoNo(arvore, t, 1));
+    case ArrIdK:
+        return 1 + instrucoes(filhoNo(arvore, t, 0));
+    default:
+        return 0;
+    }
+}
+
+/* Sem chamadas, atribuições nem operações que podem dar erro de
+   execução: pode ser descartada. Só a divisão por uma constante que não é
+   0 nem -1 (INT_MIN / -1 estoura) nunca falha; o acesso a um array pode
+   sair dos limites. */
+static int semEfeitos(No t) {
+    No b;
+
+    if (t == NENHUM) return TRUE;
+    if (arvore->nos[t].nodekind != ExpK) return FALSE;
+    switch (arvore->nos[t].kind) {
+    case OpK:
+        b = filhoNo(arvore, t, 1);
+        if (opNo(arvore, t) == OVER &&
+            (!ehExpressao(b, ConstK) || valorNo(arvore, b) == 0 || valorNo(arvore, b) == -1))
+            return FALSE;
+        return semEfeitos(filhoNo(arvore, t, 0)) && semEfeitos(b);
+    case ArrIdK:
+        return FALSE;
+    default:
+        return TRUE;
+    }
+}
+
+/* Mesma expressão: mesmas variáveis (pela declaração), constantes e
+   operadores */
+static int iguais(No a, No b) {
+    const NoAst *x = &arvore->nos[a], *y = &arvore->nos[b];
+
+    if (x->nodekind != ExpK || y->nodekind != ExpK || x->kind != y->kind) return FALSE;
+    switch (x->kind) {
+    case ConstK:
+        return valorNo(arvore, a) == valorNo(arvore, b);
+    case IdK:
+        return simboloNo(a) == simboloNo(b);
+    case ArrIdK:
+        return simboloNo(a) == simboloNo(b) &&
+               iguais(filhoNo(arvore, a, 0), filhoNo(arvore, b, 0));
+    case OpK:
+        return opNo(arvore, a) == opNo(arvore, b) &&
+               iguais(filhoNo(arvore, a, 0), filhoNo(arvore, b, 0)) &&
+               iguais(filhoNo(arvore, a, 1), filhoNo(arvore, b, 1));
+    default:
+        return FALSE;
+    }
+}
+
+/* a op b com inteiros de 32 bits, como na execução; FALSE se o resultado
+   não é definido (divisão por zero, INT32_MIN / -1) */
+static int calcular(TokenType op, int32_t a, int32_t b, int32_t *r) {
+    switch (op) {
+    case PLUS:  *r = (int32_t)((uint32_t)a + (uint32_t)b); break;
+    case MINUS: *r = (int32_t)((uint32_t)a - (uint32_t)b); break;
+    case TIMES: *r = (int32_t)((uint32_t)a * (uint32_t)b); break;
+    case OVER:
+        if (b == 0 || (a == INT32_MIN && b == -1)) return FALSE;
+        *r = a / b;
+        break;
+    case LT: *r = a < b; break;
+    case LE: *r = a <= b; break;
+    case GT: *r = a > b; break;
+    case GE: *r = a >= b; break;
+    case EQ: *r = a == b; break;
+    case NE: *r = a != b; break;
+    default: return FALSE;
+    }
+    return TRUE;
+}
+
+/* k se v == 2^k com k >= 1, senão -1 */
+static int expoente(int32_t v) {
+    int k = 0;
+
+    if (v <= 1 || (v & (v - 1)) != 0) return -1;
+    while ((1 << k) != v) k++;
+    return k;
+}
+
+/* O próprio nó vira a constante v (o tipo, Integer ou Boolean, fica) */
+static No virarConstante(No t, int32_t v) {
+    NoAst *n = &arvore->nos[t];
+
+    economizadas += instrucoes(t);
+    n->kind = ConstK;
+    n->nfilhos = 0;
+    n->dados = (uint32_t)v;
+    return t;
+}
+
+/* O operando x toma o lugar da operação */
+static No eliminar(No x) {
+    economizadas++;
+    return x;
+}
+
+/* t vira x << k; c é a constante 2^k, que passa a guardar k */
+static void deslocar(No t, No x, No c, int k) {
+    NoAst *n = &arvore->nos[t];
+
+    arvore->extra[n->dados] = x;
+    arvore->extra[n->dados + 1] = c;
+    arvore->extra[n->dados + n->nfilhos] = SHL;
+    arvore->nos[c].dados = (uint32_t)k;
+}
+
+/* Simplifica a operação t, cujos operandos já foram simplificados;
+   devolve o nó que fica no lugar dela */
+static No simplificar(No t) {
+    No a = filhoNo(arvore, t, 0), b = filhoNo(arvore, t, 1);
+    TokenType op = opNo(arvore, t);
+    int ca = ehExpressao(a, ConstK), cb = ehExpressao(b, ConstK);
+    int32_t va = ca ? valorNo(arvore, a) : 0, vb = cb ? valorNo(arvore, b) : 0;
+    int32_t v;
+    int k;
+
+    if (op == OVER && cb && vb == 0) {
+        fprintf(listing, "\nAVISO: divisao por zero - LINHA: %d\n", arvore->nos[t].lineno);
+        return t;
+    }
+    if (ca && cb)
+        return calcular(op, va, vb, &v) ? virarConstante(t, v) : t;
+
+    switch (op) {
+    case PLUS:
+        if (cb && vb == 0) return eliminar(a);
+        if (ca && va == 0) return eliminar(b);
+        break;
+    case MINUS:
+        if (cb && vb == 0) return eliminar(a);
+        if (iguais(a, b) && semEfeitos(a)) return virarConstante(t, 0);
+        break;
+    case TIMES:
+        if (cb && vb == 1) return eliminar(a);
+        if (ca && va == 1) return eliminar(b);
+        if ((cb && vb == 0 && semEfeitos(a)) || (ca && va == 0 && semEfeitos(b)))
+            return virarConstante(t, 0);
+        if (cb && (k = expoente(vb)) > 0) deslocar(t, a, b, k);
+        else if (ca && (k = expoente(va)) > 0) deslocar(t, b, a, k);
+        break;
+    case OVER:
+        if (cb && vb == 1) return eliminar(a);
+        break;
+    default:
+        break;
+    }
+    return t;
+}
+
+/* Simplifica a lista de irmãos que começa em *ref, de baixo para cima;
+   ref é um campo de filho em extra ou o sibling do irmão anterior */
+static void dobrarLista(uint32_t *ref) {
+    while (*ref != NENHUM) {
+        No t = *ref;
+        NoAst *n = &arvore->nos[t];
+
+        for (int i = 0; i < n->nfilhos; i++)
+            dobrarLista(&arvore->extra[n->dados + i]);
+        if (n->nodekind == ExpK && n->kind == OpK) {
+            No novo = simplificar(t);
+            if (novo != t) {
+                arvore->nos[novo].sibling = n->sibling;
+                *ref = t = novo;
+            }
+        }
+        ref = &arvore->nos[t].sibling;
+    }
+}
+
+/* Cada declaração global só altera os próprios nós (sessao.h) */
+typedef struct {
+    No *decls;
+    int *contagens;
+} Declaracoes;
+
+static void dobrarDeclaracao(int i, void *ctx) {
+    Declaracoes *d = (Declaracoes *)ctx;
+    NoAst *n = &arvore->nos[d->decls[i]];
+
+    economizadas = 0;
+    for (int j = 0; j < n->nfilhos; j++)
+        dobrarLista(&arvore->extra[n->dados + j]);
+    d->contagens[i] = economizadas;
+}
+
+int dobrarConstantes(ArvoreCompacta *a) {
+    Declaracoes d;
+    int n, total = 0;
+
+    arvore = a;
+    d.decls = declaracoesGlobais(arvore, &n);
+    d.contagens = (int *)arenaAlloc((n + 1) * sizeof(int));
+    paraCadaParalelo(n, dobrarDeclaracao, &d);
+
+    for (int i = 0; i < n; i++) total += d.contagens[i];
+    economizadas = total;
+    return total;
+}
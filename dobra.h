@@ -0,0 +1,21 @@
+/* dobra.h - Dobra de constantes e simplificação algébrica */
+
+#ifndef DOBRA_H
+#define DOBRA_H
+
+#include "globals.h"
+#include "ast.h"
+
+/*
+ * Reescreve as expressões da árvore já verificada (após typeCheck):
+ *   c1 op c2            constante (aritmética de 32 bits, comparações 0/1)
+ *   x + 0, 0 + x, x - 0, x * 1, 1 * x, x / 1     x
+ *   x * 0, 0 * x, x - x                          0, se x não tem efeitos
+ *   x * 2^k, 2^k * x                             x << k
+ * Uma divisão por zero fica como está e gera um aviso. Os nós substituídos
+ * ficam órfãos no vetor da árvore; a pré-ordem dos nós vivos se mantém.
+ * Devolve quantas instruções do código intermediário deixam de existir.
+ */
+int dobrarConstantes(ArvoreCompacta *arvore);
+
+#endif
@@ -0,0 +1,87 @@
+/*
+ * Gerador da tabela de palavras reservadas (palavras.h)
+ *
+ * Procura um hash perfeito sobre (tamanho, primeiro caractere, último
+ * caractere) para a lista abaixo e imprime a tabela indexada por ele.
+ * Para acrescentar uma palavra reservada, inclua-a aqui (e o token em
+ * globals.h) e rode "make palavras.h".
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const struct {
+    const char *texto;
+    const char *token;
+} palavras[] = {
+    {"else", "ELSE"}, {"if", "IF"}, {"int", "INT"},
+    {"return", "RETURN"}, {"void", "VOID"}, {"while", "WHILE"}
+};
+
+#define NPALAVRAS ((int)(sizeof(palavras) / sizeof(palavras[0])))
+#define MAXMULT 32
+
+static unsigned hashPalavra(const char *s, unsigned a, unsigned b, unsigned c, unsigned mascara) {
+    unsigned n = (unsigned)strlen(s);
+    return (n * a + (unsigned char)s[0] * b + (unsigned char)s[n - 1] * c) & mascara;
+}
+
+/* Verifica se (a, b, c) não gera colisões numa tabela de mascara + 1 posições */
+static int semColisao(unsigned a, unsigned b, unsigned c, unsigned mascara) {
+    char ocupado[1024] = {0};
+    for (int i = 0; i < NPALAVRAS; i++) {
+        unsigned h = hashPalavra(palavras[i].texto, a, b, c, mascara);
+        if (ocupado[h]) return 0;
+        ocupado[h] = 1;
+    }
+    return 1;
+}
+
+int main(void) {
+    unsigned tam, a, b, c;
+    int minimo = 1 << 30, maximo = 0;
+
+    for (int i = 0; i < NPALAVRAS; i++) {
+        int n = (int)strlen(palavras[i].texto);
+        if (n < minimo) minimo = n;
+        if (n > maximo) maximo = n;
+    }
+
+    /* menor tabela potência de 2 que admita multiplicadores sem colisão */
+    for (tam = 1; tam < (unsigned)NPALAVRAS; tam <<= 1);
+    for (; tam <= 1024; tam <<= 1)
+        for (a = 1; a < MAXMULT; a++)
+            for (b = 1; b < MAXMULT; b++)
+                for (c = 1; c < MAXMULT; c++)
+                    if (semColisao(a, b, c, tam - 1)) goto achou;
+
+    fprintf(stderr, "gerapalavras: nenhum hash perfeito encontrado\n");
+    return 1;
+
+achou:
+    printf("/* palavras.h - gerado por gerapalavras.c (make palavras.h); nao editar */\n\n");
+    printf("#ifndef PALAVRAS_H\n#define PALAVRAS_H\n\n");
+    printf("#define PALAVRA_MIN %d\n", minimo);
+    printf("#define PALAVRA_MAX %d\n", maximo);
+    printf("#define PALAVRA_TAM_TABELA %u\n\n", tam);
+    printf("/* hash perfeito sobre tamanho, primeiro e ultimo caractere */\n");
+    printf("#define PALAVRA_HASH(n, p, u) \\\n");
+    printf("    (((unsigned)(n) * %uu + (unsigned)(p) * %uu + (unsigned)(u) * %uu) & %uu)\n\n",
+           a, b, c, tam - 1);
+    printf("static const struct {\n");
+    printf("    const char *texto;\n");
+    printf("    int tamanho;\n");
+    printf("    TokenType token;\n");
+    printf("} tabelaPalavras[PALAVRA_TAM_TABELA] = {\n");
+    for (unsigned h = 0; h < tam; h++) {
+        for (int i = 0; i < NPALAVRAS; i++) {
+            if (hashPalavra(palavras[i].texto, a, b, c, tam - 1) == h) {
+                printf("    [%u] = {\"%s\", %d, %s},\n", h, palavras[i].texto,
+                       (int)strlen(palavras[i].texto), palavras[i].token);
+            }
+        }
+    }
+    printf("};\n\n#endif\n");
+    return 0;
+}
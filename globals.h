@@ -9,15 +9,14 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <stdint.h>
+#include <setjmp.h>
 
 #define TRUE 1
 #define FALSE 0
 
-#define MAXRESERVED 6
 #define MAXCHILDREN 3
 
-extern int lineno;
-
 typedef enum {
     // Palavras reservadas
     IF, ELSE, INT, RETURN, VOID, WHILE,
@@ -26,13 +25,11 @@ typedef enum {
     ASSIGN, SEMI, COMMA, LPAREN, RPAREN, LBRACKET, RBRACKET,
     LBRACE, RBRACE,
     // Outros
-    ID, NUM, ENDFILE, ERROR
+    ID, NUM, ENDFILE, ERROR,
+    // Operadores internos, criados pela dobra de constantes (dobra.c)
+    SHL
 } TokenType;
 
-extern FILE *source;
-extern FILE *listing;
-extern int lineno;
-
 typedef enum {StmtK, ExpK} NodeKind;
 
 typedef enum {
@@ -61,11 +58,145 @@ typedef struct treeNode {
     int arraySize;
 } TreeNode;
 
-extern int EchoSource;
-extern int TraceScan;
-extern int TraceParse;
-extern int TraceAnalyze;
-extern int TraceCode;
-extern int Error;
+/*
+ * Sessão de compilação: todo o estado de uma compilação, que antes ficava
+ * em variáveis globais e estáticas dos módulos. Cada thread compila na
+ * sessão apontada por sessaoAtual, que as funções de sessao.h ajustam na
+ * entrada e restauram na saída; os módulos leem o estado por meio das
+ * macros abaixo e das que cada um define sobre o seu grupo de campos.
+ */
+
+struct BlocoArena;
+struct EntradaNome;
+struct Posicao;
+struct ScopeRec;
+struct SymbolRec;
+struct ArvoreCompacta;
+struct CodigoIR;
+struct GrafoFluxo;
+struct Pool;
+
+typedef struct CompilerSession {
+    FILE *saida;                /* listing */
+    int linha;                  /* linha corrente do scanner */
+    int erro;                   /* Error */
+    int echoSource;
+    int traceScan;
+    int traceParse;
+    int traceAnalyze;
+    int traceCode;
+    FILE *tokens;               /* TraceScan: destino dos tokens (NULL = saida) */
+    int silencioso;             /* sem mensagens de progresso na saida */
+    int otimizar;               /* código intermediário otimizado (otimiza.h): 1 com -O, 2 com -O2 */
+
+    struct Pool *pool;          /* funções em paralelo (sessaoUsarPool) */
+    int fase;                   /* sessao.c: última fase concluída */
+    jmp_buf *abortar;           /* fase em execução (abortarSessao) */
+    int interrupcao;            /* resultado passado a abortarSessao */
+    TreeNode *arvoreSintatica;
+    struct ArvoreCompacta *arvore;
+    struct CodigoIR *ir;        /* código intermediário (cgen.c) */
+    struct GrafoFluxo *cfg;     /* blocos básicos do ir (cfg.c) */
+    struct Bytecode *bytecode;  /* bytecode do ir (vm.c) */
+    struct CodigoX64 *x64;      /* código nativo do ir (x64.c) */
+
+    struct {                    /* arena.c */
+        struct BlocoArena *blocoAtual;
+        size_t proximoTamanho;
+        long chamadasMalloc;
+        size_t bytesPedidos;
+        size_t bytesReservados;
+    } arena;
+
+    struct {                    /* nomes.c */
+        struct EntradaNome *tabela;
+        unsigned capacidade;
+        unsigned ocupados;
+    } nomes;
+
+    struct {                    /* scan.c */
+        const char *bufferFonte;
+        long inicioToken;
+        int tamanhoToken;
+        char *nomeToken;
+        long tamanhoFonte;
+        long posicao;
+        int flag_EOF;
+        int linhaEcoada;
+        long posicaoEco;
+        int fonteMapeada;
+        int fonteAlocada;
+        int linhaInicioComentario;
+    } scan;
+
+    struct {                    /* parse.c */
+        TokenType token;
+        char *nomeInput;
+        char *nomeOutput;
+        int errorCount;
+    } parse;
+
+    struct {                    /* symtab.c */
+        struct Posicao *tabela;
+        uint32_t capacidade;
+        uint32_t ocupados;
+        struct ScopeRec *topScope;
+        struct ScopeRec *freeScopes;
+        int nivel;
+        int congelada;
+        struct SymbolRec *firstDecl;
+        struct SymbolRec *lastDecl;
+    } symtab;
+
+    struct {                    /* analyse.c */
+        char *nomeGlobal;
+        char *nomeMain;
+        char *nomeInput;
+        char *nomeOutput;
+        struct ArvoreCompacta *arvore;
+        char *currentScope;
+        int location;
+        int hasMain;
+        struct SymbolRec **simbolos;
+        uint32_t corpoFuncao;
+    } analise;
+
+    struct {                    /* dobra.c */
+        struct ArvoreCompacta *arvore;
+        int economizadas;       /* instruções a menos no código */
+    } dobra;
+
+    struct {                    /* otimiza.c */
+        int desvios;            /* if_false eliminados */
+        int reaproveitados;     /* operações que reaproveitam um valor */
+        int removidas;          /* instruções a menos */
+    } otimiza;
+
+    struct {                    /* cgen.c */
+        struct ArvoreCompacta *arvore;
+        int tempCounter;
+        int maxTemps;
+        int labelCounter;
+        struct CodigoIR *codigo;
+    } cgen;
+
+    struct {                    /* util.c: saída DOT */
+        int nodeCounter;
+        FILE *dotFile;
+        struct ArvoreCompacta *arvore;
+    } dot;
+} CompilerSession;
+
+extern _Thread_local CompilerSession *sessaoAtual;
+
+#define listing      (sessaoAtual->saida)
+#define linhaAtual   (sessaoAtual->linha)
+#define Error        (sessaoAtual->erro)
+#define EchoSource   (sessaoAtual->echoSource)
+#define TraceScan    (sessaoAtual->traceScan)
+#define TraceParse   (sessaoAtual->traceParse)
+#define TraceAnalyze (sessaoAtual->traceAnalyze)
+#define TraceCode    (sessaoAtual->traceCode)
+#define Silencioso   (sessaoAtual->silencioso)
 
 #endif
\ No newline at end of file
@@ -0,0 +1,375 @@
+/* Interpretador da árvore (interp.c) */
+
+#include "globals.h"
+#include "interp.h"
+#include "analyse.h"
+#include "symtab.h"
+#include "arena.h"
+#include "sessao.h"
+
+#include <pthread.h>
+#include <stdarg.h>
+
+/* Pilha da thread do interpretador: cada chamada do programa usa alguns
+   quadros de C (avaliar, chamar, executar) */
+#define PILHA_THREAD      ((size_t)512 << 20)
+
+/* Onde fica cada variável (por memloc) */
+#define LUGAR_GLOBAL      0   /* endereço absoluto */
+#define LUGAR_LOCAL       1   /* deslocamento no quadro */
+#define LUGAR_REFERENCIA  2   /* array parâmetro: endereço e tamanho no quadro */
+
+typedef struct {
+    uint8_t tipo;
+    int32_t endereco;
+    int32_t tamanho;         /* arrays declarados; 0 nos escalares */
+} Lugar;
+
+typedef struct {
+    ArvoreCompacta *arvore;
+    CompilerSession *sessao;
+    FILE *entrada, *saida;
+    Lugar *lugar;            /* por memloc */
+    No *funcao;              /* por memloc: a FunDeclK, ou NENHUM nas embutidas */
+    int32_t *quadro;         /* por memloc de função: palavras do quadro */
+    char *nomeInput;
+    No main;
+    int32_t *mem;
+    int32_t capacidade;
+    int32_t sp, fp;          /* topo da pilha e quadro corrente */
+    int profundidade;
+    int32_t retorno;         /* valor do último return */
+    jmp_buf erro;
+    int terminou;
+} Interpretador;
+
+#define nos (x->arvore->nos)
+
+static void erro(Interpretador *x, No t, const char *fmt, ...) {
+    va_list ap;
+
+    fflush(x->saida);
+    fprintf(listing, "\nERRO DE EXECUCAO: ");
+    va_start(ap, fmt);
+    vfprintf(listing, fmt, ap);
+    va_end(ap);
+    fprintf(listing, " - LINHA: %d\n", nos[t].lineno);
+    Error = TRUE;
+    longjmp(x->erro, 1);
+}
+
+/* Garante n palavras livres acima do topo da pilha */
+static void reservar(Interpretador *x, No t, int32_t n) {
+    int32_t cap = x->capacidade;
+    int32_t *novo;
+
+    if (x->sp + n <= cap) return;
+    if (x->sp + n > LIMITE_MEMORIA) erro(x, t, "memoria esgotada");
+    while (cap < x->sp + n) cap = cap > LIMITE_MEMORIA / 2 ? LIMITE_MEMORIA : cap * 2;
+    novo = (int32_t *)realloc(x->mem, (size_t)cap * sizeof(int32_t));
+    if (novo == NULL) erro(x, t, "memoria esgotada");
+    x->mem = novo;
+    x->capacidade = cap;
+}
+
+/* ---------------------- Variáveis ---------------------- */
+
+static const Lugar *lugarDe(const Interpretador *x, No t) {
+    return &x->lugar[simboloNo(t)->memloc];
+}
+
+/* Endereço do escalar usado em t */
+static int32_t endereco(const Interpretador *x, No t) {
+    const Lugar *l = lugarDe(x, t);
+    return l->tipo == LUGAR_GLOBAL ? l->endereco : x->fp + l->endereco;
+}
+
+/* Início e tamanho do array usado em t */
+static void array(const Interpretador *x, No t, int32_t *base, int32_t *tamanho) {
+    const Lugar *l = lugarDe(x, t);
+
+    if (l->tipo == LUGAR_REFERENCIA) {
+        *base = x->mem[x->fp + l->endereco];
+        *tamanho = x->mem[x->fp + l->endereco + 1];
+    } else {
+        *base = l->tipo == LUGAR_GLOBAL ? l->endereco : x->fp + l->endereco;
+        *tamanho = l->tamanho;
+    }
+}
+
+static int32_t avaliar(Interpretador *x, No t);
+
+/* Endereço de a[i], com o índice já verificado: o array é o usado em t e
+   o índice, a expressão indice */
+static int32_t elemento(Interpretador *x, No t, No indice) {
+    int32_t i = avaliar(x, indice);
+    int32_t base, tamanho;
+
+    array(x, t, &base, &tamanho);
+    if (i < 0 || i >= tamanho)
+        erro(x, t, "indice %d fora do array '%s' (tamanho %d)", i, nomeNo(x->arvore, t), tamanho);
+    return base + i;
+}
+
+/* ---------------------- Expressões ---------------------- */
+
+static int32_t calcular(Interpretador *x, No t, TokenType op, int32_t a, int32_t b) {
+    switch (op) {
+    case PLUS:  return (int32_t)((uint32_t)a + (uint32_t)b);
+    case MINUS: return (int32_t)((uint32_t)a - (uint32_t)b);
+    case TIMES: return (int32_t)((uint32_t)a * (uint32_t)b);
+    case OVER:
+        if (b == 0) erro(x, t, "divisao por zero");
+        if (a == INT32_MIN && b == -1) erro(x, t, "estouro na divisao");
+        return a / b;
+    case SHL:   return (int32_t)((uint32_t)a << (b & 31));
+    case LT:    return a < b;
+    case LE:    return a <= b;
+    case GT:    return a > b;
+    case GE:    return a >= b;
+    case EQ:    return a == b;
+    default:    return a != b;
+    }
+}
+
+static int executar(Interpretador *x, No t);
+static int executarLista(Interpretador *x, No t);
+
+/* input() e output(x) */
+static int32_t embutida(Interpretador *x, No t, const SymbolRec *f) {
+    int32_t v;
+
+    if (f->name == x->nomeInput) {
+        fflush(x->saida);
+        if (fscanf(x->entrada, "%d", &v) != 1) erro(x, t, "entrada esgotada ou invalida em input()");
+        return v;
+    }
+    v = avaliar(x, filhoNo(x->arvore, t, 0));
+    fprintf(x->saida, "%d\n", v);
+    return 0;
+}
+
+/* Executa a função f, chamada em t, com os argumentos em [base, sp): eles
+   são o início do quadro */
+static int32_t executarFuncao(Interpretador *x, No t, const SymbolRec *f, int32_t base) {
+    int32_t fp = x->fp, quadro = x->quadro[f->memloc];
+
+    if (++x->profundidade > LIMITE_CHAMADAS)
+        erro(x, t, "recursao profunda demais (%d chamadas)", LIMITE_CHAMADAS);
+    reservar(x, t, base + quadro - x->sp);
+    memset(&x->mem[x->sp], 0, (size_t)(base + quadro - x->sp) * sizeof(int32_t));
+    x->fp = base;
+    x->sp = base + quadro;
+    x->retorno = 0;
+    executarLista(x, filhoNo(x->arvore, x->funcao[f->memloc], 1));
+    x->sp = base;
+    x->fp = fp;
+    x->profundidade--;
+    return x->retorno;
+}
+
+/* Chamada t: os argumentos são empilhados na ordem dos parâmetros */
+static int32_t chamar(Interpretador *x, No t) {
+    const SymbolRec *f = simboloNo(t);
+    int32_t base = x->sp;
+
+    if (x->funcao[f->memloc] == NENHUM) return embutida(x, t, f);
+    for (No arg = filhoNo(x->arvore, t, 0); arg != NENHUM; arg = nos[arg].sibling) {
+        if (nos[arg].type == IntegerArray) {
+            int32_t b, tamanho;
+            array(x, arg, &b, &tamanho);
+            reservar(x, arg, 2);
+            x->mem[x->sp++] = b;
+            x->mem[x->sp++] = tamanho;
+        } else {
+            int32_t v = avaliar(x, arg);
+            reservar(x, arg, 1);
+            x->mem[x->sp++] = v;
+        }
+    }
+    return executarFuncao(x, t, f, base);
+}
+
+static int32_t avaliar(Interpretador *x, No t) {
+    const NoAst *n = &nos[t];
+    int32_t a, b;
+
+    if (n->nodekind == StmtK) {
+        if (n->kind == CallK) return chamar(x, t);
+        if (n->kind == AssignK) {
+            No lhs = filhoNo(x->arvore, t, 0);
+            int32_t e;
+
+            if (lhs != NENHUM && nos[lhs].kind == ArrIdK) {
+                e = elemento(x, t, filhoNo(x->arvore, lhs, 0));
+                a = avaliar(x, filhoNo(x->arvore, t, 1));
+            } else {
+                a = avaliar(x, filhoNo(x->arvore, t, 1));
+                e = endereco(x, t);
+            }
+            x->mem[e] = a;
+            return a;
+        }
+        return 0;
+    }
+
+    switch (n->kind) {
+    case ConstK:
+        return valorNo(x->arvore, t);
+    case IdK:
+        return x->mem[endereco(x, t)];
+    case ArrIdK:
+        return x->mem[elemento(x, t, filhoNo(x->arvore, t, 0))];
+    default:
+        a = avaliar(x, filhoNo(x->arvore, t, 0));
+        b = avaliar(x, filhoNo(x->arvore, t, 1));
+        return calcular(x, t, opNo(x->arvore, t), a, b);
+    }
+}
+
+/* ---------------------- Comandos ---------------------- */
+
+/* Devolvem TRUE quando um return foi executado */
+static int executar(Interpretador *x, No t) {
+    const NoAst *n = &nos[t];
+    No e;
+
+    if (n->nodekind == ExpK) {
+        avaliar(x, t);
+        return FALSE;
+    }
+    switch (n->kind) {
+    case IfK:
+        if (avaliar(x, filhoNo(x->arvore, t, 0)))
+            return executarLista(x, filhoNo(x->arvore, t, 1));
+        return executarLista(x, filhoNo(x->arvore, t, 2));
+    case WhileK:
+        while (avaliar(x, filhoNo(x->arvore, t, 0)))
+            if (executarLista(x, filhoNo(x->arvore, t, 1))) return TRUE;
+        return FALSE;
+    case ReturnK:
+        e = filhoNo(x->arvore, t, 0);
+        x->retorno = e != NENHUM ? avaliar(x, e) : 0;
+        return TRUE;
+    case CompoundK:
+        return executarLista(x, filhoNo(x->arvore, t, 1));
+    case AssignK:
+    case CallK:
+        avaliar(x, t);
+        return FALSE;
+    default:
+        return FALSE;        /* declarações: o espaço já está no quadro */
+    }
+}
+
+static int executarLista(Interpretador *x, No t) {
+    for (; t != NENHUM; t = nos[t].sibling)
+        if (executar(x, t)) return TRUE;
+    return FALSE;
+}
+
+/* ---------------------- Memória ---------------------- */
+
+/* Locais declaradas em t e nos seus descendentes, depois de *fim */
+static void reservarLocais(Interpretador *x, No t, int32_t *fim) {
+    for (; t != NENHUM; t = nos[t].sibling) {
+        if (nos[t].nodekind == StmtK && nos[t].kind == VarDeclK) {
+            Lugar *l = &x->lugar[simboloNo(t)->memloc];
+            l->tipo = LUGAR_LOCAL;
+            l->endereco = *fim;
+            l->tamanho = nos[t].type == IntegerArray ? tamanhoArrayNo(x->arvore, t) : 0;
+            *fim += l->tamanho > 0 ? l->tamanho : 1;
+        }
+        for (int i = 0; i < nos[t].nfilhos; i++) reservarLocais(x, filhoNo(x->arvore, t, i), fim);
+    }
+}
+
+/* Globais no início da memória; parâmetros e locais de cada função */
+static void organizar(Interpretador *x) {
+    int nsimbolos, ndecls;
+    No *decls = declaracoesGlobais(x->arvore, &ndecls);
+    int32_t globais = 0;
+
+    st_declaracoes(&nsimbolos);
+    x->lugar = (Lugar *)arenaAlloc((nsimbolos + 1) * sizeof(Lugar));
+    x->funcao = (No *)arenaAlloc((nsimbolos + 1) * sizeof(No));
+    x->quadro = (int32_t *)arenaAlloc((nsimbolos + 1) * sizeof(int32_t));
+    x->main = NENHUM;
+    for (int i = 0; i < ndecls; i++) {
+        No d = decls[i];
+        SymbolRec *s = simboloNo(d);
+
+        if (nos[d].kind == VarDeclK) {
+            Lugar *l = &x->lugar[s->memloc];
+            l->tipo = LUGAR_GLOBAL;
+            l->endereco = globais;
+            l->tamanho = nos[d].type == IntegerArray ? tamanhoArrayNo(x->arvore, d) : 0;
+            globais += l->tamanho > 0 ? l->tamanho : 1;
+        } else if (nos[d].kind == FunDeclK) {
+            int32_t fim = 0;
+
+            for (No p = filhoNo(x->arvore, d, 0); p != NENHUM; p = nos[p].sibling) {
+                Lugar *l;
+                if (nomeNo(x->arvore, p) == NULL) continue;     /* (void) */
+                l = &x->lugar[simboloNo(p)->memloc];
+                l->tipo = nos[p].type == IntegerArray ? LUGAR_REFERENCIA : LUGAR_LOCAL;
+                l->endereco = fim;
+                fim += l->tipo == LUGAR_REFERENCIA ? 2 : 1;
+            }
+            reservarLocais(x, filhoNo(x->arvore, d, 1), &fim);
+            x->funcao[s->memloc] = d;
+            x->quadro[s->memloc] = fim;
+            if (s->name == sessaoAtual->analise.nomeMain) x->main = d;
+        }
+    }
+
+    x->capacidade = 1024;
+    while (x->capacidade < 2 * globais) x->capacidade *= 2;
+    x->mem = (int32_t *)calloc((size_t)x->capacidade, sizeof(int32_t));
+    if (x->mem == NULL) abortarSessao(CM_ERRO_MEMORIA);
+    x->sp = globais;
+    x->fp = globais;
+}
+
+/* ---------------------- Execução ---------------------- */
+
+static void *rodar(void *arg) {
+    Interpretador *x = (Interpretador *)arg;
+
+    sessaoAtual = x->sessao;
+    if (setjmp(x->erro) == 0) {
+        executarFuncao(x, x->main, simboloNo(x->main), x->sp);
+        x->terminou = TRUE;
+    }
+    fflush(x->saida);
+    return NULL;
+}
+
+int interpretar(ArvoreCompacta *arvore, FILE *entrada, FILE *saida) {
+    Interpretador x;
+    pthread_attr_t atributos;
+    pthread_t thread;
+    int criada;
+
+    memset(&x, 0, sizeof(x));
+    x.arvore = arvore;
+    x.sessao = sessaoAtual;
+    x.entrada = entrada;
+    x.saida = saida;
+    x.nomeInput = sessaoAtual->analise.nomeInput;
+    organizar(&x);
+
+    if (x.main == NENHUM) {
+        free(x.mem);
+        return FALSE;
+    }
+
+    pthread_attr_init(&atributos);
+    pthread_attr_setstacksize(&atributos, PILHA_THREAD);
+    criada = pthread_create(&thread, &atributos, rodar, &x) == 0;
+    pthread_attr_destroy(&atributos);
+    if (criada) pthread_join(thread, NULL);
+    else rodar(&x);
+    free(x.mem);
+    return x.terminou;
+}
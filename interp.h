@@ -0,0 +1,32 @@
+/* interp.h - Interpretador da árvore */
+
+#ifndef INTERP_H
+#define INTERP_H
+
+#include "globals.h"
+#include "ast.h"
+
+/*
+ * Executa o programa percorrendo a árvore já verificada (após typeCheck
+ * e a dobra de constantes), a partir de main. input() lê um inteiro de
+ * entrada e output(x) escreve x e uma quebra de linha em saida.
+ *
+ * A memória é um vetor de inteiros de 32 bits: os globais no início e,
+ * acima deles, um quadro por chamada com os parâmetros (na ordem da
+ * declaração) e todas as locais da função, zeradas na entrada. Um array
+ * passado como argumento vai por referência: o parâmetro guarda o
+ * endereço e o tamanho do array de quem chamou. A aritmética é a de 32
+ * bits da execução (ir.h); divisão por zero, INT32_MIN / -1, índice fora
+ * do array, entrada esgotada e recursão profunda demais interrompem o
+ * programa com uma mensagem na saída da sessão. A recursão do programa é
+ * a do próprio interpretador, que roda numa thread com pilha grande.
+ *
+ * Devolve TRUE se main terminou.
+ */
+int interpretar(ArvoreCompacta *arvore, FILE *entrada, FILE *saida);
+
+/* Limites da execução, os mesmos nos outros executores (vm.h) */
+#define LIMITE_CHAMADAS   200000                /* chamadas aninhadas */
+#define LIMITE_MEMORIA    ((int32_t)1 << 28)    /* palavras */
+
+#endif
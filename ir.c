@@ -0,0 +1,248 @@
+/* Código de três endereços (ir.c) */
+
+#include "globals.h"
+#include "ir.h"
+#include "arena.h"
+
+#include <string.h>
+
+#define QUADS_INICIAIS 256
+
+CodigoIR *novoIR(SymbolRec **simbolos, int nsimbolos) {
+    CodigoIR *c = (CodigoIR *)arenaAlloc(sizeof(CodigoIR));
+    c->simbolos = simbolos;
+    c->nsimbolos = nsimbolos;
+    return c;
+}
+
+/* Como a tabela de símbolos, o vetor antigo fica na arena */
+static void reservar(CodigoIR *c, uint32_t n) {
+    uint32_t cap = c->capacidade ? c->capacidade : QUADS_INICIAIS;
+    Quad *q;
+
+    if (n <= c->capacidade) return;
+    while (cap < n) cap *= 2;
+    q = (Quad *)arenaAlloc(cap * sizeof(Quad));
+    if (c->n > 0) memcpy(q, c->quads, c->n * sizeof(Quad));
+    c->quads = q;
+    c->capacidade = cap;
+}
+
+void irEmitir(CodigoIR *c, OpIR op, Operando r, Operando a, Operando b) {
+    Quad *q;
+
+    if (c->n == c->capacidade) reservar(c, c->n + 1);
+    q = &c->quads[c->n++];
+    q->op = (uint8_t)op;
+    q->r = r;
+    q->a = a;
+    q->b = b;
+}
+
+static void renumerar(Operando *o, int temps, int labels) {
+    if (o->tipo == OPR_TEMP) o->v += temps;
+    else if (o->tipo == OPR_LABEL) o->v += labels;
+}
+
+void irJuntar(CodigoIR *c, const CodigoIR *trecho) {
+    Quad *q;
+
+    reservar(c, c->n + trecho->n);
+    q = &c->quads[c->n];
+    if (trecho->n > 0) memcpy(q, trecho->quads, trecho->n * sizeof(Quad));
+    for (uint32_t i = 0; i < trecho->n; i++) {
+        renumerar(&q[i].r, c->ntemps, c->nlabels);
+        renumerar(&q[i].a, c->ntemps, c->nlabels);
+        renumerar(&q[i].b, c->ntemps, c->nlabels);
+    }
+    c->n += trecho->n;
+    c->ntemps += trecho->ntemps;
+    c->nlabels += trecho->nlabels;
+}
+
+/* Novo número de cada temporário e label, na ordem em que aparecem */
+typedef struct {
+    int32_t *temps, *labels;
+    int ntemps, nlabels;
+} Renumeracao;
+
+static void renumerarOperando(Renumeracao *m, Operando *o) {
+    if (o->tipo == OPR_TEMP) {
+        if (m->temps[o->v] < 0) m->temps[o->v] = m->ntemps++;
+        o->v = m->temps[o->v];
+    } else if (o->tipo == OPR_LABEL) {
+        if (m->labels[o->v] < 0) m->labels[o->v] = m->nlabels++;
+        o->v = m->labels[o->v];
+    }
+}
+
+void irCompactar(CodigoIR *c) {
+    Renumeracao m;
+    int32_t maxTemp = -1, maxLabel = -1;
+    uint8_t *usado;
+    uint32_t n = 0;
+
+    for (uint32_t i = 0; i < c->n; i++) {
+        Operando *o[3] = {&c->quads[i].r, &c->quads[i].a, &c->quads[i].b};
+        for (int k = 0; k < 3; k++) {
+            if (o[k]->tipo == OPR_TEMP && o[k]->v > maxTemp) maxTemp = o[k]->v;
+            else if (o[k]->tipo == OPR_LABEL && o[k]->v > maxLabel) maxLabel = o[k]->v;
+        }
+    }
+    m.temps = (int32_t *)arenaAlloc((maxTemp + 1) * sizeof(int32_t) + 1);
+    m.labels = (int32_t *)arenaAlloc((maxLabel + 1) * sizeof(int32_t) + 1);
+    usado = (uint8_t *)arenaAlloc(maxLabel + 2);
+    memset(m.temps, 0xff, (maxTemp + 1) * sizeof(int32_t));
+    memset(m.labels, 0xff, (maxLabel + 1) * sizeof(int32_t));
+    m.ntemps = m.nlabels = 0;
+
+    /* goto para um dos labels logo a seguir */
+    for (uint32_t i = 0; i < c->n; i++) {
+        if (c->quads[i].op != IR_GOTO) continue;
+        for (uint32_t j = i + 1; j < c->n && (c->quads[j].op == IR_NOP || c->quads[j].op == IR_LABEL); j++) {
+            if (c->quads[j].op == IR_LABEL && c->quads[j].a.v == c->quads[i].a.v) {
+                c->quads[i].op = IR_NOP;
+                break;
+            }
+        }
+    }
+    for (uint32_t i = 0; i < c->n; i++) {
+        const Quad *q = &c->quads[i];
+        if (q->op == IR_GOTO) usado[q->a.v] = 1;
+        else if (q->op == IR_IFFALSE) usado[q->b.v] = 1;
+    }
+    for (uint32_t i = 0; i < c->n; i++) {
+        Quad q = c->quads[i];
+
+        if (q.op == IR_NOP || (q.op == IR_LABEL && !usado[q.a.v])) continue;
+        renumerarOperando(&m, &q.r);
+        renumerarOperando(&m, &q.a);
+        renumerarOperando(&m, &q.b);
+        c->quads[n++] = q;
+    }
+    c->n = n;
+    c->ntemps = m.ntemps;
+    c->nlabels = m.nlabels;
+}
+
+CodigoIR *irExtrair(const CodigoIR *c, uint32_t inicio, uint32_t fim) {
+    CodigoIR *t = novoIR(c->simbolos, c->nsimbolos);
+
+    reservar(t, fim - inicio);
+    memcpy(t->quads, &c->quads[inicio], (fim - inicio) * sizeof(Quad));
+    t->n = fim - inicio;
+    irCompactar(t);
+    return t;
+}
+
+int irCalcular(OpIR op, int32_t a, int32_t b, int32_t *r) {
+    switch (op) {
+    case IR_ADD: *r = (int32_t)((uint32_t)a + (uint32_t)b); break;
+    case IR_SUB: *r = (int32_t)((uint32_t)a - (uint32_t)b); break;
+    case IR_MUL: *r = (int32_t)((uint32_t)a * (uint32_t)b); break;
+    case IR_DIV:
+        if (b == 0 || (a == INT32_MIN && b == -1)) return FALSE;
+        *r = a / b;
+        break;
+    case IR_SHL: *r = (int32_t)((uint32_t)a << (b & 31)); break;
+    case IR_LT: *r = a < b; break;
+    case IR_LE: *r = a <= b; break;
+    case IR_GT: *r = a > b; break;
+    case IR_GE: *r = a >= b; break;
+    case IR_EQ: *r = a == b; break;
+    case IR_NE: *r = a != b; break;
+    default: return FALSE;
+    }
+    return TRUE;
+}
+
+const char *textoOperador(OpIR op) {
+    switch (op) {
+    case IR_ADD: return "+";
+    case IR_SUB: return "-";
+    case IR_MUL: return "*";
+    case IR_DIV: return "/";
+    case IR_SHL: return "<<";
+    case IR_LT: return "<";
+    case IR_LE: return "<=";
+    case IR_GT: return ">";
+    case IR_GE: return ">=";
+    case IR_EQ: return "==";
+    case IR_NE: return "!=";
+    default: return "?";
+    }
+}
+
+/* Texto de um operando em buf (nomes são devolvidos diretamente) */
+static const char *texto(const CodigoIR *c, Operando o, char *buf) {
+    switch (o.tipo) {
+    case OPR_VAR: return c->simbolos[o.v]->name;
+    case OPR_TEMP: sprintf(buf, "t%d", o.v); return buf;
+    case OPR_CONST: sprintf(buf, "%d", o.v); return buf;
+    case OPR_LABEL: sprintf(buf, "L%d", o.v); return buf;
+    default: return "";
+    }
+}
+
+void escreverQuad(FILE *f, const CodigoIR *c, const Quad *q) {
+    char r[16], a[16], b[16];
+
+    switch (q->op) {
+    case IR_FUNC:
+        fprintf(f, "func %s:", texto(c, q->a, a));
+        break;
+    case IR_PARAM:
+    case IR_ARG:
+        fprintf(f, "param %s", texto(c, q->a, a));
+        break;
+    case IR_ENDFUNC:
+        fprintf(f, "endfunc %s", texto(c, q->a, a));
+        break;
+    case IR_VAR:
+        if (q->b.tipo == OPR_CONST)
+            fprintf(f, "var %s[%d]", texto(c, q->a, a), q->b.v);
+        else
+            fprintf(f, "var %s", texto(c, q->a, a));
+        break;
+    case IR_LABEL:
+        fprintf(f, "%s:", texto(c, q->a, a));
+        break;
+    case IR_GOTO:
+        fprintf(f, "goto %s", texto(c, q->a, a));
+        break;
+    case IR_IFFALSE:
+        fprintf(f, "if_false %s goto %s", texto(c, q->a, a), texto(c, q->b, b));
+        break;
+    case IR_COPY:
+        fprintf(f, "%s = %s", texto(c, q->r, r), texto(c, q->a, a));
+        break;
+    case IR_LOAD:
+        fprintf(f, "%s = %s[%s]", texto(c, q->r, r), texto(c, q->a, a), texto(c, q->b, b));
+        break;
+    case IR_STORE:
+        fprintf(f, "%s[%s] = %s", texto(c, q->r, r), texto(c, q->a, a), texto(c, q->b, b));
+        break;
+    case IR_CALL:
+        fprintf(f, "%s = call %s", texto(c, q->r, r), texto(c, q->a, a));
+        break;
+    case IR_RETURN:
+        if (q->a.tipo != OPR_NADA) fprintf(f, "return %s", texto(c, q->a, a));
+        else fprintf(f, "return");
+        break;
+    case IR_NOP:
+        fprintf(f, "nop");
+        break;
+    default:
+        fprintf(f, "%s = %s %s %s", texto(c, q->r, r), texto(c, q->a, a),
+                textoOperador((OpIR)q->op), texto(c, q->b, b));
+        break;
+    }
+}
+
+void imprimirIR(FILE *f, const CodigoIR *c) {
+    for (uint32_t i = 0; i < c->n; i++) {
+        if (c->quads[i].op == IR_FUNC) fputc('\n', f);
+        escreverQuad(f, c, &c->quads[i]);
+        fputc('\n', f);
+    }
+}
@@ -0,0 +1,122 @@
+/* ir.h - Código de três endereços em memória */
+
+#ifndef IR_H
+#define IR_H
+
+#include "globals.h"
+#include "symtab.h"
+
+#include <stdint.h>
+
+/*
+ * O cgen traduz a árvore para um vetor de quádruplas (op, r, a, b), que
+ * imprimirIR() escreve no formato textual de sempre. Os operandos são
+ * inteiros marcados com o tipo: variáveis e funções pelo memloc da
+ * declaração (simbolos[memloc]), temporários e labels pelo número e
+ * constantes pelo valor.
+ *
+ *   IR_FUNC     func a:                 a: função
+ *   IR_PARAM    param a                 parâmetro formal; b = 1 se array
+ *   IR_ENDFUNC  endfunc a
+ *   IR_VAR      var a / var a[b]        b: tamanho (constante) ou nada
+ *   IR_LABEL    a:
+ *   IR_GOTO     goto a
+ *   IR_IFFALSE  if_false a goto b
+ *   IR_COPY     r = a
+ *   IR_ADD..    r = a op b
+ *   IR_SHL      r = a << b              b: constante (x * 2^b, da dobra)
+ *   IR_LOAD     r = a[b]
+ *   IR_STORE    r[a] = b
+ *   IR_ARG      param a                 argumento da próxima chamada
+ *   IR_CALL     r = call a              b: número de argumentos
+ *   IR_RETURN   return a / return
+ *   IR_NOP      (removida; só existe durante as otimizações)
+ */
+
+typedef enum {
+    IR_FUNC, IR_PARAM, IR_ENDFUNC, IR_VAR,
+    IR_LABEL, IR_GOTO, IR_IFFALSE,
+    IR_COPY,
+    IR_ADD, IR_SUB, IR_MUL, IR_DIV, IR_SHL,
+    IR_LT, IR_LE, IR_GT, IR_GE, IR_EQ, IR_NE,
+    IR_LOAD, IR_STORE,
+    IR_ARG, IR_CALL, IR_RETURN,
+    IR_NOP
+} OpIR;
+
+typedef enum {
+    OPR_NADA, OPR_VAR, OPR_TEMP, OPR_CONST, OPR_LABEL
+} TipoOperando;
+
+typedef struct {
+    uint8_t tipo;            /* TipoOperando */
+    int32_t v;
+} Operando;
+
+typedef struct {
+    uint8_t op;              /* OpIR */
+    Operando r, a, b;
+} Quad;
+
+typedef struct CodigoIR {
+    Quad *quads;
+    uint32_t n;
+    uint32_t capacidade;
+    int ntemps;              /* temporários t0 .. t(ntemps-1) */
+    int nlabels;
+    SymbolRec **simbolos;    /* declarações por memloc */
+    int nsimbolos;
+} CodigoIR;
+
+static inline Operando operando(TipoOperando tipo, int32_t v) {
+    Operando o;
+    o.tipo = (uint8_t)tipo;
+    o.v = v;
+    return o;
+}
+
+#define NADA operando(OPR_NADA, 0)
+
+/* Operações que escrevem em r (em IR_STORE, r é o array lido) */
+static inline int defineR(OpIR op) {
+    return op == IR_COPY || (op >= IR_ADD && op <= IR_NE) || op == IR_LOAD || op == IR_CALL;
+}
+
+/* Operações em que a e b, quando não são labels, são valores lidos (fora
+   delas, são a declaração ou a função chamada); em IR_STORE, r também */
+static inline int leOperandos(OpIR op) {
+    return op >= IR_IFFALSE && op <= IR_RETURN && op != IR_CALL;
+}
+
+/* Código vazio (memória da arena) */
+CodigoIR *novoIR(SymbolRec **simbolos, int nsimbolos);
+
+void irEmitir(CodigoIR *c, OpIR op, Operando r, Operando a, Operando b);
+
+/* Acrescenta as quádruplas de trecho ao fim de c; os temporários e labels
+   de trecho são renumerados depois dos de c */
+void irJuntar(CodigoIR *c, const CodigoIR *trecho);
+
+/* Cópia das quádruplas [inicio, fim) de c, com temporários e labels
+   renumerados a partir de 0 (irCompactar) */
+CodigoIR *irExtrair(const CodigoIR *c, uint32_t inicio, uint32_t fim);
+
+/* Remove as IR_NOP, os goto para o label seguinte e os labels sem
+   desvios para eles, e renumera temporários e labels na ordem em que
+   aparecem */
+void irCompactar(CodigoIR *c);
+
+/* a op b (IR_ADD..IR_NE) em 32 bits, como na execução; FALSE se não é
+   definido (divisão por zero, INT32_MIN / -1) */
+int irCalcular(OpIR op, int32_t a, int32_t b, int32_t *r);
+
+/* Operador de IR_ADD..IR_NE ("+", "<<", "<=", ...) */
+const char *textoOperador(OpIR op);
+
+/* Uma quádrupla em uma linha, sem o '\n' */
+void escreverQuad(FILE *f, const CodigoIR *c, const Quad *q);
+
+/* Listagem textual do código */
+void imprimirIR(FILE *f, const CodigoIR *c);
+
+#endif
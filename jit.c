@@ -0,0 +1,504 @@
+/* Execução do código x86-64 em memória (jit.c) */
+
+#include "globals.h"
+#include "jit.h"
+#include "interp.h"
+#include "arena.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) && !defined(_WIN32)
+
+#include <pthread.h>
+#include <setjmp.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+/* Pilha da thread, como a do runtime. Abaixo dela, uma guarda sem acesso
+   maior que o maior quadro (LIMITE_MEMORIA): um quadro que não cabe
+   sempre cai na guarda, nunca em outro mapeamento. */
+#define PILHA_THREAD  ((size_t)512 << 20)
+#define GUARDA_PILHA  ((size_t)LIMITE_MEMORIA * 4 + ((size_t)64 << 10))
+#define MARGEM_PILHA  ((size_t)256 << 10)   /* para as funções de C chamadas pelo programa */
+#define PILHA_SINAL   ((size_t)64 << 10)
+
+/* Funções do compilador chamadas pelo código */
+enum { EXTERNA_INPUT, EXTERNA_OUTPUT, EXTERNA_ERRO, NEXTERNAS };
+
+typedef enum { ALVO_ROTULO, ALVO_FUNCAO, ALVO_EXTERNA, ALVO_GLOBAL } TipoAlvo;
+
+/* rel32 em pos, relativo ao fim da instrução */
+typedef struct {
+    uint32_t pos, fim;
+    uint8_t tipo;            /* TipoAlvo */
+    int32_t v;               /* label, memloc ou externa */
+} Correcao;
+
+typedef struct {
+    const CodigoX64 *x;
+    uint8_t *bytes;
+    uint32_t n, capacidade;
+    Correcao *correcoes;
+    uint32_t ncorrecoes, capCorrecoes;
+    int32_t *rotulos;        /* por label: posição no código */
+    int32_t *funcoes;        /* por memloc: posição da função */
+    int64_t *globais;        /* por memloc: posição nos globais */
+    int32_t externas[NEXTERNAS];  /* posição do salto indireto; -1: não é chamada */
+} Montador;
+
+/* ---------------------- Codificação ---------------------- */
+
+/* Vetores da arena que dobram de tamanho, como as instruções (x64.c) */
+static void byte(Montador *m, int b) {
+    if (m->n == m->capacidade) {
+        uint32_t cap = m->capacidade ? m->capacidade * 2 : 4096;
+        uint8_t *novo = (uint8_t *)arenaAlloc(cap);
+        if (m->n > 0) memcpy(novo, m->bytes, m->n);
+        m->bytes = novo;
+        m->capacidade = cap;
+    }
+    m->bytes[m->n++] = (uint8_t)b;
+}
+
+static void imediato32(Montador *m, int32_t v) {
+    for (int k = 0; k < 4; k++) byte(m, (int)((uint32_t)v >> (8 * k) & 0xFF));
+}
+
+static void imediato64(Montador *m, uint64_t v) {
+    for (int k = 0; k < 8; k++) byte(m, (int)(v >> (8 * k) & 0xFF));
+}
+
+/* rel32 a corrigir quando as posições forem conhecidas */
+static void corrigir(Montador *m, TipoAlvo tipo, int32_t v) {
+    Correcao *c;
+
+    if (m->ncorrecoes == m->capCorrecoes) {
+        uint32_t cap = m->capCorrecoes ? m->capCorrecoes * 2 : 256;
+        Correcao *novo = (Correcao *)arenaAlloc(cap * sizeof(Correcao));
+        if (m->ncorrecoes > 0) memcpy(novo, m->correcoes, m->ncorrecoes * sizeof(Correcao));
+        m->correcoes = novo;
+        m->capCorrecoes = cap;
+    }
+    c = &m->correcoes[m->ncorrecoes++];
+    c->pos = m->n;
+    c->tipo = (uint8_t)tipo;
+    c->v = v;
+    imediato32(m, 0);
+}
+
+static int cabe8(int32_t v) {
+    return v >= -128 && v <= 127;
+}
+
+/* Prefixo REX: w (64 bits), reg no campo reg da ModRM e o no r/m; com
+   byte8, o é de 8 bits (spl, bpl, sil e dil só existem com REX) */
+static void rex(Montador *m, int w, int reg, OperandoX64 o, int byte8) {
+    int r = 0x40 | (w ? 8 : 0) | (reg >> 3 & 1) << 2;
+    int obrigatorio = FALSE;
+
+    if (o.tipo == XO_REG) {
+        r |= o.base >> 3;
+        obrigatorio = byte8 && o.base >= RSP && o.base <= RDI;
+    } else if (o.tipo == XO_MEM) {
+        r |= o.base >> 3;
+        if (o.indice != SEM_REG) r |= (o.indice >> 3) << 1;
+    }
+    if (r != 0x40 || obrigatorio) byte(m, r);
+}
+
+/* ModRM (e SIB e deslocamento) de reg e o; um global é relativo a rip */
+static void modrm(Montador *m, int reg, OperandoX64 o) {
+    reg &= 7;
+    if (o.tipo == XO_REG) {
+        byte(m, 0xC0 | reg << 3 | (o.base & 7));
+    } else if (o.tipo == XO_GLOBAL) {
+        byte(m, reg << 3 | 5);
+        corrigir(m, ALVO_GLOBAL, o.v);
+    } else {
+        /* rbp e r13 sem deslocamento seriam rip; rsp e r12 pedem SIB */
+        int mod = o.v == 0 && (o.base & 7) != RBP ? 0 : cabe8(o.v) ? 1 : 2;
+        int sib = o.indice != SEM_REG || (o.base & 7) == RSP;
+
+        byte(m, mod << 6 | reg << 3 | (sib ? 4 : o.base & 7));
+        if (sib) byte(m, (o.indice != SEM_REG ? 2 << 6 | (o.indice & 7) << 3 : 4 << 3) | (o.base & 7));
+        if (mod == 1) byte(m, o.v & 0xFF);
+        else if (mod == 2) imediato32(m, o.v);
+    }
+}
+
+/* op (0x0F seguido de um byte, se passa de 0xFF) com a ModRM de reg e o */
+static void codificar(Montador *m, int w, int op, int reg, OperandoX64 o, int byte8) {
+    rex(m, w, reg, o, byte8);
+    if (op > 0xFF) byte(m, op >> 8);
+    byte(m, op & 0xFF);
+    modrm(m, reg, o);
+}
+
+/* add, sub, cmp e xor: a extensão é também o opcode / 8 */
+static void aritmetica(Montador *m, const InstrX64 *i, int ext) {
+    if (i->s.tipo == XO_IMED) {
+        codificar(m, i->q, cabe8(i->s.v) ? 0x83 : 0x81, ext, i->d, FALSE);
+        if (cabe8(i->s.v)) byte(m, i->s.v & 0xFF);
+        else imediato32(m, i->s.v);
+    } else if (i->s.tipo == XO_REG) {
+        codificar(m, i->q, ext << 3 | 1, i->s.base, i->d, FALSE);
+    } else {
+        codificar(m, i->q, ext << 3 | 3, i->d.base, i->s, FALSE);
+    }
+}
+
+/* Chamada de uma função do programa, ou de input, output e
+   cm_erro_execucao, que são do compilador */
+static void chamar(Montador *m, int32_t memloc) {
+    const char *nome = memloc == X64_ERRO ? NULL : m->x->ir->simbolos[memloc]->name;
+
+    byte(m, 0xE8);
+    if (memloc == X64_ERRO) corrigir(m, ALVO_EXTERNA, EXTERNA_ERRO);
+    else if (nome == sessaoAtual->analise.nomeInput) corrigir(m, ALVO_EXTERNA, EXTERNA_INPUT);
+    else if (nome == sessaoAtual->analise.nomeOutput) corrigir(m, ALVO_EXTERNA, EXTERNA_OUTPUT);
+    else corrigir(m, ALVO_FUNCAO, memloc);
+}
+
+static void codificarInstr(Montador *m, const InstrX64 *i) {
+    switch ((OpX64)i->op) {
+    case X_ROTULO:
+        m->rotulos[i->d.v] = (int32_t)m->n;
+        return;
+    case X_FUNCAO:
+        /* int3 entre as funções, onde nada chega */
+        while (m->n % 16 != 0) byte(m, 0xCC);
+        m->funcoes[i->d.v] = (int32_t)m->n;
+        return;
+    case X_MOV:
+        if (i->s.tipo == XO_IMED && i->d.tipo == XO_REG && !i->q) {
+            rex(m, FALSE, 0, i->d, FALSE);
+            byte(m, 0xB8 | (i->d.base & 7));
+            imediato32(m, i->s.v);
+        } else if (i->s.tipo == XO_IMED) {
+            codificar(m, i->q, 0xC7, 0, i->d, FALSE);
+            imediato32(m, i->s.v);
+        } else if (i->s.tipo == XO_REG) {
+            codificar(m, i->q, 0x89, i->s.base, i->d, FALSE);
+        } else {
+            codificar(m, i->q, 0x8B, i->d.base, i->s, FALSE);
+        }
+        return;
+    case X_LEA:   codificar(m, i->q, 0x8D, i->d.base, i->s, FALSE); return;
+    case X_ADD:   aritmetica(m, i, 0); return;
+    case X_SUB:   aritmetica(m, i, 5); return;
+    case X_XOR:   aritmetica(m, i, 6); return;
+    case X_CMP:   aritmetica(m, i, 7); return;
+    case X_IMUL:
+        if (i->s.tipo == XO_IMED) {
+            codificar(m, i->q, cabe8(i->s.v) ? 0x6B : 0x69, i->d.base, i->d, FALSE);
+            if (cabe8(i->s.v)) byte(m, i->s.v & 0xFF);
+            else imediato32(m, i->s.v);
+        } else {
+            codificar(m, i->q, 0x0FAF, i->d.base, i->s, FALSE);
+        }
+        return;
+    case X_SHL:
+        if (i->s.tipo == XO_IMED) {
+            codificar(m, i->q, 0xC1, 4, i->d, FALSE);
+            byte(m, i->s.v & 31);
+        } else {
+            codificar(m, i->q, 0xD3, 4, i->d, FALSE);
+        }
+        return;
+    case X_CLTD:
+        if (i->q) byte(m, 0x48);
+        byte(m, 0x99);
+        return;
+    case X_IDIV:  codificar(m, i->q, 0xF7, 7, i->d, FALSE); return;
+    case X_SET:   codificar(m, FALSE, 0x0F90 | i->cc, 0, i->d, TRUE); return;
+    case X_MOVZB: codificar(m, FALSE, 0x0FB6, i->d.base, i->s, TRUE); return;
+    case X_JMP:
+        byte(m, 0xE9);
+        corrigir(m, ALVO_ROTULO, i->d.v);
+        return;
+    case X_JCC:
+        byte(m, 0x0F);
+        byte(m, 0x80 | i->cc);
+        corrigir(m, ALVO_ROTULO, i->d.v);
+        return;
+    case X_CALL:  chamar(m, i->d.v); return;
+    case X_RET:   byte(m, 0xC3); return;
+    case X_LEAVE: byte(m, 0xC9); return;
+    case X_PUSH: case X_POP:
+        rex(m, FALSE, 0, i->d, FALSE);
+        byte(m, (i->op == X_PUSH ? 0x50 : 0x58) | (i->d.base & 7));
+        return;
+    case X_REPSTOS:
+        byte(m, 0xF3);
+        byte(m, 0x48);
+        byte(m, 0xAB);
+        return;
+    }
+}
+
+/* ---------------------- Execução ---------------------- */
+
+typedef struct {
+    const CodigoJit *j;
+    CompilerSession *sessao;
+    FILE *entrada, *saida;
+    char *pilha;             /* base da pilha da thread, acima da guarda; NULL sem ela */
+    sigjmp_buf erro;
+    const char *motivo;
+    int terminou;
+} Execucao;
+
+static _Thread_local Execucao *execucaoAtual = NULL;
+
+/* Motivos de x64.h (ERRO_INDICE, ERRO_DIVISAO, ERRO_ESTOURO) */
+static const char *const motivos[] = {
+    "indice fora do array", "divisao por zero", "estouro na divisao"
+};
+
+static void falhar(const char *motivo) {
+    execucaoAtual->motivo = motivo;
+    siglongjmp(execucaoAtual->erro, 1);
+}
+
+/* Uma função de C que estoura a pilha não pode ser interrompida (ela pode
+   ter a trava de um FILE): perto da guarda, já é recursão demais */
+static void verificarPilha(void) {
+    char topo;
+    const Execucao *e = execucaoAtual;
+
+    if (e->pilha != NULL && (size_t)(&topo - e->pilha) < MARGEM_PILHA) falhar("recursao profunda demais");
+}
+
+static int jitInput(void) {
+    int v;
+
+    verificarPilha();
+    fflush(execucaoAtual->saida);
+    if (fscanf(execucaoAtual->entrada, "%d", &v) != 1) falhar("entrada esgotada ou invalida em input()");
+    return v;
+}
+
+static void jitOutput(int x) {
+    verificarPilha();
+    fprintf(execucaoAtual->saida, "%d\n", x);
+}
+
+static void jitErro(int motivo) {
+    falhar(motivo >= 0 && motivo < 3 ? motivos[motivo] : "erro desconhecido");
+}
+
+/* O tratador de SIGSEGV fica instalado só enquanto há execuções; o do
+   programa que nos usa é guardado e volta quando a última termina */
+static pthread_mutex_t travaTratador = PTHREAD_MUTEX_INITIALIZER;
+static int execucoesAtivas = 0;
+static struct sigaction anterior;
+
+/* Um acesso à guarda da pilha da thread é a recursão profunda demais;
+   qualquer outra falha vai para o tratamento anterior */
+static void estouroDaPilha(int sinal, siginfo_t *info, void *contexto) {
+    Execucao *e = execucaoAtual;
+    char *endereco = (char *)info->si_addr;
+
+    if (e != NULL && e->pilha != NULL && endereco < e->pilha && endereco >= e->pilha - GUARDA_PILHA) {
+        e->motivo = "recursao profunda demais";
+        siglongjmp(e->erro, 1);
+    }
+    if (anterior.sa_flags & SA_SIGINFO) {
+        anterior.sa_sigaction(sinal, info, contexto);
+    } else if (anterior.sa_handler != SIG_DFL && anterior.sa_handler != SIG_IGN) {
+        anterior.sa_handler(sinal);
+    } else {
+        /* ao voltar, a instrução falha de novo, agora com o padrão */
+        signal(sinal, SIG_DFL);
+    }
+}
+
+static void instalarTratador(void) {
+    struct sigaction acao;
+
+    pthread_mutex_lock(&travaTratador);
+    if (execucoesAtivas++ == 0) {
+        memset(&acao, 0, sizeof(acao));
+        acao.sa_sigaction = estouroDaPilha;
+        acao.sa_flags = SA_SIGINFO | SA_ONSTACK;
+        sigemptyset(&acao.sa_mask);
+        sigaction(SIGSEGV, &acao, &anterior);
+    }
+    pthread_mutex_unlock(&travaTratador);
+}
+
+static void restaurarTratador(void) {
+    pthread_mutex_lock(&travaTratador);
+    if (--execucoesAtivas == 0) sigaction(SIGSEGV, &anterior, NULL);
+    pthread_mutex_unlock(&travaTratador);
+}
+
+static void *rodar(void *arg) {
+    Execucao *e = (Execucao *)arg;
+    stack_t alternativa;
+
+    sessaoAtual = e->sessao;
+    execucaoAtual = e;
+    alternativa.ss_sp = malloc(PILHA_SINAL);
+    alternativa.ss_size = PILHA_SINAL;
+    alternativa.ss_flags = 0;
+    if (alternativa.ss_sp != NULL && sigaltstack(&alternativa, NULL) != 0) {
+        free(alternativa.ss_sp);
+        alternativa.ss_sp = NULL;
+    }
+    if (sigsetjmp(e->erro, 1) == 0) {
+        e->j->main();
+        e->terminou = TRUE;
+    }
+    fflush(e->saida);
+    if (alternativa.ss_sp != NULL) {
+        alternativa.ss_flags = SS_DISABLE;
+        sigaltstack(&alternativa, NULL);
+        free(alternativa.ss_sp);
+    }
+    execucaoAtual = NULL;
+    return NULL;
+}
+
+static size_t alinharPagina(size_t n, size_t pagina) {
+    return (n + pagina - 1) / pagina * pagina;
+}
+
+CodigoJit *montarJit(const CodigoX64 *x) {
+    static void *const externas[NEXTERNAS] = {
+        (void *)jitInput, (void *)jitOutput, (void *)jitErro
+    };
+    Montador m;
+    CodigoJit *j;
+    int32_t nrotulos = 0;
+    int64_t dados = 0;
+    size_t pagina = (size_t)sysconf(_SC_PAGESIZE), inicioDados, tamanho;
+    uint8_t *memoria;
+    uint32_t main = 0;
+
+    memset(&m, 0, sizeof(m));
+    m.x = x;
+    for (uint32_t i = 0; i < x->n; i++) {
+        const InstrX64 *in = &x->instrucoes[i];
+        if (in->op == X_ROTULO && in->d.v >= nrotulos) nrotulos = in->d.v + 1;
+        if (in->op == X_FUNCAO && x->ir->simbolos[in->d.v]->name == sessaoAtual->analise.nomeMain)
+            main = (uint32_t)in->d.v;
+    }
+    m.rotulos = (int32_t *)arenaAlloc((size_t)(nrotulos + 1) * sizeof(int32_t));
+    m.funcoes = (int32_t *)arenaAlloc((size_t)x->ir->nsimbolos * sizeof(int32_t));
+    m.globais = (int64_t *)arenaAlloc((size_t)x->ir->nsimbolos * sizeof(int64_t));
+    for (uint32_t g = 0; g < x->nglobais; g++) {
+        m.globais[x->globais[g]] = dados;
+        dados += (x->tamanhos[g] + 3) & ~(int64_t)3;
+    }
+    for (int k = 0; k < NEXTERNAS; k++) m.externas[k] = -1;
+
+    for (uint32_t i = 0; i < x->n; i++) {
+        uint32_t c = m.ncorrecoes;
+        codificarInstr(&m, &x->instrucoes[i]);
+        for (; c < m.ncorrecoes; c++) m.correcoes[c].fim = m.n;
+    }
+
+    /* jmp *0(%rip) seguido do endereço, para cada função do compilador */
+    for (uint32_t c = 0; c < m.ncorrecoes; c++) {
+        int k = m.correcoes[c].v;
+        if (m.correcoes[c].tipo != ALVO_EXTERNA || m.externas[k] >= 0) continue;
+        m.externas[k] = (int32_t)m.n;
+        byte(&m, 0xFF);
+        byte(&m, 0x25);
+        imediato32(&m, 0);
+        imediato64(&m, (uint64_t)(uintptr_t)externas[k]);
+    }
+
+    inicioDados = alinharPagina(m.n, pagina);
+    tamanho = inicioDados + alinharPagina((size_t)dados, pagina);
+    memoria = (uint8_t *)mmap(NULL, tamanho, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memoria == MAP_FAILED) return NULL;
+    memcpy(memoria, m.bytes, m.n);
+    for (uint32_t c = 0; c < m.ncorrecoes; c++) {
+        const Correcao *k = &m.correcoes[c];
+        int64_t alvo = k->tipo == ALVO_ROTULO ? m.rotulos[k->v] :
+                       k->tipo == ALVO_FUNCAO ? m.funcoes[k->v] :
+                       k->tipo == ALVO_EXTERNA ? m.externas[k->v] :
+                       (int64_t)inicioDados + m.globais[k->v];
+        int32_t rel = (int32_t)(alvo - (int64_t)k->fim);
+        memcpy(memoria + k->pos, &rel, sizeof(rel));
+    }
+    if (mprotect(memoria, inicioDados, PROT_READ | PROT_EXEC) != 0) {
+        munmap(memoria, tamanho);
+        return NULL;
+    }
+
+    j = (CodigoJit *)arenaAlloc(sizeof(CodigoJit));
+    j->memoria = memoria;
+    j->tamanho = tamanho;
+    j->codigo = m.n;
+    j->main = (int (*)(void))(uintptr_t)(memoria + m.funcoes[main]);
+    return j;
+}
+
+void liberarJit(CodigoJit *j) {
+    if (j != NULL) munmap(j->memoria, j->tamanho);
+}
+
+int executarJit(const CodigoJit *j, FILE *entrada, FILE *saida) {
+    Execucao e;
+    pthread_attr_t atributos;
+    pthread_t thread;
+    char *mapa;
+    int criada = FALSE;
+
+    memset(&e, 0, sizeof(e));
+    e.j = j;
+    e.sessao = sessaoAtual;
+    e.entrada = entrada;
+    e.saida = saida;
+    instalarTratador();
+
+    /* a guarda só reserva endereços; a pilha é escrita sob demanda */
+    mapa = (char *)mmap(NULL, GUARDA_PILHA + PILHA_THREAD, PROT_NONE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (mapa != MAP_FAILED && mprotect(mapa + GUARDA_PILHA, PILHA_THREAD, PROT_READ | PROT_WRITE) == 0) {
+        e.pilha = mapa + GUARDA_PILHA;
+        pthread_attr_init(&atributos);
+        pthread_attr_setstack(&atributos, e.pilha, PILHA_THREAD);
+        criada = pthread_create(&thread, &atributos, rodar, &e) == 0;
+        pthread_attr_destroy(&atributos);
+    }
+    if (criada) {
+        pthread_join(thread, NULL);
+    } else {
+        e.pilha = NULL;
+        rodar(&e);
+    }
+    restaurarTratador();
+    if (mapa != MAP_FAILED) munmap(mapa, GUARDA_PILHA + PILHA_THREAD);
+
+    if (!e.terminou) {
+        fprintf(listing, "\nERRO DE EXECUCAO: %s\n", e.motivo);
+        Error = TRUE;
+    }
+    return e.terminou;
+}
+
+#else
+
+CodigoJit *montarJit(const CodigoX64 *x) {
+    (void)x;
+    return NULL;
+}
+
+void liberarJit(CodigoJit *j) {
+    (void)j;
+}
+
+int executarJit(const CodigoJit *j, FILE *entrada, FILE *saida) {
+    (void)j;
+    (void)entrada;
+    (void)saida;
+    return FALSE;
+}
+
+#endif
@@ -0,0 +1,50 @@
+/* jit.h - Execução do código x86-64 em memória, sem as e ld */
+
+#ifndef JIT_H
+#define JIT_H
+
+#include "globals.h"
+#include "x64.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * As instruções da seleção (x64.h) são codificadas direto em código de
+ * máquina, num mapeamento anônimo com o código e, na página seguinte, os
+ * globais: o código é escrito com as páginas só de leitura e escrita e
+ * passa a leitura e execução antes de rodar (nunca as duas coisas ao
+ * mesmo tempo). Os desvios e as chamadas são sempre rel32 e os globais
+ * são relativos a rip, como no assembly; input, output e
+ * cm_erro_execucao chamam funções do próprio compilador por um salto
+ * indireto no fim do código, com a semântica do runtime (runtime.c) e a
+ * entrada e a saída dos outros executores (interp.h). Só em x86-64; nas
+ * outras máquinas montarJit devolve NULL.
+ */
+
+typedef struct CodigoJit {
+    uint8_t *memoria;        /* código e, alinhados à página, os globais */
+    size_t tamanho;          /* bytes mapeados */
+    uint32_t codigo;         /* bytes de código */
+    int (*main)(void);
+} CodigoJit;
+
+/* Codifica x num mapeamento novo (j na arena); NULL se a máquina não é
+   x86-64 ou se o mapeamento falhou. O mapeamento vive até liberarJit. */
+CodigoJit *montarJit(const CodigoX64 *x);
+
+/* Desfaz o mapeamento de j */
+void liberarJit(CodigoJit *j);
+
+/*
+ * Executa main numa thread com pilha grande, como o runtime: input() lê
+ * de entrada e output(x) escreve em saida. Os erros de execução (os de
+ * x64.h, entrada esgotada e recursão profunda demais, que é o estouro da
+ * pilha da thread) interrompem o programa com a mensagem na saída da
+ * sessão. Devolve TRUE se main terminou. Durante a execução, SIGSEGV é
+ * tratado aqui; as falhas fora da guarda da pilha vão para o tratador
+ * que já estava instalado, que volta quando a última execução termina.
+ */
+int executarJit(const CodigoJit *j, FILE *entrada, FILE *saida);
+
+#endif
@@ -1,153 +1,774 @@
 /*
  * Compilador para Linguagem C-
  * Arquivo principal
+ *
+ * Com um único arquivo, a listagem vai direto para stdout. Com vários
+ * arquivos (ou uma lista @arquivo), cada um é compilado numa sessão
+ * própria por um pool de threads (pool.h); as listagens saem na ordem
+ * dos argumentos e, ao final, os tempos de cada fase vão para stderr.
+ * Com --funcoes, as funções de cada arquivo também são verificadas e
+ * traduzidas em paralelo, no mesmo pool.
+ *
+ * Sem a listagem completa (-q, ou no modo em lote sem --listagem), a
+ * saída tem só os artefatos pedidos (--tokens, --tabela, --dot, --cfg,
+ * --codigo, --bytecode, --asm) e os diagnósticos vão para stderr.
+ * --listagem vence -q nos dois modos.
+ *
+ * Com --run, um único arquivo é executado pelo interpretador da árvore
+ * (interp.h) depois da análise: input() lê de stdin e output() escreve
+ * em stdout. Com --vm, a execução é a do bytecode (vm.h), e --bytecode
+ * grava o bytecode na codificação binária.
+ *
+ * Com --asm, o código x86-64 (x64.h) sai em assembly do GNU as, para
+ * ligar com runtime.c; com --jit, o mesmo código é executado em memória
+ * (jit.h), como --run.
  */
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <pthread.h>
 #include "globals.h"
+#include "sessao.h"
+#include "pool.h"
 #include "util.h"
-#include "scan.h"
-#include "parse.h"
-#include "analyze.h"
-#include "symtab.h"
-#include "cgen.h"
-
-int lineno = 0;
-FILE *source;
-FILE *listing;
-int EchoSource = FALSE;
-int TraceScan = FALSE;
-int TraceParse = FALSE;
-int TraceAnalyze = FALSE;
-int TraceCode = FALSE;
-int Error = FALSE;
-int SemanticError = FALSE;
 
-int main(int argc, char *argv[]) {
-    TreeNode *arvore_sintatica;
-    char pgm[120];
-    char baseName[120];
-    char dotFilename[150];
-    char pngFilename[150];
-    
-    if (argc != 2) {
-        fprintf(stderr, "Uso: %s <arquivo.cm>\n", argv[0]);
-        exit(1);
+#define MAXCAMINHO 1024
+
+/* Buffer de stdout e dos artefatos: as listagens saem em poucas escritas */
+#define BUFFER_SAIDA (1 << 20)
+
+static int mostrarMemoria = FALSE;
+
+/* --funcoes: as funções de cada arquivo também são divididas entre as
+   threads (sessaoUsarPool) */
+static int funcoesParalelas = FALSE;
+static Pool *poolFuncoes = NULL;
+
+/* Artefatos pedidos (--tokens, --tabela, --dot, --cfg, --codigo,
+   --bytecode, --asm): NULL =
+   não emitido, "" = na saída (para os .dot, o nome padrão), senão o
+   arquivo, com %s trocado pelo nome base da entrada */
+static struct {
+    const char *tokens;
+    const char *tabela;
+    const char *dot;
+    const char *cfg;
+    const char *codigo;
+    const char *bytecode;
+    const char *assembly;
+} artefatos;
+
+/* Listagem completa, com os banners de cada fase: o padrão com um único
+   arquivo. Sem ela (-q, ou em lote) só saem diagnósticos e artefatos. */
+static int listagemCompleta = TRUE;
+
+/* --png: o Graphviz gera ast_<nome>.png em segundo plano (implica --dot) */
+static int gerarPng = FALSE;
+
+/* --run, --vm e --jit: executa o programa depois da análise, percorrendo
+   a árvore (sessaoExecutar), na máquina virtual (sessaoExecutarBytecode)
+   ou em código nativo na memória (sessaoExecutarJit) */
+#define EXECUTAR_ARVORE 1
+#define EXECUTAR_VM     2
+#define EXECUTAR_JIT    3
+static int executarPrograma = 0;
+
+/* -O (1) ou -O2 (2, numeração de valores global): código intermediário otimizado (otimiza.h) */
+static int otimizar = 0;
+
+/* Tempo de cada fase de uma compilação, em segundos, e o resultado da
+   dobra de constantes e das otimizações */
+typedef struct {
+    double carregar;
+    double parse;
+    double analise;
+    double saidas;      /* tabela de símbolos e DOT */
+    double codigo;
+    int economizadas;   /* instruções a menos (dobra.h) */
+    int desvios;        /* if_false eliminados (otimiza.h) */
+    int reaproveitados; /* operações que reaproveitam um valor (otimiza.h) */
+    int removidas;      /* instruções a menos (otimiza.h) */
+} Tempos;
+
+static double agora(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Alocações e pico de RSS (--memoria); a sessão é liberada */
+static int terminar(CompilerSession *sessao, FILE *erros, int status) {
+    if (mostrarMemoria) sessaoImprimirMemoria(sessao, erros);
+    destruirSessao(sessao);
+    return status;
+}
+
+/* Nome de saída a partir de modelo, com cada %s trocado por base */
+static void formatarNome(char *dest, size_t n, const char *modelo, const char *base) {
+    size_t k = 0;
+
+    while (*modelo != '\0' && k + 1 < n) {
+        if (modelo[0] == '%' && modelo[1] == 's') {
+            for (const char *b = base; *b != '\0' && k + 1 < n; b++) dest[k++] = *b;
+            modelo += 2;
+        } else {
+            dest[k++] = *modelo++;
+        }
+    }
+    dest[k] = '\0';
+}
+
+/* Destino de um artefato: padrao se o modelo é "", senão o arquivo */
+static FILE *abrirArtefato(const char *modelo, const char *base, FILE *padrao, FILE *erros) {
+    char nome[MAXCAMINHO];
+    FILE *f;
+
+    if (modelo[0] == '\0') return padrao;
+    formatarNome(nome, sizeof(nome), modelo, base);
+    f = fopen(nome, "w");
+    if (f == NULL) fprintf(erros, "Erro: Nao foi possivel criar %s\n", nome);
+    else setvbuf(f, NULL, _IOFBF, BUFFER_SAIDA);
+    return f;
+}
+
+static void fecharArtefato(FILE *f, FILE *padrao) {
+    if (f != NULL && f != padrao) fclose(f);
+}
+
+static ResultadoSessao executar(CompilerSession *sessao, FILE *saida) {
+    if (executarPrograma == EXECUTAR_VM) return sessaoExecutarBytecode(sessao, stdin, saida);
+    if (executarPrograma == EXECUTAR_JIT) return sessaoExecutarJit(sessao, stdin, saida);
+    return sessaoExecutar(sessao, stdin, saida);
+}
+
+/* Listagem completa: banners de cada fase, tabela, DOT e código */
+static int gerarListagem(CompilerSession *sessao, const char *pgm, const char *base,
+                         const char *dotFilename, const char *pngFilename, const char *cfgFilename,
+                         FILE *saida, FILE *erros, Tempos *tempos) {
+    ResultadoSessao r;
+    FILE *tabela = NULL, *codigo = NULL;
+    double t0;
+
+    if (artefatos.tabela != NULL &&
+        (tabela = abrirArtefato(artefatos.tabela, base, NULL, erros)) == NULL &&
+        artefatos.tabela[0] != '\0')
+        return terminar(sessao, erros, 1);
+    if (artefatos.codigo != NULL &&
+        (codigo = abrirArtefato(artefatos.codigo, base, NULL, erros)) == NULL &&
+        artefatos.codigo[0] != '\0') {
+        fecharArtefato(tabela, NULL);
+        return terminar(sessao, erros, 1);
+    }
+
+    fprintf(saida, "\n========================================\n");
+    fprintf(saida, "    COMPILADOR C- - UNIFESP\n");
+    fprintf(saida, "========================================\n");
+    fprintf(saida, "Arquivo: %s\n", pgm);
+    fprintf(saida, "========================================\n\n");
+
+    /* FASE 1: Análise Léxica e Sintática */
+    fprintf(saida, "=== ANALISE LEXICA E SINTATICA ===\n");
+    t0 = agora();
+    r = sessaoParse(sessao);
+    tempos->parse += agora() - t0;
+
+    if (r == CM_ERRO_SINTATICO || r == CM_ERRO_MEMORIA) {
+        fprintf(saida, "\n========================================\n");
+        fprintf(saida, "COMPILACAO ABORTADA: Erros detectados na analise\n");
+        fprintf(saida, "========================================\n");
+        goto falhou;
+    }
+    if (r != CM_OK) {
+        fprintf(saida, "\n========================================\n");
+        fprintf(saida, "COMPILACAO ABORTADA: Erros detectados na analise\n");
+        fprintf(saida, "========================================\n");
+        fprintf(saida, "\nPara recompilar o programa, execute:\n");
+        fprintf(saida, "  gcc -o compilador.exe main.c scan.c parse.c analyze.c symtab.c util.c cgen.c\n");
+        fprintf(saida, "\nDepois execute novamente:\n");
+        fprintf(saida, "  compilador.exe %s\n\n", pgm);
+        goto falhou;
+    }
+    fprintf(saida, "OK - Analise lexica e sintatica concluida com sucesso\n\n");
+
+    /* FASE 2: Análise Semântica */
+    fprintf(saida, "=== ANALISE SEMANTICA ===\n");
+    t0 = agora();
+    r = sessaoAnalisar(sessao);
+    tempos->analise += agora() - t0;
+
+    if (r == CM_ERRO_SEMANTICO) {
+        fprintf(saida, "\n========================================\n");
+        fprintf(saida, "COMPILACAO ABORTADA: Erros semanticos detectados\n");
+        fprintf(saida, "========================================\n");
+        fprintf(saida, "\nCorrija os erros acima e execute novamente:\n");
+        fprintf(saida, "  ./cminus.exe.exe %s\n\n", pgm);
+        goto falhou;
+    }
+
+    if (r == CM_ERRO_TIPOS) {
+        fprintf(saida, "\n========================================\n");
+        fprintf(saida, "COMPILACAO ABORTADA: Erros de tipo detectados\n");
+        fprintf(saida, "========================================\n");
+        fprintf(saida, "\nCorrija os erros acima e execute novamente:\n");
+        fprintf(saida, "  ./cminus.exe %s\n\n", pgm);
+        goto falhou;
+    }
+    if (r != CM_OK) goto falhou;
+    tempos->economizadas += sessao->dobra.economizadas;
+    fprintf(saida, "OK - Analise semantica concluida com sucesso\n\n");
+
+    /* SAÍDA 1: Tabela de Símbolos */
+    t0 = agora();
+    fprintf(saida, "========================================\n");
+    fprintf(saida, "    TABELA DE SIMBOLOS\n");
+    fprintf(saida, "========================================\n");
+    sessaoImprimirTabela(sessao, tabela);
+    fprintf(saida, "\n");
+
+    /* SAÍDA 2: Árvore Sintática Abstrata (Textual) */
+    fprintf(saida, "========================================\n");
+    fprintf(saida, "    ARVORE SINTATICA ABSTRATA (AST)\n");
+    fprintf(saida, "========================================\n");
+    if (artefatos.dot != NULL)
+        sessaoGerarDot(sessao, dotFilename, gerarPng ? pngFilename : NULL);
+    else
+        fprintf(saida, "\nArquivo .dot nao solicitado (use --dot para gerar %s)\n\n", dotFilename);
+    tempos->saidas += agora() - t0;
+
+    /* FASE 3: Geração de Código Intermediário */
+    fprintf(saida, "========================================\n");
+    fprintf(saida, "    CODIGO INTERMEDIARIO\n");
+    fprintf(saida, "========================================\n");
+    fprintf(saida, "\nDobra de constantes: %d instrucao(oes) a menos\n", sessao->dobra.economizadas);
+    t0 = agora();
+    sessaoGerarCodigo(sessao, codigo);
+    tempos->codigo += agora() - t0;
+    if (otimizar) {
+        tempos->desvios += sessao->otimiza.desvios;
+        tempos->reaproveitados += sessao->otimiza.reaproveitados;
+        tempos->removidas += sessao->otimiza.removidas;
+        fprintf(saida, "\nOtimizacao (SSA, numeracao de valores%s, propagacao de constantes e de copias): "
+                       "%d desvio(s) constante(s), %d valor(es) reaproveitado(s), %d instrucao(oes) a menos\n",
+                otimizar >= 2 ? " global" : "", sessao->otimiza.desvios, sessao->otimiza.reaproveitados,
+                sessao->otimiza.removidas);
+    }
+    fprintf(saida, "\n");
+
+    fprintf(saida, "\n");
+
+    /* SAÍDA 3: Grafo de fluxo de controle, só quando pedido */
+    if (artefatos.cfg != NULL) {
+        fprintf(saida, "========================================\n");
+        fprintf(saida, "    GRAFO DE FLUXO DE CONTROLE (CFG)\n");
+        fprintf(saida, "========================================\n");
+        t0 = agora();
+        sessaoGerarCfg(sessao, cfgFilename);
+        tempos->saidas += agora() - t0;
+    }
+
+    /* SAÍDA 4: Bytecode, só em arquivo */
+    if (artefatos.bytecode != NULL) {
+        FILE *f = artefatos.bytecode[0] != '\0' ? abrirArtefato(artefatos.bytecode, base, NULL, erros) : NULL;
+
+        if (f == NULL) {
+            fprintf(saida, "Bytecode nao gravado (use --bytecode=ARQ)\n\n");
+        } else {
+            t0 = agora();
+            r = sessaoGerarBytecode(sessao, f);
+            fclose(f);
+            tempos->codigo += agora() - t0;
+            if (r != CM_OK) goto falhou;
+            fprintf(saida, "Bytecode gravado em %s\n\n", artefatos.bytecode);
+        }
+    }
+
+    /* SAÍDA 5: Código nativo, só com --asm */
+    if (artefatos.assembly != NULL) {
+        FILE *f = artefatos.assembly[0] != '\0' ? abrirArtefato(artefatos.assembly, base, NULL, erros) : saida;
+
+        if (f == NULL) goto falhou;
+        fprintf(saida, "========================================\n");
+        fprintf(saida, "    CODIGO NATIVO (X86-64)\n");
+        fprintf(saida, "========================================\n");
+        t0 = agora();
+        r = sessaoGerarAssembly(sessao, f);
+        fecharArtefato(f, saida);
+        tempos->codigo += agora() - t0;
+        if (r != CM_OK) goto falhou;
+        if (f != saida) fprintf(saida, "Assembly gravado em %s\n", artefatos.assembly);
+        fprintf(saida, "\n");
+    }
+
+    /* SAÍDA 6: Execução, só com --run, --vm ou --jit */
+    if (executarPrograma) {
+        fprintf(saida, "========================================\n");
+        fprintf(saida, "    EXECUCAO%s\n", executarPrograma == EXECUTAR_VM ? " (BYTECODE)" :
+                                        executarPrograma == EXECUTAR_JIT ? " (JIT)" : "");
+        fprintf(saida, "========================================\n");
+        if (executar(sessao, saida) != CM_OK) goto falhou;
+        fprintf(saida, "\n");
+    }
+
+    fprintf(saida, "========================================\n");
+    fprintf(saida, "COMPILACAO CONCLUIDA!\n");
+    fprintf(saida, "========================================\n");
+    fprintf(saida, "\n");
+
+    fecharArtefato(tabela, NULL);
+    fecharArtefato(codigo, NULL);
+    return terminar(sessao, erros, 0);
+
+falhou:
+    fecharArtefato(tabela, NULL);
+    fecharArtefato(codigo, NULL);
+    return terminar(sessao, erros, 1);
+}
+
+/* Sem banners: diagnósticos em erros e só os artefatos pedidos, na saída
+   ou nos seus arquivos */
+static int gerarArtefatos(CompilerSession *sessao, const char *base,
+                          const char *dotFilename, const char *pngFilename, const char *cfgFilename,
+                          FILE *saida, FILE *erros, Tempos *tempos) {
+    ResultadoSessao r;
+    FILE *f;
+    int status = 0;
+    double t0;
+
+    t0 = agora();
+    r = sessaoParse(sessao);
+    tempos->parse += agora() - t0;
+    if (r != CM_OK) return terminar(sessao, erros, 1);
+
+    t0 = agora();
+    r = sessaoAnalisar(sessao);
+    tempos->analise += agora() - t0;
+    if (r != CM_OK) return terminar(sessao, erros, 1);
+    tempos->economizadas += sessao->dobra.economizadas;
+
+    t0 = agora();
+    if (artefatos.tabela != NULL) {
+        if ((f = abrirArtefato(artefatos.tabela, base, saida, erros)) == NULL) status = 1;
+        else sessaoImprimirTabela(sessao, f);
+        fecharArtefato(f, saida);
+    }
+    if (artefatos.dot != NULL) sessaoGerarDot(sessao, dotFilename, gerarPng ? pngFilename : NULL);
+    tempos->saidas += agora() - t0;
+
+    if (artefatos.codigo != NULL) {
+        t0 = agora();
+        if ((f = abrirArtefato(artefatos.codigo, base, saida, erros)) == NULL) status = 1;
+        else sessaoGerarCodigo(sessao, f);
+        fecharArtefato(f, saida);
+        tempos->codigo += agora() - t0;
+    }
+    if (artefatos.cfg != NULL) {
+        t0 = agora();
+        sessaoGerarCfg(sessao, cfgFilename);
+        tempos->saidas += agora() - t0;
     }
-    
-    strcpy(pgm, argv[1]);
-    
+    if (artefatos.bytecode != NULL) {
+        t0 = agora();
+        if ((f = abrirArtefato(artefatos.bytecode, base, saida, erros)) == NULL) status = 1;
+        else if (sessaoGerarBytecode(sessao, f) != CM_OK) status = 1;
+        fecharArtefato(f, saida);
+        tempos->codigo += agora() - t0;
+    }
+    if (artefatos.assembly != NULL) {
+        t0 = agora();
+        if ((f = abrirArtefato(artefatos.assembly, base, saida, erros)) == NULL) status = 1;
+        else if (sessaoGerarAssembly(sessao, f) != CM_OK) status = 1;
+        fecharArtefato(f, saida);
+        tempos->codigo += agora() - t0;
+    }
+    if (executarPrograma) {
+        fflush(saida);
+        if (executar(sessao, saida) != CM_OK) status = 1;
+    }
+    tempos->desvios += sessao->otimiza.desvios;
+    tempos->reaproveitados += sessao->otimiza.reaproveitados;
+    tempos->removidas += sessao->otimiza.removidas;
+    return terminar(sessao, erros, status);
+}
+
+/* Compila pgm com a listagem (ou os artefatos) em saida e as mensagens do
+   driver em erros; devolve o status de saída do processo */
+static int compilarArquivo(const char *pgm, FILE *saida, FILE *erros, Tempos *tempos) {
+    CompilerSession *sessao;
+    FILE *source;
+    FILE *tokens = NULL;
+    ResultadoSessao r;
+    char baseName[MAXCAMINHO];
+    char dotFilename[MAXCAMINHO + 16];
+    char pngFilename[MAXCAMINHO + 16];
+    char cfgFilename[MAXCAMINHO + 16];
+    double t0;
+    int status;
+
     /* Extrai o nome base do arquivo (sem extensão e sem caminho) */
-    strcpy(baseName, pgm);
-    
+    snprintf(baseName, sizeof(baseName), "%s", pgm);
+
     /* Remove caminho (se houver) - pega apenas o nome do arquivo */
     char *lastSlash = strrchr(baseName, '\\');
     char *lastFwdSlash = strrchr(baseName, '/');
     char *fileName = baseName;
-    
+
     if (lastSlash != NULL) {
         fileName = lastSlash + 1;
     } else if (lastFwdSlash != NULL) {
         fileName = lastFwdSlash + 1;
     }
-    
+
     /* Move o nome do arquivo para o início de baseName */
     if (fileName != baseName) {
-        strcpy(baseName, fileName);
+        memmove(baseName, fileName, strlen(fileName) + 1);
     }
-    
+
     /* Remove a extensão */
     char *dot = strrchr(baseName, '.');
     if (dot != NULL) *dot = '\0';
-    
+
+    /* "-" lê o programa da entrada padrão */
+    if (strcmp(pgm, "-") == 0) {
+        source = stdin;
+        strcpy(baseName, "stdin");
+    } else {
+        source = fopen(pgm, "r");
+    }
+
     /* Gera nomes dos arquivos de saída para Graphviz */
-    snprintf(dotFilename, sizeof(dotFilename), "ast_%s.dot", baseName);
+    if (artefatos.dot != NULL && artefatos.dot[0] != '\0')
+        formatarNome(dotFilename, sizeof(dotFilename), artefatos.dot, baseName);
+    else
+        snprintf(dotFilename, sizeof(dotFilename), "ast_%s.dot", baseName);
     snprintf(pngFilename, sizeof(pngFilename), "ast_%s.png", baseName);
-    
-    source = fopen(pgm, "r");
+    if (artefatos.cfg != NULL && artefatos.cfg[0] != '\0')
+        formatarNome(cfgFilename, sizeof(cfgFilename), artefatos.cfg, baseName);
+    else
+        snprintf(cfgFilename, sizeof(cfgFilename), "cfg_%s.dot", baseName);
+
     if (source == NULL) {
-        fprintf(stderr, "Erro: Arquivo %s nao encontrado\n", pgm);
+        fprintf(erros, "Erro: Arquivo %s nao encontrado\n", pgm);
+        return 1;
+    }
+    /* sem a listagem, os diagnósticos das fases vão para erros */
+    sessao = criarSessao(listagemCompleta ? saida : erros);
+    if (sessao == NULL) {
+        fprintf(erros, "Erro: sem memoria\n");
+        if (source != stdin) fclose(source);
+        return 1;
+    }
+    sessaoUsarPool(sessao, poolFuncoes);
+    sessao->silencioso = !listagemCompleta;
+    sessao->otimizar = otimizar;
+    if (artefatos.tokens != NULL) {
+        tokens = abrirArtefato(artefatos.tokens, baseName, listagemCompleta ? NULL : saida, erros);
+        if (tokens == NULL && artefatos.tokens[0] != '\0') {
+            if (source != stdin) fclose(source);
+            return terminar(sessao, erros, 1);
+        }
+        sessao->traceScan = TRUE;
+        sessao->tokens = tokens;
+    }
+    t0 = agora();
+    r = sessaoCarregarArquivo(sessao, source);
+    if (source != stdin) fclose(source);
+    tempos->carregar += agora() - t0;
+    if (r != CM_OK) {
+        fprintf(erros, "Erro: Nao foi possivel ler %s\n", pgm);
+        status = terminar(sessao, erros, 1);
+    } else if (listagemCompleta) {
+        status = gerarListagem(sessao, pgm, baseName, dotFilename, pngFilename, cfgFilename, saida, erros, tempos);
+    } else {
+        status = gerarArtefatos(sessao, baseName, dotFilename, pngFilename, cfgFilename, saida, erros, tempos);
+    }
+    fecharArtefato(tokens, listagemCompleta ? NULL : saida);
+    return status;
+}
+
+/* ---------------------- Compilação em lote ---------------------- */
+
+struct Lote;
+
+/* Um arquivo do lote: a listagem e as mensagens ficam em memória até
+   chegar a vez do arquivo de ser escrito */
+typedef struct {
+    struct Lote *lote;
+    const char *arquivo;
+    char *listagem;
+    size_t tamListagem;
+    char *erros;
+    size_t tamErros;
+    int status;
+    int pronto;
+    Tempos tempos;
+} Unidade;
+
+typedef struct Lote {
+    Unidade *unidades;
+    int n;
+    int proxima;                /* primeira unidade ainda não escrita */
+    pthread_mutex_t trava;
+} Lote;
+
+/* Marca u como pronta e escreve, em ordem, as unidades prontas */
+static void escreverProntas(Lote *l, Unidade *u) {
+    pthread_mutex_lock(&l->trava);
+    u->pronto = TRUE;
+    while (l->proxima < l->n && l->unidades[l->proxima].pronto) {
+        Unidade *v = &l->unidades[l->proxima++];
+        fwrite(v->listagem, 1, v->tamListagem, stdout);
+        fflush(stdout);
+        /* sem a listagem, nada mais diz de qual arquivo são os erros */
+        if (!listagemCompleta && v->tamErros > 0) fprintf(stderr, "%s:", v->arquivo);
+        fwrite(v->erros, 1, v->tamErros, stderr);
+        free(v->listagem);
+        free(v->erros);
+        v->listagem = v->erros = NULL;
+    }
+    pthread_mutex_unlock(&l->trava);
+}
+
+static void compilarUnidade(void *arg) {
+    Unidade *u = (Unidade *)arg;
+    FILE *saida = abrirMemoria(&u->listagem, &u->tamListagem);
+    FILE *erros = abrirMemoria(&u->erros, &u->tamErros);
+
+    if (saida == NULL || erros == NULL) {
+        fprintf(stderr, "Erro: sem memoria\n");
         exit(1);
     }
-    
-    listing = stdout;
-    
-    fprintf(listing, "\n========================================\n");
-    fprintf(listing, "    COMPILADOR C- - UNIFESP\n");
-    fprintf(listing, "========================================\n");
-    fprintf(listing, "Arquivo: %s\n", pgm);
-    fprintf(listing, "========================================\n\n");
-    
-    /* FASE 1: Análise Léxica e Sintática */
-    fprintf(listing, "=== ANALISE LEXICA E SINTATICA ===\n");
-    arvore_sintatica = parse();
-    fclose(source);
-    
-    if (Error) {
-        fprintf(listing, "\n========================================\n");
-        fprintf(listing, "COMPILACAO ABORTADA: Erros detectados na analise\n");
-        fprintf(listing, "========================================\n");
-        fprintf(listing, "\nPara recompilar o programa, execute:\n");
-        fprintf(listing, "  gcc -o compilador.exe main.c scan.c parse.c analyze.c symtab.c util.c cgen.c\n");
-        fprintf(listing, "\nDepois execute novamente:\n");
-        fprintf(listing, "  compilador.exe %s\n\n", pgm);
+    u->status = compilarArquivo(u->arquivo, saida, erros, &u->tempos);
+    if (fecharMemoria(saida, &u->listagem, &u->tamListagem) != 0 ||
+        fecharMemoria(erros, &u->erros, &u->tamErros) != 0) {
+        fprintf(stderr, "Erro: sem memoria\n");
         exit(1);
     }
-    fprintf(listing, "OK - Analise lexica e sintatica concluida com sucesso\n\n");
-    
-    /* FASE 2: Análise Semântica */
-    fprintf(listing, "=== ANALISE SEMANTICA ===\n");
-    buildSymtab(arvore_sintatica);
-    
-    if (Error) {
-        fprintf(listing, "\n========================================\n");
-        fprintf(listing, "COMPILACAO ABORTADA: Erros semanticos detectados\n");
-        fprintf(listing, "========================================\n");
-        fprintf(listing, "\nCorrija os erros acima e execute novamente:\n");
-        fprintf(listing, "  ./cminus.exe.exe %s\n\n", pgm);
+    escreverProntas(u->lote, u);
+}
+
+static void imprimirFase(const char *nome, double t, double total) {
+    fprintf(stderr, "  %-10s %9.3f s  %5.1f%%\n", nome, t, total > 0 ? 100.0 * t / total : 0.0);
+}
+
+/* Compila os arquivos em paralelo; devolve 1 se algum falhou */
+static int compilarLote(char **arquivos, int n, int nthreads) {
+    Lote lote;
+    GrupoTarefas grupo = GRUPO_VAZIO;
+    Tempos soma = {0};
+    Pool *pool;
+    double t0, total, fases;
+    int falhas = 0;
+
+    pool = criarPool(nthreads);
+    lote.unidades = (Unidade *)calloc(n, sizeof(Unidade));
+    if (pool == NULL || lote.unidades == NULL) {
+        fprintf(stderr, "Erro: nao foi possivel criar as threads\n");
+        return 1;
+    }
+    if (funcoesParalelas) poolFuncoes = pool;
+    lote.n = n;
+    lote.proxima = 0;
+    pthread_mutex_init(&lote.trava, NULL);
+
+    /* a última submetida é a primeira que a thread principal executa:
+       submetendo de trás para frente, ela começa pelo primeiro arquivo */
+    t0 = agora();
+    for (int i = n - 1; i >= 0; i--) {
+        lote.unidades[i].lote = &lote;
+        lote.unidades[i].arquivo = arquivos[i];
+        poolSubmeter(pool, &grupo, compilarUnidade, &lote.unidades[i]);
+    }
+    poolEsperar(pool, &grupo);
+    total = agora() - t0;
+
+    for (int i = 0; i < n; i++) {
+        Unidade *u = &lote.unidades[i];
+        if (u->status != 0) falhas++;
+        soma.carregar += u->tempos.carregar;
+        soma.parse += u->tempos.parse;
+        soma.analise += u->tempos.analise;
+        soma.saidas += u->tempos.saidas;
+        soma.codigo += u->tempos.codigo;
+        soma.economizadas += u->tempos.economizadas;
+        soma.desvios += u->tempos.desvios;
+        soma.reaproveitados += u->tempos.reaproveitados;
+        soma.removidas += u->tempos.removidas;
+    }
+    fases = soma.carregar + soma.parse + soma.analise + soma.saidas + soma.codigo;
+
+    fprintf(stderr, "\nlote: %d arquivo(s), %d com erros, %d thread(s)\n", n, falhas, poolThreads(pool));
+    fprintf(stderr, "  %-10s %9.3f s  %.1f arquivos/s\n", "total", total, total > 0 ? n / total : 0.0);
+    fprintf(stderr, "  tempo somado das fases em todas as threads:\n");
+    imprimirFase("carregar", soma.carregar, fases);
+    imprimirFase("parse", soma.parse, fases);
+    imprimirFase("analise", soma.analise, fases);
+    imprimirFase("tabela/dot", soma.saidas, fases);
+    imprimirFase("codigo", soma.codigo, fases);
+    fprintf(stderr, "  dobra de constantes: %d instrucao(oes) a menos\n", soma.economizadas);
+    if (otimizar)
+        fprintf(stderr, "  otimizacao: %d desvio(s) constante(s), %d valor(es) reaproveitado(s), "
+                        "%d instrucao(oes) a menos\n", soma.desvios, soma.reaproveitados, soma.removidas);
+
+    poolFuncoes = NULL;
+    destruirPool(pool);
+    pthread_mutex_destroy(&lote.trava);
+    free(lote.unidades);
+    return falhas ? 1 : 0;
+}
+
+/* ---------------------- Argumentos ---------------------- */
+
+typedef struct {
+    char **v;
+    int n;
+    int capacidade;
+} ListaArquivos;
+
+static void adicionarArquivo(ListaArquivos *l, char *arquivo) {
+    if (l->n == l->capacidade) {
+        l->capacidade = l->capacidade ? l->capacidade * 2 : 16;
+        l->v = (char **)realloc(l->v, l->capacidade * sizeof(char *));
+        if (l->v == NULL) {
+            fprintf(stderr, "Erro: sem memoria\n");
+            exit(1);
+        }
+    }
+    l->v[l->n++] = arquivo;
+}
+
+/* Lista de arquivos: um caminho por linha; linhas vazias e iniciadas
+   por '#' são ignoradas */
+static int lerLista(ListaArquivos *l, const char *nome) {
+    FILE *f = fopen(nome, "r");
+    char linha[MAXCAMINHO];
+
+    if (f == NULL) {
+        fprintf(stderr, "Erro: Arquivo %s nao encontrado\n", nome);
+        return -1;
+    }
+    while (fgets(linha, sizeof(linha), f) != NULL) {
+        size_t n = strlen(linha);
+        char *ini = linha;
+        while (n > 0 && (linha[n - 1] == '\n' || linha[n - 1] == '\r' ||
+                         linha[n - 1] == ' ' || linha[n - 1] == '\t'))
+            linha[--n] = '\0';
+        while (*ini == ' ' || *ini == '\t') ini++;
+        if (*ini == '\0' || *ini == '#') continue;
+        adicionarArquivo(l, strdup(ini));
+    }
+    fclose(f);
+    return 0;
+}
+
+/* --nome ou --nome=ARQ: o destino do artefato ("" = na saída) */
+static int opcaoArtefato(const char *arg, const char *nome, const char **destino) {
+    size_t n = strlen(nome);
+
+    if (strncmp(arg, nome, n) != 0) return FALSE;
+    if (arg[n] == '\0') *destino = "";
+    else if (arg[n] == '=' && arg[n + 1] != '\0') *destino = arg + n + 1;
+    else return FALSE;
+    return TRUE;
+}
+
+/* Com vários arquivos, cada artefato em arquivo precisa de um nome por
+   entrada */
+static int nomePorEntrada(const char *destino, const char *opcao) {
+    if (destino == NULL || destino[0] == '\0' || strstr(destino, "%s") != NULL) return TRUE;
+    fprintf(stderr, "Erro: com varios arquivos, o nome em %s deve conter %%s\n", opcao);
+    return FALSE;
+}
+
+int main(int argc, char *argv[]) {
+    ListaArquivos arquivos = {NULL, 0, 0};
+    int nthreads = 0;
+    int usouLista = FALSE;
+    int silencioso = FALSE, listagem = FALSE;
+    int i;
+
+    setvbuf(stdout, NULL, _IOFBF, BUFFER_SAIDA);
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--memoria") == 0) {
+            /* alocações e pico de RSS em stderr ao terminar */
+            mostrarMemoria = TRUE;
+        } else if (strcmp(argv[i], "--funcoes") == 0) {
+            funcoesParalelas = TRUE;
+        } else if (strcmp(argv[i], "-q") == 0 || strcmp(argv[i], "--silencioso") == 0) {
+            silencioso = TRUE;
+        } else if (strcmp(argv[i], "--listagem") == 0) {
+            listagem = TRUE;
+        } else if (strcmp(argv[i], "--png") == 0) {
+            gerarPng = TRUE;
+        } else if (strcmp(argv[i], "-O") == 0) {
+            otimizar = 1;
+        } else if (strcmp(argv[i], "-O2") == 0) {
+            otimizar = 2;
+        } else if (strcmp(argv[i], "--run") == 0) {
+            executarPrograma = EXECUTAR_ARVORE;
+        } else if (strcmp(argv[i], "--vm") == 0) {
+            executarPrograma = EXECUTAR_VM;
+        } else if (strcmp(argv[i], "--jit") == 0) {
+            executarPrograma = EXECUTAR_JIT;
+        } else if (opcaoArtefato(argv[i], "--tokens", &artefatos.tokens) ||
+                   opcaoArtefato(argv[i], "--tabela", &artefatos.tabela) ||
+                   opcaoArtefato(argv[i], "--dot", &artefatos.dot) ||
+                   opcaoArtefato(argv[i], "--cfg", &artefatos.cfg) ||
+                   opcaoArtefato(argv[i], "--codigo", &artefatos.codigo) ||
+                   opcaoArtefato(argv[i], "--bytecode", &artefatos.bytecode) ||
+                   opcaoArtefato(argv[i], "--asm", &artefatos.assembly)) {
+            /* artefato pedido */
+        } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            nthreads = atoi(argv[++i]);
+        } else if (strncmp(argv[i], "-j", 2) == 0 && argv[i][2] != '\0') {
+            nthreads = atoi(argv[i] + 2);
+        } else if (argv[i][0] == '@') {
+            if (lerLista(&arquivos, argv[i] + 1) != 0) exit(1);
+            usouLista = TRUE;
+        } else {
+            adicionarArquivo(&arquivos, argv[i]);
+        }
+    }
+    if (arquivos.n == 0) {
+        fprintf(stderr, "Uso: %s [-q | --listagem] [--tokens[=ARQ]] [--tabela[=ARQ]] [--dot[=ARQ]] [--png] [--cfg[=ARQ]]\n"
+                        "       [--codigo[=ARQ]] [--bytecode[=ARQ]] [--asm[=ARQ]] [-O | -O2] [--run | --vm | --jit] [--memoria] [--funcoes] [-j threads] <arquivo.cm>... | @lista\n"
+                        "  -q omite a listagem; --listagem a inclui sempre, mesmo com -q\n", argv[0]);
         exit(1);
     }
-    
-    typeCheck(arvore_sintatica);
-    
-    if (Error) {
-        fprintf(listing, "\n========================================\n");
-        fprintf(listing, "COMPILACAO ABORTADA: Erros de tipo detectados\n");
-        fprintf(listing, "========================================\n");
-        fprintf(listing, "\nCorrija os erros acima e execute novamente:\n");
-        fprintf(listing, "  ./cminus.exe %s\n\n", pgm);
+    if (gerarPng && artefatos.dot == NULL) artefatos.dot = "";
+
+    if (arquivos.n == 1 && !usouLista) {
+        Tempos tempos = {0};
+        int status;
+
+        /* pedir um artefato ou a execução também dispensa a listagem */
+        listagemCompleta = listagem ||
+            (!silencioso && artefatos.tokens == NULL && artefatos.tabela == NULL &&
+             artefatos.dot == NULL && artefatos.cfg == NULL && artefatos.codigo == NULL &&
+             artefatos.bytecode == NULL && artefatos.assembly == NULL && !executarPrograma);
+        if (funcoesParalelas && (poolFuncoes = criarPool(nthreads)) == NULL) {
+            fprintf(stderr, "Erro: nao foi possivel criar as threads\n");
+            exit(1);
+        }
+        status = compilarArquivo(arquivos.v[0], stdout, stderr, &tempos);
+        destruirPool(poolFuncoes);
+        fflush(stdout);
+        if (esperarPngs(stderr) > 0) status = 1;
+        return status;
+    }
+
+    if (executarPrograma) {
+        fprintf(stderr, "Erro: --run, --vm e --jit executam um unico arquivo\n");
         exit(1);
     }
-    fprintf(listing, "OK - Analise semantica concluida com sucesso\n\n");
-    
-    /* SAÍDA 1: Tabela de Símbolos */
-    fprintf(listing, "========================================\n");
-    fprintf(listing, "    TABELA DE SIMBOLOS\n");
-    fprintf(listing, "========================================\n");
-    printSymTab(listing);
-    fprintf(listing, "\n");
-    
-    /* SAÍDA 2: Árvore Sintática Abstrata (Textual) */
-    fprintf(listing, "========================================\n");
-    fprintf(listing, "    ARVORE SINTATICA ABSTRATA (AST)\n");
-    fprintf(listing, "========================================\n");
-    printTreeDot(arvore_sintatica, dotFilename, pngFilename);
-    
-    /* FASE 3: Geração de Código Intermediário */
-    fprintf(listing, "========================================\n");
-    fprintf(listing, "    CODIGO INTERMEDIARIO\n");
-    fprintf(listing, "========================================\n");
-    codeGen(arvore_sintatica);
-    fprintf(listing, "\n");
-
-    fprintf(listing, "\n");
-    
-    fprintf(listing, "========================================\n");
-    fprintf(listing, "COMPILACAO CONCLUIDA!\n");
-    fprintf(listing, "========================================\n");
-    fprintf(listing, "\n");
-    
-    return 0;
-}
\ No newline at end of file
+    listagemCompleta = listagem;    /* em lote, a listagem só com --listagem */
+    if (!nomePorEntrada(artefatos.tokens, "--tokens") || !nomePorEntrada(artefatos.tabela, "--tabela") ||
+        !nomePorEntrada(artefatos.dot, "--dot") || !nomePorEntrada(artefatos.cfg, "--cfg") ||
+        !nomePorEntrada(artefatos.codigo, "--codigo") || !nomePorEntrada(artefatos.bytecode, "--bytecode") ||
+        !nomePorEntrada(artefatos.assembly, "--asm"))
+        exit(1);
+    i = compilarLote(arquivos.v, arquivos.n, nthreads);
+    if (esperarPngs(stderr) > 0) i = 1;
+    return i;
+}
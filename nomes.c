@@ -0,0 +1,74 @@
+/*Tabela de nomes internados (nomes.c)*/
+
+#include "globals.h"
+#include "util.h"
+#include "nomes.h"
+#include "arena.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct EntradaNome {
+    char *nome;
+    unsigned hash;
+    int tamanho;
+} EntradaNome;
+
+/* endereçamento aberto com sondagem linear, ocupação máxima de 50%;
+   a tabela e as strings ficam na arena da sessão */
+#define tabelaNomes (sessaoAtual->nomes.tabela)
+#define capacidade  (sessaoAtual->nomes.capacidade)
+#define ocupados    (sessaoAtual->nomes.ocupados)
+
+/* FNV-1a */
+static unsigned hashNome(const char *s, int n) {
+    unsigned h = 2166136261u;
+    for (int i = 0; i < n; i++) {
+        h ^= (unsigned char)s[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static void crescer(void) {
+    unsigned novaCapacidade = capacidade ? capacidade * 2 : 1024;
+    EntradaNome *nova = (EntradaNome *)arenaAlloc(novaCapacidade * sizeof(EntradaNome));
+
+    for (unsigned i = 0; i < capacidade; i++) {
+        if (tabelaNomes[i].nome != NULL) {
+            unsigned j = tabelaNomes[i].hash & (novaCapacidade - 1);
+            while (nova[j].nome != NULL) j = (j + 1) & (novaCapacidade - 1);
+            nova[j] = tabelaNomes[i];
+        }
+    }
+    tabelaNomes = nova;
+    capacidade = novaCapacidade;
+}
+
+char *internarNome(const char *s, int n) {
+    unsigned h, i;
+
+    if (capacidade == 0) crescer();
+    h = hashNome(s, n);
+    i = h & (capacidade - 1);
+    while (tabelaNomes[i].nome != NULL) {
+        if (tabelaNomes[i].hash == h && tabelaNomes[i].tamanho == n &&
+            memcmp(tabelaNomes[i].nome, s, n) == 0)
+            return tabelaNomes[i].nome;
+        i = (i + 1) & (capacidade - 1);
+    }
+
+    tabelaNomes[i].nome = copyStringN(s, n);
+    tabelaNomes[i].hash = h;
+    tabelaNomes[i].tamanho = n;
+    if (++ocupados * 2 > capacidade) {
+        char *nome = tabelaNomes[i].nome;
+        crescer();
+        return nome;
+    }
+    return tabelaNomes[i].nome;
+}
+
+char *internar(const char *s) {
+    return internarNome(s, (int)strlen(s));
+}
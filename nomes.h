@@ -0,0 +1,18 @@
+/* nomes.h - Tabela de nomes internados */
+
+#ifndef NOMES_H
+#define NOMES_H
+
+/*
+ * Cada identificador do programa tem um único representante: dois nomes
+ * são iguais se e somente se os ponteiros devolvidos são iguais. As
+ * strings internadas não devem ser modificadas.
+ */
+
+/* Representante de s[0..n) */
+char *internarNome(const char *s, int n);
+
+/* Representante de uma string terminada em '\0' */
+char *internar(const char *s);
+
+#endif
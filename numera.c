@@ -0,0 +1,292 @@
+/* Numeração de valores na forma SSA (numera.c) */
+
+#include "globals.h"
+#include "numera.h"
+#include "arena.h"
+
+/* O que um memloc lido como OPR_VAR é na função */
+#define ESTAVEL      0   /* escalar da função: na SSA, só a versão inicial é lida */
+#define GLOBAL       1   /* escalar global */
+#define ARRAY_LOCAL  2
+#define ARRAY_GLOBAL 3
+#define ARRAY_PARAM  4
+
+/* Operação já calculada: op com os operandos (a, b) e as versões da
+   memória que eles leem (0 se não leem memória) */
+typedef struct {
+    uint8_t op;
+    uint8_t ocupada;
+    Operando a, b;
+    uint32_t va, vb;
+    Operando valor;          /* quem tem o resultado */
+} Entrada;
+
+typedef struct {
+    FuncaoSsa *s;
+    uint8_t *classe;         /* por memloc */
+    uint32_t *escrita;       /* por memloc: relógio da última escrita */
+    uint32_t relogio;
+    uint32_t barreira;       /* início do bloco ou última chamada */
+    uint32_t escritaParams;  /* última escrita num array parâmetro */
+    uint32_t escritaGlobais; /* última escrita num array global */
+    Operando *canonico;      /* por temporário: o valor que ele copia, ou NADA */
+    Entrada *tabela;         /* aberta, com sondagem linear */
+    uint32_t mascara;
+    uint32_t *pilha;         /* posições ocupadas, na ordem: saem da última à primeira */
+    int npilha;
+    int32_t *escritos;       /* memlocs escritos, na ordem, e ... */
+    uint32_t *anteriores;    /* ... a escrita anterior de cada um, para desfazer */
+    int nescritos;
+    int reaproveitados;
+} Numeracao;
+
+static uint32_t maior(uint32_t a, uint32_t b) {
+    return a > b ? a : b;
+}
+
+static void classificar(Numeracao *x) {
+    const CodigoIR *c = x->s->codigo;
+
+    x->classe = (uint8_t *)arenaAlloc(c->nsimbolos + 1);
+    x->escrita = (uint32_t *)arenaAlloc((c->nsimbolos + 1) * sizeof(uint32_t));
+    for (int m = 0; m < c->nsimbolos; m++)
+        x->classe[m] = c->simbolos[m] != NULL && c->simbolos[m]->type == IntegerArray ? ARRAY_GLOBAL : GLOBAL;
+    for (uint32_t i = 0; i < c->n; i++) {
+        const Quad *q = &c->quads[i];
+        if (q->op == IR_VAR) x->classe[q->a.v] = q->b.tipo == OPR_NADA ? ESTAVEL : ARRAY_LOCAL;
+        else if (q->op == IR_PARAM) x->classe[q->a.v] = q->b.v == 0 ? ESTAVEL : ARRAY_PARAM;
+    }
+}
+
+static int memoria(const Numeracao *x, Operando o) {
+    return o.tipo == OPR_VAR && x->classe[o.v] != ESTAVEL;
+}
+
+/* Versão da memória lida em o: muda a cada escrita que pode atingi-la */
+static uint32_t versao(const Numeracao *x, Operando o) {
+    uint32_t v;
+
+    if (!memoria(x, o)) return 0;
+    v = maior(x->escrita[o.v], x->barreira);
+    if (x->classe[o.v] == ARRAY_GLOBAL) v = maior(v, x->escritaParams);
+    else if (x->classe[o.v] == ARRAY_PARAM) v = maior(v, maior(x->escritaParams, x->escritaGlobais));
+    return v;
+}
+
+static void escrever(Numeracao *x, int32_t m) {
+    x->escritos[x->nescritos] = m;
+    x->anteriores[x->nescritos++] = x->escrita[m];
+    x->escrita[m] = ++x->relogio;
+    if (x->classe[m] == ARRAY_GLOBAL) x->escritaGlobais = x->relogio;
+    else if (x->classe[m] == ARRAY_PARAM) x->escritaParams = x->relogio;
+}
+
+static Operando canonico(const Numeracao *x, Operando o) {
+    if (o.tipo == OPR_TEMP && x->canonico[o.v].tipo != OPR_NADA) return x->canonico[o.v];
+    return o;
+}
+
+static int comutativa(OpIR op) {
+    return op == IR_ADD || op == IR_MUL || op == IR_EQ || op == IR_NE;
+}
+
+static int antes(Operando a, uint32_t va, Operando b, uint32_t vb) {
+    if (a.tipo != b.tipo) return a.tipo < b.tipo;
+    if (a.v != b.v) return a.v < b.v;
+    return va < vb;
+}
+
+static Entrada chave(const Numeracao *x, OpIR op, Operando a, Operando b) {
+    Entrada k;
+
+    k.op = (uint8_t)op;
+    k.ocupada = 1;
+    k.a = canonico(x, a);
+    k.va = versao(x, a);
+    k.b = canonico(x, b);
+    k.vb = versao(x, b);
+    if (comutativa(op) && antes(k.b, k.vb, k.a, k.va)) {
+        Operando o = k.a;
+        uint32_t v = k.va;
+        k.a = k.b;
+        k.va = k.vb;
+        k.b = o;
+        k.vb = v;
+    }
+    k.valor = NADA;
+    return k;
+}
+
+static int mesmaChave(const Entrada *e, const Entrada *k) {
+    return e->op == k->op && e->a.tipo == k->a.tipo && e->a.v == k->a.v && e->va == k->va &&
+           e->b.tipo == k->b.tipo && e->b.v == k->b.v && e->vb == k->vb;
+}
+
+/* Posição de k na tabela, ou a vaga onde ele entraria */
+static uint32_t posicao(const Numeracao *x, const Entrada *k) {
+    uint32_t h = k->op * 0x9E3779B1u;
+
+    h = (h ^ ((uint32_t)k->a.tipo << 29) ^ (uint32_t)k->a.v ^ k->va * 0x85EBCA77u) * 0x9E3779B1u;
+    h = (h ^ ((uint32_t)k->b.tipo << 29) ^ (uint32_t)k->b.v ^ k->vb * 0xC2B2AE3Du) * 0x9E3779B1u;
+    h = (h ^ (h >> 16)) & x->mascara;
+    while (x->tabela[h].ocupada && !mesmaChave(&x->tabela[h], k)) h = (h + 1) & x->mascara;
+    return h;
+}
+
+static void inserir(Numeracao *x, uint32_t h, const Entrada *k, Operando valor) {
+    x->tabela[h] = *k;
+    x->tabela[h].valor = valor;
+    x->pilha[x->npilha++] = h;
+}
+
+/* Tira da tabela o que entrou depois da marca; como saem na ordem
+   inversa, nenhuma sondagem passa por uma vaga aberta aqui */
+static void esquecer(Numeracao *x, int marca) {
+    while (x->npilha > marca) x->tabela[x->pilha[--x->npilha]].ocupada = 0;
+}
+
+/* r = a op b, r = a[b] ou r = a (a na memória) */
+static void numerar(Numeracao *x, Quad *q) {
+    Entrada k = chave(x, (OpIR)q->op, q->a, q->b);
+    uint32_t h = posicao(x, &k);
+
+    if (x->tabela[h].ocupada) {
+        *q = (Quad){IR_COPY, q->r, x->tabela[h].valor, NADA};
+        x->reaproveitados++;
+    } else if (q->r.tipo == OPR_TEMP) {
+        inserir(x, h, &k, q->r);
+    }
+}
+
+/* Com continua, a memória está como no fim do único predecessor */
+static void numerarBloco(Numeracao *x, int b, int continua) {
+    const BlocoBasico *bb = &x->s->cfg->blocos[b];
+
+    if (!continua) x->barreira = ++x->relogio;
+    for (uint32_t i = bb->inicio; i < bb->fim; i++) {
+        Quad *q = &x->s->codigo->quads[i];
+
+        switch (q->op) {
+        case IR_COPY:
+            if (memoria(x, q->a)) numerar(x, q);
+            break;
+        case IR_ADD: case IR_SUB: case IR_MUL: case IR_DIV: case IR_SHL:
+        case IR_LT: case IR_LE: case IR_GT: case IR_GE: case IR_EQ: case IR_NE:
+        case IR_LOAD:
+            numerar(x, q);
+            break;
+        case IR_STORE:
+            escrever(x, q->r.v);
+            /* a[i] = v: a leitura seguinte de a[i] é v */
+            if (!memoria(x, q->b)) {
+                Entrada k = chave(x, IR_LOAD, q->r, q->a);
+                uint32_t h = posicao(x, &k);
+                if (!x->tabela[h].ocupada) inserir(x, h, &k, canonico(x, q->b));
+            }
+            break;
+        case IR_CALL:
+            x->barreira = ++x->relogio;
+            break;
+        default:
+            break;
+        }
+
+        if (q->op == IR_COPY && q->r.tipo == OPR_TEMP)
+            x->canonico[q->r.v] = memoria(x, q->a) ? NADA : canonico(x, q->a);
+        else if (defineR((OpIR)q->op) && memoria(x, q->r))
+            escrever(x, q->r.v);
+    }
+}
+
+/* Estado da memória na entrada de um bloco, para voltar a ele quando a
+   subárvore do bloco termina */
+typedef struct {
+    int npilha, nescritos;
+    uint32_t barreira, escritaParams, escritaGlobais;
+} Marca;
+
+static Marca marcar(const Numeracao *x) {
+    Marca m;
+
+    m.npilha = x->npilha;
+    m.nescritos = x->nescritos;
+    m.barreira = x->barreira;
+    m.escritaParams = x->escritaParams;
+    m.escritaGlobais = x->escritaGlobais;
+    return m;
+}
+
+static void voltar(Numeracao *x, const Marca *m) {
+    esquecer(x, m->npilha);
+    while (x->nescritos > m->nescritos) {
+        x->nescritos--;
+        x->escrita[x->escritos[x->nescritos]] = x->anteriores[x->nescritos];
+    }
+    x->barreira = m->barreira;
+    x->escritaParams = m->escritaParams;
+    x->escritaGlobais = m->escritaGlobais;
+}
+
+/* Pré-ordem da árvore de dominadores, com pilha explícita (como a
+   renomeação em ssa.c): o que um bloco calculou vale na sua subárvore.
+   Um bloco cujo único predecessor é o dominador imediato continua também
+   com a memória dele (leituras de arrays e globais incluídas); os outros
+   recomeçam a memória. */
+static void numerarDominados(Numeracao *x) {
+    const FuncaoCfg *f = x->s->cfg;
+    int *filho = (int *)arenaAlloc(f->nblocos * sizeof(int));
+    int *pai = (int *)arenaAlloc(f->nblocos * sizeof(int));
+    Marca *marca = (Marca *)arenaAlloc(f->nblocos * sizeof(Marca));
+    int topo = 0;
+
+    numerarBloco(x, 0, FALSE);
+    pai[topo] = 0;
+    filho[topo++] = f->blocos[0].filhoDom;
+    while (topo > 0) {
+        int c = filho[topo - 1];
+
+        if (c >= 0) {
+            const BlocoBasico *bc = &f->blocos[c];
+
+            filho[topo - 1] = bc->irmaoDom;
+            marca[topo] = marcar(x);
+            numerarBloco(x, c, bc->npred == 1 && bc->pred[0] == pai[topo - 1]);
+            pai[topo] = c;
+            filho[topo++] = bc->filhoDom;
+        } else if (--topo > 0) {
+            voltar(x, &marca[topo]);
+        }
+    }
+}
+
+int numerarValores(FuncaoSsa *s, int global) {
+    const CodigoIR *c = s->codigo;
+    const FuncaoCfg *f = s->cfg;
+    Numeracao x;
+    uint32_t tamanho = 16;
+
+    while (tamanho < 2 * (c->n + 1)) tamanho *= 2;
+    x.s = s;
+    classificar(&x);
+    x.relogio = x.barreira = x.escritaParams = x.escritaGlobais = 0;
+    x.canonico = (Operando *)arenaAlloc((c->ntemps + 1) * sizeof(Operando));
+    x.tabela = (Entrada *)arenaAlloc(tamanho * sizeof(Entrada));
+    x.mascara = tamanho - 1;
+    x.pilha = (uint32_t *)arenaAlloc((c->n + 1) * sizeof(uint32_t));
+    x.npilha = 0;
+    x.escritos = (int32_t *)arenaAlloc((c->n + 1) * sizeof(int32_t));
+    x.anteriores = (uint32_t *)arenaAlloc((c->n + 1) * sizeof(uint32_t));
+    x.nescritos = 0;
+    x.reaproveitados = 0;
+
+    if (global) {
+        numerarDominados(&x);
+    } else {
+        for (int b = 0; b < f->nblocos; b++) {
+            if (!s->vivo[b]) continue;
+            numerarBloco(&x, b, FALSE);
+            esquecer(&x, 0);
+        }
+    }
+    return x.reaproveitados;
+}
@@ -0,0 +1,35 @@
+/* numera.h - Numeração de valores na forma SSA */
+
+#ifndef NUMERA_H
+#define NUMERA_H
+
+#include "globals.h"
+#include "ssa.h"
+
+/*
+ * Uma operação (aritmética, comparação ou leitura de array) que repete
+ * outra já calculada, com os mesmos operandos, vira uma cópia do
+ * resultado anterior; a propagação de cópias depois a remove. Na forma
+ * SSA um temporário nunca muda, então só a memória tem versões: cada
+ * global, array local ou array recebido como parâmetro, e cada chamada.
+ * Uma leitura só é reaproveitada se nenhuma escrita que possa atingir o
+ * mesmo array veio depois dela:
+ *   - um array local só é escrito pelo próprio nome;
+ *   - um array parâmetro (ParamK IntegerArray) pode ser qualquer array
+ *     global ou outro parâmetro, e a escrita num deles invalida o outro;
+ *   - uma chamada invalida toda a memória.
+ * O valor guardado por a[i] = x é o que uma leitura seguinte de a[i]
+ * devolve, sem ler o array.
+ *
+ * Sem global, a numeração é local: a memória e a tabela de valores
+ * recomeçam em cada bloco básico. Com global, a tabela acompanha a
+ * árvore de dominadores: um valor calculado num bloco vale nos blocos
+ * que ele domina. A memória só continua num bloco cujo único
+ * predecessor é o dominador imediato (o lado de um if, o corpo de um
+ * laço); nos pontos de junção ela recomeça.
+ */
+
+/* Devolve quantas operações passaram a reaproveitar um valor */
+int numerarValores(FuncaoSsa *s, int global);
+
+#endif
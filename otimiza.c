@@ -0,0 +1,102 @@
+/* Otimizações sobre o código intermediário (otimiza.c) */
+
+#include "globals.h"
+#include "otimiza.h"
+#include "cfg.h"
+#include "ssa.h"
+#include "numera.h"
+#include "sccp.h"
+#include "vida.h"
+#include "arena.h"
+#include "sessao.h"
+
+/* Estado das otimizações na sessão corrente (globals.h) */
+#define desvios   (sessaoAtual->otimiza.desvios)
+#define reaproveitados (sessaoAtual->otimiza.reaproveitados)
+#define removidas (sessaoAtual->otimiza.removidas)
+#define nivel     (sessaoAtual->otimizar)
+
+/* O código é dividido em trechos: cada função, de IR_FUNC a IR_ENDFUNC,
+   e cada sequência de declarações globais entre elas */
+typedef struct {
+    const CodigoIR *codigo;
+    uint32_t *inicio, *fim;
+    uint8_t *funcao;
+    CodigoIR **trechos;
+    int global;                    /* numeração de valores global (-O2) */
+    int *desviosDe, *reaproveitadosDe, *removidasDe;  /* por trecho */
+} Trechos;
+
+/* Instruções do trecho, sem contar os labels */
+static int instrucoes(const CodigoIR *c) {
+    int n = 0;
+    for (uint32_t i = 0; i < c->n; i++) n += c->quads[i].op != IR_LABEL;
+    return n;
+}
+
+static void otimizarTrecho(int i, void *ctx) {
+    Trechos *t = (Trechos *)ctx;
+    CodigoIR *trecho = irExtrair(t->codigo, t->inicio[i], t->fim[i]);
+    GrafoFluxo *g;
+    FuncaoSsa *s;
+    CodigoIR *otimizado;
+
+    t->desviosDe[i] = 0;
+    t->reaproveitadosDe[i] = 0;
+    t->removidasDe[i] = 0;
+    if (!t->funcao[i]) {
+        t->trechos[i] = trecho;
+        return;
+    }
+    t->removidasDe[i] = instrucoes(trecho);
+    g = construirCfg(trecho);
+    s = construirSsa(trecho, &g->funcoes[0]);
+    t->reaproveitadosDe[i] = numerarValores(s, t->global);
+    t->desviosDe[i] = propagarConstantes(s);
+    propagarCopias(s);
+    otimizado = sairSsa(s);
+    reciclarTemporarios(otimizado);
+    t->removidasDe[i] -= instrucoes(otimizado);
+    t->trechos[i] = otimizado;
+}
+
+CodigoIR *otimizarIR(const CodigoIR *c) {
+    Trechos t;
+    CodigoIR *novo;
+    int n = 0;
+    uint32_t i = 0;
+
+    t.codigo = c;
+    t.global = nivel >= 2;
+    t.inicio = (uint32_t *)arenaAlloc((c->n + 1) * sizeof(uint32_t));
+    t.fim = (uint32_t *)arenaAlloc((c->n + 1) * sizeof(uint32_t));
+    t.funcao = (uint8_t *)arenaAlloc(c->n + 1);
+    while (i < c->n) {
+        t.inicio[n] = i;
+        if (c->quads[i].op == IR_FUNC) {
+            while (c->quads[i].op != IR_ENDFUNC) i++;
+            t.funcao[n] = TRUE;
+            i++;
+        } else {
+            while (i < c->n && c->quads[i].op != IR_FUNC) i++;
+        }
+        t.fim[n++] = i;
+    }
+    t.trechos = (CodigoIR **)arenaAlloc((n + 1) * sizeof(CodigoIR *));
+    t.desviosDe = (int *)arenaAlloc((n + 1) * sizeof(int));
+    t.reaproveitadosDe = (int *)arenaAlloc((n + 1) * sizeof(int));
+    t.removidasDe = (int *)arenaAlloc((n + 1) * sizeof(int));
+    paraCadaParalelo(n, otimizarTrecho, &t);
+
+    novo = novoIR(c->simbolos, c->nsimbolos);
+    desvios = 0;
+    reaproveitados = 0;
+    removidas = 0;
+    for (int k = 0; k < n; k++) {
+        irJuntar(novo, t.trechos[k]);
+        desvios += t.desviosDe[k];
+        reaproveitados += t.reaproveitadosDe[k];
+        removidas += t.removidasDe[k];
+    }
+    return novo;
+}
@@ -0,0 +1,24 @@
+/* otimiza.h - Otimizações sobre o código intermediário */
+
+#ifndef OTIMIZA_H
+#define OTIMIZA_H
+
+#include "globals.h"
+#include "ir.h"
+
+/*
+ * Cada função do código passa, isoladamente, pela forma SSA (ssa.h),
+ * pela numeração de valores (numera.h; global se a sessão tem
+ * otimizar == 2), pela propagação de constantes condicional esparsa
+ * (sccp.h) e pela de cópias, e volta ao código de três endereços com os
+ * temporários reaproveitados (vida.h); as declarações globais ficam como
+ * estão. As funções podem ser otimizadas em paralelo (sessao.h) e o
+ * resultado é o mesmo da execução serial. Os campos otimiza.desvios,
+ * otimiza.reaproveitados e otimiza.removidas da sessão dizem quantos
+ * if_false deixaram de existir, quantas operações passaram a
+ * reaproveitar um valor e quantas instruções (sem os labels) saíram.
+ * Devolve um código novo; c não muda.
+ */
+CodigoIR *otimizarIR(const CodigoIR *c);
+
+#endif
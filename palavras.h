@@ -0,0 +1,27 @@
+/* palavras.h - gerado por gerapalavras.c (make palavras.h); nao editar */
+
+#ifndef PALAVRAS_H
+#define PALAVRAS_H
+
+#define PALAVRA_MIN 2
+#define PALAVRA_MAX 6
+#define PALAVRA_TAM_TABELA 8
+
+/* hash perfeito sobre tamanho, primeiro e ultimo caractere */
+#define PALAVRA_HASH(n, p, u) \
+    (((unsigned)(n) * 1u + (unsigned)(p) * 1u + (unsigned)(u) * 7u) & 7u)
+
+static const struct {
+    const char *texto;
+    int tamanho;
+    TokenType token;
+} tabelaPalavras[PALAVRA_TAM_TABELA] = {
+    [0] = {"int", 3, INT},
+    [2] = {"return", 6, RETURN},
+    [4] = {"else", 4, ELSE},
+    [5] = {"if", 2, IF},
+    [6] = {"void", 4, VOID},
+    [7] = {"while", 5, WHILE},
+};
+
+#endif
@@ -4,13 +4,19 @@
 #include "util.h"
 #include "scan.h"
 #include "parse.h"
+#include "nomes.h"
+#include "sessao.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-static TokenType token;
-static int errorCount = 0;
+/* Estado do parser na sessão corrente (globals.h) */
+#define token      (sessaoAtual->parse.token)
+#define nomeInput  (sessaoAtual->parse.nomeInput)    /* nomes internados das funções de E/S */
+#define nomeOutput (sessaoAtual->parse.nomeOutput)
+#define errorCount (sessaoAtual->parse.errorCount)
+
 static const int MAX_ERRORS = 1;
 
 static TreeNode *declaration_list(void);
@@ -41,11 +47,16 @@ static TreeNode *arg_list(void);
 /* helper: parse de expressão quando statement começou com ID e já consumimos o ID */
 static TreeNode *expression_from_consumed_id(char *identifier);
 
+/* Valor do lexema NUM corrente */
+static int valorLexema(void) {
+    unsigned v = 0;
+    for (int i = 0; i < tamanhoToken; i++) v = v * 10 + (unsigned)(lexemaToken[i] - '0');
+    return (int)v;
+}
+
+/* Encerra a fase: parse() não retorna e a sessão devolve CM_ERRO_SINTATICO */
 static void abortCompilation(void) {
-    fprintf(listing, "\n========================================\n");
-    fprintf(listing, "COMPILACAO ABORTADA: Erros detectados na analise\n");
-    fprintf(listing, "========================================\n");
-    exit(1);
+    abortarSessao(CM_ERRO_SINTATICO);
 }
 
 /* ---------------------- Padronização de mensagens ---------------------- */
@@ -79,13 +90,13 @@ static void foundTokenStr(char *out, size_t outSz) {
         case ID:
         case NUM:
         case ERROR:
-            snprintf(out, outSz, "'%s'", stringToken);
+            snprintf(out, outSz, "'%.*s'", tamanhoToken, lexemaToken);
             break;
         case ENDFILE:
             snprintf(out, outSz, "fim de arquivo");
             break;
         default:
-            snprintf(out, outSz, "'%s'", stringToken);
+            snprintf(out, outSz, "'%.*s'", tamanhoToken, lexemaToken);
             break;
     }
 }
@@ -98,7 +109,7 @@ static void syntaxUnexpectedExpectedStr(const char *expectedStr) {
 
     fprintf(listing,
             "\nERRO SINTATICO: token inesperado %s, esperado '%s' - LINHA: %d\n",
-            foundStr, expectedStr, lineno);
+            foundStr, expectedStr, linhaAtual);
 
     Error = TRUE;
     errorCount++;
@@ -154,7 +165,7 @@ TreeNode *declaration(void) {
     }
 
     if (token == ID) {
-        identifier = copyString(stringToken);
+        identifier = nomeToken;
         match(ID);
     } else {
         syntaxUnexpectedToken(ID);
@@ -193,7 +204,7 @@ TreeNode *var_declaration(void) {
         match(LBRACKET);
 
         if (token == NUM) {
-            t->arraySize = atoi(stringToken);
+            t->arraySize = valorLexema();
             t->type = IntegerArray;
             match(NUM);
         } else {
@@ -256,7 +267,7 @@ TreeNode *param(void) {
     match(token);
 
     if (token == ID) {
-        t->attr.name = copyString(stringToken);
+        t->attr.name = nomeToken;
         match(ID);
     } else {
         syntaxUnexpectedToken(ID);
@@ -348,7 +359,7 @@ TreeNode *expression_stmt(void) {
     }
 
     if (token == ID) {
-        char *identifier = copyString(stringToken);
+        char *identifier = nomeToken;
         match(ID);
 
         /* Se veio ';' direto: exemplo "add;" => erro */
@@ -371,7 +382,7 @@ TreeNode *conditional_expression(void) {
     TreeNode *t = NULL;
 
     if (token == ID) {
-        char *identifier = copyString(stringToken);
+        char *identifier = nomeToken;
         match(ID);
 
         if (token == ASSIGN) {
@@ -447,10 +458,10 @@ TreeNode *expression(void) {
     TreeNode *t = NULL;
 
     if (token == ID) {
-        char *identifier = copyString(stringToken);
+        char *identifier = nomeToken;
 
         /* input/output exigem '(' depois */
-        if (strcmp(stringToken, "input") == 0 || strcmp(stringToken, "output") == 0) {
+        if (nomeToken == nomeInput || nomeToken == nomeOutput) {
             match(ID);
             if (token != LPAREN) {
                 syntaxUnexpectedToken(LPAREN);
@@ -502,7 +513,7 @@ TreeNode *expression(void) {
 /* helper: mesma lógica do começo de expression(), mas com ID já consumido */
 static TreeNode *expression_from_consumed_id(char *identifier) {
 
-    if (strcmp(identifier, "input") == 0 || strcmp(identifier, "output") == 0) {
+    if (identifier == nomeInput || identifier == nomeOutput) {
         if (token != LPAREN) {
             syntaxUnexpectedToken(LPAREN);
             return NULL;
@@ -600,14 +611,14 @@ TreeNode *factor(void) {
     switch (token) {
         case NUM:
             t = newExpNode(ConstK);
-            t->attr.val = atoi(stringToken);
+            t->attr.val = valorLexema();
             match(NUM);
             break;
 
         case ID: {
-            char *identifier = copyString(stringToken);
+            char *identifier = nomeToken;
 
-            if (strcmp(stringToken, "input") == 0 || strcmp(stringToken, "output") == 0) {
+            if (nomeToken == nomeInput || nomeToken == nomeOutput) {
                 match(ID);
                 if (token != LPAREN) {
                     syntaxUnexpectedToken(LPAREN);
@@ -688,6 +699,8 @@ TreeNode *arg_list(void) {
 TreeNode *parse(void) {
     TreeNode *t;
     errorCount = 0;
+    nomeInput = internar("input");
+    nomeOutput = internar("output");
 
     token = getToken();
     t = declaration_list();
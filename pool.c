@@ -0,0 +1,280 @@
+/*
+ * Pool de threads com roubo de tarefas (pool.c)
+ *
+ * As filas são vetores circulares protegidos por uma trava cada: as
+ * tarefas do compilador (um arquivo, uma função) são grossas o bastante
+ * para que a trava não apareça no tempo, e assim a dona e os ladrões não
+ * precisam de protocolo sem travas. Threads sem trabalho dormem em aviso,
+ * que é sinalizado a cada tarefa submetida, grupo concluído e no
+ * encerramento do pool.
+ */
+
+#include "pool.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+#define FILA_INICIAL 64
+
+typedef struct {
+    void (*f)(void *arg);
+    void *arg;
+    GrupoTarefas *grupo;
+} Tarefa;
+
+/* Fila de uma thread: a dona usa o fim, os ladrões o início. Cada fila
+   ocupa a sua própria linha de cache. */
+typedef struct {
+    _Alignas(64) pthread_mutex_t trava;
+    Tarefa *v;
+    unsigned capacidade;        /* potência de 2 */
+    unsigned inicio, fim;       /* fim - inicio tarefas */
+} Fila;
+
+typedef struct {
+    Pool *pool;
+    int posicao;
+} Trabalhador;
+
+struct Pool {
+    int n;
+    Fila *filas;
+    void *memoriaFilas;         /* o bloco alocado, antes do alinhamento */
+    Trabalhador *trabalhadores;
+    pthread_t *threads;
+    pthread_mutex_t trava;
+    pthread_cond_t aviso;
+    atomic_int enfileiradas;
+    int encerrar;
+};
+
+/* Posição da thread corrente no pool a que pertence */
+static _Thread_local Pool *poolAtual = NULL;
+static _Thread_local int posicaoAtual = 0;
+
+static int posicao(Pool *p) {
+    return poolAtual == p ? posicaoAtual : 0;
+}
+
+/* FALSE se a fila estava cheia e não pôde crescer */
+static int empilhar(Fila *q, Tarefa t) {
+    pthread_mutex_lock(&q->trava);
+    if (q->fim - q->inicio == q->capacidade) {
+        unsigned cap = q->capacidade * 2;
+        Tarefa *v = (Tarefa *)malloc(cap * sizeof(Tarefa));
+        if (v == NULL) {
+            pthread_mutex_unlock(&q->trava);
+            return 0;
+        }
+        for (unsigned i = q->inicio; i != q->fim; i++)
+            v[i - q->inicio] = q->v[i & (q->capacidade - 1)];
+        free(q->v);
+        q->fim -= q->inicio;
+        q->inicio = 0;
+        q->v = v;
+        q->capacidade = cap;
+    }
+    q->v[q->fim++ & (q->capacidade - 1)] = t;
+    pthread_mutex_unlock(&q->trava);
+    return 1;
+}
+
+static int desempilhar(Fila *q, Tarefa *t) {
+    int achou = 0;
+    pthread_mutex_lock(&q->trava);
+    if (q->fim != q->inicio) {
+        *t = q->v[--q->fim & (q->capacidade - 1)];
+        achou = 1;
+    }
+    pthread_mutex_unlock(&q->trava);
+    return achou;
+}
+
+static int roubar(Fila *q, Tarefa *t) {
+    int achou = 0;
+    pthread_mutex_lock(&q->trava);
+    if (q->fim != q->inicio) {
+        *t = q->v[q->inicio++ & (q->capacidade - 1)];
+        achou = 1;
+    }
+    pthread_mutex_unlock(&q->trava);
+    return achou;
+}
+
+/* Da própria fila primeiro; depois das outras, a partir da vizinha */
+static int obterTarefa(Pool *p, int eu, Tarefa *t) {
+    if (!desempilhar(&p->filas[eu], t)) {
+        int i;
+        for (i = 1; i < p->n; i++)
+            if (roubar(&p->filas[(eu + i) % p->n], t)) break;
+        if (i >= p->n) return 0;
+    }
+    atomic_fetch_sub(&p->enfileiradas, 1);
+    return 1;
+}
+
+static void executarTarefa(Pool *p, Tarefa *t) {
+    t->f(t->arg);
+    if (atomic_fetch_sub(&t->grupo->pendentes, 1) == 1) {
+        pthread_mutex_lock(&p->trava);
+        pthread_cond_broadcast(&p->aviso);
+        pthread_mutex_unlock(&p->trava);
+    }
+}
+
+static void *trabalhar(void *arg) {
+    Trabalhador *w = (Trabalhador *)arg;
+    Pool *p = w->pool;
+    Tarefa t;
+
+    poolAtual = p;
+    posicaoAtual = w->posicao;
+    for (;;) {
+        if (obterTarefa(p, w->posicao, &t)) {
+            executarTarefa(p, &t);
+            continue;
+        }
+        pthread_mutex_lock(&p->trava);
+        while (atomic_load(&p->enfileiradas) == 0 && !p->encerrar)
+            pthread_cond_wait(&p->aviso, &p->trava);
+        if (p->encerrar && atomic_load(&p->enfileiradas) == 0) {
+            pthread_mutex_unlock(&p->trava);
+            return NULL;
+        }
+        pthread_mutex_unlock(&p->trava);
+    }
+}
+
+int numeroNucleos(void) {
+#ifdef _SC_NPROCESSORS_ONLN
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n > 0) return (int)n;
+#endif
+    return 1;
+}
+
+/* Encerra as threads 1..criadas-1 e libera o pool */
+static void encerrar(Pool *p, int criadas) {
+    pthread_mutex_lock(&p->trava);
+    p->encerrar = 1;
+    pthread_cond_broadcast(&p->aviso);
+    pthread_mutex_unlock(&p->trava);
+    for (int i = 1; i < criadas; i++) pthread_join(p->threads[i], NULL);
+
+    for (int i = 0; i < p->n; i++) {
+        pthread_mutex_destroy(&p->filas[i].trava);
+        free(p->filas[i].v);
+    }
+    pthread_mutex_destroy(&p->trava);
+    pthread_cond_destroy(&p->aviso);
+    free(p->memoriaFilas);
+    free(p->trabalhadores);
+    free(p->threads);
+    free(p);
+}
+
+/* n filas alinhadas à linha de cache; *bloco é o que vai para o free.
+   O Windows não tem aligned_alloc: lá o bloco sobra 63 bytes e o
+   ponteiro é arredondado. */
+static Fila *alocarFilas(int n, void **bloco) {
+#ifndef _WIN32
+    *bloco = aligned_alloc(64, n * sizeof(Fila));
+    return (Fila *)*bloco;
+#else
+    *bloco = malloc(n * sizeof(Fila) + 63);
+    if (*bloco == NULL) return NULL;
+    return (Fila *)(((uintptr_t)*bloco + 63) & ~(uintptr_t)63);
+#endif
+}
+
+Pool *criarPool(int nthreads) {
+    Pool *p = (Pool *)calloc(1, sizeof(Pool));
+    int i;
+
+    if (p == NULL) return NULL;
+    if (nthreads <= 0) nthreads = numeroNucleos();
+    p->n = nthreads;
+    p->filas = alocarFilas(nthreads, &p->memoriaFilas);
+    p->trabalhadores = (Trabalhador *)calloc(nthreads, sizeof(Trabalhador));
+    p->threads = (pthread_t *)calloc(nthreads, sizeof(pthread_t));
+    if (p->filas == NULL || p->trabalhadores == NULL || p->threads == NULL) {
+        free(p->memoriaFilas);
+        free(p->trabalhadores);
+        free(p->threads);
+        free(p);
+        return NULL;
+    }
+    memset(p->filas, 0, nthreads * sizeof(Fila));
+    for (i = 0; i < nthreads; i++) {
+        pthread_mutex_init(&p->filas[i].trava, NULL);
+        p->filas[i].v = (Tarefa *)malloc(FILA_INICIAL * sizeof(Tarefa));
+        p->filas[i].capacidade = FILA_INICIAL;
+        p->trabalhadores[i].pool = p;
+        p->trabalhadores[i].posicao = i;
+    }
+    pthread_mutex_init(&p->trava, NULL);
+    pthread_cond_init(&p->aviso, NULL);
+    atomic_init(&p->enfileiradas, 0);
+    for (i = 0; i < nthreads; i++) {
+        if (p->filas[i].v == NULL) {
+            encerrar(p, 1);
+            return NULL;
+        }
+    }
+
+    for (i = 1; i < nthreads; i++) {
+        if (pthread_create(&p->threads[i], NULL, trabalhar, &p->trabalhadores[i]) != 0) {
+            encerrar(p, i);
+            return NULL;
+        }
+    }
+    return p;
+}
+
+void destruirPool(Pool *p) {
+    if (p != NULL) encerrar(p, p->n);
+}
+
+int poolThreads(Pool *p) {
+    return p->n;
+}
+
+void poolSubmeter(Pool *p, GrupoTarefas *g, void (*f)(void *arg), void *arg) {
+    Tarefa t;
+
+    t.f = f;
+    t.arg = arg;
+    t.grupo = g;
+    atomic_fetch_add(&g->pendentes, 1);
+    if (!empilhar(&p->filas[posicao(p)], t)) {
+        executarTarefa(p, &t);  /* sem memória para enfileirar: roda aqui */
+        return;
+    }
+    atomic_fetch_add(&p->enfileiradas, 1);
+
+    pthread_mutex_lock(&p->trava);
+    pthread_cond_broadcast(&p->aviso);
+    pthread_mutex_unlock(&p->trava);
+}
+
+void poolEsperar(Pool *p, GrupoTarefas *g) {
+    int eu = posicao(p);
+    Tarefa t;
+
+    while (atomic_load(&g->pendentes) > 0) {
+        if (obterTarefa(p, eu, &t)) {
+            executarTarefa(p, &t);
+            continue;
+        }
+        pthread_mutex_lock(&p->trava);
+        while (atomic_load(&g->pendentes) > 0 && atomic_load(&p->enfileiradas) == 0)
+            pthread_cond_wait(&p->aviso, &p->trava);
+        pthread_mutex_unlock(&p->trava);
+    }
+}
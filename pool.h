@@ -0,0 +1,48 @@
+/* pool.h - Pool de threads com roubo de tarefas */
+
+#ifndef POOL_H
+#define POOL_H
+
+/*
+ * Cada thread do pool tem a sua fila de tarefas: tira do fim da própria
+ * fila (a última submetida primeiro) e, sem trabalho, rouba do início
+ * da fila de outra thread. A thread que criou o pool ocupa a posição 0 e
+ * só executa tarefas dentro de poolEsperar(); as demais são criadas pelo
+ * pool. Uma tarefa pode submeter outras e esperar por elas.
+ *
+ * Tarefas são agrupadas: poolEsperar() retorna quando todas as tarefas
+ * do grupo terminaram, executando tarefas pendentes enquanto espera.
+ */
+
+#include <stdatomic.h>
+
+typedef struct Pool Pool;
+
+typedef struct {
+    atomic_int pendentes;
+} GrupoTarefas;
+
+#define GRUPO_VAZIO {0}
+
+/* nthreads <= 0: uma thread por núcleo. NULL sem memória ou se as
+   threads não puderem ser criadas. */
+Pool *criarPool(int nthreads);
+
+/* Espera as threads terminarem; não deve haver tarefas pendentes */
+void destruirPool(Pool *p);
+
+/* Número de threads, contando a que criou o pool */
+int poolThreads(Pool *p);
+
+/* Enfileira f(arg) no grupo g, na fila da thread que chama. Se a fila
+   não pode crescer por falta de memória, f(arg) roda na hora, nesta
+   thread. */
+void poolSubmeter(Pool *p, GrupoTarefas *g, void (*f)(void *arg), void *arg);
+
+/* Executa tarefas até todas as do grupo g terminarem */
+void poolEsperar(Pool *p, GrupoTarefas *g);
+
+/* Núcleos disponíveis */
+int numeroNucleos(void);
+
+#endif
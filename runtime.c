@@ -0,0 +1,96 @@
+/*
+ * runtime.c - Runtime dos programas compilados para x86-64 (x64.h)
+ *
+ * Ligado com o assembly gerado por --asm:
+ *
+ *   ./cminus --asm=prog.s prog.cm && cc -o prog prog.s runtime.c
+ *
+ * input() e output(x) são cm_input e cm_output. O main chama cm_main numa
+ * thread com pilha grande, como o interpretador (interp.c), e os erros de
+ * execução terminam o programa com status 1 e a mensagem do
+ * interpretador em stderr. Sem contar as chamadas, a recursão profunda
+ * demais é o estouro da pilha da thread (SIGSEGV numa pilha alternativa).
+ */
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define PILHA_THREAD ((size_t)512 << 20)
+#define PILHA_SINAL  ((size_t)64 << 10)
+
+int cm_main(void);
+
+/* Motivos de x64.h (ERRO_INDICE, ERRO_DIVISAO, ERRO_ESTOURO) */
+static const char *const motivos[] = {
+    "indice fora do array", "divisao por zero", "estouro na divisao"
+};
+
+static void falhar(const char *msg) {
+    fflush(stdout);
+    fprintf(stderr, "\nERRO DE EXECUCAO: %s\n", msg);
+    exit(1);
+}
+
+void cm_erro_execucao(int motivo) {
+    falhar(motivo >= 0 && motivo < 3 ? motivos[motivo] : "erro desconhecido");
+}
+
+int cm_input(void) {
+    int v;
+
+    fflush(stdout);
+    if (scanf("%d", &v) != 1) falhar("entrada esgotada ou invalida em input()");
+    return v;
+}
+
+void cm_output(int x) {
+    printf("%d\n", x);
+}
+
+/* O programa termina aqui: esvaziar stdout não é seguro num tratador de
+   sinal, mas a saída já escrita não se perde */
+static void estouroDaPilha(int sinal) {
+    static const char msg[] = "\nERRO DE EXECUCAO: recursao profunda demais\n";
+
+    (void)sinal;
+    fflush(stdout);
+    if (write(STDERR_FILENO, msg, sizeof(msg) - 1) < 0) _exit(1);
+    _exit(1);
+}
+
+static void *executar(void *arg) {
+    stack_t alternativa;
+    struct sigaction acao;
+
+    (void)arg;
+    alternativa.ss_sp = malloc(PILHA_SINAL);
+    alternativa.ss_size = PILHA_SINAL;
+    alternativa.ss_flags = 0;
+    if (alternativa.ss_sp != NULL && sigaltstack(&alternativa, NULL) == 0) {
+        memset(&acao, 0, sizeof(acao));
+        acao.sa_handler = estouroDaPilha;
+        acao.sa_flags = SA_ONSTACK;
+        sigemptyset(&acao.sa_mask);
+        sigaction(SIGSEGV, &acao, NULL);
+    }
+    cm_main();
+    return NULL;
+}
+
+int main(void) {
+    pthread_attr_t atributos;
+    pthread_t thread;
+    int ok;
+
+    pthread_attr_init(&atributos);
+    pthread_attr_setstacksize(&atributos, PILHA_THREAD);
+    ok = pthread_create(&thread, &atributos, executar, NULL) == 0;
+    pthread_attr_destroy(&atributos);
+    if (ok) pthread_join(thread, NULL);
+    else executar(NULL);
+    return 0;
+}
@@ -3,69 +3,213 @@
 #include "globals.h"
 #include "util.h"
 #include "scan.h"
+#include "palavras.h"
+#include "scansimd.h"
+#include "nomes.h"
 
 #include <ctype.h>
 #include <string.h>
+#include <pthread.h>
+
+#ifndef _WIN32
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 
 typedef enum {
-    INICIO, EMCOMENTARIO, EMNUM, EMNUMERRO, EMID, EMATRIBUICAO, EMNE, EMLE, EMGE, CONCLUIDO
+    INICIO, EMCOMENTARIO, EMNUM, EMNUMERRO, EMID, EMATRIBUICAO, EMNE, EMLE, EMGE,
+    EMBARRA, EMFIMCOMENTARIO, CONCLUIDO
 } TipoEstado;
 
-char stringToken[MAXTOKENLEN + 1];
+/* Estado do scanner na sessão corrente (globals.h); bufferFonte e o
+   lexema do token são exportados por scan.h */
+#define tamanhoFonte (sessaoAtual->scan.tamanhoFonte)
+#define posicao      (sessaoAtual->scan.posicao)
+#define flag_EOF     (sessaoAtual->scan.flag_EOF)
+#define linhaEcoada  (sessaoAtual->scan.linhaEcoada)    /* EchoSource: última linha já impressa */
+#define posicaoEco   (sessaoAtual->scan.posicaoEco)     /* EchoSource: início da próxima linha a imprimir */
+#define fonteMapeada (sessaoAtual->scan.fonteMapeada)   /* buffer vem de mmap */
+#define fonteAlocada (sessaoAtual->scan.fonteAlocada)   /* buffer vem de malloc */
 
-#define TAMANHOBUF 256
-static char bufferLinha[TAMANHOBUF];
-static int posicaoLinha = 0;
-static int tamanhoBuffer = 0;
-static int flag_EOF = FALSE;
+#define linhaInicioComentario (sessaoAtual->scan.linhaInicioComentario)
 
-static int linhaInicioComentario = 0;
+/* Bytes zerados depois do fonte nos buffers alocados: cobrem o bloco lido
+   pelos kernels de scansimd.c que contém a sentinela */
+#define FOLGA_FONTE 32
 
-static struct {
-    char *texto;
-    TokenType token;
-} palavrasReservadas[MAXRESERVED] = {
-    {"else", ELSE}, {"if", IF}, {"int", INT},
-    {"return", RETURN}, {"void", VOID}, {"while", WHILE}
-};
+/* Lê o restante de f para um buffer com sentinela (pipes, stdin, Windows) */
+static int lerFonte(FILE *f) {
+    long capacidade = 1 << 16;
+    long n = 0;
+    char *buf = (char *)malloc(capacidade + FOLGA_FONTE);
+    size_t lidos;
 
-static int obterProximoChar(void) {
-    if (!(posicaoLinha < tamanhoBuffer)) {
-        lineno++;
-        if (fgets(bufferLinha, TAMANHOBUF - 1, source)) {
-            if (EchoSource) fprintf(listing, "%4d: %s", lineno, bufferLinha);
-            tamanhoBuffer = (int)strlen(bufferLinha);
-            posicaoLinha = 0;
-            return bufferLinha[posicaoLinha++];
-        } else {
-            flag_EOF = TRUE;
-            return EOF;
+    if (buf == NULL) return -1;
+    while ((lidos = fread(buf + n, 1, capacidade - n, f)) > 0) {
+        n += (long)lidos;
+        if (n == capacidade) {
+            char *novo = (char *)realloc(buf, capacidade * 2 + FOLGA_FONTE);
+            if (novo == NULL) { free(buf); return -1; }
+            buf = novo;
+            capacidade *= 2;
         }
-    } else {
-        return bufferLinha[posicaoLinha++];
     }
+    memset(buf + n, 0, FOLGA_FONTE);
+    bufferFonte = buf;
+    tamanhoFonte = n;
+    fonteAlocada = TRUE;
+    return 0;
+}
+
+/* Os kernels são escolhidos uma vez no processo, pela primeira sessão a
+   carregar um fonte; sessões em outras threads esperam a escolha */
+static pthread_once_t kernelsEscolhidos = PTHREAD_ONCE_INIT;
+
+static void escolherKernelsPadrao(void) {
+    if (kernelsScanner.nome == NULL) escolherKernelsScanner(SIMD_AUTO);
+}
+
+static void reiniciarScanner(void) {
+    pthread_once(&kernelsEscolhidos, escolherKernelsPadrao);
+    posicao = 0;
+    flag_EOF = FALSE;
+    inicioToken = 0;
+    tamanhoToken = 0;
+    linhaEcoada = 0;
+    posicaoEco = 0;
+    linhaAtual = 1;
+}
+
+void usarFonteMemoria(const char *buf, long n) {
+    liberarFonte();
+    bufferFonte = buf;
+    tamanhoFonte = n;
+    reiniciarScanner();
+}
+
+int copiarFonte(const char *buf, long n) {
+    char *copia = (char *)malloc(n + FOLGA_FONTE);
+
+    if (copia == NULL) return -1;
+    memcpy(copia, buf, n);
+    memset(copia + n, 0, FOLGA_FONTE);
+    usarFonteMemoria(copia, n);
+    fonteAlocada = TRUE;
+    return 0;
+}
+
+int carregarFonte(FILE *f) {
+    liberarFonte();
+    reiniciarScanner();
+
+#ifndef _WIN32
+    {
+        struct stat st;
+        long pagina = sysconf(_SC_PAGESIZE);
+        int fd = fileno(f);
+
+        /* Os bytes após o fim do arquivo na última página do mapeamento são
+           zerados pelo kernel e servem de sentinela. Se o tamanho for múltiplo
+           exato da página não há essa folga, e o arquivo é lido normalmente. */
+        if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0 &&
+            pagina > 0 && st.st_size % pagina != 0) {
+            void *p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+#ifdef MADV_SEQUENTIAL
+                madvise(p, (size_t)st.st_size, MADV_SEQUENTIAL);
+#endif
+                bufferFonte = (const char *)p;
+                tamanhoFonte = (long)st.st_size;
+                fonteMapeada = TRUE;
+                return 0;
+            }
+        }
+    }
+#endif
+
+    return lerFonte(f);
+}
+
+void liberarFonte(void) {
+#ifndef _WIN32
+    if (fonteMapeada) munmap((void *)bufferFonte, (size_t)tamanhoFonte);
+#endif
+    if (fonteAlocada) free((void *)bufferFonte);
+    bufferFonte = "";
+    tamanhoFonte = 0;
+    fonteMapeada = FALSE;
+    fonteAlocada = FALSE;
+}
+
+/* TraceScan: o token corrente na listagem ou no destino dos tokens */
+static void imprimirToken(TokenType t) {
+    FILE *f = sessaoAtual->tokens != NULL ? sessaoAtual->tokens : listing;
+    fprintf(f, "\t%d: ", linhaAtual);
+    printToken(f, t, bufferFonte + inicioToken, tamanhoToken);
+}
+
+/* EchoSource: imprime as linhas do fonte até a linha corrente */
+static void ecoarLinhas(void) {
+    while (linhaEcoada < linhaAtual && posicaoEco < tamanhoFonte) {
+        const char *ini = bufferFonte + posicaoEco;
+        const char *fim = memchr(ini, '\n', (size_t)(tamanhoFonte - posicaoEco));
+        int n = fim ? (int)(fim - ini) + 1 : (int)(tamanhoFonte - posicaoEco);
+        fprintf(listing, "%4d: %.*s", ++linhaEcoada, n, ini);
+        posicaoEco += n;
+    }
+}
+
+/* O fim de arquivo conta como uma linha a mais quando o fonte não termina em '\n' */
+static void marcarFimDeArquivo(void) {
+    if (!flag_EOF) {
+        flag_EOF = TRUE;
+        if (tamanhoFonte > 0 && bufferFonte[tamanhoFonte - 1] != '\n') linhaAtual++;
+    }
+}
+
+/* linhaAtual avança ao consumir '\n' e recua se ele for devolvido, de modo que
+   um token terminado pelo fim da linha é reportado na própria linha */
+static int obterProximoChar(void) {
+    int c = (unsigned char)bufferFonte[posicao];
+
+    if (c == '\0' && posicao >= tamanhoFonte) {
+        marcarFimDeArquivo();
+        return EOF;
+    }
+    if (c == '\n') linhaAtual++;
+    posicao++;
+    return c;
 }
 
 static void devolverProximoChar(void) {
-    if (!flag_EOF) posicaoLinha--;
+    if (!flag_EOF) {
+        posicao--;
+        if (bufferFonte[posicao] == '\n') linhaAtual--;
+    }
 }
 
-static TokenType buscarPalavraReservada(char *s) {
-    for (int i = 0; i < MAXRESERVED; i++)
-        if (!strcmp(s, palavrasReservadas[i].texto))
-            return palavrasReservadas[i].token;
+/* Uma posição da tabela de hash perfeito (palavras.h) e um memcmp */
+static TokenType buscarPalavraReservada(const char *s, int n) {
+    if (n < PALAVRA_MIN || n > PALAVRA_MAX) return ID;
+    int h = PALAVRA_HASH(n, (unsigned char)s[0], (unsigned char)s[n - 1]);
+    if (tabelaPalavras[h].tamanho == n && memcmp(s, tabelaPalavras[h].texto, n) == 0)
+        return tabelaPalavras[h].token;
     return ID;
 }
 
-TokenType getToken(void) {
-    int indiceStringToken = 0;
+/* Scanner original escrito à mão (switch sobre TipoEstado), mantido como
+   referência para o benchmark e para comparação com o scanner por tabela */
+TokenType getTokenReferencia(void) {
     TokenType tokenAtual = ERROR;
     TipoEstado estado = INICIO;
-    int salvar;
 
     while (estado != CONCLUIDO) {
+        /* o lexema começa no primeiro caractere lido a partir de INICIO */
+        if (estado == INICIO) inicioToken = posicao;
+
         int c = obterProximoChar();
-        salvar = TRUE;
 
         switch (estado) {
 
@@ -89,14 +233,13 @@ TokenType getToken(void) {
                 estado = EMGE;
             }
             else if ((c == ' ') || (c == '\t') || (c == '\n')) {
-                salvar = FALSE;
+                /* espaço em branco: continua em INICIO */
             }
             else if (c == '/') {
-                salvar = FALSE;
                 int c2 = obterProximoChar();
                 if (c2 == '*') {
                     estado = EMCOMENTARIO;
-                    linhaInicioComentario = lineno;
+                    linhaInicioComentario = linhaAtual;
                 } else {
                     devolverProximoChar();
                     estado = CONCLUIDO;
@@ -107,7 +250,6 @@ TokenType getToken(void) {
                 estado = CONCLUIDO;
                 switch (c) {
                 case EOF:
-                    salvar = FALSE;
                     tokenAtual = ENDFILE;
                     break;
                 case '+': tokenAtual = PLUS; break;
@@ -123,7 +265,7 @@ TokenType getToken(void) {
                 case '}': tokenAtual = RBRACE; break;
                 default:
                     /* ERRO LÉXICO: caractere desconhecido */
-                    fprintf(listing, "\nERRO LEXICO: '%c' - LINHA: %d\n", c, lineno);
+                    fprintf(listing, "\nERRO LEXICO: '%c' - LINHA: %d\n", c, linhaAtual);
                     Error = TRUE;
                     tokenAtual = ERROR;
                     break;
@@ -132,7 +274,6 @@ TokenType getToken(void) {
             break;
 
         case EMCOMENTARIO:
-            salvar = FALSE;
             if (c == EOF) {
                 estado = CONCLUIDO;
                 tokenAtual = ENDFILE;
@@ -162,7 +303,6 @@ TokenType getToken(void) {
             if (c == '=') tokenAtual = EQ;
             else {
                 devolverProximoChar();
-                salvar = FALSE;
                 tokenAtual = ASSIGN;
             }
             break;
@@ -173,8 +313,7 @@ TokenType getToken(void) {
             else {
                 /* ERRO LÉXICO: '!' sem '=' */
                 devolverProximoChar();
-                salvar = FALSE;
-                fprintf(listing, "\nERRO LEXICO: '!' esperava '=' - LINHA: %d\n", lineno);
+                fprintf(listing, "\nERRO LEXICO: '!' esperava '=' - LINHA: %d\n", linhaAtual);
                 Error = TRUE;
                 tokenAtual = ERROR;
             }
@@ -185,7 +324,6 @@ TokenType getToken(void) {
             if (c == '=') tokenAtual = LE;
             else {
                 devolverProximoChar();
-                salvar = FALSE;
                 tokenAtual = LT;
             }
             break;
@@ -195,7 +333,6 @@ TokenType getToken(void) {
             if (c == '=') tokenAtual = GE;
             else {
                 devolverProximoChar();
-                salvar = FALSE;
                 tokenAtual = GT;
             }
             break;
@@ -206,11 +343,10 @@ TokenType getToken(void) {
                 estado = EMNUMERRO;
                 tokenAtual = ERROR;
                 Error = TRUE;
-                /* mantém salvar=TRUE para capturar o 'a' em stringToken */
+                /* o lexema segue até o fim do "token ruim" (10abc) */
             }
             else if (!isdigit(c)) {
                 devolverProximoChar();
-                salvar = FALSE;
                 estado = CONCLUIDO;
                 tokenAtual = NUM;
             }
@@ -220,11 +356,10 @@ TokenType getToken(void) {
             /* Consumir o resto do "token ruim" (letras/dígitos). Para ao encontrar delimitador. */
             if (!isalnum(c)) {
                 devolverProximoChar();
-                salvar = FALSE;
                 estado = CONCLUIDO;
 
-                /* stringToken já terá algo como "10abc" */
-                /* OBS: a mensagem será emitida ao final, quando stringToken estiver fechado */
+                /* o lexema será algo como "10abc" */
+                /* OBS: a mensagem será emitida ao final, quando o lexema estiver fechado */
                 tokenAtual = ERROR;
             }
             break;
@@ -233,7 +368,6 @@ TokenType getToken(void) {
             /* ID no C-: letra (letra|digito)*  */
             if (!isalnum(c)) {
                 devolverProximoChar();
-                salvar = FALSE;
                 estado = CONCLUIDO;
                 tokenAtual = ID;
             }
@@ -248,38 +382,251 @@ TokenType getToken(void) {
             break;
         }
 
-        if ((salvar) && (indiceStringToken <= MAXTOKENLEN)) {
-            stringToken[indiceStringToken++] = (char)c;
-        }
-
         if (estado == CONCLUIDO) {
-            stringToken[indiceStringToken] = '\0';
+            tamanhoToken = (tokenAtual == ENDFILE) ? 0 : (int)(posicao - inicioToken);
 
             /* Se terminamos com ID, pode ser palavra reservada */
             if (tokenAtual == ID) {
-                tokenAtual = buscarPalavraReservada(stringToken);
+                tokenAtual = buscarPalavraReservada(bufferFonte + inicioToken, tamanhoToken);
+                if (tokenAtual == ID) nomeToken = internarNome(bufferFonte + inicioToken, tamanhoToken);
             }
 
             /* Se terminamos com ERROR por número mal-formado, reporta aqui com o lexema completo */
-            if (tokenAtual == ERROR && indiceStringToken > 0 && isdigit((unsigned char)stringToken[0])) {
+            if (tokenAtual == ERROR && tamanhoToken > 0 && isdigit((unsigned char)bufferFonte[inicioToken])) {
                 /* pega casos como 10abc */
                 int temLetra = 0;
-                for (int i = 0; stringToken[i] != '\0'; i++) {
-                    if (isalpha((unsigned char)stringToken[i])) { temLetra = 1; break; }
+                for (int i = 0; i < tamanhoToken; i++) {
+                    if (isalpha((unsigned char)bufferFonte[inicioToken + i])) { temLetra = 1; break; }
                 }
                 if (temLetra) {
                     fprintf(listing,
-                            "\nERRO LEXICO: '%s' - LINHA: %d\n",
-                            stringToken, lineno);
+                            "\nERRO LEXICO: '%.*s' - LINHA: %d\n",
+                            tamanhoToken, bufferFonte + inicioToken, linhaAtual);
                 }
             }
         }
     }
 
-    if (TraceScan) {
-        fprintf(listing, "\t%d: ", lineno);
-        printToken(tokenAtual, stringToken);
+    if (EchoSource) ecoarLinhas();
+    if (TraceScan) imprimirToken(tokenAtual);
+
+    return tokenAtual;
+}
+
+/* ---------------------- Scanner por tabela ---------------------- */
+
+/* Classes de caractere da DFA; C_FIM é a sentinela '\0' */
+typedef enum {
+    C_FIM, C_OUTRO, C_LETRA, C_DIGITO, C_ESPACO, C_NOVALINHA,
+    C_IGUAL, C_EXCL, C_MENOR, C_MAIOR, C_BARRA, C_ASTERISCO,
+    C_MAIS, C_MENOS, C_ABREPAR, C_FECHAPAR, C_PONTOVIRGULA, C_VIRGULA,
+    C_ABRECOL, C_FECHACOL, C_ABRECHAVE, C_FECHACHAVE,
+    NCLASSES
+} ClasseChar;
+
+/* Somente ASCII: sem dependência do locale de <ctype.h> */
+static const unsigned char classeChar[256] = {
+    [0 ... 255] = C_OUTRO,
+    ['\0'] = C_FIM,
+    ['a' ... 'z'] = C_LETRA, ['A' ... 'Z'] = C_LETRA,
+    ['0' ... '9'] = C_DIGITO,
+    [' '] = C_ESPACO, ['\t'] = C_ESPACO, ['\n'] = C_NOVALINHA,
+    ['='] = C_IGUAL, ['!'] = C_EXCL, ['<'] = C_MENOR, ['>'] = C_MAIOR,
+    ['/'] = C_BARRA, ['*'] = C_ASTERISCO,
+    ['+'] = C_MAIS, ['-'] = C_MENOS, ['('] = C_ABREPAR, [')'] = C_FECHAPAR,
+    [';'] = C_PONTOVIRGULA, [','] = C_VIRGULA, ['['] = C_ABRECOL, [']'] = C_FECHACOL,
+    ['{'] = C_ABRECHAVE, ['}'] = C_FECHACHAVE
+};
+
+/* Ações de uma transição */
+#define A_LINHA   1   /* consumiu '\n' fora de token: linhaAtual++ */
+#define A_ACEITA  2   /* fim do token */
+#define A_CONSOME 4   /* com A_ACEITA: o caractere faz parte do token */
+#define A_RAPIDO  8   /* após a transição, avança com um kernel de scansimd.c */
+
+typedef struct {
+    unsigned char proximo;   /* estado seguinte */
+    unsigned char token;     /* token reconhecido (com A_ACEITA) */
+    unsigned char acao;
+} Transicao;
+
+#define VAI(e)       { (e), 0, 0 }
+#define LINHA(e)     { (e), 0, A_LINHA }
+#define ACEITA(t)    { CONCLUIDO, (t), A_ACEITA }
+#define CONSOME(t)   { CONCLUIDO, (t), A_ACEITA | A_CONSOME }
+#define RAPIDO(e)    { (e), 0, A_RAPIDO }
+#define RAPIDOLINHA(e) { (e), 0, A_RAPIDO | A_LINHA }
+
+/* Transições estado x classe. Cada linha começa por um padrão que cobre
+   todas as classes e depois sobrescreve as que mudam o comportamento. */
+static const Transicao tabelaDFA[CONCLUIDO][NCLASSES] = {
+    [INICIO] = {
+        [0 ... NCLASSES - 1] = CONSOME(ERROR),
+        [C_FIM] = ACEITA(ENDFILE),
+        [C_LETRA] = RAPIDO(EMID), [C_DIGITO] = VAI(EMNUM),
+        [C_ESPACO] = RAPIDO(INICIO), [C_NOVALINHA] = RAPIDOLINHA(INICIO),
+        [C_IGUAL] = VAI(EMATRIBUICAO), [C_EXCL] = VAI(EMNE),
+        [C_MENOR] = VAI(EMLE), [C_MAIOR] = VAI(EMGE), [C_BARRA] = VAI(EMBARRA),
+        [C_ASTERISCO] = CONSOME(TIMES), [C_MAIS] = CONSOME(PLUS), [C_MENOS] = CONSOME(MINUS),
+        [C_ABREPAR] = CONSOME(LPAREN), [C_FECHAPAR] = CONSOME(RPAREN),
+        [C_PONTOVIRGULA] = CONSOME(SEMI), [C_VIRGULA] = CONSOME(COMMA),
+        [C_ABRECOL] = CONSOME(LBRACKET), [C_FECHACOL] = CONSOME(RBRACKET),
+        [C_ABRECHAVE] = CONSOME(LBRACE), [C_FECHACHAVE] = CONSOME(RBRACE)
+    },
+    [EMCOMENTARIO] = {
+        [0 ... NCLASSES - 1] = RAPIDO(EMCOMENTARIO),
+        [C_FIM] = ACEITA(ENDFILE),
+        [C_NOVALINHA] = RAPIDOLINHA(EMCOMENTARIO),
+        [C_ASTERISCO] = VAI(EMFIMCOMENTARIO)
+    },
+    [EMFIMCOMENTARIO] = {
+        [0 ... NCLASSES - 1] = RAPIDO(EMCOMENTARIO),
+        [C_FIM] = ACEITA(ENDFILE),
+        [C_NOVALINHA] = RAPIDOLINHA(EMCOMENTARIO),
+        [C_ASTERISCO] = VAI(EMFIMCOMENTARIO),
+        [C_BARRA] = VAI(INICIO)
+    },
+    [EMBARRA] = {
+        [0 ... NCLASSES - 1] = ACEITA(OVER),
+        [C_ASTERISCO] = RAPIDO(EMCOMENTARIO)
+    },
+    [EMNUM] = {
+        [0 ... NCLASSES - 1] = ACEITA(NUM),
+        [C_DIGITO] = VAI(EMNUM), [C_LETRA] = VAI(EMNUMERRO)
+    },
+    [EMNUMERRO] = {
+        [0 ... NCLASSES - 1] = ACEITA(ERROR),
+        [C_DIGITO] = VAI(EMNUMERRO), [C_LETRA] = VAI(EMNUMERRO)
+    },
+    [EMID] = {
+        [0 ... NCLASSES - 1] = ACEITA(ID),
+        [C_DIGITO] = VAI(EMID), [C_LETRA] = VAI(EMID)
+    },
+    [EMATRIBUICAO] = {
+        [0 ... NCLASSES - 1] = ACEITA(ASSIGN),
+        [C_IGUAL] = CONSOME(EQ)
+    },
+    [EMNE] = {
+        [0 ... NCLASSES - 1] = ACEITA(ERROR),
+        [C_IGUAL] = CONSOME(NE)
+    },
+    [EMLE] = {
+        [0 ... NCLASSES - 1] = ACEITA(LT),
+        [C_IGUAL] = CONSOME(LE)
+    },
+    [EMGE] = {
+        [0 ... NCLASSES - 1] = ACEITA(GT),
+        [C_IGUAL] = CONSOME(GE)
+    }
+};
+
+/* Conta os '\n' em [ini, fim) */
+static int contarLinhas(const char *ini, const char *fim) {
+    int n = 0;
+    while ((ini = memchr(ini, '\n', (size_t)(fim - ini))) != NULL) {
+        n++;
+        ini++;
     }
+    return n;
+}
+
+TokenType getToken(void) {
+    const unsigned char *base = (const unsigned char *)bufferFonte;
+    const unsigned char *p = base + posicao;
+    const unsigned char *inicio = p;
+    const Transicao *t;
+    int estado = INICIO;
+    TokenType tokenAtual;
+
+    for (;;) {
+        /* laço principal: uma consulta de tabela por byte */
+        for (;;) {
+            t = &tabelaDFA[estado][classeChar[*p]];
+            if (t->acao & (A_ACEITA | A_RAPIDO)) {
+                if (t->acao & A_ACEITA) break;
+
+                /* espaços e identificadores seguem em bloco quando a sequência
+                   continua após este byte; comentários, sempre */
+                linhaAtual += t->acao & A_LINHA;
+                estado = t->proximo;
+                p++;
+                if (estado == INICIO) {
+                    if (tabelaDFA[INICIO][classeChar[*p]].proximo == INICIO)
+                        p = (const unsigned char *)kernelsScanner.pularEspacos((const char *)p, &linhaAtual);
+                    inicio = p;
+                } else if (estado == EMID) {
+                    if (tabelaDFA[EMID][classeChar[*p]].proximo == EMID)
+                        p = (const unsigned char *)kernelsScanner.fimIdentificador((const char *)p);
+                } else {
+                    p = (const unsigned char *)kernelsScanner.pularComentario((const char *)p, &linhaAtual);
+                }
+                continue;
+            }
+            linhaAtual += t->acao & A_LINHA;
+            estado = t->proximo;
+            p++;
+            if (estado == INICIO) inicio = p;
+        }
+
+        /* '\0' antes do fim do buffer é um caractere comum do fonte */
+        if (*p == '\0' && p < base + tamanhoFonte) {
+            if (estado == EMCOMENTARIO || estado == EMFIMCOMENTARIO) {
+                estado = EMCOMENTARIO;
+                p++;
+                continue;
+            }
+            if (estado == INICIO) t = &tabelaDFA[INICIO][C_OUTRO];
+        }
+        break;
+    }
+
+    if (t->acao & A_CONSOME) {
+        p++;
+    } else if (*p == '\0' && p >= base + tamanhoFonte) {
+        /* comentário aberto: o lexema vai da sua abertura até o fim, e a linha
+           inicial é contada antes da linha extra do fim de arquivo */
+        if (estado == EMCOMENTARIO || estado == EMFIMCOMENTARIO)
+            linhaInicioComentario = linhaAtual - contarLinhas((const char *)inicio, (const char *)p);
+        marcarFimDeArquivo();
+    }
+
+    posicao = (long)(p - base);
+    inicioToken = (long)(inicio - base);
+    tamanhoToken = (int)(p - inicio);
+    tokenAtual = (TokenType)t->token;
+
+    switch (tokenAtual) {
+    case ID:
+        tokenAtual = buscarPalavraReservada((const char *)inicio, tamanhoToken);
+        if (tokenAtual == ID) nomeToken = internarNome((const char *)inicio, tamanhoToken);
+        break;
+    case ENDFILE:
+        if (estado != INICIO) {
+            fprintf(listing,
+                    "\nERRO LEXICO: comentario nao fechado - LINHA: %d\n",
+                    linhaInicioComentario);
+            Error = TRUE;
+        }
+        tamanhoToken = 0;
+        break;
+    case ERROR:
+        Error = TRUE;
+        if (estado == EMNE) {
+            fprintf(listing, "\nERRO LEXICO: '!' esperava '=' - LINHA: %d\n", linhaAtual);
+        } else if (estado == EMNUMERRO) {
+            fprintf(listing, "\nERRO LEXICO: '%.*s' - LINHA: %d\n",
+                    tamanhoToken, (const char *)inicio, linhaAtual);
+        } else {
+            fprintf(listing, "\nERRO LEXICO: '%c' - LINHA: %d\n", *inicio, linhaAtual);
+        }
+        break;
+    default:
+        break;
+    }
+
+
+    if (EchoSource) ecoarLinhas();
+    if (TraceScan) imprimirToken(tokenAtual);
 
     return tokenAtual;
-}
\ No newline at end of file
+}
@@ -5,10 +5,36 @@
 
 #include "globals.h"
 
-#define MAXTOKENLEN 40
+/* Estado da sessão corrente (globals.h) */
 
-extern char stringToken[MAXTOKENLEN + 1];
+/* Fonte inteiro em memória (mmap ou lido), terminado por '\0' */
+#define bufferFonte (sessaoAtual->scan.bufferFonte)
 
+/* Lexema do token corrente: fatia (deslocamento, tamanho) de bufferFonte */
+#define inicioToken (sessaoAtual->scan.inicioToken)
+#define tamanhoToken (sessaoAtual->scan.tamanhoToken)
+
+#define lexemaToken (bufferFonte + inicioToken)
+
+/* Nome internado (nomes.h) do último token ID */
+#define nomeToken (sessaoAtual->scan.nomeToken)
+
+/* Carrega o fonte inteiro de f; retorna 0 em sucesso */
+int carregarFonte(FILE *f);
+
+/* Usa buf[0..n) como fonte; buf[n] deve ser '\0' e continua do chamador */
+void usarFonteMemoria(const char *buf, long n);
+
+/* Usa uma cópia de buf[0..n) como fonte; retorna 0 em sucesso */
+int copiarFonte(const char *buf, long n);
+
+/* Libera o buffer do fonte (invalida os lexemas) */
+void liberarFonte(void);
+
+/* Scanner por tabela (DFA) */
 TokenType getToken(void);
 
+/* Scanner original (switch), usado como referência */
+TokenType getTokenReferencia(void);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,234 @@
+/*
+ * Kernels de varredura em bloco do scanner (scansimd.c)
+ *
+ * Espaços em branco, corpos de comentário e identificadores são medidos
+ * 16 (SSE2) ou 32 (AVX2) bytes por vez. As leituras são alinhadas ao
+ * tamanho do bloco, então nunca atravessam uma página além do bloco que
+ * contém a sentinela '\0' do buffer do fonte; os bytes anteriores a p no
+ * primeiro bloco são mascarados.
+ */
+
+#include "scansimd.h"
+
+#include <stdint.h>
+#include <stddef.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+/* ---------------------- Escalar ---------------------- */
+
+static const char *pularEspacosEscalar(const char *p, int *linhas) {
+    for (;; p++) {
+        if (*p == '\n') (*linhas)++;
+        else if (*p != ' ' && *p != '\t') return p;
+    }
+}
+
+static const char *pularComentarioEscalar(const char *p, int *linhas) {
+    for (; *p != '*' && *p != '\0'; p++)
+        if (*p == '\n') (*linhas)++;
+    return p;
+}
+
+static const char *fimIdentificadorEscalar(const char *p) {
+    while ((*p >= 'a' && *p <= 'z') || (*p >= 'A' && *p <= 'Z') || (*p >= '0' && *p <= '9'))
+        p++;
+    return p;
+}
+
+#ifdef SIMD_X86
+
+/* ---------------------- SSE2 (16 bytes) ---------------------- */
+
+__attribute__((target("sse2")))
+static const char *pularEspacosSse2(const char *p, int *linhas) {
+    const __m128i espaco = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i nl = _mm_set1_epi8('\n');
+    unsigned desl = (unsigned)((uintptr_t)p & 15);
+    const char *bloco = p - desl;
+    unsigned ignorar = (1u << desl) - 1;   /* bytes antes de p */
+
+    for (;;) {
+        __m128i v = _mm_load_si128((const __m128i *)bloco);
+        unsigned eNl = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(v, nl)) & ~ignorar;
+        unsigned branco = (unsigned)_mm_movemask_epi8(
+            _mm_or_si128(_mm_cmpeq_epi8(v, espaco),
+                         _mm_or_si128(_mm_cmpeq_epi8(v, tab), _mm_cmpeq_epi8(v, nl))));
+        unsigned parada = ~branco & 0xFFFFu & ~ignorar;
+        if (parada) {
+            unsigned i = (unsigned)__builtin_ctz(parada);
+            *linhas += __builtin_popcount(eNl & ((1u << i) - 1));
+            return bloco + i;
+        }
+        *linhas += __builtin_popcount(eNl);
+        ignorar = 0;
+        bloco += 16;
+    }
+}
+
+__attribute__((target("sse2")))
+static const char *pularComentarioSse2(const char *p, int *linhas) {
+    const __m128i asterisco = _mm_set1_epi8('*');
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i nl = _mm_set1_epi8('\n');
+    unsigned desl = (unsigned)((uintptr_t)p & 15);
+    const char *bloco = p - desl;
+    unsigned ignorar = (1u << desl) - 1;
+
+    for (;;) {
+        __m128i v = _mm_load_si128((const __m128i *)bloco);
+        unsigned eNl = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(v, nl)) & ~ignorar;
+        unsigned parada = (unsigned)_mm_movemask_epi8(
+            _mm_or_si128(_mm_cmpeq_epi8(v, asterisco), _mm_cmpeq_epi8(v, zero))) & ~ignorar;
+        if (parada) {
+            unsigned i = (unsigned)__builtin_ctz(parada);
+            *linhas += __builtin_popcount(eNl & ((1u << i) - 1));
+            return bloco + i;
+        }
+        *linhas += __builtin_popcount(eNl);
+        ignorar = 0;
+        bloco += 16;
+    }
+}
+
+/* letra: (c | 0x20) em 'a'..'z'; dígito: c em '0'..'9' (comparações com sinal:
+   bytes >= 0x80 ficam negativos e nunca casam) */
+__attribute__((target("sse2")))
+static const char *fimIdentificadorSse2(const char *p) {
+    const __m128i minusc = _mm_set1_epi8(0x20);
+    const __m128i antesA = _mm_set1_epi8('a' - 1), depoisZ = _mm_set1_epi8('z' + 1);
+    const __m128i antes0 = _mm_set1_epi8('0' - 1), depois9 = _mm_set1_epi8('9' + 1);
+    unsigned desl = (unsigned)((uintptr_t)p & 15);
+    const char *bloco = p - desl;
+    unsigned ignorar = (1u << desl) - 1;
+
+    for (;;) {
+        __m128i v = _mm_load_si128((const __m128i *)bloco);
+        __m128i m = _mm_or_si128(v, minusc);
+        __m128i letra = _mm_and_si128(_mm_cmpgt_epi8(m, antesA), _mm_cmpgt_epi8(depoisZ, m));
+        __m128i digito = _mm_and_si128(_mm_cmpgt_epi8(v, antes0), _mm_cmpgt_epi8(depois9, v));
+        unsigned alnum = (unsigned)_mm_movemask_epi8(_mm_or_si128(letra, digito));
+        unsigned parada = ~alnum & 0xFFFFu & ~ignorar;
+        if (parada) return bloco + __builtin_ctz(parada);
+        ignorar = 0;
+        bloco += 16;
+    }
+}
+
+/* ---------------------- AVX2 (32 bytes) ---------------------- */
+
+__attribute__((target("avx2,popcnt")))
+static const char *pularEspacosAvx2(const char *p, int *linhas) {
+    const __m256i espaco = _mm256_set1_epi8(' ');
+    const __m256i tab = _mm256_set1_epi8('\t');
+    const __m256i nl = _mm256_set1_epi8('\n');
+    unsigned desl = (unsigned)((uintptr_t)p & 31);
+    const char *bloco = p - desl;
+    uint32_t ignorar = (uint32_t)((1ull << desl) - 1);
+
+    for (;;) {
+        __m256i v = _mm256_load_si256((const __m256i *)bloco);
+        uint32_t eNl = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, nl)) & ~ignorar;
+        uint32_t branco = (uint32_t)_mm256_movemask_epi8(
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, espaco),
+                            _mm256_or_si256(_mm256_cmpeq_epi8(v, tab), _mm256_cmpeq_epi8(v, nl))));
+        uint32_t parada = ~branco & ~ignorar;
+        if (parada) {
+            unsigned i = (unsigned)__builtin_ctz(parada);
+            *linhas += __builtin_popcount(eNl & (uint32_t)((1ull << i) - 1));
+            return bloco + i;
+        }
+        *linhas += __builtin_popcount(eNl);
+        ignorar = 0;
+        bloco += 32;
+    }
+}
+
+__attribute__((target("avx2,popcnt")))
+static const char *pularComentarioAvx2(const char *p, int *linhas) {
+    const __m256i asterisco = _mm256_set1_epi8('*');
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i nl = _mm256_set1_epi8('\n');
+    unsigned desl = (unsigned)((uintptr_t)p & 31);
+    const char *bloco = p - desl;
+    uint32_t ignorar = (uint32_t)((1ull << desl) - 1);
+
+    for (;;) {
+        __m256i v = _mm256_load_si256((const __m256i *)bloco);
+        uint32_t eNl = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, nl)) & ~ignorar;
+        uint32_t parada = (uint32_t)_mm256_movemask_epi8(
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, asterisco), _mm256_cmpeq_epi8(v, zero))) & ~ignorar;
+        if (parada) {
+            unsigned i = (unsigned)__builtin_ctz(parada);
+            *linhas += __builtin_popcount(eNl & (uint32_t)((1ull << i) - 1));
+            return bloco + i;
+        }
+        *linhas += __builtin_popcount(eNl);
+        ignorar = 0;
+        bloco += 32;
+    }
+}
+
+__attribute__((target("avx2")))
+static const char *fimIdentificadorAvx2(const char *p) {
+    const __m256i minusc = _mm256_set1_epi8(0x20);
+    const __m256i antesA = _mm256_set1_epi8('a' - 1), depoisZ = _mm256_set1_epi8('z' + 1);
+    const __m256i antes0 = _mm256_set1_epi8('0' - 1), depois9 = _mm256_set1_epi8('9' + 1);
+    unsigned desl = (unsigned)((uintptr_t)p & 31);
+    const char *bloco = p - desl;
+    uint32_t ignorar = (uint32_t)((1ull << desl) - 1);
+
+    for (;;) {
+        __m256i v = _mm256_load_si256((const __m256i *)bloco);
+        __m256i m = _mm256_or_si256(v, minusc);
+        __m256i letra = _mm256_and_si256(_mm256_cmpgt_epi8(m, antesA), _mm256_cmpgt_epi8(depoisZ, m));
+        __m256i digito = _mm256_and_si256(_mm256_cmpgt_epi8(v, antes0), _mm256_cmpgt_epi8(depois9, v));
+        uint32_t alnum = (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(letra, digito));
+        uint32_t parada = ~alnum & ~ignorar;
+        if (parada) return bloco + __builtin_ctz(parada);
+        ignorar = 0;
+        bloco += 32;
+    }
+}
+
+#endif /* SIMD_X86 */
+
+/* ---------------------- Seleção ---------------------- */
+
+static const KernelsScanner kernelsEscalar = {
+    "escalar", pularEspacosEscalar, pularComentarioEscalar, fimIdentificadorEscalar
+};
+
+#ifdef SIMD_X86
+static const KernelsScanner kernelsSse2 = {
+    "sse2", pularEspacosSse2, pularComentarioSse2, fimIdentificadorSse2
+};
+
+static const KernelsScanner kernelsAvx2 = {
+    "avx2", pularEspacosAvx2, pularComentarioAvx2, fimIdentificadorAvx2
+};
+#endif
+
+KernelsScanner kernelsScanner;
+
+NivelSimd escolherKernelsScanner(NivelSimd nivel) {
+#ifdef SIMD_X86
+    __builtin_cpu_init();
+    if (nivel >= SIMD_AVX2 && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt")) {
+        kernelsScanner = kernelsAvx2;
+        return SIMD_AVX2;
+    }
+    if (nivel >= SIMD_SSE2 && __builtin_cpu_supports("sse2")) {
+        kernelsScanner = kernelsSse2;
+        return SIMD_SSE2;
+    }
+#else
+    (void)nivel;
+#endif
+    kernelsScanner = kernelsEscalar;
+    return SIMD_ESCALAR;
+}
@@ -0,0 +1,29 @@
+/* scansimd.h - Kernels de varredura em bloco do scanner */
+
+#ifndef SCANSIMD_H
+#define SCANSIMD_H
+
+/* Níveis de kernel, do mais simples ao mais largo */
+typedef enum { SIMD_ESCALAR, SIMD_SSE2, SIMD_AVX2, SIMD_AUTO } NivelSimd;
+
+/*
+ * Todos os kernels param na sentinela '\0', que não é espaço, letra,
+ * dígito nem '*'. As linhas atravessadas são somadas em *linhas.
+ */
+typedef struct {
+    const char *nome;
+    /* primeiro caractere que não é ' ', '\t' ou '\n' */
+    const char *(*pularEspacos)(const char *p, int *linhas);
+    /* primeiro '*' ou '\0' dentro de um comentário */
+    const char *(*pularComentario)(const char *p, int *linhas);
+    /* primeiro caractere que não é letra ou dígito ASCII */
+    const char *(*fimIdentificador)(const char *p);
+} KernelsScanner;
+
+extern KernelsScanner kernelsScanner;
+
+/* Seleciona os kernels; SIMD_AUTO consulta a CPU. Retorna o nível
+   efetivo, que é menor que o pedido se a CPU não o suportar. */
+NivelSimd escolherKernelsScanner(NivelSimd nivel);
+
+#endif
@@ -0,0 +1,261 @@
+/* Propagação de constantes condicional esparsa (sccp.c) */
+
+#include "globals.h"
+#include "sccp.h"
+#include "arena.h"
+
+/* Reticulado: TOPO (ainda sem valor) > CONSTANTE > FUNDO (qualquer valor) */
+#define TOPO      0
+#define CONSTANTE 1
+#define FUNDO     2
+
+typedef struct {
+    uint8_t estado;
+    int32_t valor;
+} Valor;
+
+typedef struct {
+    FuncaoSsa *s;
+    FuncaoCfg *f;
+    CodigoIR *c;
+    Valor *valores;          /* por temporário */
+    int *usos, *primeiroUso; /* quádruplas (>= 0) e phis (-1 - i) que leem cada temporário */
+    int *blocoDaQuad;
+    uint8_t *executavel;     /* por bloco */
+    uint8_t *arestaExec;     /* por bloco e índice do sucessor */
+    int *filaBlocos, nfilaBlocos;
+    int *filaTemps, nfilaTemps;
+    uint8_t *naFila;
+} Sccp;
+
+static Valor valorDe(const Sccp *x, Operando o) {
+    Valor v = {FUNDO, 0};
+
+    if (o.tipo == OPR_CONST) {
+        v.estado = CONSTANTE;
+        v.valor = o.v;
+    } else if (o.tipo == OPR_TEMP) {
+        v = x->valores[o.v];
+    }
+    return v;
+}
+
+static void rebaixar(Sccp *x, Operando r, Valor novo) {
+    Valor *v = &x->valores[r.v];
+
+    if (novo.estado < v->estado) return;
+    if (novo.estado == v->estado && (novo.estado != CONSTANTE || novo.valor == v->valor)) return;
+    if (novo.estado == CONSTANTE && v->estado == CONSTANTE) novo.estado = FUNDO;
+    *v = novo;
+    if (!x->naFila[r.v]) {
+        x->naFila[r.v] = 1;
+        x->filaTemps[x->nfilaTemps++] = r.v;
+    }
+}
+
+static int arestaExecutavel(const Sccp *x, int p, int b) {
+    const BlocoBasico *bp = &x->f->blocos[p];
+    for (int i = 0; i < bp->nsucc; i++)
+        if (bp->succ[i] == b && x->arestaExec[2 * p + i]) return TRUE;
+    return FALSE;
+}
+
+static void avaliarPhi(Sccp *x, int i) {
+    const Phi *p = &x->s->phis[i];
+    const BlocoBasico *bb = &x->f->blocos[p->bloco];
+    Valor v = {TOPO, 0};
+
+    for (int j = 0; j < bb->npred && v.estado != FUNDO; j++) {
+        Valor a;
+        if (!arestaExecutavel(x, bb->pred[j], p->bloco)) continue;
+        a = valorDe(x, p->args[j]);
+        if (a.estado == TOPO) continue;
+        if (v.estado == TOPO) v = a;
+        else if (a.estado == FUNDO || a.valor != v.valor) v.estado = FUNDO;
+    }
+    rebaixar(x, p->r, v);
+}
+
+static void marcarAresta(Sccp *x, int b, int i) {
+    int suc = x->f->blocos[b].succ[i];
+
+    if (x->arestaExec[2 * b + i]) return;
+    x->arestaExec[2 * b + i] = 1;
+    if (!x->executavel[suc]) {
+        x->executavel[suc] = 1;
+        x->filaBlocos[x->nfilaBlocos++] = suc;
+    } else {
+        for (int k = x->s->primeiroPhi[suc]; k < x->s->primeiroPhi[suc + 1]; k++) avaliarPhi(x, k);
+    }
+}
+
+static void avaliarQuad(Sccp *x, uint32_t i) {
+    const Quad *q = &x->c->quads[i];
+    Valor a, b, v = {FUNDO, 0};
+
+    if (q->op == IR_IFFALSE) {
+        int bloco = x->blocoDaQuad[i];
+        const BlocoBasico *bb = &x->f->blocos[bloco];
+
+        a = valorDe(x, q->a);
+        if (a.estado == TOPO) return;
+        if (a.estado == CONSTANTE && bb->nsucc == 2) {
+            marcarAresta(x, bloco, a.valor != 0 ? 0 : 1);
+        } else {
+            for (int k = 0; k < bb->nsucc; k++) marcarAresta(x, bloco, k);
+        }
+        return;
+    }
+    if (!defineR((OpIR)q->op) || q->r.tipo != OPR_TEMP) return;
+
+    if (q->op == IR_COPY) {
+        v = valorDe(x, q->a);
+    } else if (q->op >= IR_ADD && q->op <= IR_NE) {
+        a = valorDe(x, q->a);
+        b = valorDe(x, q->b);
+        if (a.estado == FUNDO || b.estado == FUNDO) v.estado = FUNDO;
+        else if (a.estado == TOPO || b.estado == TOPO) v.estado = TOPO;
+        else if (irCalcular((OpIR)q->op, a.valor, b.valor, &v.valor)) v.estado = CONSTANTE;
+    }
+    rebaixar(x, q->r, v);
+}
+
+static void visitarBloco(Sccp *x, int b) {
+    const BlocoBasico *bb = &x->f->blocos[b];
+
+    for (int k = x->s->primeiroPhi[b]; k < x->s->primeiroPhi[b + 1]; k++) avaliarPhi(x, k);
+    for (uint32_t i = bb->inicio; i < bb->fim; i++) avaliarQuad(x, i);
+    if (bb->fim == bb->inicio || x->c->quads[bb->fim - 1].op != IR_IFFALSE)
+        for (int k = 0; k < bb->nsucc; k++) marcarAresta(x, b, k);
+}
+
+/* Listas de usos de cada temporário */
+static void encontrarUsos(Sccp *x) {
+    const CodigoIR *c = x->c;
+    int *conta = (int *)arenaAlloc((c->ntemps + 1) * sizeof(int));
+
+    x->primeiroUso = (int *)arenaAlloc((c->ntemps + 1) * sizeof(int));
+    for (int passo = 0; passo < 2; passo++) {
+        for (uint32_t i = 0; i < c->n; i++) {
+            const Quad *q = &c->quads[i];
+            if (!leOperandos((OpIR)q->op)) continue;
+            if (q->a.tipo == OPR_TEMP) {
+                if (passo == 0) conta[q->a.v + 1]++;
+                else x->usos[conta[q->a.v]++] = (int)i;
+            }
+            if (q->b.tipo == OPR_TEMP) {
+                if (passo == 0) conta[q->b.v + 1]++;
+                else x->usos[conta[q->b.v]++] = (int)i;
+            }
+        }
+        for (int k = 0; k < x->s->nphis; k++) {
+            const Phi *p = &x->s->phis[k];
+            for (int j = 0; j < x->f->blocos[p->bloco].npred; j++) {
+                if (p->args[j].tipo != OPR_TEMP) continue;
+                if (passo == 0) conta[p->args[j].v + 1]++;
+                else x->usos[conta[p->args[j].v]++] = -1 - k;
+            }
+        }
+        if (passo == 0) {
+            for (int t = 0; t < c->ntemps; t++) conta[t + 1] += conta[t];
+            x->usos = (int *)arenaAlloc((conta[c->ntemps] + 1) * sizeof(int));
+            for (int t = 0; t <= c->ntemps; t++) x->primeiroUso[t] = conta[t];
+        }
+    }
+}
+
+/* Troca os temporários constantes lidos em o pela constante */
+static void substituir(const Sccp *x, Operando *o) {
+    if (o->tipo == OPR_TEMP && x->valores[o->v].estado == CONSTANTE)
+        *o = operando(OPR_CONST, x->valores[o->v].valor);
+}
+
+static int reescrever(Sccp *x) {
+    FuncaoSsa *s = x->s;
+    FuncaoCfg *f = x->f;
+    int saida = f->nblocos - 1;
+    int desvios = 0;
+
+    for (int b = 0; b < f->nblocos; b++) {
+        BlocoBasico *bb = &f->blocos[b];
+
+        if (!x->executavel[b] && b != saida) {
+            s->vivo[b] = 0;
+            bb->nsucc = 0;
+            continue;
+        }
+
+        for (int k = s->primeiroPhi[b]; k < s->primeiroPhi[b + 1]; k++) {
+            Phi *p = &s->phis[k];
+            if (x->valores[p->r.v].estado == CONSTANTE) p->r.tipo = OPR_NADA;
+            else for (int j = 0; j < bb->npred; j++) substituir(x, &p->args[j]);
+        }
+
+        for (uint32_t i = bb->inicio; i < bb->fim; i++) {
+            Quad *q = &x->c->quads[i];
+
+            if (leOperandos((OpIR)q->op)) {
+                substituir(x, &q->a);
+                substituir(x, &q->b);
+            }
+            if (defineR((OpIR)q->op) && q->r.tipo == OPR_TEMP &&
+                x->valores[q->r.v].estado == CONSTANTE) {
+                q->op = IR_NOP;
+            } else if (q->op == IR_IFFALSE && q->a.tipo == OPR_CONST) {
+                /* só o lado tomado continua */
+                if (q->a.v != 0 || bb->nsucc == 1) {
+                    q->op = IR_NOP;
+                } else {
+                    *q = (Quad){IR_GOTO, NADA, q->b, NADA};
+                    bb->succ[0] = bb->succ[1];
+                }
+                bb->nsucc = 1;
+                desvios++;
+            }
+        }
+    }
+    return desvios;
+}
+
+int propagarConstantes(FuncaoSsa *s) {
+    Sccp x;
+    CodigoIR *c = s->codigo;
+
+    x.s = s;
+    x.f = s->cfg;
+    x.c = c;
+    x.valores = (Valor *)arenaAlloc((c->ntemps + 1) * sizeof(Valor));
+    x.naFila = (uint8_t *)arenaAlloc(c->ntemps + 1);
+    x.filaTemps = (int *)arenaAlloc((c->ntemps + 1) * sizeof(int));
+    x.nfilaTemps = 0;
+    x.executavel = (uint8_t *)arenaAlloc(x.f->nblocos);
+    x.arestaExec = (uint8_t *)arenaAlloc(2 * x.f->nblocos);
+    x.filaBlocos = (int *)arenaAlloc(x.f->nblocos * sizeof(int));
+    x.nfilaBlocos = 0;
+    x.blocoDaQuad = (int *)arenaAlloc((c->n + 1) * sizeof(int));
+    for (int b = 0; b < x.f->nblocos; b++)
+        for (uint32_t i = x.f->blocos[b].inicio; i < x.f->blocos[b].fim; i++) x.blocoDaQuad[i] = b;
+    encontrarUsos(&x);
+
+    x.executavel[0] = 1;
+    x.filaBlocos[x.nfilaBlocos++] = 0;
+    while (x.nfilaBlocos > 0 || x.nfilaTemps > 0) {
+        int t;
+
+        if (x.nfilaBlocos > 0) {
+            visitarBloco(&x, x.filaBlocos[--x.nfilaBlocos]);
+            continue;
+        }
+        t = x.filaTemps[--x.nfilaTemps];
+        x.naFila[t] = 0;
+        for (int k = x.primeiroUso[t]; k < x.primeiroUso[t + 1]; k++) {
+            int u = x.usos[k];
+            if (u >= 0) {
+                if (x.executavel[x.blocoDaQuad[u]]) avaliarQuad(&x, (uint32_t)u);
+            } else if (x.executavel[s->phis[-1 - u].bloco]) {
+                avaliarPhi(&x, -1 - u);
+            }
+        }
+    }
+    return reescrever(&x);
+}
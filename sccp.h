@@ -0,0 +1,26 @@
+/* sccp.h - Propagação de constantes condicional esparsa */
+
+#ifndef SCCP_H
+#define SCCP_H
+
+#include "globals.h"
+#include "ssa.h"
+
+/*
+ * Wegman e Zadeck: cada temporário começa indefinido (topo) e só desce
+ * para constante ou variável; só os blocos alcançados por arestas já
+ * executáveis são avaliados, e um if_false com condição constante só
+ * torna executável o lado que será tomado. Ao final:
+ *   - os usos de temporários constantes viram a constante, e as suas
+ *     definições (cópias e operações) são removidas;
+ *   - um if_false constante vira goto ou some, e os sucessores do bloco
+ *     no cfg ficam só com o lado tomado;
+ *   - os blocos nunca alcançados deixam de estar vivos.
+ * Globais, arrays, chamadas e a versão inicial das variáveis não são
+ * constantes.
+ */
+
+/* Devolve quantos if_false foram eliminados */
+int propagarConstantes(FuncaoSsa *s);
+
+#endif
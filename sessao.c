@@ -0,0 +1,435 @@
+/*
+ * Sessões de compilação (sessao.c)
+ *
+ * Cada função pública torna a sessão recebida a corrente da thread,
+ * executa a fase e restaura a sessão anterior. abortarSessao() volta para
+ * executar() por longjmp: a memória da fase interrompida fica na arena
+ * e é liberada com a sessão.
+ */
+
+#include "globals.h"
+#include "sessao.h"
+#include "arena.h"
+#include "scan.h"
+#include "parse.h"
+#include "ast.h"
+#include "analyse.h"
+#include "symtab.h"
+#include "dobra.h"
+#include "cgen.h"
+#include "otimiza.h"
+#include "cfg.h"
+#include "util.h"
+#include "interp.h"
+#include "vm.h"
+#include "x64.h"
+#include "jit.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+_Thread_local CompilerSession *sessaoAtual = NULL;
+
+/* Valores do campo fase */
+#define FASE_FALHOU    (-1)
+#define FASE_CRIADA    0
+#define FASE_CARREGADA 1
+#define FASE_PARSE     2
+#define FASE_ANALISE   3
+
+typedef ResultadoSessao (*Fase)(CompilerSession *s, void *arg);
+
+static ResultadoSessao executar(CompilerSession *s, Fase f, void *arg) {
+    CompilerSession *anterior = sessaoAtual;
+    jmp_buf retorno;
+    ResultadoSessao r;
+
+    sessaoAtual = s;
+    s->abortar = &retorno;
+    if (setjmp(retorno) == 0) r = f(s, arg);
+    else r = (ResultadoSessao)s->interrupcao;
+    s->abortar = NULL;
+    sessaoAtual = anterior;
+    return r;
+}
+
+/* Executa f se a sessão já concluiu a fase exigida. Em CM_OK a sessão
+   avança para proxima; qualquer erro a invalida. */
+static ResultadoSessao rodar(CompilerSession *s, int exigida, int proxima, Fase f, void *arg) {
+    ResultadoSessao r;
+
+    if (s->fase < exigida) return CM_ERRO_USO;
+    r = executar(s, f, arg);
+    if (r != CM_OK) s->fase = FASE_FALHOU;
+    else if (proxima > s->fase) s->fase = proxima;
+    return r;
+}
+
+void abortarSessao(ResultadoSessao resultado) {
+    CompilerSession *s = sessaoAtual;
+
+    if (s == NULL || s->abortar == NULL) exit(1);
+    s->interrupcao = resultado;
+    longjmp(*s->abortar, 1);
+}
+
+/* rodar() com a saída da sessão desviada para destino (NULL = a própria
+   saída), esvaziada ao fim da fase */
+static ResultadoSessao rodarEm(CompilerSession *s, int exigida, int proxima,
+                               Fase f, void *arg, FILE *destino) {
+    FILE *saida = s->saida;
+    ResultadoSessao r;
+
+    if (destino != NULL) s->saida = destino;
+    r = rodar(s, exigida, proxima, f, arg);
+    s->saida = saida;
+    fflush(destino != NULL ? destino : saida);
+    return r;
+}
+
+/* ---------------------- Fases ---------------------- */
+
+static ResultadoSessao faseIniciar(CompilerSession *s, void *arg) {
+    liberarFonte();     /* fonte vazio */
+    return CM_OK;
+}
+
+static ResultadoSessao faseDestruir(CompilerSession *s, void *arg) {
+    liberarFonte();
+    liberarArena();
+    return CM_OK;
+}
+
+static ResultadoSessao faseCarregarArquivo(CompilerSession *s, void *arg) {
+    return carregarFonte((FILE *)arg) == 0 ? CM_OK : CM_ERRO_LEITURA;
+}
+
+typedef struct {
+    const char *buf;
+    size_t n;
+} Memoria;
+
+static ResultadoSessao faseCarregarMemoria(CompilerSession *s, void *arg) {
+    Memoria *m = (Memoria *)arg;
+    return copiarFonte(m->buf, (long)m->n) == 0 ? CM_OK : CM_ERRO_MEMORIA;
+}
+
+/* Os nomes já estão internados: o fonte não é mais necessário */
+static ResultadoSessao faseParse(CompilerSession *s, void *arg) {
+    s->arvoreSintatica = parse();
+    liberarFonte();
+    if (Error) return CM_ERRO_LEXICO;
+    s->arvore = compactarArvore(s->arvoreSintatica);
+    return CM_OK;
+}
+
+static ResultadoSessao faseAnalisar(CompilerSession *s, void *arg) {
+    buildSymtab(s->arvore);
+    if (Error) return CM_ERRO_SEMANTICO;
+    typeCheck(s->arvore);
+    if (Error) return CM_ERRO_TIPOS;
+    dobrarConstantes(s->arvore);
+    return CM_OK;
+}
+
+/* O código intermediário é gerado uma vez, e otimizado se pedido */
+static CodigoIR *codigoDaSessao(CompilerSession *s) {
+    if (s->ir == NULL) {
+        s->ir = gerarIR(s->arvore);
+        if (s->otimizar) s->ir = otimizarIR(s->ir);
+    }
+    return s->ir;
+}
+
+static ResultadoSessao faseGerarCodigo(CompilerSession *s, void *arg) {
+    codeGen(codigoDaSessao(s));
+    return CM_OK;
+}
+
+static ResultadoSessao faseGerarCfg(CompilerSession *s, void *arg) {
+    if (s->cfg == NULL) s->cfg = construirCfg(codigoDaSessao(s));
+    printCfgDot(s->cfg, (const char *)arg);
+    return CM_OK;
+}
+
+static ResultadoSessao faseImprimirTabela(CompilerSession *s, void *arg) {
+    printSymTab(listing);
+    return CM_OK;
+}
+
+typedef struct {
+    const char *dot;
+    const char *png;
+} ArquivosDot;
+
+static ResultadoSessao faseGerarDot(CompilerSession *s, void *arg) {
+    ArquivosDot *a = (ArquivosDot *)arg;
+    printTreeDot(s->arvore, a->dot, a->png);
+    return CM_OK;
+}
+
+typedef struct {
+    FILE *entrada;
+    FILE *saida;
+} ArquivosExecucao;
+
+static ResultadoSessao faseExecutar(CompilerSession *s, void *arg) {
+    ArquivosExecucao *a = (ArquivosExecucao *)arg;
+    return interpretar(s->arvore, a->entrada, a->saida) ? CM_OK : CM_ERRO_EXECUCAO;
+}
+
+/* Montado uma vez, do código intermediário (otimizado se pedido) */
+static Bytecode *bytecodeDaSessao(CompilerSession *s) {
+    if (s->bytecode == NULL) s->bytecode = montarBytecode(codigoDaSessao(s));
+    return s->bytecode;
+}
+
+static ResultadoSessao faseGerarBytecode(CompilerSession *s, void *arg) {
+    Bytecode *b = bytecodeDaSessao(s);
+
+    if (b == NULL) {
+        fprintf(listing, "\nERRO: quadro de registradores grande demais para o bytecode\n");
+        return CM_ERRO_MEMORIA;
+    }
+    if (!escreverBytecode((FILE *)arg, b)) {
+        fprintf(listing, "\nERRO: falha ao escrever o bytecode\n");
+        return CM_ERRO_ESCRITA;
+    }
+    return CM_OK;
+}
+
+static ResultadoSessao faseExecutarBytecode(CompilerSession *s, void *arg) {
+    ArquivosExecucao *a = (ArquivosExecucao *)arg;
+    Bytecode *b = bytecodeDaSessao(s);
+
+    if (b == NULL) {
+        fprintf(listing, "\nERRO: quadro de registradores grande demais para o bytecode\n");
+        return CM_ERRO_MEMORIA;
+    }
+    return executarBytecode(b, a->entrada, a->saida, FALSE, NULL) ? CM_OK : CM_ERRO_EXECUCAO;
+}
+
+/* Selecionado uma vez, do código intermediário (otimizado se pedido) */
+static CodigoX64 *x64DaSessao(CompilerSession *s) {
+    if (s->x64 == NULL) s->x64 = gerarX64(codigoDaSessao(s), TRUE);
+    return s->x64;
+}
+
+static ResultadoSessao faseGerarAssembly(CompilerSession *s, void *arg) {
+    CodigoX64 *x = x64DaSessao(s);
+
+    if (x == NULL) {
+        fprintf(listing, "\nERRO: quadro grande demais para o codigo nativo\n");
+        return CM_ERRO_MEMORIA;
+    }
+    escreverGas((FILE *)arg, x);
+    if (fflush((FILE *)arg) != 0) {
+        fprintf(listing, "\nERRO: falha ao escrever o assembly\n");
+        return CM_ERRO_ESCRITA;
+    }
+    return CM_OK;
+}
+
+static ResultadoSessao faseExecutarJit(CompilerSession *s, void *arg) {
+    ArquivosExecucao *a = (ArquivosExecucao *)arg;
+    CodigoX64 *x = x64DaSessao(s);
+    CodigoJit *j;
+    int ok;
+
+    if (x == NULL) {
+        fprintf(listing, "\nERRO: quadro grande demais para o codigo nativo\n");
+        return CM_ERRO_MEMORIA;
+    }
+    if ((j = montarJit(x)) == NULL) {
+        fprintf(listing, "\nERRO: codigo nativo em memoria indisponivel\n");
+        return CM_ERRO_MEMORIA;
+    }
+    ok = executarJit(j, a->entrada, a->saida);
+    liberarJit(j);
+    return ok ? CM_OK : CM_ERRO_EXECUCAO;
+}
+
+static ResultadoSessao faseImprimirMemoria(CompilerSession *s, void *arg) {
+    imprimirEstatisticasMemoria((FILE *)arg);
+    return CM_OK;
+}
+
+/* ---------------------- Sessões filhas ---------------------- */
+
+/* Faixas por thread: algumas a mais que as threads, para equilibrar
+   funções de tamanhos diferentes */
+#define FAIXAS_POR_THREAD 4
+
+typedef struct {
+    CompilerSession s;
+    int inicio, fim;
+    void (*f)(int i, void *ctx);
+    void *ctx;
+    char *texto;
+    size_t tamanho;
+    ResultadoSessao r;
+} Filha;
+
+static ResultadoSessao faseFaixa(CompilerSession *s, void *arg) {
+    Filha *fi = (Filha *)arg;
+    for (int i = fi->inicio; i < fi->fim; i++) fi->f(i, fi->ctx);
+    return CM_OK;
+}
+
+static void rodarFilha(void *arg) {
+    Filha *fi = (Filha *)arg;
+    fi->r = executar(&fi->s, faseFaixa, fi);
+    if (fecharMemoria(fi->s.saida, &fi->texto, &fi->tamanho) != 0 && fi->r == CM_OK)
+        fi->r = CM_ERRO_MEMORIA;
+}
+
+int sessaoParalela(void) {
+    return sessaoAtual->pool != NULL && poolThreads(sessaoAtual->pool) > 1;
+}
+
+void paraCadaParalelo(int n, void (*f)(int i, void *ctx), void *ctx) {
+    CompilerSession *pai = sessaoAtual;
+    GrupoTarefas grupo = GRUPO_VAZIO;
+    ResultadoSessao r = CM_OK;
+    Filha *filhas;
+    int nfilhas;
+
+    if (n < 2 || !sessaoParalela()) {
+        for (int i = 0; i < n; i++) f(i, ctx);
+        return;
+    }
+    nfilhas = poolThreads(pai->pool) * FAIXAS_POR_THREAD;
+    if (nfilhas > n) nfilhas = n;
+    filhas = (Filha *)calloc(nfilhas, sizeof(Filha));
+    if (filhas == NULL) abortarSessao(CM_ERRO_MEMORIA);
+
+    /* cópias rasas do pai: compartilham árvore, nomes e tabela */
+    for (int k = 0; k < nfilhas; k++) {
+        Filha *fi = &filhas[k];
+        fi->s = *pai;
+        memset(&fi->s.arena, 0, sizeof(fi->s.arena));
+        fi->s.erro = FALSE;
+        fi->s.abortar = NULL;
+        fi->s.saida = abrirMemoria(&fi->texto, &fi->tamanho);
+        if (fi->s.saida == NULL) {
+            while (--k >= 0) {
+                fecharMemoria(filhas[k].s.saida, &filhas[k].texto, &filhas[k].tamanho);
+                free(filhas[k].texto);
+            }
+            free(filhas);
+            abortarSessao(CM_ERRO_MEMORIA);
+        }
+        fi->inicio = (int)((long)n * k / nfilhas);
+        fi->fim = (int)((long)n * (k + 1) / nfilhas);
+        fi->f = f;
+        fi->ctx = ctx;
+    }
+    /* de trás para frente: esta thread começa pela primeira faixa */
+    for (int k = nfilhas - 1; k >= 0; k--)
+        poolSubmeter(pai->pool, &grupo, rodarFilha, &filhas[k]);
+    poolEsperar(pai->pool, &grupo);
+
+    for (int k = 0; k < nfilhas; k++) {
+        Filha *fi = &filhas[k];
+        fwrite(fi->texto, 1, fi->tamanho, pai->saida);
+        free(fi->texto);
+        if (fi->s.erro) pai->erro = TRUE;
+        if (fi->r != CM_OK && r == CM_OK) r = fi->r;
+        juntarArena(&fi->s);
+    }
+    free(filhas);
+    if (r != CM_OK) abortarSessao(r);
+}
+
+/* ---------------------- API ---------------------- */
+
+CompilerSession *criarSessao(FILE *saida) {
+    CompilerSession *s = (CompilerSession *)calloc(1, sizeof(CompilerSession));
+
+    if (s == NULL) return NULL;
+    s->saida = saida;
+    s->fase = FASE_CRIADA;
+    executar(s, faseIniciar, NULL);
+    return s;
+}
+
+void destruirSessao(CompilerSession *s) {
+    if (s == NULL) return;
+    executar(s, faseDestruir, NULL);
+    if (sessaoAtual == s) sessaoAtual = NULL;
+    free(s);
+}
+
+void sessaoUsarPool(CompilerSession *s, Pool *p) {
+    s->pool = p;
+}
+
+ResultadoSessao sessaoCarregarArquivo(CompilerSession *s, FILE *f) {
+    if (s->fase != FASE_CRIADA) return CM_ERRO_USO;
+    return rodar(s, FASE_CRIADA, FASE_CARREGADA, faseCarregarArquivo, f);
+}
+
+ResultadoSessao sessaoCarregarMemoria(CompilerSession *s, const char *buf, size_t n) {
+    Memoria m = {buf, n};
+
+    if (s->fase != FASE_CRIADA) return CM_ERRO_USO;
+    return rodar(s, FASE_CRIADA, FASE_CARREGADA, faseCarregarMemoria, &m);
+}
+
+ResultadoSessao sessaoParse(CompilerSession *s) {
+    ResultadoSessao r;
+
+    if (s->fase != FASE_CARREGADA) return CM_ERRO_USO;
+    r = rodar(s, FASE_CARREGADA, FASE_PARSE, faseParse, NULL);
+    if (s->traceScan && s->tokens != NULL) fflush(s->tokens);
+    return r;
+}
+
+ResultadoSessao sessaoAnalisar(CompilerSession *s) {
+    if (s->fase != FASE_PARSE) return CM_ERRO_USO;
+    return rodar(s, FASE_PARSE, FASE_ANALISE, faseAnalisar, NULL);
+}
+
+ResultadoSessao sessaoGerarCodigo(CompilerSession *s, FILE *destino) {
+    return rodarEm(s, FASE_ANALISE, FASE_ANALISE, faseGerarCodigo, NULL, destino);
+}
+
+ResultadoSessao sessaoImprimirTabela(CompilerSession *s, FILE *destino) {
+    return rodarEm(s, FASE_ANALISE, FASE_ANALISE, faseImprimirTabela, NULL, destino);
+}
+
+ResultadoSessao sessaoGerarDot(CompilerSession *s, const char *dotFilename, const char *pngFilename) {
+    ArquivosDot a = {dotFilename, pngFilename};
+    return rodar(s, FASE_PARSE, FASE_PARSE, faseGerarDot, &a);
+}
+
+ResultadoSessao sessaoGerarCfg(CompilerSession *s, const char *dotFilename) {
+    return rodar(s, FASE_ANALISE, FASE_ANALISE, faseGerarCfg, (void *)dotFilename);
+}
+
+ResultadoSessao sessaoExecutar(CompilerSession *s, FILE *entrada, FILE *saida) {
+    ArquivosExecucao a = {entrada, saida};
+    return rodar(s, FASE_ANALISE, FASE_ANALISE, faseExecutar, &a);
+}
+
+ResultadoSessao sessaoGerarBytecode(CompilerSession *s, FILE *destino) {
+    return rodar(s, FASE_ANALISE, FASE_ANALISE, faseGerarBytecode, destino);
+}
+
+ResultadoSessao sessaoExecutarBytecode(CompilerSession *s, FILE *entrada, FILE *saida) {
+    ArquivosExecucao a = {entrada, saida};
+    return rodar(s, FASE_ANALISE, FASE_ANALISE, faseExecutarBytecode, &a);
+}
+
+ResultadoSessao sessaoGerarAssembly(CompilerSession *s, FILE *destino) {
+    return rodar(s, FASE_ANALISE, FASE_ANALISE, faseGerarAssembly, destino);
+}
+
+ResultadoSessao sessaoExecutarJit(CompilerSession *s, FILE *entrada, FILE *saida) {
+    ArquivosExecucao a = {entrada, saida};
+    return rodar(s, FASE_ANALISE, FASE_ANALISE, faseExecutarJit, &a);
+}
+
+void sessaoImprimirMemoria(CompilerSession *s, FILE *f) {
+    executar(s, faseImprimirMemoria, f);
+}
@@ -0,0 +1,125 @@
+/* sessao.h - Compilação como biblioteca: sessões reentrantes */
+
+#ifndef SESSAO_H
+#define SESSAO_H
+
+#include "globals.h"
+#include "pool.h"
+
+/*
+ * Cada CompilerSession (globals.h) guarda o estado de uma compilação:
+ * fonte, nomes internados, árvore, tabela de símbolos e arena. Sessões
+ * diferentes são independentes e podem ser usadas em threads diferentes;
+ * uma mesma sessão não deve ser usada por duas threads ao mesmo tempo.
+ *
+ * As fases são chamadas em ordem: carregar o fonte, sessaoParse,
+ * sessaoAnalisar, sessaoGerarCodigo. Mensagens e listagens vão para o
+ * FILE de saída da sessão; o resultado de cada fase é um ResultadoSessao.
+ * Nenhuma fase termina o processo: um erro sintático ou a falta de memória
+ * interrompem a fase e a sessão não aceita outras fases depois disso.
+ * As opções de rastreamento (echoSource, traceScan, ...) são campos da
+ * sessão e podem ser ajustadas antes de sessaoParse; com traceScan, os
+ * tokens vão para o FILE do campo tokens, ou para a saída se ele é NULL.
+ * Com o campo silencioso, as fases só escrevem diagnósticos e artefatos.
+ * Com o campo otimizar, o código intermediário, a listagem e o cfg saem
+ * otimizados (otimiza.h).
+ */
+
+typedef enum {
+    CM_OK = 0,
+    CM_ERRO_USO,            /* fase fora de ordem ou após uma falha */
+    CM_ERRO_LEITURA,        /* o fonte não pôde ser lido */
+    CM_ERRO_LEXICO,         /* erros léxicos: a árvore não é usada */
+    CM_ERRO_SINTATICO,      /* erro sintático: o parse foi interrompido */
+    CM_ERRO_SEMANTICO,      /* erros de declaração (buildSymtab) */
+    CM_ERRO_TIPOS,          /* erros de tipo (typeCheck) */
+    CM_ERRO_MEMORIA,
+    CM_ERRO_EXECUCAO,       /* o programa interpretado parou com um erro */
+    CM_ERRO_ESCRITA         /* um artefato binário não pôde ser escrito */
+} ResultadoSessao;
+
+/* Nova sessão que escreve em saida; NULL sem memória */
+CompilerSession *criarSessao(FILE *saida);
+
+/* Libera o fonte, a arena e a própria sessão */
+void destruirSessao(CompilerSession *s);
+
+/* Lê o fonte de f (mmap quando possível); f pode ser fechado em seguida */
+ResultadoSessao sessaoCarregarArquivo(CompilerSession *s, FILE *f);
+
+/* Usa uma cópia de buf[0..n) como fonte */
+ResultadoSessao sessaoCarregarMemoria(CompilerSession *s, const char *buf, size_t n);
+
+/* Análise léxica e sintática; em CM_OK a árvore compacta está pronta e o
+   fonte já foi liberado */
+ResultadoSessao sessaoParse(CompilerSession *s);
+
+/* Tabela de símbolos e verificação de tipos; sem erros, as expressões são
+   simplificadas (dobra.h), e o campo dobra.economizadas diz quantas
+   instruções o código intermediário deixou de ter */
+ResultadoSessao sessaoAnalisar(CompilerSession *s);
+
+/* Código intermediário em destino (NULL = saída da sessão), esvaziado ao
+   final: com um buffer grande no FILE (setvbuf), é uma única escrita */
+ResultadoSessao sessaoGerarCodigo(CompilerSession *s, FILE *destino);
+
+/* Tabela de símbolos em destino (NULL = saída da sessão), como acima
+   (após sessaoAnalisar) */
+ResultadoSessao sessaoImprimirTabela(CompilerSession *s, FILE *destino);
+
+/* Árvore em formato DOT (após sessaoParse; depois de sessaoAnalisar, com
+   as expressões já simplificadas). Com pngFilename, o Graphviz
+   gera o PNG em segundo plano; esperarPngs() (util.h) espera por ele. */
+ResultadoSessao sessaoGerarDot(CompilerSession *s, const char *dotFilename, const char *pngFilename);
+
+/* Grafo de fluxo de controle do código intermediário (cfg.h) em formato
+   DOT, com os blocos básicos, a árvore de dominadores e os laços de cada
+   função (após sessaoAnalisar) */
+ResultadoSessao sessaoGerarCfg(CompilerSession *s, const char *dotFilename);
+
+/* Executa o programa com o interpretador da árvore (interp.h), lendo
+   input() de entrada e escrevendo output() em saida; os erros de execução
+   vão para a saída da sessão (após sessaoAnalisar) */
+ResultadoSessao sessaoExecutar(CompilerSession *s, FILE *entrada, FILE *saida);
+
+/* Monta o bytecode de registradores do código intermediário (vm.h) e o
+   escreve em destino na codificação binária (após sessaoAnalisar) */
+ResultadoSessao sessaoGerarBytecode(CompilerSession *s, FILE *destino);
+
+/* Executa o bytecode do programa na máquina virtual (vm.h), como
+   sessaoExecutar */
+ResultadoSessao sessaoExecutarBytecode(CompilerSession *s, FILE *entrada, FILE *saida);
+
+/* Código x86-64 do código intermediário (x64.h) em assembly do GNU as,
+   para ligar com runtime.c (após sessaoAnalisar) */
+ResultadoSessao sessaoGerarAssembly(CompilerSession *s, FILE *destino);
+
+/* Executa o código x86-64 do programa em memória (jit.h), sem as e ld,
+   como sessaoExecutar */
+ResultadoSessao sessaoExecutarJit(CompilerSession *s, FILE *entrada, FILE *saida);
+
+/* Distribui as funções do programa entre as threads de p na verificação
+   de tipos e na geração de código (NULL volta ao modo serial). A listagem
+   é a mesma da execução serial. p deve existir enquanto a sessão for
+   usada e pode ser o mesmo pool que executa a sessão. */
+void sessaoUsarPool(CompilerSession *s, Pool *p);
+
+/* Estatísticas da arena da sessão (arena.h) */
+void sessaoImprimirMemoria(CompilerSession *s, FILE *f);
+
+/* Uso interno: chama f(i, ctx) para i em [0, n). Com o pool da sessão
+   corrente, os índices são divididos em faixas contíguas, cada uma numa
+   sessão filha com saída e arena próprias; as saídas são copiadas em
+   ordem para a sessão corrente, que herda os erros e a memória das
+   filhas. f só pode ler o estado compartilhado (a tabela de símbolos já
+   congelada, a árvore fora da sua faixa). */
+void paraCadaParalelo(int n, void (*f)(int i, void *ctx), void *ctx);
+
+/* Uso interno: verdadeiro se paraCadaParalelo usa threads */
+int sessaoParalela(void);
+
+/* Uso interno: interrompe a fase em execução na sessão corrente com o
+   resultado dado; fora de uma fase, termina o processo */
+void abortarSessao(ResultadoSessao resultado);
+
+#endif
@@ -0,0 +1,589 @@
+/* Forma SSA: construção e volta ao código de três endereços (ssa.c) */
+
+#include "globals.h"
+#include "ssa.h"
+#include "arena.h"
+
+#include <string.h>
+
+/* Vetor de pares que cresce na arena, como as quádruplas (ir.c): espaço
+   para mais um par depois dos n inteiros de v */
+static int *crescerPares(int *v, int n, int *cap) {
+    int *novo;
+
+    if (n + 2 <= *cap) return v;
+    *cap = *cap ? *cap * 2 : 64;
+    novo = (int *)arenaAlloc(*cap * sizeof(int));
+    if (n > 0) memcpy(novo, v, n * sizeof(int));
+    return novo;
+}
+
+int indicePred(const FuncaoCfg *f, int b, int p) {
+    for (int j = 0; j < f->blocos[b].npred; j++)
+        if (f->blocos[b].pred[j] == p) return j;
+    return -1;
+}
+
+/* ---------------------- Construção ---------------------- */
+
+/* Variáveis renomeadas: [0, nlocais) são as locais (memloc - primeira),
+   e as seguintes os temporários do trecho (nlocais + t) */
+typedef struct {
+    FuncaoSsa *s;
+    int32_t primeira;        /* memloc da primeira variável da função */
+    int nlocais;
+    int32_t ntemps;          /* temporários antes da renomeação */
+    int nvars;
+    uint8_t *promovida;      /* por variável */
+    Operando *nomes;         /* pilhas de nomes: [base[v], base[v] + topo[v]) */
+    int *base, *topo;
+    int *registro;           /* variáveis empilhadas, para desfazer */
+    int nregistro;
+} Renomeacao;
+
+/* Variável da forma SSA lida ou escrita em o, ou -1 */
+static int variavel(const Renomeacao *x, Operando o) {
+    int v;
+
+    if (o.tipo == OPR_TEMP) return o.v < x->ntemps ? x->nlocais + o.v : -1;
+    if (o.tipo != OPR_VAR) return -1;
+    v = o.v - x->primeira;
+    if (v < 0 || v >= x->nlocais || !x->promovida[v]) return -1;
+    return v;
+}
+
+/* O operando original da variável v, que é também a sua versão inicial */
+static Operando original(const Renomeacao *x, int v) {
+    if (v < x->nlocais) return operando(OPR_VAR, x->primeira + v);
+    return operando(OPR_TEMP, v - x->nlocais);
+}
+
+static void lerNome(const Renomeacao *x, Operando *o) {
+    int v = variavel(x, *o);
+    if (v >= 0) *o = x->nomes[x->base[v] + x->topo[v] - 1];
+}
+
+static Operando novoNome(Renomeacao *x, int v) {
+    Operando t = operando(OPR_TEMP, x->s->codigo->ntemps++);
+    x->nomes[x->base[v] + x->topo[v]++] = t;
+    x->registro[x->nregistro++] = v;
+    return t;
+}
+
+/* Escalares declarados na função (IR_VAR sem tamanho, IR_PARAM sem ser
+   array), cujos memlocs são consecutivos (buildSymtab), e todos os
+   temporários */
+static void escolherVariaveis(Renomeacao *x) {
+    const CodigoIR *c = x->s->codigo;
+    int32_t ultima = -1;
+
+    x->primeira = INT32_MAX;
+    for (uint32_t i = 0; i < c->n; i++) {
+        const Quad *q = &c->quads[i];
+        if (q->op != IR_VAR && q->op != IR_PARAM) continue;
+        if (q->a.v < x->primeira) x->primeira = q->a.v;
+        if (q->a.v > ultima) ultima = q->a.v;
+    }
+    x->nlocais = ultima >= x->primeira ? ultima - x->primeira + 1 : 0;
+    x->ntemps = c->ntemps;
+    x->nvars = x->nlocais + x->ntemps;
+    x->promovida = (uint8_t *)arenaAlloc(x->nvars + 1);
+    memset(x->promovida + x->nlocais, 1, x->ntemps);
+    for (uint32_t i = 0; i < c->n; i++) {
+        const Quad *q = &c->quads[i];
+        if ((q->op == IR_VAR && q->b.tipo == OPR_NADA) || (q->op == IR_PARAM && q->b.v == 0))
+            x->promovida[q->a.v - x->primeira] = 1;
+    }
+}
+
+/* Fronteira de dominância de cada bloco, em listas [inicio[b], inicio[b + 1]) */
+static int *fronteiras(const FuncaoCfg *f, int **inicio) {
+    int *pares = NULL, npares = 0, cap = 0;
+    int *marca = (int *)arenaAlloc(f->nblocos * sizeof(int));
+    int *conta = (int *)arenaAlloc((f->nblocos + 1) * sizeof(int));
+    int *lista;
+
+    for (int b = 0; b < f->nblocos; b++) {
+        const BlocoBasico *bb = &f->blocos[b];
+        if (bb->npred < 2 || bb->rpo < 0) continue;
+        for (int j = 0; j < bb->npred; j++) {
+            int r = bb->pred[j];
+            if (f->blocos[r].rpo < 0) continue;
+            while (r != bb->idom && marca[r] != b + 1) {
+                marca[r] = b + 1;
+                pares = crescerPares(pares, npares, &cap);
+                pares[npares++] = r;
+                pares[npares++] = b;
+                r = f->blocos[r].idom;
+            }
+        }
+    }
+
+    for (int i = 0; i < npares; i += 2) conta[pares[i] + 1]++;
+    for (int b = 0; b < f->nblocos; b++) conta[b + 1] += conta[b];
+    lista = (int *)arenaAlloc((npares / 2 + 1) * sizeof(int));
+    *inicio = (int *)arenaAlloc((f->nblocos + 1) * sizeof(int));
+    memcpy(*inicio, conta, (f->nblocos + 1) * sizeof(int));
+    for (int i = 0; i < npares; i += 2) lista[conta[pares[i]]++] = pares[i + 1];
+    return lista;
+}
+
+static void inserirPhis(Renomeacao *x, int *nomesPorVar) {
+    FuncaoSsa *s = x->s;
+    const FuncaoCfg *f = s->cfg;
+    const CodigoIR *c = s->codigo;
+    int *defs = NULL, *inicioDefs = NULL, *conta;
+    uint8_t *global = (uint8_t *)arenaAlloc(x->nvars + 1);
+    int *escrita = (int *)arenaAlloc((x->nvars + 1) * sizeof(int));
+    int *df, *inicioDf;
+    int *fila = (int *)arenaAlloc(f->nblocos * sizeof(int));
+    int *temPhi = (int *)arenaAlloc(f->nblocos * sizeof(int));
+    int *naFila = (int *)arenaAlloc(f->nblocos * sizeof(int));
+    int *pares = NULL, npares = 0, cap = 0;
+
+    /* blocos com definições de cada variável; as lidas antes de escritas
+       num mesmo bloco são as que precisam de phi */
+    conta = (int *)arenaAlloc((x->nvars + 1) * sizeof(int));
+    for (int pass = 0; pass < 2; pass++) {
+        memset(escrita, 0, x->nvars * sizeof(int));
+        for (int b = 0; b < f->nblocos; b++) {
+            if (f->blocos[b].rpo < 0) continue;
+            for (uint32_t i = f->blocos[b].inicio; i < f->blocos[b].fim; i++) {
+                const Quad *q = &c->quads[i];
+                int v;
+
+                if (pass == 0 && leOperandos((OpIR)q->op)) {
+                    if ((v = variavel(x, q->a)) >= 0 && escrita[v] != b + 1) global[v] = 1;
+                    if ((v = variavel(x, q->b)) >= 0 && escrita[v] != b + 1) global[v] = 1;
+                }
+                if (!defineR((OpIR)q->op) || (v = variavel(x, q->r)) < 0) continue;
+                nomesPorVar[v]++;
+                if (escrita[v] == b + 1) continue;
+                escrita[v] = b + 1;
+                if (pass == 0) conta[v + 1]++;
+                else defs[inicioDefs[v] + conta[v]++] = b;
+            }
+        }
+        if (pass == 0) {
+            for (int v = 0; v < x->nvars; v++) conta[v + 1] += conta[v];
+            defs = (int *)arenaAlloc((conta[x->nvars] + 1) * sizeof(int));
+            inicioDefs = (int *)arenaAlloc((x->nvars + 1) * sizeof(int));
+            memcpy(inicioDefs, conta, (x->nvars + 1) * sizeof(int));
+            memset(conta, 0, (x->nvars + 1) * sizeof(int));
+            memset(nomesPorVar, 0, x->nvars * sizeof(int));
+        }
+    }
+
+    /* phis na fronteira de dominância iterada das definições */
+    df = fronteiras(f, &inicioDf);
+    for (int v = 0; v < x->nvars; v++) {
+        int n = 0;
+
+        if (!global[v]) continue;
+        for (int i = inicioDefs[v]; i < inicioDefs[v] + conta[v]; i++) {
+            fila[n++] = defs[i];
+            naFila[defs[i]] = v + 1;
+        }
+        while (n > 0) {
+            int b = fila[--n];
+            for (int i = inicioDf[b]; i < inicioDf[b + 1]; i++) {
+                int y = df[i];
+                if (temPhi[y] == v + 1) continue;
+                temPhi[y] = v + 1;
+                pares = crescerPares(pares, npares, &cap);
+                pares[npares++] = y;
+                pares[npares++] = v;
+                nomesPorVar[v]++;
+                if (naFila[y] != v + 1) {
+                    naFila[y] = v + 1;
+                    fila[n++] = y;
+                }
+            }
+        }
+    }
+
+    /* agrupadas por bloco */
+    s->nphis = npares / 2;
+    s->phis = (Phi *)arenaAlloc((s->nphis + 1) * sizeof(Phi));
+    s->primeiroPhi = (int *)arenaAlloc((f->nblocos + 1) * sizeof(int));
+    for (int i = 0; i < npares; i += 2) s->primeiroPhi[pares[i] + 1]++;
+    for (int b = 0; b < f->nblocos; b++) s->primeiroPhi[b + 1] += s->primeiroPhi[b];
+    memset(naFila, 0, f->nblocos * sizeof(int));
+    for (int i = 0; i < npares; i += 2) {
+        int b = pares[i];
+        Phi *p = &s->phis[s->primeiroPhi[b] + naFila[b]++];
+
+        p->var = original(x, pares[i + 1]);
+        p->bloco = b;
+        p->args = (Operando *)arenaAlloc(f->blocos[b].npred * sizeof(Operando) + 1);
+    }
+}
+
+static void renomearBloco(Renomeacao *x, int b) {
+    FuncaoSsa *s = x->s;
+    const BlocoBasico *bb = &s->cfg->blocos[b];
+    int v;
+
+    for (int i = s->primeiroPhi[b]; i < s->primeiroPhi[b + 1]; i++)
+        s->phis[i].r = novoNome(x, variavel(x, s->phis[i].var));
+
+    for (uint32_t i = bb->inicio; i < bb->fim; i++) {
+        Quad *q = &s->codigo->quads[i];
+
+        if (leOperandos((OpIR)q->op)) {
+            lerNome(x, &q->a);
+            lerNome(x, &q->b);
+        }
+        if (defineR((OpIR)q->op) && (v = variavel(x, q->r)) >= 0)
+            q->r = novoNome(x, v);
+    }
+
+    for (int k = 0; k < bb->nsucc; k++) {
+        int suc = bb->succ[k];
+        int j = indicePred(s->cfg, suc, b);
+
+        for (int i = s->primeiroPhi[suc]; i < s->primeiroPhi[suc + 1]; i++) {
+            Phi *p = &s->phis[i];
+            v = variavel(x, p->var);
+            p->args[j] = x->nomes[x->base[v] + x->topo[v] - 1];
+        }
+    }
+}
+
+/* Percorre a árvore de dominadores em pré-ordem, com pilha explícita:
+   os nomes empilhados por um bloco saem quando a subárvore termina */
+static void renomear(Renomeacao *x) {
+    const FuncaoCfg *f = x->s->cfg;
+    int *bloco = (int *)arenaAlloc(f->nblocos * sizeof(int));
+    int *filho = (int *)arenaAlloc(f->nblocos * sizeof(int));
+    int *marca = (int *)arenaAlloc(f->nblocos * sizeof(int));
+    int topo = 0;
+
+    bloco[0] = 0;
+    marca[0] = x->nregistro;
+    renomearBloco(x, 0);
+    filho[topo++] = f->blocos[0].filhoDom;
+    while (topo > 0) {
+        int c = filho[topo - 1];
+
+        if (c >= 0) {
+            filho[topo - 1] = f->blocos[c].irmaoDom;
+            bloco[topo] = c;
+            marca[topo] = x->nregistro;
+            renomearBloco(x, c);
+            filho[topo++] = f->blocos[c].filhoDom;
+        } else {
+            topo--;
+            while (x->nregistro > marca[topo]) x->topo[x->registro[--x->nregistro]]--;
+        }
+    }
+}
+
+FuncaoSsa *construirSsa(CodigoIR *trecho, FuncaoCfg *f) {
+    FuncaoSsa *s = (FuncaoSsa *)arenaAlloc(sizeof(FuncaoSsa));
+    Renomeacao x;
+    int *nomesPorVar;
+    int total = 0;
+
+    s->codigo = trecho;
+    s->cfg = f;
+    s->vivo = (uint8_t *)arenaAlloc(f->nblocos);
+    for (int b = 0; b < f->nblocos; b++) s->vivo[b] = f->blocos[b].rpo >= 0;
+    s->vivo[f->nblocos - 1] = 1;     /* o endfunc fica mesmo sem return */
+
+    memset(&x, 0, sizeof(x));
+    x.s = s;
+    escolherVariaveis(&x);
+    nomesPorVar = (int *)arenaAlloc((x.nvars + 1) * sizeof(int));
+    inserirPhis(&x, nomesPorVar);
+
+    /* versão inicial: a própria variável */
+    x.base = (int *)arenaAlloc((x.nvars + 1) * sizeof(int));
+    x.topo = (int *)arenaAlloc((x.nvars + 1) * sizeof(int));
+    for (int v = 0; v < x.nvars; v++) {
+        x.base[v] = total;
+        total += nomesPorVar[v] + 1;
+    }
+    x.nomes = (Operando *)arenaAlloc((total + 1) * sizeof(Operando));
+    x.registro = (int *)arenaAlloc((total + 1) * sizeof(int));
+    for (int v = 0; v < x.nvars; v++) {
+        x.nomes[x.base[v]] = original(&x, v);
+        x.topo[v] = 1;
+    }
+    renomear(&x);
+    return s;
+}
+
+/* ---------------------- Propagação de cópias ---------------------- */
+
+/* Na forma SSA, t = a vale em todo o alcance de t: a cadeia de cópias
+   leva à origem, que nunca é redefinida */
+static int32_t origem(int32_t *rep, int32_t t) {
+    while (rep[t] != t) {
+        rep[t] = rep[rep[t]];
+        t = rep[t];
+    }
+    return t;
+}
+
+static void trocarPelaOrigem(int32_t *rep, Operando *o) {
+    if (o->tipo == OPR_TEMP) o->v = origem(rep, o->v);
+}
+
+void propagarCopias(FuncaoSsa *s) {
+    CodigoIR *c = s->codigo;
+    const FuncaoCfg *f = s->cfg;
+    int32_t *rep = (int32_t *)arenaAlloc((c->ntemps + 1) * sizeof(int32_t));
+    int removidas = 0;
+
+    for (int32_t t = 0; t < c->ntemps; t++) rep[t] = t;
+    for (int b = 0; b < f->nblocos; b++) {
+        if (!s->vivo[b]) continue;
+        for (uint32_t i = f->blocos[b].inicio; i < f->blocos[b].fim; i++) {
+            Quad *q = &c->quads[i];
+            if (q->op != IR_COPY || q->r.tipo != OPR_TEMP || q->a.tipo != OPR_TEMP) continue;
+            rep[q->r.v] = q->a.v;
+            q->op = IR_NOP;
+            removidas++;
+        }
+    }
+    if (removidas == 0) return;
+
+    for (int b = 0; b < f->nblocos; b++) {
+        if (!s->vivo[b]) continue;
+        for (int k = s->primeiroPhi[b]; k < s->primeiroPhi[b + 1]; k++)
+            for (int j = 0; j < f->blocos[b].npred; j++) trocarPelaOrigem(rep, &s->phis[k].args[j]);
+        for (uint32_t i = f->blocos[b].inicio; i < f->blocos[b].fim; i++) {
+            Quad *q = &c->quads[i];
+            if (!leOperandos((OpIR)q->op)) continue;
+            trocarPelaOrigem(rep, &q->a);
+            trocarPelaOrigem(rep, &q->b);
+        }
+    }
+}
+
+/* ---------------------- Saída da forma SSA ---------------------- */
+
+typedef struct {
+    Operando dest, orig;
+    int pendente;
+} Copia;
+
+static int mesmoOperando(Operando a, Operando b) {
+    return a.tipo == b.tipo && a.v == b.v;
+}
+
+/* Cópias paralelas das phis de suc na aresta b -> suc, em sequência: uma
+   cópia sai quando ninguém mais lê o seu destino; num ciclo, um destino é
+   salvo num temporário novo */
+static void copiasDaAresta(FuncaoSsa *s, CodigoIR *novo, int b, int suc) {
+    int j = indicePred(s->cfg, suc, b);
+    int n = 0, restantes;
+    Copia *copias;
+
+    copias = (Copia *)arenaAlloc((s->primeiroPhi[suc + 1] - s->primeiroPhi[suc] + 1) * sizeof(Copia));
+    for (int i = s->primeiroPhi[suc]; i < s->primeiroPhi[suc + 1]; i++) {
+        const Phi *p = &s->phis[i];
+        if (p->r.tipo == OPR_NADA || mesmoOperando(p->r, p->args[j])) continue;
+        copias[n].dest = p->r;
+        copias[n].orig = p->args[j];
+        copias[n++].pendente = TRUE;
+    }
+
+    restantes = n;
+    while (restantes > 0) {
+        int livre = -1;
+
+        for (int i = 0; i < n && livre < 0; i++) {
+            int lido = FALSE;
+            if (!copias[i].pendente) continue;
+            for (int k = 0; k < n && !lido; k++)
+                lido = k != i && copias[k].pendente && mesmoOperando(copias[k].orig, copias[i].dest);
+            if (!lido) livre = i;
+        }
+        if (livre >= 0) {
+            irEmitir(novo, IR_COPY, copias[livre].dest, copias[livre].orig, NADA);
+            copias[livre].pendente = FALSE;
+            restantes--;
+        } else {
+            /* ciclo: o primeiro destino pendente vai para um temporário */
+            Operando t = operando(OPR_TEMP, novo->ntemps++);
+            Operando d;
+
+            for (livre = 0; !copias[livre].pendente; livre++) ;
+            d = copias[livre].dest;
+            irEmitir(novo, IR_COPY, t, d, NADA);
+            for (int k = 0; k < n; k++)
+                if (copias[k].pendente && mesmoOperando(copias[k].orig, d)) copias[k].orig = t;
+        }
+    }
+}
+
+static int temPhis(const FuncaoSsa *s, int b) {
+    for (int i = s->primeiroPhi[b]; i < s->primeiroPhi[b + 1]; i++)
+        if (s->phis[i].r.tipo != OPR_NADA) return TRUE;
+    return FALSE;
+}
+
+/* r = a op b; ...; y = r, com r lido só pela cópia: a operação escreve
+   direto em y, se nada entre as duas lê ou escreve y nem desvia */
+static int podeCoalescer(const CodigoIR *c, uint32_t i, uint32_t j, Operando y) {
+    for (uint32_t k = i + 1; k < j; k++) {
+        const Quad *q = &c->quads[k];
+        OpIR op = (OpIR)q->op;
+
+        if (op == IR_LABEL || op == IR_GOTO || op == IR_IFFALSE || op == IR_RETURN) return FALSE;
+        if (leOperandos(op) && (mesmoOperando(q->a, y) || mesmoOperando(q->b, y))) return FALSE;
+        if (defineR(op) && mesmoOperando(q->r, y)) return FALSE;
+        if (op == IR_CALL && y.tipo == OPR_VAR) return FALSE;   /* global lida pela função */
+    }
+    return TRUE;
+}
+
+static void coalescer(CodigoIR *c) {
+    int *usos = (int *)arenaAlloc((c->ntemps + 1) * sizeof(int));
+    int *defs = (int *)arenaAlloc((c->ntemps + 1) * sizeof(int));
+    uint32_t *def = (uint32_t *)arenaAlloc((c->ntemps + 1) * sizeof(uint32_t));
+
+    for (uint32_t i = 0; i < c->n; i++) {
+        const Quad *q = &c->quads[i];
+        if (leOperandos((OpIR)q->op)) {
+            if (q->a.tipo == OPR_TEMP) usos[q->a.v]++;
+            if (q->b.tipo == OPR_TEMP) usos[q->b.v]++;
+        }
+        if (defineR((OpIR)q->op) && q->r.tipo == OPR_TEMP) {
+            defs[q->r.v]++;
+            def[q->r.v] = i;
+        }
+    }
+    for (uint32_t j = 0; j < c->n; j++) {
+        Quad *q = &c->quads[j];
+        int32_t x = q->a.v;
+
+        if (q->op != IR_COPY || q->a.tipo != OPR_TEMP || usos[x] != 1 || defs[x] != 1) continue;
+        if (def[x] >= j || !podeCoalescer(c, def[x], j, q->r)) continue;
+        c->quads[def[x]].r = q->r;
+        if (q->r.tipo == OPR_TEMP) def[q->r.v] = def[x];
+        q->op = IR_NOP;
+    }
+}
+
+/* Cópias de uma aresta crítica de if_false, num bloco próprio: logo antes
+   do bloco de destino, ou depois do último se o destino vem antes */
+typedef struct {
+    int bloco;
+    Operando rotulo, destino;
+    int proxima;             /* próxima aresta com o mesmo destino, ou -1 */
+} ArestaAdiada;
+
+/* O último desvio emitido não continua na quádrupla seguinte */
+static int semSequencia(const CodigoIR *c) {
+    OpIR op = (OpIR)c->quads[c->n - 1].op;
+    return op == IR_GOTO || op == IR_RETURN;
+}
+
+/* Emite as arestas da lista que começa em k; a última continua em
+   seguinte (NADA se não continua em ninguém) */
+static void emitirAdiadas(FuncaoSsa *s, CodigoIR *novo, const ArestaAdiada *adiadas, int k, Operando seguinte) {
+    for (; k >= 0; k = adiadas[k].proxima) {
+        const ArestaAdiada *a = &adiadas[k];
+
+        irEmitir(novo, IR_LABEL, NADA, a->rotulo, NADA);
+        copiasDaAresta(s, novo, a->bloco, s->cfg->blocos[a->bloco].succ[1]);
+        if (a->proxima >= 0 || !mesmoOperando(a->destino, seguinte))
+            irEmitir(novo, IR_GOTO, NADA, a->destino, NADA);
+    }
+}
+
+/* As declarações dos blocos removidos, logo depois dos param: a versão
+   inicial de uma variável do escopo de um deles ainda pode chegar a uma
+   phi viva, como cópia */
+static void declararRemovidas(const FuncaoSsa *s, CodigoIR *novo) {
+    const CodigoIR *c = s->codigo;
+
+    for (int b = 0; b < s->cfg->nblocos; b++) {
+        if (s->vivo[b]) continue;
+        for (uint32_t i = s->cfg->blocos[b].inicio; i < s->cfg->blocos[b].fim; i++)
+            if (c->quads[i].op == IR_VAR) irEmitir(novo, IR_VAR, NADA, c->quads[i].a, c->quads[i].b);
+    }
+}
+
+CodigoIR *sairSsa(FuncaoSsa *s) {
+    const CodigoIR *c = s->codigo;
+    const FuncaoCfg *f = s->cfg;
+    CodigoIR *novo = novoIR(c->simbolos, c->nsimbolos);
+    ArestaAdiada *adiadas = (ArestaAdiada *)arenaAlloc(f->nblocos * sizeof(ArestaAdiada));
+    int *adiadasPara = (int *)arenaAlloc((f->nblocos + 1) * sizeof(int));  /* por destino; o último = depois */
+    int nadiadas = 0;
+
+    novo->ntemps = c->ntemps;
+    novo->nlabels = c->nlabels;
+    for (int b = 0; b <= f->nblocos; b++) adiadasPara[b] = -1;
+    for (int b = 0; b < f->nblocos; b++) {
+        const BlocoBasico *bb = &f->blocos[b];
+        uint32_t fim = bb->fim;
+        const Quad *desvio = NULL;
+
+        if (!s->vivo[b]) continue;
+
+        /* antes do bloco de saída (o endfunc), as arestas para trás */
+        if (b == f->nblocos - 1 && adiadasPara[f->nblocos] >= 0) {
+            Operando saida = operando(OPR_LABEL, novo->nlabels++);
+
+            if (!semSequencia(novo)) irEmitir(novo, IR_GOTO, NADA, saida, NADA);
+            emitirAdiadas(s, novo, adiadas, adiadasPara[f->nblocos], NADA);
+            irEmitir(novo, IR_LABEL, NADA, saida, NADA);
+        }
+        /* antes do destino, as arestas que levam a ele; a última cai nele */
+        if (adiadasPara[b] >= 0) {
+            Operando rotulo = adiadas[adiadasPara[b]].destino;
+
+            if (!semSequencia(novo)) irEmitir(novo, IR_GOTO, NADA, rotulo, NADA);
+            emitirAdiadas(s, novo, adiadas, adiadasPara[b], rotulo);
+        }
+
+        /* a última quádrupla que sobrou, se for um desvio, fica depois das cópias */
+        while (fim > bb->inicio && c->quads[fim - 1].op == IR_NOP) fim--;
+        if (fim > bb->inicio) {
+            OpIR op = (OpIR)c->quads[fim - 1].op;
+            if (op == IR_GOTO || op == IR_IFFALSE || op == IR_RETURN) desvio = &c->quads[--fim];
+        }
+        for (uint32_t i = bb->inicio; i < fim; i++) {
+            const Quad *q = &c->quads[i];
+            if (q->op != IR_NOP) irEmitir(novo, (OpIR)q->op, q->r, q->a, q->b);
+            /* os param ficam colados ao func (x64.c) */
+            if ((q->op == IR_FUNC || q->op == IR_PARAM) && (i + 1 >= fim || c->quads[i + 1].op != IR_PARAM))
+                declararRemovidas(s, novo);
+        }
+
+        if (desvio == NULL) {
+            if (bb->nsucc > 0) copiasDaAresta(s, novo, b, bb->succ[0]);
+        } else if (desvio->op == IR_GOTO) {
+            copiasDaAresta(s, novo, b, bb->succ[0]);
+            irEmitir(novo, IR_GOTO, NADA, desvio->a, NADA);
+        } else if (desvio->op == IR_RETURN) {
+            irEmitir(novo, IR_RETURN, NADA, desvio->a, NADA);
+        } else if (bb->nsucc == 1) {
+            /* os dois lados levam ao mesmo bloco: o desvio não faz nada */
+            copiasDaAresta(s, novo, b, bb->succ[0]);
+        } else if (!temPhis(s, bb->succ[1])) {
+            irEmitir(novo, IR_IFFALSE, NADA, desvio->a, desvio->b);
+            copiasDaAresta(s, novo, b, bb->succ[0]);
+        } else {
+            /* aresta crítica: as cópias do desvio ficam num bloco próprio */
+            ArestaAdiada *a = &adiadas[nadiadas];
+            int lista = bb->succ[1] > b ? bb->succ[1] : f->nblocos;
+
+            a->bloco = b;
+            a->rotulo = operando(OPR_LABEL, novo->nlabels++);
+            a->destino = desvio->b;
+            a->proxima = adiadasPara[lista];
+            adiadasPara[lista] = nadiadas++;
+            irEmitir(novo, IR_IFFALSE, NADA, desvio->a, a->rotulo);
+            copiasDaAresta(s, novo, b, bb->succ[0]);
+        }
+    }
+    coalescer(novo);
+    irCompactar(novo);
+    return novo;
+}
@@ -0,0 +1,60 @@
+/* ssa.h - Forma SSA do código de uma função */
+
+#ifndef SSA_H
+#define SSA_H
+
+#include "globals.h"
+#include "ir.h"
+#include "cfg.h"
+
+/*
+ * As variáveis escalares da função (locais e parâmetros que não são
+ * arrays) e os temporários, que o cgen reaproveita, entram na forma SSA;
+ * globais e arrays continuam como memória. Cada definição ganha um
+ * temporário novo e cada uso passa a ler o temporário da definição que o
+ * alcança. A versão inicial é a própria variável: o parâmetro recebido,
+ * ou o valor indefinido de uma local.
+ *
+ * As funções phi (Cytron et al.) ficam fora das quádruplas, nos blocos
+ * da fronteira de dominância das definições, só para as variáveis lidas
+ * em algum bloco antes de serem escritas nele (SSA semi-podada). args[j]
+ * vem do predecessor pred[j] do bloco; r.tipo == OPR_NADA marca uma phi
+ * removida.
+ */
+
+typedef struct {
+    Operando r;
+    Operando var;            /* variável ou temporário original */
+    int bloco;
+    Operando *args;
+} Phi;
+
+typedef struct {
+    CodigoIR *codigo;        /* o trecho da função, renomeado no lugar */
+    FuncaoCfg *cfg;
+    Phi *phis;               /* phis do bloco b: [primeiroPhi[b], primeiroPhi[b + 1]) */
+    int nphis;
+    int *primeiroPhi;
+    uint8_t *vivo;           /* blocos que continuam no código */
+} FuncaoSsa;
+
+/* Forma SSA de trecho, que contém uma única função, com o grafo cfg */
+FuncaoSsa *construirSsa(CodigoIR *trecho, FuncaoCfg *cfg);
+
+/* Propagação de cópias: os usos do destino de cada r = a entre
+   temporários passam a ler a, e a cópia sai */
+void propagarCopias(FuncaoSsa *s);
+
+/* Índice de p entre os predecessores de b, ou -1 */
+int indicePred(const FuncaoCfg *cfg, int b, int p);
+
+/* Volta ao código de três endereços: as phis viram cópias no fim dos
+   predecessores (as arestas críticas ganham um bloco próprio, logo antes
+   do destino, ou depois do último bloco se o destino vem antes), os
+   blocos mortos são descartados e uma operação cujo resultado só é
+   copiado logo adiante escreve direto no destino da cópia. Os sucessores
+   de cada bloco são os de cfg, que as otimizações podem ter reduzido.
+   Devolve um trecho novo, compactado (irCompactar). */
+CodigoIR *sairSsa(FuncaoSsa *s);
+
+#endif
@@ -1,113 +1,265 @@
 /*Tabela de Símbolos*/
 
+/* Nomes e escopos são internados (nomes.h): comparação por identidade */
+
+/*
+ * Endereçamento aberto com Robin Hood: cada posição guarda um nome e a
+ * sua declaração visível mais interna; as declarações que ela oculta
+ * seguem pelo campo shadow. Ao fechar um escopo, cada nome declarado
+ * nele volta a apontar para a declaração que ocultava (ou para NULL). A
+ * posição do nome continua ocupada, então nunca há remoções: a tabela
+ * só cresce, dobrando quando passa de 80% de ocupação. Tabela e símbolos
+ * ficam na arena.
+ */
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
 #include "globals.h"
 #include "symtab.h"
+#include "arena.h"
+#include "sessao.h"
 
-#define SIZE 211
-#define SHIFT 4
+#define CAPACIDADE_INICIAL 256
+#define LINHAS_INICIAIS 4
 
-static int hash(char *key) {
-    int temp = 0;
-    int i = 0;
-    while (key[i] != '\0') {
-        temp = ((temp << SHIFT) + key[i]) % SIZE;
-        ++i;
-    }
-    return temp;
-}
-
-typedef struct LineListRec {
-    int lineno;
-    struct LineListRec *next;
-} *LineList;
-
-typedef struct BucketListRec {
-    char *name;
-    LineList lines;
-    int memloc;
-    ExpType type;
-    char *scope;
-    struct BucketListRec *next;
-} *BucketList;
-
-static BucketList hashTable[SIZE];
-
-void st_insert(char *name, int lineno, int loc, ExpType type, char *scope) {
-    int h = hash(name);
-    BucketList l = hashTable[h];
-    
-    while ((l != NULL) && (strcmp(name, l->name) != 0)) l = l->next;
-    
-    if (l == NULL) {
-        l = (BucketList)malloc(sizeof(struct BucketListRec));
-        l->name = name;
-        l->lines = (LineList)malloc(sizeof(struct LineListRec));
-        l->lines->lineno = lineno;
-        l->memloc = loc;
-        l->type = type;
-        l->scope = scope;
-        l->lines->next = NULL;
-        l->next = hashTable[h];
-        hashTable[h] = l;
-    } else {
-        LineList t = l->lines;
-        while (t->next != NULL) t = t->next;
-        t->next = (LineList)malloc(sizeof(struct LineListRec));
-        t->next->lineno = lineno;
-        t->next->next = NULL;
+/* Hash de 64 bits lendo 8 bytes por vez, com o finalizador do splitmix64 */
+static uint64_t mistura(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ull;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBull;
+    x ^= x >> 31;
+    return x;
+}
+
+static uint64_t hash(const char *key) {
+    size_t n = strlen(key);
+    uint64_t h = 0x9E3779B97F4A7C15ull ^ n;
+    uint64_t w;
+
+    for (; n >= 8; key += 8, n -= 8) {
+        memcpy(&w, key, 8);
+        h = (h ^ w) * 0xFF51AFD7ED558CCDull;
+        h ^= h >> 32;
     }
+    w = 0;
+    memcpy(&w, key, n);
+    return mistura(h ^ w);
+}
+
+typedef struct Posicao {
+    char *name;                 /* NULL: posição livre */
+    SymbolRec *sym;             /* declaração visível; NULL fora de escopo */
+    uint64_t hash;
+} Posicao;
+
+typedef struct ScopeRec {
+    SymbolRec *symbols;         /* declarações do escopo, a última primeiro */
+    struct ScopeRec *outer;
+} ScopeRec;
+
+/* Estado da sessão corrente (globals.h); o escopo global é criado na
+   primeira declaração */
+#define tabela     (sessaoAtual->symtab.tabela)
+#define capacidade (sessaoAtual->symtab.capacidade)
+#define ocupados   (sessaoAtual->symtab.ocupados)
+#define topScope   (sessaoAtual->symtab.topScope)
+#define freeScopes (sessaoAtual->symtab.freeScopes)   /* escopos fechados, para reuso */
+#define nivel      (sessaoAtual->symtab.nivel)
+#define congelada  (sessaoAtual->symtab.congelada)
+#define firstDecl  (sessaoAtual->symtab.firstDecl)
+#define lastDecl   (sessaoAtual->symtab.lastDecl)
+
+static uint32_t distancia(uint64_t h, uint32_t i) {
+    return (i - (uint32_t)h) & (capacidade - 1);
 }
 
-int st_lookup(char *name) {
-    int h = hash(name);
-    BucketList l = hashTable[h];
-    while ((l != NULL) && (strcmp(name, l->name) != 0)) l = l->next;
-    if (l == NULL) return -1;
-    else return l->memloc;
+/* Posição de name, ou NULL se ele nunca foi declarado */
+static Posicao *buscar(char *name, uint64_t h) {
+    uint32_t i;
+
+    if (capacidade == 0) return NULL;
+    i = (uint32_t)h & (capacidade - 1);
+    for (uint32_t d = 0;; d++, i = (i + 1) & (capacidade - 1)) {
+        Posicao *p = &tabela[i];
+        /* Robin Hood: quem está mais perto de casa que d encerra a busca */
+        if (p->name == NULL || distancia(p->hash, i) < d) return NULL;
+        if (p->name == name) return p;
+    }
 }
 
-int st_lookup_scope(char *name, char *scope) {
-    int h = hash(name);
-    BucketList l = hashTable[h];
-    
-    while (l != NULL) {
-        /* Verifica se o nome E o escopo são iguais */
-        if (strcmp(name, l->name) == 0 && strcmp(scope, l->scope) == 0) {
-            return l->memloc;  /* Encontrou no mesmo escopo */
+/* Coloca e numa posição livre, deslocando quem está mais perto de casa */
+static Posicao *colocar(Posicao e) {
+    uint32_t i = (uint32_t)e.hash & (capacidade - 1);
+    Posicao *inserida = NULL;
+
+    for (uint32_t d = 0;; d++, i = (i + 1) & (capacidade - 1)) {
+        Posicao *p = &tabela[i];
+        if (p->name == NULL) {
+            *p = e;
+            return inserida ? inserida : p;
         }
-        l = l->next;
+        if (distancia(p->hash, i) < d) {
+            Posicao t = *p;
+            *p = e;
+            if (inserida == NULL) inserida = p;
+            e = t;
+            d = distancia(e.hash, i);
+        }
+    }
+}
+
+static void crescer(void) {
+    Posicao *antiga = tabela;
+    uint32_t capAntiga = capacidade;
+
+    capacidade = capacidade ? capacidade * 2 : CAPACIDADE_INICIAL;
+    tabela = (Posicao *)arenaAlloc(capacidade * sizeof(Posicao));
+    for (uint32_t i = 0; i < capAntiga; i++)
+        if (antiga[i].name != NULL) colocar(antiga[i]);
+}
+
+/* Após st_congelar() a tabela é compartilhada entre threads (sessões
+   filhas, sessao.h) e só pode ser consultada */
+static void modificar(void) {
+    if (congelada) {
+        fprintf(stderr, "Erro interno: tabela de simbolos congelada\n");
+        abortarSessao(CM_ERRO_USO);
+    }
+}
+
+static ScopeRec *novoEscopo(void) {
+    ScopeRec *s = freeScopes;
+    if (s != NULL) freeScopes = s->outer;
+    else s = (ScopeRec *)arenaAlloc(sizeof(ScopeRec));
+    s->symbols = NULL;
+    s->outer = topScope;
+    return s;
+}
+
+static ScopeRec *escopoAtual(void) {
+    if (topScope == NULL) topScope = novoEscopo();
+    return topScope;
+}
+
+void st_enter_scope(void) {
+    modificar();
+    escopoAtual();
+    topScope = novoEscopo();
+    nivel++;
+}
+
+void st_exit_scope(void) {
+    ScopeRec *s = topScope;
+    modificar();
+    if (nivel == 0) return;
+    for (SymbolRec *sym = s->symbols; sym != NULL; sym = sym->nextInScope)
+        buscar(sym->name, sym->hash)->sym = sym->shadow;
+    topScope = s->outer;
+    s->outer = freeScopes;
+    freeScopes = s;
+    nivel--;
+}
+
+SymbolRec *st_insert(char *name, int lineno, int loc, ExpType type, char *scope) {
+    uint64_t h = hash(name);
+    Posicao *p = buscar(name, h);
+    SymbolRec *s;
+
+    modificar();
+    s = (SymbolRec *)arenaAlloc(sizeof(SymbolRec));
+
+    s->name = name;
+    s->scope = scope;
+    s->type = type;
+    s->memloc = loc;
+    s->lines = NULL;
+    st_add_line(s, lineno);
+    s->level = nivel;
+    s->hash = h;
+
+    if (p == NULL) {
+        Posicao e = {name, NULL, h};
+        if (ocupados * 5 >= capacidade * 4) crescer();
+        p = colocar(e);
+        ocupados++;
     }
-    
-    return -1;  /* Não encontrou no escopo */
+    s->shadow = p->sym;
+    p->sym = s;
+    s->nextInScope = escopoAtual()->symbols;
+    topScope->symbols = s;
+
+    if (lastDecl != NULL) lastDecl->nextDecl = s;
+    else firstDecl = s;
+    lastDecl = s;
+    return s;
+}
+
+SymbolRec *st_lookup(char *name) {
+    Posicao *p = buscar(name, hash(name));
+    return p != NULL ? p->sym : NULL;
 }
 
-void printSymTab(FILE *listing) {
-    int i;
-    
+SymbolRec *st_lookup_current(char *name) {
+    SymbolRec *s = st_lookup(name);
+    return (s != NULL && s->level == nivel) ? s : NULL;
+}
+
+SymbolRec *st_lookup_global(char *name) {
+    SymbolRec *s = st_lookup(name);
+    while (s != NULL && s->level != 0) s = s->shadow;
+    return s;
+}
+
+void st_add_line(SymbolRec *s, int lineno) {
+    LineList t = s->linesTail;
+    modificar();
+    if (s->lines == NULL || t->count == t->capacity) {
+        int cap = s->lines == NULL ? LINHAS_INICIAIS : t->capacity * 2;
+        LineList b = (LineList)arenaAlloc(sizeof(struct LineListRec) + cap * sizeof(int));
+        b->capacity = cap;
+        if (s->lines == NULL) s->lines = b;
+        else t->next = b;
+        s->linesTail = t = b;
+    }
+    t->lineno[t->count++] = lineno;
+}
+
+SymbolRec **st_declaracoes(int *n) {
+    SymbolRec **v;
+    int max = -1;
+
+    for (SymbolRec *l = firstDecl; l != NULL; l = l->nextDecl)
+        if (l->memloc > max) max = l->memloc;
+    v = (SymbolRec **)arenaAlloc((max + 2) * sizeof(SymbolRec *));
+    for (SymbolRec *l = firstDecl; l != NULL; l = l->nextDecl)
+        v[l->memloc] = l;
+    *n = max + 1;
+    return v;
+}
+
+void st_congelar(void) {
+    congelada = TRUE;
+}
+
+void printSymTab(FILE *saida) {
     /* Cabeçalho da tabela - SEM coluna de Linha */
-    fprintf(listing, "%-15s %-15s %-10s\n", "Nome", "Escopo", "Tipo");
-    fprintf(listing, "%-15s %-15s %-10s\n", "---------------", "---------------", "----------");
-    
-    for (i = 0; i < SIZE; ++i) {
-        if (hashTable[i] != NULL) {
-            BucketList l = hashTable[i];
-            while (l != NULL) {
-                /* Imprime: Nome, Escopo, Tipo - SEM linhas */
-                fprintf(listing, "%-15s %-15s ", l->name, l->scope);
-                
-                switch (l->type) {
-                case Integer: fprintf(listing, "%-10s", "int"); break;
-                case Void: fprintf(listing, "%-10s", "void"); break;
-                case IntegerArray: fprintf(listing, "%-10s", "int[]"); break;
-                default: fprintf(listing, "%-10s", "?"); break;
-                }
-                
-                fprintf(listing, "\n");
-                l = l->next;
-            }
+    fprintf(saida, "%-15s %-15s %-10s\n", "Nome", "Escopo", "Tipo");
+    fprintf(saida, "%-15s %-15s %-10s\n", "---------------", "---------------", "----------");
+
+    for (SymbolRec *l = firstDecl; l != NULL; l = l->nextDecl) {
+        /* Imprime: Nome, Escopo, Tipo - SEM linhas */
+        fprintf(saida, "%-15s %-15s ", l->name, l->scope);
+
+        switch (l->type) {
+        case Integer: fprintf(saida, "%-10s", "int"); break;
+        case Void: fprintf(saida, "%-10s", "void"); break;
+        case IntegerArray: fprintf(saida, "%-10s", "int[]"); break;
+        default: fprintf(saida, "%-10s", "?"); break;
         }
+
+        fprintf(saida, "\n");
     }
-}
\ No newline at end of file
+}
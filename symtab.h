@@ -5,16 +5,68 @@
 
 #include "globals.h"
 
-/* Insere identificador na tabela */
-void st_insert(char *name, int lineno, int loc, ExpType type, char *scope);
+#include <stdint.h>
 
-/* Busca identificador na tabela */
-int st_lookup(char *name);
+/* Nomes e escopos devem ser representantes internados (nomes.h) */
 
-/* Busca identificador em escopo específico */
-int st_lookup_scope(char *name, char *scope);
+/* Linhas em que o símbolo aparece: blocos de tamanho crescente, dos
+   quais só o último (linesTail) recebe novas linhas */
+typedef struct LineListRec {
+    struct LineListRec *next;
+    int count;
+    int capacity;
+    int lineno[];
+} *LineList;
 
-/* Imprime a tabela de símbolos */
-void printSymTab(FILE *listing);
+/* Uma declaração. Declarações de escopos internos ocultam as externas
+   com o mesmo nome até o escopo ser fechado. */
+typedef struct SymbolRec {
+    char *name;
+    char *scope;        /* função onde foi declarado, ou "global" */
+    ExpType type;
+    int memloc;
+    int isFunction;     /* 1 se for função, 0 caso contrário */
+    int paramCount;     /* quantidade de parâmetros se isFunction=1 */
+    LineList lines;
+    LineList linesTail;
 
-#endif
\ No newline at end of file
+    /* uso interno de symtab.c */
+    int level;                      /* profundidade do escopo; 0 = global */
+    uint64_t hash;
+    struct SymbolRec *shadow;       /* declaração oculta por esta */
+    struct SymbolRec *nextInScope;  /* declarado antes no mesmo escopo */
+    struct SymbolRec *nextDecl;     /* ordem de declaração, para impressão */
+} SymbolRec;
+
+/* Abre um escopo aninhado (função ou bloco) */
+void st_enter_scope(void);
+
+/* Fecha o escopo mais interno; suas declarações deixam de ser visíveis */
+void st_exit_scope(void);
+
+/* Declara name no escopo mais interno; scope é o nome exibido na tabela */
+SymbolRec *st_insert(char *name, int lineno, int loc, ExpType type, char *scope);
+
+/* Declaração visível de name, ou NULL */
+SymbolRec *st_lookup(char *name);
+
+/* Declaração de name no escopo mais interno, ou NULL */
+SymbolRec *st_lookup_current(char *name);
+
+/* Declaração global de name, mesmo que oculta, ou NULL */
+SymbolRec *st_lookup_global(char *name);
+
+/* Registra um uso de s na linha lineno */
+void st_add_line(SymbolRec *s, int lineno);
+
+/* Todas as declarações, indexadas por memloc (vetor na arena) */
+SymbolRec **st_declaracoes(int *n);
+
+/* Torna a tabela somente leitura: as consultas podem ser feitas de várias
+   threads, e qualquer modificação interrompe a fase (CM_ERRO_USO) */
+void st_congelar(void);
+
+/* Imprime a tabela de símbolos, na ordem de declaração */
+void printSymTab(FILE *saida);
+
+#endif
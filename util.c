@@ -2,15 +2,23 @@
 
 #include "globals.h"
 #include "util.h"
+#include "arena.h"
+#include "sessao.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-/* IMPORTANTE: A variável global é stringToken (definida em scan.c) */
-extern char stringToken[];
+#ifndef _WIN32
+#include <fcntl.h>
+#include <pthread.h>
+#include <spawn.h>
+#include <sys/wait.h>
 
-void printToken(TokenType token, const char *tokenStr) {
+extern char **environ;
+#endif
+
+void printToken(FILE *saida, TokenType token, const char *tokenStr, int n) {
     switch (token) {
     case IF:
     case ELSE:
@@ -18,44 +26,44 @@ void printToken(TokenType token, const char *tokenStr) {
     case RETURN:
     case VOID:
     case WHILE:
-        fprintf(listing, "palavra-chave: %s\n", tokenStr);
+        fprintf(saida, "palavra-chave: %.*s\n", n, tokenStr);
         break;
-    case ASSIGN: fprintf(listing, "=\n"); break;
-    case EQ: fprintf(listing, "==\n"); break;
-    case NE: fprintf(listing, "!=\n"); break;
-    case LT: fprintf(listing, "<\n"); break;
-    case LE: fprintf(listing, "<=\n"); break;
-    case GT: fprintf(listing, ">\n"); break;
-    case GE: fprintf(listing, ">=\n"); break;
-    case PLUS: fprintf(listing, "+\n"); break;
-    case MINUS: fprintf(listing, "-\n"); break;
-    case TIMES: fprintf(listing, "*\n"); break;
-    case OVER: fprintf(listing, "/\n"); break;
-    case LPAREN: fprintf(listing, "(\n"); break;
-    case RPAREN: fprintf(listing, ")\n"); break;
-    case LBRACKET: fprintf(listing, "[\n"); break;
-    case RBRACKET: fprintf(listing, "]\n"); break;
-    case LBRACE: fprintf(listing, "{\n"); break;
-    case RBRACE: fprintf(listing, "}\n"); break;
-    case SEMI: fprintf(listing, ";\n"); break;
-    case COMMA: fprintf(listing, ",\n"); break;
-    case ENDFILE: fprintf(listing, "EOF\n"); break;
+    case ASSIGN: fprintf(saida, "=\n"); break;
+    case EQ: fprintf(saida, "==\n"); break;
+    case NE: fprintf(saida, "!=\n"); break;
+    case LT: fprintf(saida, "<\n"); break;
+    case LE: fprintf(saida, "<=\n"); break;
+    case GT: fprintf(saida, ">\n"); break;
+    case GE: fprintf(saida, ">=\n"); break;
+    case PLUS: fprintf(saida, "+\n"); break;
+    case MINUS: fprintf(saida, "-\n"); break;
+    case TIMES: fprintf(saida, "*\n"); break;
+    case OVER: fprintf(saida, "/\n"); break;
+    case LPAREN: fprintf(saida, "(\n"); break;
+    case RPAREN: fprintf(saida, ")\n"); break;
+    case LBRACKET: fprintf(saida, "[\n"); break;
+    case RBRACKET: fprintf(saida, "]\n"); break;
+    case LBRACE: fprintf(saida, "{\n"); break;
+    case RBRACE: fprintf(saida, "}\n"); break;
+    case SEMI: fprintf(saida, ";\n"); break;
+    case COMMA: fprintf(saida, ",\n"); break;
+    case ENDFILE: fprintf(saida, "EOF\n"); break;
     case NUM:
-        fprintf(listing, "NUM: %s\n", tokenStr);
+        fprintf(saida, "NUM: %.*s\n", n, tokenStr);
         break;
     case ID:
-        fprintf(listing, "ID: %s\n", tokenStr);
+        fprintf(saida, "ID: %.*s\n", n, tokenStr);
         break;
     case ERROR:
-        fprintf(listing, "ERRO: %s\n", tokenStr);
+        fprintf(saida, "ERRO: %.*s\n", n, tokenStr);
         break;
     default:
-        fprintf(listing, "Token desconhecido: %d\n", token);
+        fprintf(saida, "Token desconhecido: %d\n", token);
     }
 }
 
 TreeNode *newStmtNode(StmtKind kind) {
-    TreeNode *t = (TreeNode *)malloc(sizeof(TreeNode));
+    TreeNode *t = (TreeNode *)arenaAlloc(sizeof(TreeNode));
     int i;
     if (t == NULL)
         fprintf(listing, "Erro: sem memoria\n");
@@ -64,7 +72,7 @@ TreeNode *newStmtNode(StmtKind kind) {
         t->sibling = NULL;
         t->nodekind = StmtK;
         t->kind.stmt = kind;
-        t->lineno = lineno;
+        t->lineno = linhaAtual;
         t->type = Void;
         t->arraySize = 0;
         t->attr.name = NULL;
@@ -73,7 +81,7 @@ TreeNode *newStmtNode(StmtKind kind) {
 }
 
 TreeNode *newExpNode(ExpKind kind) {
-    TreeNode *t = (TreeNode *)malloc(sizeof(TreeNode));
+    TreeNode *t = (TreeNode *)arenaAlloc(sizeof(TreeNode));
     int i;
     if (t == NULL)
         fprintf(listing, "Erro: sem memoria\n");
@@ -82,7 +90,7 @@ TreeNode *newExpNode(ExpKind kind) {
         t->sibling = NULL;
         t->nodekind = ExpK;
         t->kind.exp = kind;
-        t->lineno = lineno;
+        t->lineno = linhaAtual;
         t->type = Void;
         t->arraySize = 0;
         t->attr.name = NULL;
@@ -95,7 +103,7 @@ char *copyString(char *s) {
     char *t;
     if (s == NULL) return NULL;
     n = (int)strlen(s) + 1;
-    t = (char*)malloc(n);
+    t = (char*)arenaAlloc(n);
     if (t == NULL)
         fprintf(listing, "Erro: sem memoria\n");
     else
@@ -103,13 +111,34 @@ char *copyString(char *s) {
     return t;
 }
 
+char *copyStringN(const char *s, int n) {
+    char *t;
+    if (s == NULL) return NULL;
+    t = (char*)arenaAlloc(n + 1);
+    if (t == NULL)
+        fprintf(listing, "Erro: sem memoria\n");
+    else {
+        memcpy(t, s, n);
+        t[n] = '\0';
+    }
+    return t;
+}
+
 
-static int nodeCounter = 0;
-static FILE *dotFile = NULL;
+/* Estado da saída DOT na sessão corrente (globals.h) */
+#define nodeCounter (sessaoAtual->dot.nodeCounter)
+#define dotFile     (sessaoAtual->dot.dotFile)
+#define arvoreDot   (sessaoAtual->dot.arvore)
+
+#define BUFFER_DOT (1 << 20)
+
+static int iniciarPng(const char *dotFilename, const char *pngFilename);
+
+static const char* getNodeColor(No t) {
+    NoAst *tree = &arvoreDot->nos[t];
 
-static const char* getNodeColor(TreeNode *tree) {
     if (tree->nodekind == StmtK) {
-        switch (tree->kind.stmt) {
+        switch (tree->kind) {
         case FunDeclK: return "lightgreen";
         case IfK:
         case WhileK: return "lightyellow";
@@ -122,16 +151,18 @@ static const char* getNodeColor(TreeNode *tree) {
         default: return "lightblue";
         }
     } else if (tree->nodekind == ExpK) {
-        if (tree->kind.exp == OpK) return "orange";
-        if (tree->kind.exp == ConstK) return "white";
+        if (tree->kind == OpK) return "orange";
+        if (tree->kind == ConstK) return "white";
         return "lightcyan";
     }
     return "lightblue";
 }
 
-static const char* getNodeShape(TreeNode *tree) {
+static const char* getNodeShape(No t) {
+    NoAst *tree = &arvoreDot->nos[t];
+
     if (tree->nodekind == StmtK) {
-        switch (tree->kind.stmt) {
+        switch (tree->kind) {
         case FunDeclK:
         case VarDeclK:
         case ParamK: return "box";
@@ -140,16 +171,19 @@ static const char* getNodeShape(TreeNode *tree) {
         default: return "ellipse";
         }
     } else if (tree->nodekind == ExpK) {
-        if (tree->kind.exp == OpK) return "circle";
-        if (tree->kind.exp == ConstK) return "box";
+        if (tree->kind == OpK) return "circle";
+        if (tree->kind == ConstK) return "box";
         return "ellipse";
     }
     return "ellipse";
 }
 
+/* Nome escapado num rótulo do .dot (cortado se for maior que o buffer) */
+#define ROTULO_NOME 100
+
 static void escapeLabel(char *dest, const char *src, int maxLen) {
     int i = 0, j = 0;
-    while (src[i] != '\0' && j < maxLen - 1) {
+    while (src[i] != '\0' && j < maxLen - 2) {
         if (src[i] == '"') {
             dest[j++] = '\\';
             dest[j++] = '"';
@@ -167,16 +201,18 @@ static void escapeLabel(char *dest, const char *src, int maxLen) {
     dest[j] = '\0';
 }
 
-static void getNodeLabel(TreeNode *tree, char *label, int maxLen) {
-    char temp[100];
+static void getNodeLabel(No t, char *label, int maxLen) {
+    char temp[ROTULO_NOME];
 
-    if (tree == NULL) {
+    if (t == NENHUM) {
         snprintf(label, maxLen, "NULL");
         return;
     }
 
+    NoAst *tree = &arvoreDot->nos[t];
+
     if (tree->nodekind == StmtK) {
-        switch (tree->kind.stmt) {
+        switch (tree->kind) {
         case IfK:
             snprintf(label, maxLen, "if");
             break;
@@ -190,8 +226,8 @@ static void getNodeLabel(TreeNode *tree, char *label, int maxLen) {
             snprintf(label, maxLen, "return");
             break;
         case FunDeclK:
-            if (tree->attr.name != NULL) {
-                escapeLabel(temp, tree->attr.name, (int)sizeof(temp));
+            if (nomeNo(arvoreDot, t) != NULL) {
+                escapeLabel(temp, nomeNo(arvoreDot, t), (int)sizeof(temp));
                 snprintf(label, maxLen, "%s : %s", temp,
                          tree->type == Integer ? "int" : "void");
             } else {
@@ -200,10 +236,10 @@ static void getNodeLabel(TreeNode *tree, char *label, int maxLen) {
             }
             break;
         case VarDeclK:
-            if (tree->attr.name != NULL) {
-                escapeLabel(temp, tree->attr.name, (int)sizeof(temp));
+            if (nomeNo(arvoreDot, t) != NULL) {
+                escapeLabel(temp, nomeNo(arvoreDot, t), (int)sizeof(temp));
                 if (tree->type == IntegerArray)
-                    snprintf(label, maxLen, "int %s[%d]", temp, tree->arraySize);
+                    snprintf(label, maxLen, "int %s[%d]", temp, tamanhoArrayNo(arvoreDot, t));
                 else
                     snprintf(label, maxLen, "int %s", temp);
             } else {
@@ -211,8 +247,8 @@ static void getNodeLabel(TreeNode *tree, char *label, int maxLen) {
             }
             break;
         case ParamK:
-            if (tree->attr.name != NULL) {
-                escapeLabel(temp, tree->attr.name, (int)sizeof(temp));
+            if (nomeNo(arvoreDot, t) != NULL) {
+                escapeLabel(temp, nomeNo(arvoreDot, t), (int)sizeof(temp));
                 if (tree->type == IntegerArray)
                     snprintf(label, maxLen, "%s[]", temp);
                 else
@@ -222,8 +258,8 @@ static void getNodeLabel(TreeNode *tree, char *label, int maxLen) {
             }
             break;
         case CallK:
-            if (tree->attr.name != NULL) {
-                escapeLabel(temp, tree->attr.name, (int)sizeof(temp));
+            if (nomeNo(arvoreDot, t) != NULL) {
+                escapeLabel(temp, nomeNo(arvoreDot, t), (int)sizeof(temp));
                 snprintf(label, maxLen, "%s", temp);
             } else {
                 snprintf(label, maxLen, "call");
@@ -237,13 +273,14 @@ static void getNodeLabel(TreeNode *tree, char *label, int maxLen) {
             break;
         }
     } else if (tree->nodekind == ExpK) {
-        switch (tree->kind.exp) {
+        switch (tree->kind) {
         case OpK:
-            switch (tree->attr.op) {
+            switch (opNo(arvoreDot, t)) {
             case PLUS:  snprintf(label, maxLen, "+");  break;
             case MINUS: snprintf(label, maxLen, "-");  break;
             case TIMES: snprintf(label, maxLen, "*");  break;
             case OVER:  snprintf(label, maxLen, "/");  break;
+            case SHL:   snprintf(label, maxLen, "<<"); break;
             case LT:    snprintf(label, maxLen, "<");  break;
             case LE:    snprintf(label, maxLen, "<="); break;
             case GT:    snprintf(label, maxLen, ">");  break;
@@ -254,19 +291,19 @@ static void getNodeLabel(TreeNode *tree, char *label, int maxLen) {
             }
             break;
         case ConstK:
-            snprintf(label, maxLen, "%d", tree->attr.val);
+            snprintf(label, maxLen, "%d", valorNo(arvoreDot, t));
             break;
         case IdK:
-            if (tree->attr.name != NULL) {
-                escapeLabel(temp, tree->attr.name, (int)sizeof(temp));
+            if (nomeNo(arvoreDot, t) != NULL) {
+                escapeLabel(temp, nomeNo(arvoreDot, t), (int)sizeof(temp));
                 snprintf(label, maxLen, "%s", temp);
             } else {
                 snprintf(label, maxLen, "id");
             }
             break;
         case ArrIdK:
-            if (tree->attr.name != NULL) {
-                escapeLabel(temp, tree->attr.name, (int)sizeof(temp));
+            if (nomeNo(arvoreDot, t) != NULL) {
+                escapeLabel(temp, nomeNo(arvoreDot, t), (int)sizeof(temp));
                 snprintf(label, maxLen, "%s[]", temp);
             } else {
                 snprintf(label, maxLen, "arr");
@@ -282,11 +319,13 @@ static void getNodeLabel(TreeNode *tree, char *label, int maxLen) {
 }
 
 /* Rótulos das arestas para facilitar visualizar where is what */
-static const char* childEdgeLabel(TreeNode *parent, int idx) {
-    if (!parent) return "";
+static const char* childEdgeLabel(No p, int idx) {
+    if (p == NENHUM) return "";
+
+    NoAst *parent = &arvoreDot->nos[p];
 
     if (parent->nodekind == StmtK) {
-        switch (parent->kind.stmt) {
+        switch (parent->kind) {
         case IfK:
             if (idx == 0) return "cond";
             if (idx == 1) return "then";
@@ -314,10 +353,10 @@ static const char* childEdgeLabel(TreeNode *parent, int idx) {
             break;
         }
     } else if (parent->nodekind == ExpK) {
-        if (parent->kind.exp == OpK) {
+        if (parent->kind == OpK) {
             if (idx == 0) return "left";
             if (idx == 1) return "right";
-        } else if (parent->kind.exp == ArrIdK) {
+        } else if (parent->kind == ArrIdK) {
             if (idx == 0) return "index";
         }
     }
@@ -325,45 +364,94 @@ static const char* childEdgeLabel(TreeNode *parent, int idx) {
     return "";
 }
 
-static int printDotNode(TreeNode *tree) {
-    if (tree == NULL) return -1;
+static void printDotAresta(int de, int para, const char *elab) {
+    if (elab[0] != '\0') {
+        fprintf(dotFile, "  node%d -> node%d [label=\"%s\"];\n", de, para, elab);
+    } else {
+        fprintf(dotFile, "  node%d -> node%d;\n", de, para);
+    }
+}
 
+static int printDotNo(No tree) {
     int myId = nodeCounter++;
-    char label[100];
+    char label[ROTULO_NOME + 32];   /* o nome mais "int ", "[" e o tamanho */
 
     getNodeLabel(tree, label, (int)sizeof(label));
 
     fprintf(dotFile,
         "  node%d [label=\"%s\", shape=%s, style=filled, fillcolor=%s];\n",
         myId, label, getNodeShape(tree), getNodeColor(tree));
+    return myId;
+}
 
-    for (int i = 0; i < MAXCHILDREN; i++) {
-        if (tree->child[i] != NULL) {
-            int childId = printDotNode(tree->child[i]);
-            const char *elab = childEdgeLabel(tree, i);
+/* Nó da pilha de printDot: o próximo filho a visitar (nfilhos = o irmão) */
+typedef struct {
+    No no;
+    int id;
+    int proximo;
+} QuadroDot;
+
+/* Percorre a árvore em pré-ordem (nó, filhos, irmão) com uma pilha
+   explícita: listas longas de comandos não aprofundam a pilha de C. Cada
+   aresta sai depois da subárvore do seu destino, como no percurso
+   recursivo. */
+static void printDot(No raiz) {
+    QuadroDot *pilha;
+    int topo = 0;
+
+    if (raiz == NENHUM) return;
+    /* cada nó entra na pilha uma vez */
+    pilha = (QuadroDot *)malloc(arvoreDot->nnos * sizeof(QuadroDot));
+    if (pilha == NULL) {
+        fprintf(stderr, "Erro: sem memoria\n");
+        abortarSessao(CM_ERRO_MEMORIA);
+    }
+    pilha[0].no = raiz;
+    pilha[0].id = printDotNo(raiz);
+    pilha[0].proximo = 0;
+
+    while (topo >= 0) {
+        QuadroDot *q = &pilha[topo];
+        NoAst *n = &arvoreDot->nos[q->no];
+        No prox = NENHUM;
+
+        /* próximo filho não nulo, ou o irmão */
+        while (q->proximo < n->nfilhos && prox == NENHUM)
+            prox = filhoNo(arvoreDot, q->no, q->proximo++);
+        if (prox == NENHUM && q->proximo == n->nfilhos) {
+            prox = n->sibling;
+            q->proximo++;
+        }
 
-            if (elab[0] != '\0') {
-                fprintf(dotFile, "  node%d -> node%d [label=\"%s\"];\n", myId, childId, elab);
-            } else {
-                fprintf(dotFile, "  node%d -> node%d;\n", myId, childId);
-            }
+        if (prox != NENHUM) {
+            topo++;
+            pilha[topo].no = prox;
+            pilha[topo].id = printDotNo(prox);
+            pilha[topo].proximo = 0;
+            continue;
         }
-    }
 
-    /* irmãos como lista encadeada (next) */
-    if (tree->sibling != NULL) {
-        int sibId = printDotNode(tree->sibling);
-        fprintf(dotFile, "  node%d -> node%d [style=dashed, label=\"next\"];\n", myId, sibId);
+        /* subárvore concluída: a aresta que chega a ela */
+        if (topo > 0) {
+            QuadroDot *pai = &pilha[topo - 1];
+            if (pai->proximo > arvoreDot->nos[pai->no].nfilhos)
+                fprintf(dotFile, "  node%d -> node%d [style=dashed, label=\"next\"];\n",
+                        pai->id, q->id);
+            else
+                printDotAresta(pai->id, q->id, childEdgeLabel(pai->no, pai->proximo - 1));
+        }
+        topo--;
     }
-
-    return myId;
+    free(pilha);
 }
 
-void printTreeDot(TreeNode *tree, const char *dotFilename, const char *pngFilename) {
+void printTreeDot(ArvoreCompacta *arvore, const char *dotFilename, const char *pngFilename) {
     FILE *f = NULL;
 
-    fprintf(listing, "\n=== GERACAO DO ARQUIVO .DOT ===\n");
-    fprintf(listing, "Criando: %s\n", dotFilename);
+    if (!Silencioso) {
+        fprintf(listing, "\n=== GERACAO DO ARQUIVO .DOT ===\n");
+        fprintf(listing, "Criando: %s\n", dotFilename);
+    }
 
     f = fopen(dotFilename, "w");
 
@@ -373,8 +461,10 @@ void printTreeDot(TreeNode *tree, const char *dotFilename, const char *pngFilena
         return;
     }
 
-    fprintf(listing, "Arquivo criado com sucesso!\n");
+    if (!Silencioso) fprintf(listing, "Arquivo criado com sucesso!\n");
 
+    /* um buffer grande: poucas escritas mesmo para árvores grandes */
+    setvbuf(f, NULL, _IOFBF, BUFFER_DOT);
     dotFile = f;
 
     fprintf(dotFile, "digraph AST {\n");
@@ -383,21 +473,24 @@ void printTreeDot(TreeNode *tree, const char *dotFilename, const char *pngFilena
     fprintf(dotFile, "  edge [color=black, penwidth=1.5];\n\n");
 
     nodeCounter = 0;
-    printDotNode(tree);
+    arvoreDot = arvore;
+    printDot(arvore->raiz);
 
     fprintf(dotFile, "}\n");
     fclose(dotFile);
 
-    fprintf(listing, "\n=== ARQUIVO .DOT GERADO ===\n");
-    fprintf(listing, "Arquivo DOT: %s\n", dotFilename);
-
-    fprintf(listing, "\nGerando PNG...\n");
-    char cmd[512];
-    snprintf(cmd, (int)sizeof(cmd), "dot -Tpng \"%s\" -o \"%s\" 2>nul", dotFilename, pngFilename);
-    int ret = system(cmd);
+    if (!Silencioso) {
+        fprintf(listing, "\n=== ARQUIVO .DOT GERADO ===\n");
+        fprintf(listing, "Arquivo DOT: %s\n", dotFilename);
+    }
 
-    if (ret == 0) {
-        fprintf(listing, "Arquivo PNG gerado: %s\n\n", pngFilename);
+    /* PNG só quando pedido, sem esperar pelo Graphviz */
+    if (pngFilename == NULL) {
+        if (!Silencioso) fprintf(listing, "\n");
+        return;
+    }
+    if (iniciarPng(dotFilename, pngFilename) == 0) {
+        if (!Silencioso) fprintf(listing, "\nGerando PNG em segundo plano: %s\n\n", pngFilename);
     } else {
         fprintf(listing, "Aviso: Nao foi possivel gerar PNG automaticamente\n");
         fprintf(listing, "\nPara gerar manualmente, execute:\n");
@@ -409,4 +502,141 @@ void printTreeDot(TreeNode *tree, const char *dotFilename, const char *pngFilena
         fprintf(listing, "  2. Adicione ao PATH: C:\\Program Files\\Graphviz\\bin\n");
         fprintf(listing, "  3. Reinicie o terminal e execute o comando acima\n\n");
     }
-}
\ No newline at end of file
+}
+
+/* ---------------------- PNG (Graphviz) ---------------------- */
+
+#ifndef _WIN32
+
+/* Processos dot em andamento, de todas as sessões do processo */
+typedef struct {
+    pid_t pid;
+    char *png;
+} Renderizacao;
+
+static pthread_mutex_t travaPng = PTHREAD_MUTEX_INITIALIZER;
+static Renderizacao *renderizacoes = NULL;
+static int nRenderizacoes = 0;
+static int capRenderizacoes = 0;
+
+/* dot -Tpng sem shell, com a saída descartada */
+static int iniciarPng(const char *dotFilename, const char *pngFilename) {
+    char *argv[] = {"dot", "-Tpng", (char *)dotFilename, "-o", (char *)pngFilename, NULL};
+    posix_spawn_file_actions_t acoes;
+    Renderizacao r;
+    int erro;
+
+    r.png = strdup(pngFilename);
+    if (r.png == NULL) return -1;
+    posix_spawn_file_actions_init(&acoes);
+    posix_spawn_file_actions_addopen(&acoes, 1, "/dev/null", O_WRONLY, 0);
+    posix_spawn_file_actions_addopen(&acoes, 2, "/dev/null", O_WRONLY, 0);
+    erro = posix_spawnp(&r.pid, "dot", &acoes, NULL, argv, environ);
+    posix_spawn_file_actions_destroy(&acoes);
+    if (erro != 0) {
+        free(r.png);
+        return -1;
+    }
+
+    pthread_mutex_lock(&travaPng);
+    if (nRenderizacoes == capRenderizacoes) {
+        int cap = capRenderizacoes ? capRenderizacoes * 2 : 16;
+        Renderizacao *v = (Renderizacao *)realloc(renderizacoes, cap * sizeof(Renderizacao));
+        if (v == NULL) {
+            pthread_mutex_unlock(&travaPng);
+            fprintf(stderr, "Erro: sem memoria\n");
+            exit(1);
+        }
+        renderizacoes = v;
+        capRenderizacoes = cap;
+    }
+    renderizacoes[nRenderizacoes++] = r;
+    pthread_mutex_unlock(&travaPng);
+    return 0;
+}
+
+int esperarPngs(FILE *erros) {
+    int falhas = 0;
+
+    pthread_mutex_lock(&travaPng);
+    for (int i = 0; i < nRenderizacoes; i++) {
+        int status;
+        if (waitpid(renderizacoes[i].pid, &status, 0) < 0 ||
+            !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            fprintf(erros, "Aviso: Nao foi possivel gerar %s\n", renderizacoes[i].png);
+            falhas++;
+        }
+        free(renderizacoes[i].png);
+    }
+    nRenderizacoes = 0;
+    pthread_mutex_unlock(&travaPng);
+    return falhas;
+}
+
+#else
+
+/* Sem posix_spawn: o dot roda na hora */
+static int iniciarPng(const char *dotFilename, const char *pngFilename) {
+    char cmd[512];
+    snprintf(cmd, (int)sizeof(cmd), "dot -Tpng \"%s\" -o \"%s\" 2>nul", dotFilename, pngFilename);
+    return system(cmd) == 0 ? 0 : -1;
+}
+
+int esperarPngs(FILE *erros) {
+    (void)erros;
+    return 0;
+}
+
+#endif
+
+/* ---------------------- Saída em memória ---------------------- */
+
+#ifndef _WIN32
+
+FILE *abrirMemoria(char **texto, size_t *tam) {
+    *texto = NULL;
+    *tam = 0;
+    return open_memstream(texto, tam);
+}
+
+/* o fclose atualiza *texto e *tam, os mesmos dados a open_memstream */
+int fecharMemoria(FILE *f, char **texto, size_t *tam) {
+    if (fclose(f) != 0 || *texto == NULL) {
+        free(*texto);
+        *texto = NULL;
+        *tam = 0;
+        return -1;
+    }
+    return 0;
+}
+
+#else
+
+FILE *abrirMemoria(char **texto, size_t *tam) {
+    *texto = NULL;
+    *tam = 0;
+    return tmpfile();
+}
+
+int fecharMemoria(FILE *f, char **texto, size_t *tam) {
+    long n = 0;
+    int ok = fseek(f, 0, SEEK_END) == 0 && (n = ftell(f)) >= 0;
+
+    if (ok) {
+        *texto = (char *)malloc((size_t)n + 1);
+        rewind(f);
+        ok = *texto != NULL && fread(*texto, 1, (size_t)n, f) == (size_t)n;
+    }
+    fclose(f);
+    if (!ok) {
+        free(*texto);
+        *texto = NULL;
+        *tam = 0;
+        return -1;
+    }
+    (*texto)[n] = '\0';
+    *tam = (size_t)n;
+    return 0;
+}
+
+#endif
@@ -5,9 +5,12 @@
 #define UTIL_H
 
 #include "globals.h"
+#include "ast.h"
 
-/* Imprime token */
-void printToken(TokenType token, const char *tokenString);
+/* Imprime token (lexema dado como fatia de n caracteres) */
+void printToken(FILE *saida, TokenType token, const char *tokenString, int n);
+
+/* Nós e strings são alocados na arena da compilação (arena.h) */
 
 /* Cria novo nó de comando */
 TreeNode *newStmtNode(StmtKind kind);
@@ -18,7 +21,22 @@ TreeNode *newExpNode(ExpKind kind);
 /* Copia string alocando memória */
 char *copyString(char *s);
 
-/* Imprime árvore em formato DOT */
-void printTreeDot(TreeNode *tree, const char *dotFilename, const char *pngFilename);
+/* Copia os n primeiros caracteres de s, terminando com '\0' */
+char *copyStringN(const char *s, int n);
+
+/* Imprime árvore em formato DOT. Com pngFilename, o Graphviz gera o PNG
+   em segundo plano (no Windows, na hora) */
+void printTreeDot(ArvoreCompacta *arvore, const char *dotFilename, const char *pngFilename);
+
+/* Espera os PNGs em geração; devolve quantos falharam, avisando em erros */
+int esperarPngs(FILE *erros);
+
+/* Arquivo de saída em memória: open_memstream; no Windows, que não o
+   tem, um tmpfile() lido de volta no fechamento. NULL sem memória. */
+FILE *abrirMemoria(char **texto, size_t *tam);
+
+/* Fecha f e devolve em *texto (liberar com free) e *tam o que foi
+   escrito; -1 se faltou memória (*texto fica NULL) */
+int fecharMemoria(FILE *f, char **texto, size_t *tam);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,178 @@
+/* Vida dos temporários e reaproveitamento dos seus números (vida.c) */
+
+#include "globals.h"
+#include "vida.h"
+#include "arena.h"
+
+#include <string.h>
+
+#define BITS 64
+
+static int lido(const Quad *q, Operando o) {
+    return leOperandos((OpIR)q->op) && o.tipo == OPR_TEMP;
+}
+
+static int definido(const Quad *q) {
+    return defineR((OpIR)q->op) && q->r.tipo == OPR_TEMP;
+}
+
+/* Conjuntos de temporários: nblocos vetores de palavras de 64 bits */
+static uint64_t *conjuntos(int nblocos, int palavras) {
+    return (uint64_t *)arenaAlloc((size_t)nblocos * palavras * sizeof(uint64_t) + 1);
+}
+
+static void cobrir(Intervalo *iv, int32_t t, uint32_t pos) {
+    if (pos < iv[t].inicio) iv[t].inicio = pos;
+    if (pos > iv[t].fim) iv[t].fim = pos;
+}
+
+int palavrasVida(const CodigoIR *c) {
+    return (c->ntemps + BITS - 1) / BITS;
+}
+
+/* Vivos na entrada e na saída de cada bloco */
+static void analisarVida(const CodigoIR *c, const FuncaoCfg *f, uint64_t **vivosEntrada, uint64_t **vivosSaida) {
+    int palavras = palavrasVida(c);
+    uint64_t *usa = conjuntos(f->nblocos, palavras);
+    uint64_t *define = conjuntos(f->nblocos, palavras);
+    uint64_t *entrada = conjuntos(f->nblocos, palavras);
+    uint64_t *saida = conjuntos(f->nblocos, palavras);
+    int mudou = TRUE;
+
+    /* lidos antes de definidos e definidos em cada bloco */
+    for (int b = 0; b < f->nblocos; b++) {
+        uint64_t *u = &usa[(size_t)b * palavras], *d = &define[(size_t)b * palavras];
+
+        for (uint32_t i = f->blocos[b].inicio; i < f->blocos[b].fim; i++) {
+            const Quad *q = &c->quads[i];
+            if (lido(q, q->a) && !(d[q->a.v / BITS] >> (q->a.v % BITS) & 1))
+                u[q->a.v / BITS] |= 1ull << (q->a.v % BITS);
+            if (lido(q, q->b) && !(d[q->b.v / BITS] >> (q->b.v % BITS) & 1))
+                u[q->b.v / BITS] |= 1ull << (q->b.v % BITS);
+            if (definido(q)) d[q->r.v / BITS] |= 1ull << (q->r.v % BITS);
+        }
+    }
+
+    /* saida(b) = união das entradas dos sucessores;
+       entrada(b) = usa(b) + (saida(b) - define(b)) */
+    while (mudou) {
+        mudou = FALSE;
+        for (int b = f->nblocos - 1; b >= 0; b--) {
+            const BlocoBasico *bb = &f->blocos[b];
+            uint64_t *out = &saida[(size_t)b * palavras], *in = &entrada[(size_t)b * palavras];
+            const uint64_t *u = &usa[(size_t)b * palavras], *d = &define[(size_t)b * palavras];
+
+            for (int k = 0; k < bb->nsucc; k++) {
+                const uint64_t *s = &entrada[(size_t)bb->succ[k] * palavras];
+                for (int w = 0; w < palavras; w++) out[w] |= s[w];
+            }
+            for (int w = 0; w < palavras; w++) {
+                uint64_t novo = u[w] | (out[w] & ~d[w]);
+                if (novo != in[w]) {
+                    in[w] = novo;
+                    mudou = TRUE;
+                }
+            }
+        }
+    }
+    *vivosEntrada = entrada;
+    *vivosSaida = saida;
+}
+
+uint64_t *vivosNaSaida(const CodigoIR *c, const FuncaoCfg *f) {
+    uint64_t *entrada, *saida;
+
+    analisarVida(c, f, &entrada, &saida);
+    return saida;
+}
+
+Intervalo *intervalosDeVida(const CodigoIR *c, const FuncaoCfg *f) {
+    int palavras = palavrasVida(c);
+    uint64_t *entrada, *saida;
+    Intervalo *iv = (Intervalo *)arenaAlloc((c->ntemps + 1) * sizeof(Intervalo));
+
+    analisarVida(c, f, &entrada, &saida);
+    for (int32_t t = 0; t < c->ntemps; t++) {
+        iv[t].inicio = UINT32_MAX;
+        iv[t].fim = 0;
+    }
+    for (int b = 0; b < f->nblocos; b++) {
+        const BlocoBasico *bb = &f->blocos[b];
+        const uint64_t *in = &entrada[(size_t)b * palavras], *out = &saida[(size_t)b * palavras];
+
+        if (bb->fim == bb->inicio) continue;
+        for (int w = 0; w < palavras; w++) {
+            for (uint64_t m = in[w]; m != 0; m &= m - 1) cobrir(iv, w * BITS + __builtin_ctzll(m), bb->inicio);
+            for (uint64_t m = out[w]; m != 0; m &= m - 1) cobrir(iv, w * BITS + __builtin_ctzll(m), bb->fim - 1);
+        }
+        for (uint32_t i = bb->inicio; i < bb->fim; i++) {
+            const Quad *q = &c->quads[i];
+            if (lido(q, q->a)) cobrir(iv, q->a.v, i);
+            if (lido(q, q->b)) cobrir(iv, q->b.v, i);
+            if (definido(q)) cobrir(iv, q->r.v, i);
+        }
+    }
+    return iv;
+}
+
+/* Número livre para t, que começa em s: o de um temporário que já morreu
+   ou, se a quádrupla s define t, o de um que é lido ali pela última vez */
+static int32_t escolherNumero(const int32_t *fimDoNumero, int32_t nnumeros, uint32_t s, int define) {
+    for (int32_t k = 0; k < nnumeros; k++) {
+        uint32_t fim = (uint32_t)fimDoNumero[k];
+        if (fim < s || (define && fim == s)) return k;
+    }
+    return -1;
+}
+
+void reciclarTemporarios(CodigoIR *c) {
+    GrafoFluxo *g;
+    Intervalo *iv;
+    int32_t *ordem, *inicioPos, *numero, *fimDoNumero;
+    int32_t nnumeros = 0, n = 0;
+
+    if (c->ntemps == 0) return;
+    g = construirCfg(c);
+    iv = intervalosDeVida(c, &g->funcoes[0]);
+
+    /* temporários em ordem de início (contagem por posição) */
+    ordem = (int32_t *)arenaAlloc((c->ntemps + 1) * sizeof(int32_t));
+    inicioPos = (int32_t *)arenaAlloc((c->n + 2) * sizeof(int32_t));
+    for (int32_t t = 0; t < c->ntemps; t++)
+        if (iv[t].inicio <= iv[t].fim) inicioPos[iv[t].inicio + 1]++;
+    for (uint32_t i = 0; i < c->n; i++) inicioPos[i + 1] += inicioPos[i];
+    for (int32_t t = 0; t < c->ntemps; t++)
+        if (iv[t].inicio <= iv[t].fim) ordem[inicioPos[iv[t].inicio]++] = t;
+    for (int32_t t = 0; t < c->ntemps; t++) n += iv[t].inicio <= iv[t].fim;
+
+    numero = (int32_t *)arenaAlloc((c->ntemps + 1) * sizeof(int32_t));
+    fimDoNumero = (int32_t *)arenaAlloc((c->ntemps + 1) * sizeof(int32_t));
+    for (int32_t k = 0; k < n; k++) {
+        int32_t t = ordem[k];
+        uint32_t s = iv[t].inicio;
+        const Quad *q = &c->quads[s];
+        int define = definido(q) && q->r.v == t;
+        int32_t escolhido = -1;
+
+        /* r = a com a morrendo: r fica com o número de a */
+        if (define && q->op == IR_COPY && q->a.tipo == OPR_TEMP && q->a.v != t &&
+            iv[q->a.v].fim == s && fimDoNumero[numero[q->a.v]] == (int32_t)s)
+            escolhido = numero[q->a.v];
+        if (escolhido < 0) escolhido = escolherNumero(fimDoNumero, nnumeros, s, define);
+        if (escolhido < 0) escolhido = nnumeros++;
+        numero[t] = escolhido;
+        fimDoNumero[escolhido] = (int32_t)iv[t].fim;
+    }
+
+    for (uint32_t i = 0; i < c->n; i++) {
+        Quad *q = &c->quads[i];
+        Operando *o[3] = {&q->r, &q->a, &q->b};
+
+        for (int j = 0; j < 3; j++)
+            if (o[j]->tipo == OPR_TEMP) o[j]->v = numero[o[j]->v];
+        if (q->op == IR_COPY && q->r.tipo == OPR_TEMP && q->a.tipo == OPR_TEMP && q->r.v == q->a.v)
+            q->op = IR_NOP;
+    }
+    c->ntemps = nnumeros;
+    irCompactar(c);
+}
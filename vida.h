@@ -0,0 +1,41 @@
+/* vida.h - Vida dos temporários e reaproveitamento dos seus números */
+
+#ifndef VIDA_H
+#define VIDA_H
+
+#include "globals.h"
+#include "ir.h"
+#include "cfg.h"
+
+/*
+ * Um temporário está vivo entre uma definição e as leituras que ela
+ * alcança. A vivência na entrada e na saída de cada bloco vem da análise
+ * iterativa para trás sobre o grafo (laços incluídos); o intervalo de um
+ * temporário vai da primeira à última quádrupla em que ele está vivo,
+ * com os buracos preenchidos. Dois temporários com intervalos disjuntos
+ * podem ter o mesmo número.
+ */
+
+typedef struct {
+    uint32_t inicio, fim;    /* quádruplas [inicio, fim]; inicio > fim se não aparece */
+} Intervalo;
+
+/* Palavras de 64 bits de um conjunto de temporários de c */
+int palavrasVida(const CodigoIR *c);
+
+/* Temporários vivos na saída de cada bloco de f, uma função de c: o
+   conjunto do bloco b começa na palavra b * palavrasVida(c) (memória da
+   arena) */
+uint64_t *vivosNaSaida(const CodigoIR *c, const FuncaoCfg *f);
+
+/* Intervalo de cada temporário de trecho, que contém uma única função
+   com o grafo f (memória da arena) */
+Intervalo *intervalosDeVida(const CodigoIR *trecho, const FuncaoCfg *f);
+
+/* Renumera os temporários de trecho (uma função) por varredura linear dos
+   intervalos: um número volta a ser usado quando o temporário que o tinha
+   morre. Numa cópia r = a em que a morre, r fica com o número de a e a
+   cópia sai. */
+void reciclarTemporarios(CodigoIR *trecho);
+
+#endif
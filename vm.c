@@ -0,0 +1,664 @@
+/* Bytecode de registradores e máquina virtual (vm.c) */
+
+#include "globals.h"
+#include "vm.h"
+#include "interp.h"
+#include "arena.h"
+
+#include <string.h>
+
+#if defined(__GNUC__)
+#define VM_COMPUTADO    /* goto computado (labels as values) */
+#endif
+
+#define MAX_REGISTRADOR ((int64_t)1 << 24)      /* registrador na primeira palavra */
+#define SEM_POSICAO     UINT32_MAX
+
+#define BC_TAMANHO(nome, palavras) palavras,
+static const uint8_t tamanhos[BC_NOPS] = { BC_INSTRUCOES(BC_TAMANHO) };
+#undef BC_TAMANHO
+
+#define BC_NOME(nome, palavras) #nome,
+static const char *const nomes[BC_NOPS] = { BC_INSTRUCOES(BC_NOME) };
+#undef BC_NOME
+
+int bcTamanho(OpBytecode op) {
+    return tamanhos[op];
+}
+
+const char *bcNome(OpBytecode op) {
+    return nomes[op];
+}
+
+/* ---------------------- Montagem ---------------------- */
+
+/* Onde fica cada variável (por memloc) */
+#define LUGAR_GLOBAL       0   /* escalar global: endereço */
+#define LUGAR_ARRAY_GLOBAL 1   /* endereço e tamanho */
+#define LUGAR_REGISTRADOR  2   /* escalar da função (parâmetro ou local) */
+#define LUGAR_ARRAY_LOCAL  3   /* primeiro registrador e tamanho */
+#define LUGAR_ARRAY_PARAM  4   /* registradores do endereço e do tamanho */
+
+/* Funções embutidas no campo funcao */
+#define FUNCAO_INPUT  (-2)
+#define FUNCAO_OUTPUT (-3)
+
+typedef struct {
+    uint8_t tipo;
+    int32_t pos;
+    int32_t tamanho;
+} Lugar;
+
+typedef struct {
+    const CodigoIR *c;
+    Lugar *lugar;            /* por memloc */
+    int32_t *funcao;         /* por memloc: índice na tabela, ou -1 */
+    int32_t *temp;           /* por temporário: registrador na função corrente */
+    uint32_t *vistoEm;       /* por temporário: 1 + a função em que foi visto */
+    uint32_t *codigo;        /* código, sem cabeçalho nem tabela */
+    uint32_t n, capacidade;
+    uint32_t *rotulo;        /* por label: posição no código */
+    uint32_t *desvios;       /* palavras com um label a trocar pela posição */
+    uint32_t ndesvios, capacidadeDesvios;
+    int32_t rascunho[3];     /* registradores de rascunho da função */
+    int32_t saida;           /* primeiro registrador da área dos argumentos */
+    uint8_t *args;           /* registradores de cada argumento pendente */
+    int nargs;
+    int32_t pendentes, maxPendentes;
+    int grande;              /* um registrador não coube na primeira palavra */
+} Montagem;
+
+/* Vetor da arena que dobra de tamanho, como o de quádruplas (ir.c) */
+static uint32_t *crescerVetor(uint32_t *v, uint32_t n, uint32_t *capacidade) {
+    uint32_t cap = *capacidade ? *capacidade * 2 : 256;
+    uint32_t *novo = (uint32_t *)arenaAlloc(cap * sizeof(uint32_t));
+
+    if (n > 0) memcpy(novo, v, n * sizeof(uint32_t));
+    *capacidade = cap;
+    return novo;
+}
+
+static void palavra(Montagem *g, uint32_t w) {
+    if (g->n == g->capacidade) g->codigo = crescerVetor(g->codigo, g->n, &g->capacidade);
+    g->codigo[g->n++] = w;
+}
+
+static void instrucao(Montagem *g, OpBytecode op, int32_t r) {
+    if (r < 0 || r >= MAX_REGISTRADOR) {
+        g->grande = TRUE;
+        r = 0;
+    }
+    palavra(g, (uint32_t)op | ((uint32_t)r << 8));
+}
+
+static void desvio(Montagem *g, int32_t label) {
+    if (g->ndesvios == g->capacidadeDesvios)
+        g->desvios = crescerVetor(g->desvios, g->ndesvios, &g->capacidadeDesvios);
+    g->desvios[g->ndesvios++] = g->n;
+    palavra(g, (uint32_t)label);
+}
+
+static const Lugar *lugarDe(const Montagem *g, Operando o) {
+    return &g->lugar[o.v];
+}
+
+/* Registrador com o valor de o; globais e constantes passam pelo
+   registrador de rascunho */
+static int32_t valor(Montagem *g, Operando o, int32_t rascunho) {
+    const Lugar *l;
+
+    if (o.tipo == OPR_TEMP) return g->temp[o.v];
+    if (o.tipo == OPR_CONST) {
+        instrucao(g, BC_MOVK, rascunho);
+        palavra(g, (uint32_t)o.v);
+        return rascunho;
+    }
+    l = lugarDe(g, o);
+    if (l->tipo == LUGAR_REGISTRADOR) return l->pos;
+    instrucao(g, BC_GETG, rascunho);
+    palavra(g, (uint32_t)l->pos);
+    return rascunho;
+}
+
+/* Registrador que recebe o resultado de uma operação em o */
+static int32_t destino(Montagem *g, Operando o) {
+    if (o.tipo == OPR_TEMP) return g->temp[o.v];
+    if (o.tipo == OPR_VAR && lugarDe(g, o)->tipo == LUGAR_REGISTRADOR) return lugarDe(g, o)->pos;
+    return g->rascunho[2];
+}
+
+/* Completa a escrita em o de um resultado deixado em r */
+static void gravar(Montagem *g, Operando o, int32_t r) {
+    if (o.tipo == OPR_VAR && lugarDe(g, o)->tipo == LUGAR_GLOBAL) {
+        instrucao(g, BC_SETG, r);
+        palavra(g, (uint32_t)lugarDe(g, o)->pos);
+    }
+}
+
+static void copiar(Montagem *g, const Quad *q) {
+    int32_t d;
+
+    if (q->r.tipo == OPR_VAR && lugarDe(g, q->r)->tipo == LUGAR_GLOBAL) {
+        gravar(g, q->r, valor(g, q->a, g->rascunho[0]));
+        return;
+    }
+    d = destino(g, q->r);
+    if (q->a.tipo == OPR_CONST || (q->a.tipo == OPR_VAR && lugarDe(g, q->a)->tipo == LUGAR_GLOBAL)) {
+        valor(g, q->a, d);
+    } else {
+        int32_t x = valor(g, q->a, d);
+        if (x != d) {
+            instrucao(g, BC_MOV, d);
+            palavra(g, (uint32_t)x);
+        }
+    }
+}
+
+/* a op b com a constante à esquerda: a mesma operação com os operandos
+   trocados, ou -1 */
+static int trocada(OpIR op) {
+    switch (op) {
+    case IR_ADD: case IR_MUL: case IR_EQ: case IR_NE: return op;
+    case IR_LT: return IR_GT;
+    case IR_GT: return IR_LT;
+    case IR_LE: return IR_GE;
+    case IR_GE: return IR_LE;
+    default: return -1;
+    }
+}
+
+static void operacao(Montagem *g, const Quad *q) {
+    OpIR op = (OpIR)q->op;
+    Operando a = q->a, b = q->b;
+    int32_t d = destino(g, q->r), x, y;
+
+    if (a.tipo == OPR_CONST && b.tipo != OPR_CONST && trocada(op) >= 0) {
+        op = (OpIR)trocada(op);
+        a = q->b;
+        b = q->a;
+    }
+    x = valor(g, a, g->rascunho[0]);
+    if (b.tipo == OPR_CONST) {
+        instrucao(g, (OpBytecode)(BC_ADDK + (op - IR_ADD)), d);
+        palavra(g, (uint32_t)x);
+        palavra(g, (uint32_t)b.v);
+    } else {
+        y = valor(g, b, g->rascunho[1]);
+        instrucao(g, (OpBytecode)(BC_ADD + (op - IR_ADD)), d);
+        palavra(g, (uint32_t)x);
+        palavra(g, (uint32_t)y);
+    }
+    gravar(g, q->r, d);
+}
+
+/* r = a[i] (BC_LDL) ou a[i] = r (BC_STL) */
+static void acessar(Montagem *g, OpBytecode local, Operando array, int32_t r, int32_t i) {
+    const Lugar *l = lugarDe(g, array);
+
+    if (l->tipo == LUGAR_ARRAY_PARAM) {
+        instrucao(g, (OpBytecode)(local + (BC_LDP - BC_LDL)), r);
+        palavra(g, (uint32_t)l->pos);
+    } else {
+        instrucao(g, l->tipo == LUGAR_ARRAY_LOCAL ? local : (OpBytecode)(local + (BC_LDG - BC_LDL)), r);
+        palavra(g, (uint32_t)l->pos);
+        palavra(g, (uint32_t)l->tamanho);
+    }
+    palavra(g, (uint32_t)i);
+}
+
+/* param a: uma cópia para o registrador do parâmetro, logo acima dos
+   argumentos ainda pendentes */
+static void argumento(Montagem *g, Operando a) {
+    int32_t r = g->saida + g->pendentes;
+    int k = 1;
+
+    if (a.tipo == OPR_VAR && lugarDe(g, a)->tipo != LUGAR_GLOBAL && lugarDe(g, a)->tipo != LUGAR_REGISTRADOR) {
+        const Lugar *l = lugarDe(g, a);
+
+        if (l->tipo == LUGAR_ARRAY_PARAM) {
+            instrucao(g, BC_MOV, r);
+            palavra(g, (uint32_t)l->pos);
+            instrucao(g, BC_MOV, r + 1);
+            palavra(g, (uint32_t)l->pos + 1);
+        } else {
+            instrucao(g, l->tipo == LUGAR_ARRAY_LOCAL ? BC_ADDR : BC_MOVK, r);
+            palavra(g, (uint32_t)l->pos);
+            instrucao(g, BC_MOVK, r + 1);
+            palavra(g, (uint32_t)l->tamanho);
+        }
+        k = 2;
+    } else {
+        int32_t x = valor(g, a, r);
+        if (x != r) {
+            instrucao(g, BC_MOV, r);
+            palavra(g, (uint32_t)x);
+        }
+    }
+    g->args[g->nargs++] = (uint8_t)k;
+    g->pendentes += k;
+    if (g->pendentes > g->maxPendentes) g->maxPendentes = g->pendentes;
+}
+
+/* r = call f com n argumentos: o quadro de f começa no primeiro deles */
+static void chamada(Montagem *g, const Quad *q) {
+    int32_t f = g->funcao[q->a.v], base, d;
+
+    for (int k = 0; k < q->b.v && g->nargs > 0; k++) g->pendentes -= g->args[--g->nargs];
+    base = g->saida + g->pendentes;
+    if (f == FUNCAO_OUTPUT) {
+        instrucao(g, BC_OUT, base);
+        return;
+    }
+    d = destino(g, q->r);
+    if (f == FUNCAO_INPUT) {
+        instrucao(g, BC_IN, d);
+    } else {
+        instrucao(g, BC_CALL, d);
+        palavra(g, (uint32_t)f);
+        palavra(g, (uint32_t)base);
+    }
+    gravar(g, q->r, d);
+}
+
+static void retorno(Montagem *g, Operando a) {
+    if (a.tipo == OPR_NADA || a.tipo == OPR_CONST) {
+        instrucao(g, BC_RETK, 0);
+        palavra(g, (uint32_t)(a.tipo == OPR_CONST ? a.v : 0));
+    } else {
+        instrucao(g, BC_RET, valor(g, a, g->rascunho[0]));
+    }
+}
+
+static void montarQuad(Montagem *g, const Quad *q) {
+    switch ((OpIR)q->op) {
+    case IR_LABEL:
+        g->rotulo[q->a.v] = g->n;
+        break;
+    case IR_GOTO:
+        instrucao(g, BC_JMP, 0);
+        desvio(g, q->a.v);
+        break;
+    case IR_IFFALSE:
+        if (q->a.tipo == OPR_CONST) {
+            if (q->a.v != 0) break;
+            instrucao(g, BC_JMP, 0);
+        } else {
+            instrucao(g, BC_JZ, valor(g, q->a, g->rascunho[0]));
+        }
+        desvio(g, q->b.v);
+        break;
+    case IR_COPY:
+        copiar(g, q);
+        break;
+    case IR_ADD: case IR_SUB: case IR_MUL: case IR_DIV: case IR_SHL:
+    case IR_LT: case IR_LE: case IR_GT: case IR_GE: case IR_EQ: case IR_NE:
+        operacao(g, q);
+        break;
+    case IR_LOAD: {
+        int32_t d = destino(g, q->r);
+        acessar(g, BC_LDL, q->a, d, valor(g, q->b, g->rascunho[1]));
+        gravar(g, q->r, d);
+        break;
+    }
+    case IR_STORE: {
+        int32_t i = valor(g, q->a, g->rascunho[0]);
+        acessar(g, BC_STL, q->r, valor(g, q->b, g->rascunho[1]), i);
+        break;
+    }
+    case IR_ARG:
+        argumento(g, q->a);
+        break;
+    case IR_CALL:
+        chamada(g, q);
+        break;
+    case IR_RETURN:
+        retorno(g, q->a);
+        break;
+    case IR_ENDFUNC:
+        retorno(g, NADA);
+        break;
+    default:
+        break;              /* func, param e var: o quadro já está montado */
+    }
+}
+
+static void temporario(Montagem *g, Operando o, uint32_t funcao, int32_t *reg) {
+    if (o.tipo != OPR_TEMP || g->vistoEm[o.v] == funcao + 1) return;
+    g->vistoEm[o.v] = funcao + 1;
+    g->temp[o.v] = (*reg)++;
+}
+
+/* Quadro da função nas quádruplas [i, fim): parâmetros, escalares,
+   temporários, rascunho, arrays e argumentos; preenche a entrada da
+   tabela */
+static void montarFuncao(Montagem *g, uint32_t i, uint32_t fim, uint32_t funcao, uint32_t *entrada) {
+    const Quad *quads = g->c->quads;
+    int64_t reg = 0;
+    int32_t r32;
+    uint32_t parametros;
+
+    for (uint32_t k = i + 1; k < fim && quads[k].op == IR_PARAM; k++) {
+        Lugar *l = &g->lugar[quads[k].a.v];
+        l->tipo = quads[k].b.v ? LUGAR_ARRAY_PARAM : LUGAR_REGISTRADOR;
+        l->pos = (int32_t)reg;
+        reg += quads[k].b.v ? 2 : 1;
+    }
+    parametros = (uint32_t)reg;
+    for (uint32_t k = i; k < fim; k++) {
+        if (quads[k].op == IR_VAR && quads[k].b.tipo == OPR_NADA) {
+            g->lugar[quads[k].a.v].tipo = LUGAR_REGISTRADOR;
+            g->lugar[quads[k].a.v].pos = (int32_t)reg++;
+        }
+    }
+    r32 = (int32_t)reg;
+    for (uint32_t k = i; k < fim; k++) {
+        temporario(g, quads[k].r, funcao, &r32);
+        temporario(g, quads[k].a, funcao, &r32);
+        temporario(g, quads[k].b, funcao, &r32);
+    }
+    reg = r32;
+    for (int k = 0; k < 3; k++) g->rascunho[k] = (int32_t)reg++;
+    for (uint32_t k = i; k < fim; k++) {
+        if (quads[k].op == IR_VAR && quads[k].b.tipo == OPR_CONST) {
+            Lugar *l = &g->lugar[quads[k].a.v];
+            l->tipo = LUGAR_ARRAY_LOCAL;
+            l->pos = (int32_t)reg;
+            l->tamanho = quads[k].b.v;
+            reg += quads[k].b.v;
+        }
+    }
+    if (reg >= MAX_REGISTRADOR) {
+        g->grande = TRUE;
+        return;
+    }
+    g->saida = (int32_t)reg;
+    g->nargs = 0;
+    g->pendentes = g->maxPendentes = 0;
+
+    entrada[0] = g->n;
+    for (uint32_t k = i; k < fim; k++) montarQuad(g, &quads[k]);
+    entrada[1] = parametros;
+    entrada[2] = (uint32_t)reg - parametros;
+    entrada[3] = (uint32_t)(reg + g->maxPendentes);
+}
+
+Bytecode *montarBytecode(const CodigoIR *c) {
+    Montagem g;
+    Bytecode *b;
+    uint32_t nfuncoes = 0, nglobais = 0, principal = SEM_POSICAO, *tabela;
+    uint32_t inicio = 0, f = 0;
+
+    memset(&g, 0, sizeof(g));
+    g.c = c;
+    g.lugar = (Lugar *)arenaAlloc((c->nsimbolos + 1) * sizeof(Lugar));
+    g.funcao = (int32_t *)arenaAlloc((c->nsimbolos + 1) * sizeof(int32_t));
+    g.temp = (int32_t *)arenaAlloc((c->ntemps + 1) * sizeof(int32_t));
+    g.vistoEm = (uint32_t *)arenaAlloc((c->ntemps + 1) * sizeof(uint32_t));
+    g.rotulo = (uint32_t *)arenaAlloc((c->nlabels + 1) * sizeof(uint32_t));
+    g.args = (uint8_t *)arenaAlloc(c->n + 1);
+
+    /* globais e funções, na ordem das declarações */
+    for (int m = 0; m < c->nsimbolos; m++) g.funcao[m] = -1;
+    for (uint32_t i = 0; i < c->n; i++) {
+        const Quad *q = &c->quads[i];
+
+        if (q->op == IR_FUNC) {
+            const SymbolRec *s = c->simbolos[q->a.v];
+            if (s->name == sessaoAtual->analise.nomeMain) principal = nfuncoes;
+            g.funcao[q->a.v] = (int32_t)nfuncoes++;
+            while (i < c->n && c->quads[i].op != IR_ENDFUNC) i++;
+        } else if (q->op == IR_VAR) {
+            Lugar *l = &g.lugar[q->a.v];
+            l->tipo = q->b.tipo == OPR_CONST ? LUGAR_ARRAY_GLOBAL : LUGAR_GLOBAL;
+            l->pos = (int32_t)nglobais;
+            l->tamanho = q->b.tipo == OPR_CONST ? q->b.v : 0;
+            nglobais += q->b.tipo == OPR_CONST ? (uint32_t)q->b.v : 1;
+        }
+    }
+    for (int m = 0; m < c->nsimbolos; m++) {
+        const SymbolRec *s = c->simbolos[m];
+        if (s == NULL || !s->isFunction) continue;
+        if (s->name == sessaoAtual->analise.nomeInput) g.funcao[m] = FUNCAO_INPUT;
+        else if (s->name == sessaoAtual->analise.nomeOutput) g.funcao[m] = FUNCAO_OUTPUT;
+    }
+    if (principal == SEM_POSICAO) return NULL;
+
+    tabela = (uint32_t *)arenaAlloc((nfuncoes + 1) * BC_FUNCAO * sizeof(uint32_t));
+    for (uint32_t i = 0; i < c->n; i++) {
+        if (c->quads[i].op == IR_FUNC) inicio = i;
+        else if (c->quads[i].op == IR_ENDFUNC) {
+            montarFuncao(&g, inicio, i + 1, f, &tabela[f * BC_FUNCAO]);
+            f++;
+        }
+    }
+    if (g.grande) return NULL;
+    for (uint32_t k = 0; k < g.ndesvios; k++) g.codigo[g.desvios[k]] = g.rotulo[g.codigo[g.desvios[k]]];
+
+    b = (Bytecode *)arenaAlloc(sizeof(Bytecode));
+    b->n = BC_CABECALHO + nfuncoes * BC_FUNCAO + g.n;
+    b->palavras = (uint32_t *)arenaAlloc(b->n * sizeof(uint32_t));
+    b->palavras[0] = BC_MAGICO;
+    b->palavras[1] = BC_VERSAO;
+    b->palavras[2] = nglobais;
+    b->palavras[3] = nfuncoes;
+    b->palavras[4] = principal;
+    b->palavras[5] = g.n;
+    memcpy(b->palavras + BC_CABECALHO, tabela, nfuncoes * BC_FUNCAO * sizeof(uint32_t));
+    if (g.n > 0) memcpy(b->palavras + BC_CABECALHO + nfuncoes * BC_FUNCAO, g.codigo, g.n * sizeof(uint32_t));
+    return b;
+}
+
+/* ---------------------- Codificação binária ---------------------- */
+
+int escreverBytecode(FILE *f, const Bytecode *b) {
+    for (uint32_t i = 0; i < b->n; i++) {
+        uint32_t w = b->palavras[i];
+        unsigned char bytes[4] = {(unsigned char)w, (unsigned char)(w >> 8),
+                                  (unsigned char)(w >> 16), (unsigned char)(w >> 24)};
+        if (fwrite(bytes, 1, 4, f) != 4) return FALSE;
+    }
+    return fflush(f) == 0;
+}
+
+/* Verifica as instruções da função fn, em [inicio, fim) do código */
+static int verificarFuncao(const uint32_t *p, uint32_t fn, uint32_t fim, uint8_t *inicioInstrucao) {
+    const uint32_t *funcoes = p + BC_CABECALHO;
+    const uint32_t *codigo = funcoes + p[3] * BC_FUNCAO;
+    uint32_t nglobais = p[2], nfuncoes = p[3];
+    uint32_t inicio = funcoes[fn * BC_FUNCAO], quadro = funcoes[fn * BC_FUNCAO + 3];
+    uint32_t pc = inicio, ultima = BC_NOPS;
+
+    if ((uint64_t)funcoes[fn * BC_FUNCAO + 1] + funcoes[fn * BC_FUNCAO + 2] > quadro ||
+        (uint64_t)nglobais + quadro > (uint64_t)LIMITE_MEMORIA)
+        return FALSE;
+    for (; pc < fim; pc += tamanhos[ultima]) {
+        ultima = codigo[pc] & 0xFF;
+        if (ultima >= BC_NOPS || pc + tamanhos[ultima] > fim) return FALSE;
+        inicioInstrucao[pc] = TRUE;
+    }
+    if (inicio == fim || (ultima != BC_JMP && ultima != BC_RET && ultima != BC_RETK)) return FALSE;
+
+    for (pc = inicio; pc < fim; pc += tamanhos[codigo[pc] & 0xFF]) {
+        const uint32_t *w = &codigo[pc];
+        uint64_t r = w[0] >> 8;
+        int ok;
+
+        switch ((OpBytecode)(w[0] & 0xFF)) {
+        case BC_MOV: case BC_ADDR:
+            ok = r < quadro && w[1] < quadro;
+            break;
+        case BC_MOVK: case BC_IN: case BC_OUT: case BC_RET:
+            ok = r < quadro;
+            break;
+        case BC_GETG: case BC_SETG:
+            ok = r < quadro && w[1] < nglobais;
+            break;
+        case BC_LDL: case BC_STL:
+            ok = r < quadro && (uint64_t)w[1] + w[2] <= quadro && w[3] < quadro;
+            break;
+        case BC_LDG: case BC_STG:
+            ok = r < quadro && (uint64_t)w[1] + w[2] <= nglobais && w[3] < quadro;
+            break;
+        case BC_LDP: case BC_STP:
+            ok = r < quadro && (uint64_t)w[1] + 1 < quadro && w[2] < quadro;
+            break;
+        case BC_JMP: case BC_JZ:
+            ok = r < quadro && w[1] >= inicio && w[1] < fim && inicioInstrucao[w[1]];
+            break;
+        case BC_CALL:
+            ok = r < quadro && w[1] < nfuncoes &&
+                 (uint64_t)w[2] + funcoes[w[1] * BC_FUNCAO + 1] <= quadro;
+            break;
+        case BC_RETK:
+            ok = TRUE;
+            break;
+        default:            /* operações */
+            ok = r < quadro && w[1] < quadro && ((w[0] & 0xFF) >= BC_ADDK || w[2] < quadro);
+            break;
+        }
+        if (!ok) return FALSE;
+    }
+    return TRUE;
+}
+
+Bytecode *lerBytecode(FILE *f) {
+    Bytecode *b = (Bytecode *)arenaAlloc(sizeof(Bytecode));
+    uint32_t capacidade = 0, *p, ncodigo, nfuncoes;
+    unsigned char bytes[4];
+    uint8_t *inicioInstrucao;
+    size_t lidos;
+
+    b->palavras = NULL;
+    b->n = 0;
+    while ((lidos = fread(bytes, 1, 4, f)) == 4) {
+        if (b->n == capacidade) b->palavras = crescerVetor(b->palavras, b->n, &capacidade);
+        b->palavras[b->n++] = (uint32_t)bytes[0] | (uint32_t)bytes[1] << 8 |
+                              (uint32_t)bytes[2] << 16 | (uint32_t)bytes[3] << 24;
+    }
+    p = b->palavras;
+    if (lidos != 0 || b->n < BC_CABECALHO || p[0] != BC_MAGICO || p[1] != BC_VERSAO) return NULL;
+    nfuncoes = p[3];
+    ncodigo = p[5];
+    if (nfuncoes == 0 || p[4] >= nfuncoes || (uint64_t)nfuncoes * BC_FUNCAO + ncodigo + BC_CABECALHO != b->n)
+        return NULL;
+
+    /* as funções ficam em ordem no código, uma depois da outra */
+    inicioInstrucao = (uint8_t *)arenaAlloc(ncodigo + 1);
+    for (uint32_t fn = 0; fn < nfuncoes; fn++) {
+        uint32_t inicio = p[BC_CABECALHO + fn * BC_FUNCAO];
+        uint32_t fim = fn + 1 < nfuncoes ? p[BC_CABECALHO + (fn + 1) * BC_FUNCAO] : ncodigo;
+
+        if ((fn == 0 && inicio != 0) || fim < inicio || fim > ncodigo ||
+            !verificarFuncao(p, fn, fim, inicioInstrucao))
+            return NULL;
+    }
+    return b;
+}
+
+/* ---------------------- Execução ---------------------- */
+
+typedef struct {
+    uint32_t retorno;        /* posição depois da CALL */
+    int32_t fp;
+} Retorno;
+
+typedef struct {
+    const uint32_t *funcoes;
+    const uint32_t *codigo;
+    uint32_t main;
+    FILE *entrada, *saida;
+    int32_t *mem;            /* globais e, acima deles, os quadros */
+    int32_t capacidade;
+    int32_t fp;
+    Retorno *pilha;
+    int profundidade, capacidadePilha;
+    int contar;
+    long instrucoes;
+    const char *erro;
+} Maquina;
+
+/* Memória com pelo menos n palavras, zeradas além das que já havia */
+static int crescer(Maquina *m, int32_t n) {
+    int32_t cap = m->capacidade ? m->capacidade : 1024;
+    int32_t *novo;
+
+    if (n > LIMITE_MEMORIA) {
+        m->erro = "memoria esgotada";
+        return FALSE;
+    }
+    while (cap < n) cap = cap > LIMITE_MEMORIA / 2 ? LIMITE_MEMORIA : cap * 2;
+    novo = (int32_t *)realloc(m->mem, (size_t)cap * sizeof(int32_t));
+    if (novo == NULL) {
+        m->erro = "memoria esgotada";
+        return FALSE;
+    }
+    memset(novo + m->capacidade, 0, (size_t)(cap - m->capacidade) * sizeof(int32_t));
+    m->mem = novo;
+    m->capacidade = cap;
+    return TRUE;
+}
+
+/* Espaço para mais uma chamada; main é a primeira das LIMITE_CHAMADAS */
+static int empilhar(Maquina *m) {
+    int cap = m->capacidadePilha ? m->capacidadePilha * 2 : 64;
+    Retorno *novo;
+
+    if (m->capacidadePilha >= LIMITE_CHAMADAS - 1) {
+        m->erro = "recursao profunda demais";
+        return FALSE;
+    }
+    if (cap > LIMITE_CHAMADAS - 1) cap = LIMITE_CHAMADAS - 1;
+    novo = (Retorno *)realloc(m->pilha, (size_t)cap * sizeof(Retorno));
+    if (novo == NULL) {
+        m->erro = "memoria esgotada";
+        return FALSE;
+    }
+    m->pilha = novo;
+    m->capacidadePilha = cap;
+    return TRUE;
+}
+
+#define LACO lacoSwitch
+#include "vmlaco.h"
+#undef LACO
+
+#ifdef VM_COMPUTADO
+#define COMPUTADO
+#define LACO lacoComputado
+#include "vmlaco.h"
+#undef LACO
+#undef COMPUTADO
+#endif
+
+int executarBytecode(const Bytecode *b, FILE *entrada, FILE *saida, int despachoSwitch, long *instrucoes) {
+    Maquina m;
+    int ok;
+
+    memset(&m, 0, sizeof(m));
+    m.funcoes = b->palavras + BC_CABECALHO;
+    m.codigo = m.funcoes + b->palavras[3] * BC_FUNCAO;
+    m.main = b->palavras[4];
+    m.entrada = entrada;
+    m.saida = saida;
+    m.fp = (int32_t)b->palavras[2];
+    m.contar = instrucoes != NULL;
+
+#ifndef VM_COMPUTADO
+    despachoSwitch = TRUE;
+#endif
+    ok = crescer(&m, m.fp + (int32_t)m.funcoes[m.main * BC_FUNCAO + 3]);
+    if (ok && (despachoSwitch || m.contar)) ok = lacoSwitch(&m);
+#ifdef VM_COMPUTADO
+    else if (ok) ok = lacoComputado(&m);
+#endif
+
+    fflush(saida);
+    if (!ok) {
+        fprintf(listing, "\nERRO DE EXECUCAO: %s\n", m.erro);
+        Error = TRUE;
+    }
+    if (instrucoes != NULL) *instrucoes = m.instrucoes;
+    free(m.mem);
+    free(m.pilha);
+    return ok;
+}
@@ -0,0 +1,114 @@
+/* vm.h - Bytecode de registradores e a máquina virtual que o executa */
+
+#ifndef VM_H
+#define VM_H
+
+#include "globals.h"
+#include "ir.h"
+
+#include <stdint.h>
+
+/*
+ * O código de três endereços (ir.h) é montado num bytecode de
+ * registradores: cada função tem um quadro de registradores com os
+ * parâmetros, as variáveis locais (um array local ocupa tantos
+ * registradores quanto o seu tamanho), os temporários e, acima deles,
+ * a área dos argumentos das chamadas. Um argumento é uma cópia para o
+ * registrador que será o parâmetro no quadro de quem é chamado, então a
+ * chamada não copia nada; um array vai como dois registradores, o
+ * endereço e o tamanho. Os escalares e arrays globais ficam na memória,
+ * abaixo dos quadros, e são lidos e escritos por instruções próprias.
+ *
+ * A codificação binária é um vetor de palavras de 32 bits (little-endian
+ * no arquivo), o mesmo que a máquina executa:
+ *
+ *   cabeçalho   BC_MAGICO, BC_VERSAO, nglobais, nfuncoes, main, ncodigo
+ *   funções     nfuncoes x (início, parâmetros, locais, quadro), com
+ *               parâmetros e locais em registradores e quadro com a área
+ *               dos argumentos
+ *   código      ncodigo palavras: a primeira de cada instrução tem o
+ *               opcode no byte baixo e o registrador de destino (ou o
+ *               primeiro operando) nos 24 bits altos; os demais
+ *               operandos vêm nas palavras seguintes (bcTamanho)
+ *
+ * Os desvios e as funções chamadas são posições no código e índices na
+ * tabela de funções. As operações com uma constante à direita têm uma
+ * forma própria (ADDK, LTK, ...), e o índice de um array é sempre um
+ * registrador.
+ */
+
+#define BC_MAGICO  0x43424D43u      /* "CMBC" */
+#define BC_VERSAO  1u
+
+#define BC_CABECALHO 6
+#define BC_FUNCAO    4              /* palavras por função */
+
+/* Instruções: nome, palavras e operandos (r é o campo da primeira
+   palavra; x, y, i, v, p são registradores; K, g, n, L, f, b, palavras
+   seguintes com constantes) */
+#define BC_INSTRUCOES(X) \
+    X(MOV,  2)      /* r = x */                                         \
+    X(MOVK, 2)      /* r = K */                                         \
+    X(GETG, 2)      /* r = global[g] */                                 \
+    X(SETG, 2)      /* global[g] = r */                                 \
+    X(ADDR, 2)      /* r = endereço do registrador x do quadro */       \
+    X(ADD,  3) X(SUB, 3) X(MUL, 3) X(DIV, 3) X(SHL, 3)                  \
+    X(LT,   3) X(LE,  3) X(GT,  3) X(GE,  3) X(EQ,  3) X(NE, 3)         \
+                    /* r = x op y */                                    \
+    X(ADDK, 3) X(SUBK, 3) X(MULK, 3) X(DIVK, 3) X(SHLK, 3)              \
+    X(LTK,  3) X(LEK,  3) X(GTK,  3) X(GEK,  3) X(EQK,  3) X(NEK, 3)    \
+                    /* r = x op K */                                    \
+    X(LDL,  4)      /* r = quadro[x + i], n: tamanho do array */        \
+    X(LDG,  4)      /* r = global[g + i], n: tamanho */                 \
+    X(LDP,  3)      /* r = mem[p + i], com o tamanho em p + 1 */        \
+    X(STL,  4)      /* quadro[x + i] = r, n: tamanho */                 \
+    X(STG,  4)      /* global[g + i] = r, n: tamanho */                 \
+    X(STP,  3)      /* mem[p + i] = r */                                \
+    X(JMP,  2)      /* goto L */                                        \
+    X(JZ,   2)      /* if r == 0 goto L */                              \
+    X(CALL, 3)      /* r = f(...), com o quadro de f no registrador b */\
+    X(IN,   1)      /* r = input() */                                   \
+    X(OUT,  1)      /* output(r) */                                     \
+    X(RET,  1)      /* return r */                                      \
+    X(RETK, 2)      /* return K */
+
+#define BC_ENUM(nome, palavras) BC_##nome,
+typedef enum {
+    BC_INSTRUCOES(BC_ENUM)
+    BC_NOPS
+} OpBytecode;
+#undef BC_ENUM
+
+typedef struct Bytecode {
+    uint32_t *palavras;
+    uint32_t n;
+} Bytecode;
+
+/* Palavras da instrução op (a primeira incluída) */
+int bcTamanho(OpBytecode op);
+
+/* Nome da instrução, como na listagem */
+const char *bcNome(OpBytecode op);
+
+/* Monta o bytecode de c, que deve ter main (memória da arena) */
+Bytecode *montarBytecode(const CodigoIR *c);
+
+/* Escreve a codificação binária em f; FALSE se a escrita falhou */
+int escreverBytecode(FILE *f, const Bytecode *b);
+
+/* Lê e verifica um bytecode (os opcodes, registradores, desvios, globais e
+   funções de cada instrução); NULL se ele é inválido. Memória da arena. */
+Bytecode *lerBytecode(FILE *f);
+
+/*
+ * Executa b a partir de main, com input() lendo de entrada e output(x)
+ * escrevendo em saida, como o interpretador da árvore (interp.h), e os
+ * erros de execução na saída da sessão. O laço de despacho usa goto
+ * computado quando o compilador aceita (GCC e Clang) e um switch nos
+ * demais; com despachoSwitch, usa o switch mesmo assim. Com instrucoes,
+ * o laço do switch conta as instruções executadas. Devolve TRUE se main
+ * terminou.
+ */
+int executarBytecode(const Bytecode *b, FILE *entrada, FILE *saida, int despachoSwitch, long *instrucoes);
+
+#endif
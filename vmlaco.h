@@ -0,0 +1,180 @@
+/*
+ * vmlaco.h - Laço de despacho da máquina virtual
+ *
+ * Incluído por vm.c uma vez para cada forma de despacho, com LACO (o nome
+ * da função) e, no despacho por goto computado, COMPUTADO definidos. No
+ * switch, CONTAR (em m) liga a contagem das instruções executadas.
+ * Cada instrução termina com o seu próprio despacho: com goto computado,
+ * cada uma tem o seu desvio indireto, previsto separadamente.
+ */
+
+static int LACO(Maquina *m) {
+    const uint32_t *codigo = m->codigo;
+    const uint32_t *pc = codigo + m->funcoes[m->main * BC_FUNCAO];
+    int32_t *mem = m->mem;
+    int32_t fp = m->fp;
+    int32_t *q = mem + fp;
+    int32_t x, y, v;
+    uint32_t w;
+#ifdef COMPUTADO
+#define BC_ROTULO(nome, palavras) &&op_##nome,
+    static const void *const rotulos[BC_NOPS] = { BC_INSTRUCOES(BC_ROTULO) };
+#undef BC_ROTULO
+#define CASO(nome)  op_##nome:
+#define DESPACHAR() do { w = *pc; goto *rotulos[w & 0xFF]; } while (0)
+    DESPACHAR();
+#else
+#define CASO(nome)  case BC_##nome:
+#define DESPACHAR() continue
+    for (;;) {
+        w = *pc;
+        if (m->contar) m->instrucoes++;
+        switch ((OpBytecode)(w & 0xFF)) {
+#endif
+
+#define R       ((int32_t)(w >> 8))
+/* sem do-while: no switch, DESPACHAR é um continue do laço */
+#define PROXIMA(palavras) { pc += (palavras); DESPACHAR(); }
+#define FALHAR(msg) do { m->erro = (msg); goto falhou; } while (0)
+#define OPERACAO(nome, expr) \
+    CASO(nome) x = q[pc[1]]; y = q[pc[2]]; q[R] = (expr); PROXIMA(3); \
+    CASO(nome##K) x = q[pc[1]]; y = (int32_t)pc[2]; q[R] = (expr); PROXIMA(3);
+
+    CASO(MOV)  q[R] = q[pc[1]]; PROXIMA(2);
+    CASO(MOVK) q[R] = (int32_t)pc[1]; PROXIMA(2);
+    CASO(GETG) q[R] = mem[pc[1]]; PROXIMA(2);
+    CASO(SETG) mem[pc[1]] = q[R]; PROXIMA(2);
+    CASO(ADDR) q[R] = fp + (int32_t)pc[1]; PROXIMA(2);
+
+    OPERACAO(ADD, (int32_t)((uint32_t)x + (uint32_t)y))
+    OPERACAO(SUB, (int32_t)((uint32_t)x - (uint32_t)y))
+    OPERACAO(MUL, (int32_t)((uint32_t)x * (uint32_t)y))
+    OPERACAO(SHL, (int32_t)((uint32_t)x << (y & 31)))
+    OPERACAO(LT, x < y)
+    OPERACAO(LE, x <= y)
+    OPERACAO(GT, x > y)
+    OPERACAO(GE, x >= y)
+    OPERACAO(EQ, x == y)
+    OPERACAO(NE, x != y)
+
+    CASO(DIV)
+        x = q[pc[1]];
+        y = q[pc[2]];
+        goto dividir;
+    CASO(DIVK)
+        x = q[pc[1]];
+        y = (int32_t)pc[2];
+    dividir:
+        if (y == 0) FALHAR("divisao por zero");
+        if (x == INT32_MIN && y == -1) FALHAR("estouro na divisao");
+        q[R] = x / y;
+        PROXIMA(3);
+
+    CASO(LDL)
+        x = q[pc[3]];
+        if ((uint32_t)x >= pc[2]) goto foraDoArray;
+        q[R] = q[pc[1] + x];
+        PROXIMA(4);
+    CASO(LDG)
+        x = q[pc[3]];
+        if ((uint32_t)x >= pc[2]) goto foraDoArray;
+        q[R] = mem[pc[1] + x];
+        PROXIMA(4);
+    CASO(LDP)
+        x = q[pc[2]];
+        y = q[pc[1]];
+        if ((uint32_t)x >= (uint32_t)q[pc[1] + 1] || (uint32_t)y + (uint32_t)x >= (uint32_t)m->capacidade)
+            goto foraDoArray;
+        q[R] = mem[(uint32_t)y + (uint32_t)x];
+        PROXIMA(3);
+    CASO(STL)
+        x = q[pc[3]];
+        if ((uint32_t)x >= pc[2]) goto foraDoArray;
+        q[pc[1] + x] = q[R];
+        PROXIMA(4);
+    CASO(STG)
+        x = q[pc[3]];
+        if ((uint32_t)x >= pc[2]) goto foraDoArray;
+        mem[pc[1] + x] = q[R];
+        PROXIMA(4);
+    CASO(STP)
+        x = q[pc[2]];
+        y = q[pc[1]];
+        if ((uint32_t)x >= (uint32_t)q[pc[1] + 1] || (uint32_t)y + (uint32_t)x >= (uint32_t)m->capacidade)
+            goto foraDoArray;
+        mem[(uint32_t)y + (uint32_t)x] = q[R];
+        PROXIMA(3);
+
+    CASO(JMP)
+        pc = codigo + pc[1];
+        DESPACHAR();
+    CASO(JZ)
+        if (q[R] == 0) pc = codigo + pc[1];
+        else pc += 2;
+        DESPACHAR();
+
+    CASO(CALL) {
+        const uint32_t *f = m->funcoes + pc[1] * BC_FUNCAO;
+        int32_t novo = fp + (int32_t)pc[2];
+
+        if (m->profundidade == m->capacidadePilha && !empilhar(m)) goto falhou;
+        if (novo + (int32_t)f[3] > m->capacidade) {
+            m->mem = mem;
+            if (!crescer(m, novo + (int32_t)f[3])) goto falhou;
+            mem = m->mem;
+        }
+        m->pilha[m->profundidade].retorno = (uint32_t)(pc + 3 - codigo);
+        m->pilha[m->profundidade++].fp = fp;
+        fp = novo;
+        q = mem + fp;
+        memset(q + f[1], 0, f[2] * sizeof(int32_t));
+        pc = codigo + f[0];
+        DESPACHAR();
+    }
+
+    CASO(IN)
+        fflush(m->saida);
+        if (fscanf(m->entrada, "%d", &v) != 1) FALHAR("entrada esgotada ou invalida em input()");
+        q[R] = v;
+        PROXIMA(1);
+    CASO(OUT)
+        fprintf(m->saida, "%d\n", q[R]);
+        PROXIMA(1);
+
+    CASO(RET)
+        v = q[R];
+        goto retornar;
+    CASO(RETK)
+        v = (int32_t)pc[1];
+    retornar:
+        if (m->profundidade == 0) {
+            m->mem = mem;
+            return TRUE;
+        }
+        m->profundidade--;
+        fp = m->pilha[m->profundidade].fp;
+        q = mem + fp;
+        pc = codigo + m->pilha[m->profundidade].retorno;
+        q[pc[-3] >> 8] = v;             /* o destino da CALL */
+        DESPACHAR();
+
+#ifndef COMPUTADO
+        default:
+            FALHAR("instrucao invalida");
+        }
+    }
+#endif
+
+foraDoArray:
+    m->erro = "indice fora do array";
+falhou:
+    m->mem = mem;
+    return FALSE;
+
+#undef CASO
+#undef DESPACHAR
+#undef R
+#undef PROXIMA
+#undef FALHAR
+#undef OPERACAO
+}
@@ -0,0 +1,985 @@
+/* Código nativo x86-64 (x64.c): seleção de instruções e assembly do GNU as */
+
+#include "globals.h"
+#include "x64.h"
+#include "alocador.h"
+#include "interp.h"
+#include "cfg.h"
+#include "arena.h"
+
+#include <string.h>
+
+/* Onde fica cada variável (por memloc) */
+#define LUGAR_GLOBAL       0   /* escalar global */
+#define LUGAR_ARRAY_GLOBAL 1   /* tamanho */
+#define LUGAR_ESCALAR      2   /* escalar local: temporário pos do trecho */
+#define LUGAR_ARRAY_LOCAL  3   /* deslocamento do elemento 0 e tamanho */
+#define LUGAR_ARRAY_PARAM  4   /* deslocamentos do endereço e do tamanho */
+
+typedef struct {
+    uint8_t tipo;
+    int32_t pos;
+    int32_t tamanho;
+} Lugar;
+
+#define NREG_ARGUMENTO 6
+static const RegX64 registradorArgumento[NREG_ARGUMENTO] = {RDI, RSI, RDX, RCX, R8, R9};
+
+/* Desvio de um if_false que passa pelos movimentos da aresta */
+typedef struct {
+    int32_t rotulo, alvo;
+    uint32_t quad;
+} Trampolim;
+
+typedef struct {
+    const CodigoIR *c;
+    CodigoX64 *x;
+    Lugar *lugar;            /* por memloc */
+    int alocar;              /* FALSE: linha de base, tudo na pilha */
+    int32_t *local;          /* por temporário do programa: temporário do trecho */
+    uint32_t *vistoEm;       /* por temporário do programa: 1 + a função em que foi visto */
+    /* função corrente */
+    CodigoIR *t;             /* trecho: as escalares locais são temporários */
+    const Alocacao *aloc;
+    int32_t *pilha;          /* por virtual: deslocamento do lugar na pilha (0: nenhum) */
+    int32_t *argumento;      /* por quádrupla param: virtual do argumento, ou -1 (array) */
+    uint32_t *chamada;       /* por quádrupla param: a call que o consome */
+    uint32_t *pendentes;     /* params ainda sem call */
+    int npendentes;
+    uint32_t *primeiroMov;   /* por quádrupla: primeiro dos seus movimentos */
+    OperandoX64 *para, *de;  /* movimentos paralelos de um ponto */
+    int capMovimentos;
+    int32_t salvoEm[16];     /* registradores salvos pela função: lugar no quadro */
+    uint32_t salvos;         /* máscara */
+    Trampolim *trampolins;
+    int ntrampolins, capTrampolins;
+    uint32_t atual;          /* quádrupla corrente do trecho */
+    int32_t proximoRotulo;
+    int grande;              /* um quadro passou do limite */
+} Selecao;
+
+/* ---------------------- Instruções ---------------------- */
+
+static OperandoX64 operandoX64(TipoOperandoX64 tipo, int base, int indice, int32_t v) {
+    OperandoX64 o;
+    o.tipo = (uint8_t)tipo;
+    o.base = (uint8_t)base;
+    o.indice = (uint8_t)indice;
+    o.v = v;
+    return o;
+}
+
+#define NENHUM_X64      operandoX64(XO_NADA, SEM_REG, SEM_REG, 0)
+#define REG(r)          operandoX64(XO_REG, (r), SEM_REG, 0)
+#define IMED(v)         operandoX64(XO_IMED, SEM_REG, SEM_REG, (v))
+#define MEM(b, d)       operandoX64(XO_MEM, (b), SEM_REG, (d))
+#define MEMI(b, i, d)   operandoX64(XO_MEM, (b), (i), (d))
+#define GLOBAL(m)       operandoX64(XO_GLOBAL, SEM_REG, SEM_REG, (m))
+#define ROTULO(l)       operandoX64(XO_ROTULO, SEM_REG, SEM_REG, (l))
+#define FUNCAO(m)       operandoX64(XO_FUNCAO, SEM_REG, SEM_REG, (m))
+
+/* Vetor da arena que dobra de tamanho, como o de quádruplas (ir.c) */
+static void emitirX64(Selecao *s, OpX64 op, int cc, int q, OperandoX64 d, OperandoX64 f) {
+    CodigoX64 *x = s->x;
+    InstrX64 *i;
+
+    if (x->n == x->capacidade) {
+        uint32_t cap = x->capacidade ? x->capacidade * 2 : 1024;
+        InstrX64 *novo = (InstrX64 *)arenaAlloc(cap * sizeof(InstrX64));
+        if (x->n > 0) memcpy(novo, x->instrucoes, x->n * sizeof(InstrX64));
+        x->instrucoes = novo;
+        x->capacidade = cap;
+    }
+    i = &x->instrucoes[x->n++];
+    i->op = (uint8_t)op;
+    i->cc = (uint8_t)cc;
+    i->q = (uint8_t)q;
+    i->d = d;
+    i->s = f;
+}
+
+/* 32 bits (l) e 64 bits (q) */
+static void instr(Selecao *s, OpX64 op, OperandoX64 d, OperandoX64 f) {
+    emitirX64(s, op, 0, FALSE, d, f);
+}
+
+static void instrQ(Selecao *s, OpX64 op, OperandoX64 d, OperandoX64 f) {
+    emitirX64(s, op, 0, TRUE, d, f);
+}
+
+static void saltar(Selecao *s, CondX64 cc, int32_t label) {
+    emitirX64(s, X_JCC, cc, FALSE, ROTULO(label), NENHUM_X64);
+}
+
+static void rotulo(Selecao *s, int32_t label) {
+    emitirX64(s, X_ROTULO, 0, FALSE, ROTULO(label), NENHUM_X64);
+}
+
+/* Desvio para o erro de execução motivo */
+static int32_t erro(Selecao *s, int motivo) {
+    s->x->usaErro[motivo] = TRUE;
+    return s->x->rotuloErro[motivo];
+}
+
+static int naMemoria(OperandoX64 o) {
+    return o.tipo == XO_MEM || o.tipo == XO_GLOBAL;
+}
+
+static int mesmoLugar(OperandoX64 a, OperandoX64 b) {
+    return a.tipo == b.tipo && a.base == b.base && a.indice == b.indice && a.v == b.v;
+}
+
+/* para = de (32 bits), por eax se os dois estão na memória */
+static void mover(Selecao *s, OperandoX64 para, OperandoX64 de) {
+    if (mesmoLugar(para, de)) return;
+    if (naMemoria(para) && naMemoria(de)) {
+        instr(s, X_MOV, REG(RAX), de);
+        de = REG(RAX);
+    }
+    instr(s, X_MOV, para, de);
+}
+
+static int lidoPorOutro(OperandoX64 o, const OperandoX64 *de, int n, int k) {
+    for (int j = 0; j < n; j++)
+        if (j != k && mesmoLugar(de[j], o)) return TRUE;
+    return FALSE;
+}
+
+/* Cópias simultâneas para[k] = de[k]: um destino só é escrito quando
+   nenhuma cópia pendente o lê, e um ciclo entre registradores é quebrado
+   guardando um deles em eax. Como cada virtual tem um só lugar na pilha,
+   só registradores formam ciclos. */
+static void moverEmParalelo(Selecao *s, OperandoX64 *para, OperandoX64 *de, int n) {
+    for (int k = 0; k < n;) {
+        if (mesmoLugar(para[k], de[k])) {
+            para[k] = para[--n];
+            de[k] = de[n];
+        } else {
+            k++;
+        }
+    }
+    while (n > 0) {
+        int k = 0;
+
+        while (k < n && lidoPorOutro(para[k], de, n, k)) k++;
+        if (k < n) {
+            mover(s, para[k], de[k]);
+            para[k] = para[--n];
+            de[k] = de[n];
+            continue;
+        }
+        instr(s, X_MOV, REG(RAX), para[0]);
+        for (int j = 0; j < n; j++)
+            if (mesmoLugar(de[j], para[0])) de[j] = REG(RAX);
+    }
+}
+
+/* ---------------------- Lugares ---------------------- */
+
+static const Lugar *lugarDe(const Selecao *s, Operando o) {
+    return &s->lugar[o.v];
+}
+
+static int ehArray(const Selecao *s, Operando a) {
+    return a.tipo == OPR_VAR && lugarDe(s, a)->tipo != LUGAR_GLOBAL && lugarDe(s, a)->tipo != LUGAR_ESCALAR;
+}
+
+/* Registrador ou lugar na pilha do virtual v na posição pos */
+static OperandoX64 lugarVirtual(const Selecao *s, int32_t v, int32_t pos) {
+    uint8_t r = registradorEm(s->aloc, v, pos);
+    return r == SEM_REG ? MEM(RBP, s->pilha[v]) : REG(r);
+}
+
+/* Operando x86 com o valor lido de o na quádrupla corrente */
+static OperandoX64 fonte(const Selecao *s, Operando o) {
+    if (o.tipo == OPR_CONST) return IMED(o.v);
+    if (o.tipo == OPR_TEMP) return lugarVirtual(s, o.v, POS_LEITURA(s->atual));
+    return GLOBAL(o.v);
+}
+
+/* Operando x86 em que a quádrupla corrente escreve o */
+static OperandoX64 destino(const Selecao *s, Operando o) {
+    if (o.tipo == OPR_TEMP) return lugarVirtual(s, o.v, POS_ESCRITA(s->atual));
+    return GLOBAL(o.v);
+}
+
+static void reservarMovimentos(Selecao *s, int n) {
+    if (n <= s->capMovimentos) return;
+    s->capMovimentos = n * 2;
+    s->para = (OperandoX64 *)arenaAlloc(s->capMovimentos * sizeof(OperandoX64));
+    s->de = (OperandoX64 *)arenaAlloc(s->capMovimentos * sizeof(OperandoX64));
+}
+
+/* Movimentos do alocador na quádrupla e lado dados */
+static void emitirMovimentos(Selecao *s, uint32_t quad, LadoMovimento lado) {
+    const Alocacao *a = s->aloc;
+    int n = 0;
+
+    reservarMovimentos(s, (int)(s->primeiroMov[quad + 1] - s->primeiroMov[quad]));
+    for (uint32_t k = s->primeiroMov[quad]; k < s->primeiroMov[quad + 1]; k++) {
+        const Movimento *m = &a->movimentos[k];
+
+        if (m->lado != lado) continue;
+        s->de[n] = m->de == SEM_REG ? MEM(RBP, s->pilha[m->virtual]) : REG(m->de);
+        s->para[n++] = m->para == SEM_REG ? MEM(RBP, s->pilha[m->virtual]) : REG(m->para);
+    }
+    moverEmParalelo(s, s->para, s->de, n);
+}
+
+static int temMovimentos(const Selecao *s, uint32_t quad, LadoMovimento lado) {
+    for (uint32_t k = s->primeiroMov[quad]; k < s->primeiroMov[quad + 1]; k++)
+        if (s->aloc->movimentos[k].lado == lado) return TRUE;
+    return FALSE;
+}
+
+/* Alvo do desvio do if_false quad: o label ou, se a aresta tem
+   movimentos, um trampolim que os faz e segue para o label */
+static int32_t alvoDesvio(Selecao *s, uint32_t quad, int32_t label) {
+    Trampolim *t;
+
+    if (!temMovimentos(s, quad, MOV_DESVIO)) return label;
+    if (s->ntrampolins == s->capTrampolins) {
+        int cap = s->capTrampolins ? s->capTrampolins * 2 : 16;
+        Trampolim *novo = (Trampolim *)arenaAlloc(cap * sizeof(Trampolim));
+        if (s->ntrampolins > 0) memcpy(novo, s->trampolins, s->ntrampolins * sizeof(Trampolim));
+        s->trampolins = novo;
+        s->capTrampolins = cap;
+    }
+    t = &s->trampolins[s->ntrampolins++];
+    t->rotulo = s->proximoRotulo++;
+    t->alvo = label;
+    t->quad = quad;
+    return t->rotulo;
+}
+
+/* ---------------------- Seleção ---------------------- */
+
+/* eax = eax / b, com b em ecx; um divisor constante que não é 0 nem -1
+   dispensa as verificações */
+static void dividir(Selecao *s, Operando b) {
+    if (b.tipo == OPR_CONST && b.v != 0 && b.v != -1) {
+        instr(s, X_MOV, REG(RCX), IMED(b.v));
+    } else {
+        int32_t continua = s->proximoRotulo++;
+
+        mover(s, REG(RCX), fonte(s, b));
+        instr(s, X_CMP, REG(RCX), IMED(0));
+        saltar(s, CC_E, erro(s, ERRO_DIVISAO));
+        instr(s, X_CMP, REG(RCX), IMED(-1));
+        saltar(s, CC_NE, continua);
+        instr(s, X_CMP, REG(RAX), IMED(INT32_MIN));
+        saltar(s, CC_E, erro(s, ERRO_ESTOURO));
+        rotulo(s, continua);
+    }
+    instr(s, X_CLTD, NENHUM_X64, NENHUM_X64);
+    instr(s, X_IDIV, REG(RCX), NENHUM_X64);
+}
+
+static CondX64 condicao(OpIR op) {
+    switch (op) {
+    case IR_LT: return CC_L;
+    case IR_LE: return CC_LE;
+    case IR_GT: return CC_G;
+    case IR_GE: return CC_GE;
+    case IR_EQ: return CC_E;
+    default:    return CC_NE;
+    }
+}
+
+/* Uma comparação seguida do if_false que é a última leitura do seu
+   resultado vira um desvio condicional, a não ser que haja movimentos
+   entre as duas */
+static int fundirDesvio(const Selecao *s, const Quad *q, const Quad *seguinte) {
+    uint32_t k = s->atual + 1;
+
+    return seguinte != NULL && seguinte->op == IR_IFFALSE && q->r.tipo == OPR_TEMP &&
+           seguinte->a.tipo == OPR_TEMP && seguinte->a.v == q->r.v &&
+           !vivoEm(s->aloc, q->r.v, POS_ESCRITA(k)) &&
+           !temMovimentos(s, k, MOV_ANTES) && !temMovimentos(s, k, MOV_FIM);
+}
+
+/* r = a op b, direto no registrador de r quando ele não é o de b (numa
+   operação comutativa, a e b trocam de lugar); senão, em eax. Devolve
+   TRUE se a comparação virou desvio e o if_false seguinte já foi
+   selecionado. */
+static int operacao(Selecao *s, const Quad *q, const Quad *seguinte) {
+    OpIR op = (OpIR)q->op;
+    OperandoX64 fa = fonte(s, q->a), fb = fonte(s, q->b), fr = destino(s, q->r);
+    RegX64 alvo = RAX;
+
+    if (op == IR_DIV) {
+        mover(s, REG(RAX), fa);
+        dividir(s, q->b);
+        mover(s, fr, REG(RAX));
+        return FALSE;
+    }
+    if (op >= IR_LT) {
+        OperandoX64 esq = fa;
+
+        if (esq.tipo == XO_IMED || (naMemoria(esq) && naMemoria(fb))) {
+            mover(s, REG(RAX), esq);
+            esq = REG(RAX);
+        }
+        instr(s, X_CMP, esq, fb);
+        if (fundirDesvio(s, q, seguinte)) {
+            uint32_t k = s->atual + 1;
+            saltar(s, CC_INVERSA(condicao(op)), alvoDesvio(s, k, seguinte->b.v));
+            emitirMovimentos(s, k, MOV_DEPOIS);
+            return TRUE;
+        }
+        emitirX64(s, X_SET, condicao(op), FALSE, REG(RAX), NENHUM_X64);
+        instr(s, X_MOVZB, REG(RAX), REG(RAX));
+        mover(s, fr, REG(RAX));
+        return FALSE;
+    }
+
+    if ((op == IR_ADD || op == IR_MUL) && fr.tipo == XO_REG && mesmoLugar(fb, fr)) {
+        OperandoX64 troca = fa;
+        fa = fb;
+        fb = troca;
+    }
+    if (fr.tipo == XO_REG && !mesmoLugar(fb, fr)) alvo = (RegX64)fr.base;
+    mover(s, REG(alvo), fa);
+    switch (op) {
+    case IR_ADD:
+        instr(s, X_ADD, REG(alvo), fb);
+        break;
+    case IR_SUB:
+        instr(s, X_SUB, REG(alvo), fb);
+        break;
+    case IR_MUL:
+        instr(s, X_IMUL, REG(alvo), fb);
+        break;
+    default:
+        if (fb.tipo == XO_IMED) {
+            instr(s, X_SHL, REG(alvo), IMED(fb.v & 31));
+        } else {
+            mover(s, REG(RCX), fb);
+            instr(s, X_SHL, REG(alvo), REG(RCX));
+        }
+        break;
+    }
+    mover(s, fr, REG(alvo));
+    return FALSE;
+}
+
+/* Operando de memória de array[indice]; o índice (num registrador ou em
+   ecx) é verificado, a não ser que seja uma constante dentro de um array
+   de tamanho conhecido. O endereço de um array global ou parâmetro vai
+   para rdx. Um índice num registrador já tem os 32 bits altos zerados. */
+static OperandoX64 elemento(Selecao *s, Operando array, Operando indice) {
+    const Lugar *l = lugarDe(s, array);
+    OperandoX64 fi = fonte(s, indice);
+    RegX64 ri = RCX;
+
+    if (indice.tipo == OPR_CONST && l->tipo != LUGAR_ARRAY_PARAM &&
+        (uint32_t)indice.v < (uint32_t)l->tamanho) {
+        if (l->tipo == LUGAR_ARRAY_LOCAL) return MEM(RBP, l->pos + 4 * indice.v);
+        instrQ(s, X_LEA, REG(RDX), GLOBAL(array.v));
+        return MEM(RDX, 4 * indice.v);
+    }
+    if (fi.tipo == XO_REG) ri = (RegX64)fi.base;
+    else mover(s, REG(RCX), fi);
+    if (l->tipo == LUGAR_ARRAY_PARAM) instr(s, X_CMP, REG(ri), MEM(RBP, l->tamanho));
+    else instr(s, X_CMP, REG(ri), IMED(l->tamanho));
+    saltar(s, CC_AE, erro(s, ERRO_INDICE));
+    if (l->tipo == LUGAR_ARRAY_LOCAL) return MEMI(RBP, ri, l->pos);
+    if (l->tipo == LUGAR_ARRAY_PARAM) instrQ(s, X_MOV, REG(RDX), MEM(RBP, l->pos));
+    else instrQ(s, X_LEA, REG(RDX), GLOBAL(array.v));
+    return MEMI(RDX, ri, 0);
+}
+
+/* Slot de saída de um argumento: registrador ou topo da pilha */
+static OperandoX64 slotSaida(int slot) {
+    if (slot < NREG_ARGUMENTO) return REG(registradorArgumento[slot]);
+    return MEM(RSP, 8 * (slot - NREG_ARGUMENTO));
+}
+
+/* Endereço e tamanho do array a nos slots slot e slot + 1 */
+static void passarArray(Selecao *s, Operando a, int slot) {
+    const Lugar *l = lugarDe(s, a);
+    OperandoX64 p = slot < NREG_ARGUMENTO ? slotSaida(slot) : REG(RAX);
+
+    if (l->tipo == LUGAR_ARRAY_PARAM) instrQ(s, X_MOV, p, MEM(RBP, l->pos));
+    else instrQ(s, X_LEA, p, l->tipo == LUGAR_ARRAY_LOCAL ? MEM(RBP, l->pos) : GLOBAL(a.v));
+    if (slot >= NREG_ARGUMENTO) instrQ(s, X_MOV, slotSaida(slot), REG(RAX));
+    mover(s, slotSaida(slot + 1), l->tipo == LUGAR_ARRAY_PARAM ? MEM(RBP, l->tamanho) : IMED(l->tamanho));
+}
+
+/* r = call f com n argumentos: os escalares, que estão nos virtuais dos
+   params, vão para a pilha e depois, todos de uma vez, para os
+   registradores de argumento; os arrays vêm por último, porque não leem
+   nenhum registrador */
+static void chamada(Selecao *s, const Quad *q) {
+    int base = s->npendentes - q->b.v, slot = 0, n = 0;
+
+    if (base < 0) base = 0;
+    reservarMovimentos(s, NREG_ARGUMENTO);
+    for (int j = base; j < s->npendentes; j++) {
+        int32_t v = s->argumento[s->pendentes[j]];
+
+        if (v < 0) {
+            slot += 2;
+            continue;
+        }
+        if (slot < NREG_ARGUMENTO) {
+            s->para[n] = slotSaida(slot);
+            s->de[n++] = lugarVirtual(s, v, POS_LEITURA(s->atual));
+        } else {
+            mover(s, slotSaida(slot), lugarVirtual(s, v, POS_LEITURA(s->atual)));
+        }
+        slot++;
+    }
+    moverEmParalelo(s, s->para, s->de, n);
+    slot = 0;
+    for (int j = base; j < s->npendentes; j++) {
+        uint32_t k = s->pendentes[j];
+
+        if (s->argumento[k] >= 0) {
+            slot++;
+        } else {
+            passarArray(s, s->t->quads[k].a, slot);
+            slot += 2;
+        }
+    }
+    s->npendentes = base;
+
+    instr(s, X_CALL, FUNCAO(q->a.v), NENHUM_X64);
+    if (q->r.tipo != OPR_NADA && s->c->simbolos[q->a.v]->name != sessaoAtual->analise.nomeOutput)
+        mover(s, destino(s, q->r), REG(RAX));
+}
+
+static void retorno(Selecao *s, Operando a) {
+    if (a.tipo == OPR_NADA) instr(s, X_MOV, REG(RAX), IMED(0));
+    else mover(s, REG(RAX), fonte(s, a));
+    for (int r = 0; r < 16; r++)
+        if (s->salvos >> r & 1) instrQ(s, X_MOV, REG(r), MEM(RBP, s->salvoEm[r]));
+    instr(s, X_LEAVE, NENHUM_X64, NENHUM_X64);
+    instr(s, X_RET, NENHUM_X64, NENHUM_X64);
+}
+
+/* Seleciona a quádrupla corrente, q; devolve quantas foram consumidas */
+static int selecionarQuad(Selecao *s, const Quad *q, const Quad *seguinte) {
+    switch ((OpIR)q->op) {
+    case IR_LABEL:
+        rotulo(s, q->a.v);
+        emitirMovimentos(s, s->atual, MOV_DEPOIS);
+        break;
+    case IR_GOTO:
+        instr(s, X_JMP, ROTULO(q->a.v), NENHUM_X64);
+        break;
+    case IR_IFFALSE:
+        if (q->a.tipo == OPR_CONST) {
+            if (q->a.v == 0) instr(s, X_JMP, ROTULO(alvoDesvio(s, s->atual, q->b.v)), NENHUM_X64);
+        } else {
+            instr(s, X_CMP, fonte(s, q->a), IMED(0));
+            saltar(s, CC_E, alvoDesvio(s, s->atual, q->b.v));
+        }
+        emitirMovimentos(s, s->atual, MOV_DEPOIS);
+        break;
+    case IR_COPY:
+        mover(s, destino(s, q->r), fonte(s, q->a));
+        break;
+    case IR_ADD: case IR_SUB: case IR_MUL: case IR_DIV: case IR_SHL:
+    case IR_LT: case IR_LE: case IR_GT: case IR_GE: case IR_EQ: case IR_NE:
+        if (operacao(s, q, seguinte)) return 2;
+        break;
+    case IR_LOAD: {
+        OperandoX64 m = elemento(s, q->a, q->b), fr = destino(s, q->r);
+        if (fr.tipo == XO_REG) {
+            instr(s, X_MOV, fr, m);
+        } else {
+            instr(s, X_MOV, REG(RAX), m);
+            mover(s, fr, REG(RAX));
+        }
+        break;
+    }
+    case IR_STORE: {
+        OperandoX64 m = elemento(s, q->r, q->a), fb = fonte(s, q->b);
+        if (naMemoria(fb)) {
+            instr(s, X_MOV, REG(RAX), fb);
+            fb = REG(RAX);
+        }
+        instr(s, X_MOV, m, fb);
+        break;
+    }
+    case IR_ARG:
+        if (s->argumento[s->atual] >= 0)
+            mover(s, lugarVirtual(s, s->argumento[s->atual], POS_ESCRITA(s->atual)), fonte(s, q->a));
+        s->pendentes[s->npendentes++] = s->atual;
+        break;
+    case IR_CALL:
+        chamada(s, q);
+        break;
+    case IR_RETURN:
+        retorno(s, q->a);
+        break;
+    case IR_ENDFUNC:
+        retorno(s, NADA);
+        break;
+    default:
+        break;              /* func, param e var: o quadro já está montado */
+    }
+    return 1;
+}
+
+/* ---------------------- Função ---------------------- */
+
+static void renomear(Selecao *s, Operando *o, uint32_t funcao, int32_t *n) {
+    if (o->tipo == OPR_TEMP) {
+        if (s->vistoEm[o->v] != funcao + 1) {
+            s->vistoEm[o->v] = funcao + 1;
+            s->local[o->v] = (*n)++;
+        }
+        *o = operando(OPR_TEMP, s->local[o->v]);
+    } else if (o->tipo == OPR_VAR && s->lugar[o->v].tipo == LUGAR_ESCALAR) {
+        *o = operando(OPR_TEMP, s->lugar[o->v].pos);
+    }
+}
+
+/* Cópia da função [i, fim) em que as escalares locais (parâmetros e
+   vars, na ordem das declarações) são os temporários 0 .. nescalares-1
+   e os temporários vêm depois; os labels não mudam. Marca o lugar das
+   locais. */
+static CodigoIR *trechoDaFuncao(Selecao *s, uint32_t i, uint32_t fim, uint32_t funcao, int *nescalares) {
+    const Quad *quads = s->c->quads;
+    CodigoIR *t = novoIR(s->c->simbolos, s->c->nsimbolos);
+    int32_t n = 0;
+
+    for (uint32_t k = i; k < fim; k++) {
+        const Quad *q = &quads[k];
+        Lugar *l = &s->lugar[q->a.v];
+
+        if (q->op == IR_PARAM) {
+            l->tipo = q->b.v ? LUGAR_ARRAY_PARAM : LUGAR_ESCALAR;
+        } else if (q->op == IR_VAR) {
+            l->tipo = q->b.tipo == OPR_CONST ? LUGAR_ARRAY_LOCAL : LUGAR_ESCALAR;
+            l->tamanho = q->b.tipo == OPR_CONST ? q->b.v : 0;
+        } else {
+            continue;
+        }
+        if (l->tipo == LUGAR_ESCALAR) l->pos = n++;
+    }
+    *nescalares = n;
+
+    for (uint32_t k = i; k < fim; k++) {
+        Quad q = quads[k];
+
+        if (leOperandos((OpIR)q.op) || defineR((OpIR)q.op)) {
+            renomear(s, &q.r, funcao, &n);
+            if (q.op != IR_CALL) renomear(s, &q.a, funcao, &n);
+            renomear(s, &q.b, funcao, &n);
+        }
+        irEmitir(t, (OpIR)q.op, q.r, q.a, q.b);
+    }
+    t->ntemps = n;
+    t->nlabels = s->c->nlabels;
+    return t;
+}
+
+/* Virtual de cada argumento escalar (depois dos temporários), a call que
+   o consome e o registrador preferido de cada virtual: o do slot, para
+   os argumentos e os parâmetros. Devolve os virtuais; em maxPilha, os
+   slots na pilha de saída. */
+static int32_t prepararChamadas(Selecao *s, uint8_t *dica, int *maxPilha) {
+    const CodigoIR *t = s->t;
+    int32_t nv = t->ntemps;
+    int slot = 0;
+
+    for (uint32_t k = 1; k < t->n && t->quads[k].op == IR_PARAM; k++) {
+        const Quad *q = &t->quads[k];
+        if (q->b.v) {
+            slot += 2;
+            continue;
+        }
+        if (slot < NREG_ARGUMENTO) dica[s->lugar[q->a.v].pos] = (uint8_t)registradorArgumento[slot];
+        slot++;
+    }
+
+    *maxPilha = 0;
+    s->npendentes = 0;
+    for (uint32_t k = 0; k < t->n; k++) {
+        const Quad *q = &t->quads[k];
+
+        if (q->op == IR_ARG) {
+            s->argumento[k] = ehArray(s, q->a) ? -1 : nv++;
+            s->pendentes[s->npendentes++] = k;
+        } else if (q->op == IR_CALL) {
+            int base = s->npendentes - q->b.v;
+
+            if (base < 0) base = 0;
+            slot = 0;
+            for (int j = base; j < s->npendentes; j++) {
+                uint32_t a = s->pendentes[j];
+                int32_t v = s->argumento[a];
+
+                s->chamada[a] = k;
+                if (v >= 0 && slot < NREG_ARGUMENTO) dica[v] = (uint8_t)registradorArgumento[slot];
+                slot += v >= 0 ? 1 : 2;
+            }
+            if (slot - NREG_ARGUMENTO > *maxPilha) *maxPilha = slot - NREG_ARGUMENTO;
+            s->npendentes = base;
+        }
+    }
+    return nv;
+}
+
+static int64_t alinhar(int64_t desl, int64_t bytes) {
+    return desl & ~(bytes - 1);
+}
+
+/* Deslocamento de uma parte de um parâmetro array: a que chega num
+   registrador ganha um lugar abaixo de rbp, anotado em entrada para o
+   prólogo; as demais já estão acima do endereço de retorno */
+static int32_t lugarParametro(int64_t *desl, int slot, int bytes, int32_t *entrada, uint8_t *entradaQ) {
+    if (slot >= NREG_ARGUMENTO) return 16 + 8 * (slot - NREG_ARGUMENTO);
+    *desl = alinhar(*desl - bytes, bytes);
+    entrada[slot] = (int32_t)*desl;
+    entradaQ[slot] = bytes == 8;
+    return entrada[slot];
+}
+
+/* Zera [inicio, fim) do quadro. rep stosq usa rdi e rcx, que ainda têm
+   parâmetros: ficam em r10 e r11, livres na entrada. */
+static void zerarQuadro(Selecao *s, int64_t inicio, int64_t fim) {
+    if (fim - inicio <= 8 * 8) {
+        for (int64_t d = inicio; d < fim; d += 8) instrQ(s, X_MOV, MEM(RBP, (int32_t)d), IMED(0));
+        return;
+    }
+    instrQ(s, X_MOV, REG(R10), REG(RDI));
+    instrQ(s, X_MOV, REG(R11), REG(RCX));
+    instrQ(s, X_LEA, REG(RDI), MEM(RBP, (int32_t)inicio));
+    instr(s, X_MOV, REG(RCX), IMED((int32_t)((fim - inicio) / 8)));
+    instr(s, X_XOR, REG(RAX), REG(RAX));
+    instr(s, X_REPSTOS, NENHUM_X64, NENHUM_X64);
+    instrQ(s, X_MOV, REG(RDI), REG(R10));
+    instrQ(s, X_MOV, REG(RCX), REG(R11));
+}
+
+/* A função [i, fim] do programa: trecho, registradores e quadro, de rbp
+   para baixo: os registradores salvos, as partes dos arrays parâmetros
+   que chegam em registradores, os arrays locais (zerados), os virtuais
+   que vão para a pilha e, no topo, os argumentos que vão na pilha.
+   Depois, o prólogo, as instruções e os trampolins. */
+static void selecionarFuncao(Selecao *s, uint32_t i, uint32_t fim, uint32_t funcao) {
+    static const RegX64 salvaveis[] = {RBX, R12, R13, R14, R15};
+    const FuncaoCfg *f;
+    const Quad *quads;
+    PedidoAlocacao pedido;
+    RegistradoresX64 *estat = &s->x->funcoes[funcao];
+    int64_t desl = 0, zeroInicio, zeroFim, quadro;
+    int32_t entrada[NREG_ARGUMENTO] = {0};
+    uint8_t entradaQ[NREG_ARGUMENTO] = {0};
+    int nescalares, slot = 0, maxPilha;
+    int32_t nvirtuais;
+    uint8_t *dica;
+
+    s->t = trechoDaFuncao(s, i, fim + 1, funcao, &nescalares);
+    quads = s->t->quads;
+    f = &construirCfg(s->t)->funcoes[0];
+    s->argumento = (int32_t *)arenaAlloc((s->t->n + 1) * sizeof(int32_t));
+    s->chamada = (uint32_t *)arenaAlloc((s->t->n + 1) * sizeof(uint32_t));
+    s->pendentes = (uint32_t *)arenaAlloc((s->t->n + 1) * sizeof(uint32_t));
+    dica = (uint8_t *)arenaAlloc(s->t->ntemps + s->t->n + 1);
+    memset(dica, SEM_REG, s->t->ntemps + s->t->n + 1);
+    nvirtuais = prepararChamadas(s, dica, &maxPilha);
+
+    pedido.nvirtuais = nvirtuais;
+    pedido.nentrada = nescalares;
+    pedido.argumento = s->argumento;
+    pedido.chamada = s->chamada;
+    pedido.dica = dica;
+    pedido.tudoNaPilha = !s->alocar;
+    s->aloc = alocarRegistradores(s->t, f, &pedido);
+    s->primeiroMov = (uint32_t *)arenaAlloc((s->t->n + 2) * sizeof(uint32_t));
+    for (uint32_t k = 0, m = 0; k <= s->t->n; k++) {
+        while (m < s->aloc->nmovimentos && s->aloc->movimentos[m].quad < k) m++;
+        s->primeiroMov[k] = m;
+    }
+    s->primeiroMov[s->t->n + 1] = s->aloc->nmovimentos;
+
+    s->salvos = 0;
+    for (int r = 0; r < 5; r++) {
+        if (!(s->aloc->usados >> salvaveis[r] & 1)) continue;
+        s->salvos |= 1u << salvaveis[r];
+        desl -= 8;
+        s->salvoEm[salvaveis[r]] = (int32_t)desl;
+    }
+
+    s->pilha = (int32_t *)arenaAlloc((nvirtuais + 1) * sizeof(int32_t));
+    for (uint32_t k = 1; k < s->t->n && quads[k].op == IR_PARAM; k++) {
+        Lugar *l = &s->lugar[quads[k].a.v];
+
+        if (l->tipo == LUGAR_ARRAY_PARAM) {
+            l->pos = lugarParametro(&desl, slot++, 8, entrada, entradaQ);
+            l->tamanho = lugarParametro(&desl, slot++, 4, entrada, entradaQ);
+        } else {
+            if (slot >= NREG_ARGUMENTO) s->pilha[l->pos] = 16 + 8 * (slot - NREG_ARGUMENTO);
+            slot++;
+        }
+    }
+
+    zeroFim = desl = alinhar(desl, 8);
+    for (uint32_t k = 0; k < s->t->n; k++) {
+        Lugar *l = &s->lugar[quads[k].a.v];
+
+        if (quads[k].op != IR_VAR || l->tipo != LUGAR_ARRAY_LOCAL) continue;
+        desl -= 4 * (int64_t)l->tamanho;
+        if (desl < -4 * (int64_t)LIMITE_MEMORIA) {
+            s->grande = TRUE;
+            return;
+        }
+        l->pos = (int32_t)desl;
+    }
+    zeroInicio = desl = alinhar(desl, 8);
+
+    for (int32_t v = 0; v < nvirtuais; v++) {
+        if (!s->aloc->naPilha[v] || s->pilha[v] != 0) continue;
+        desl -= 4;
+        s->pilha[v] = (int32_t)desl;
+    }
+    desl = alinhar(desl, 8);
+    quadro = (-desl + 8 * (int64_t)maxPilha + 15) & ~(int64_t)15;
+    if (quadro > 4 * (int64_t)LIMITE_MEMORIA) {
+        s->grande = TRUE;
+        return;
+    }
+
+    estat->funcao = (uint32_t)quads[0].a.v;
+    estat->virtuais = s->aloc->presentes;
+    estat->derramados = s->aloc->derramados;
+    estat->divisoes = s->aloc->divisoes;
+    estat->salvos = __builtin_popcount(s->salvos);
+
+    /* prólogo */
+    emitirX64(s, X_FUNCAO, 0, FALSE, FUNCAO(quads[0].a.v), IMED((int32_t)funcao));
+    instrQ(s, X_PUSH, REG(RBP), NENHUM_X64);
+    instrQ(s, X_MOV, REG(RBP), REG(RSP));
+    if (quadro > 0) instrQ(s, X_SUB, REG(RSP), IMED((int32_t)quadro));
+    for (int r = 0; r < 16; r++)
+        if (s->salvos >> r & 1) instrQ(s, X_MOV, MEM(RBP, s->salvoEm[r]), REG(r));
+    for (int k = 0; k < slot && k < NREG_ARGUMENTO; k++)
+        if (entrada[k] != 0) emitirX64(s, X_MOV, 0, entradaQ[k], MEM(RBP, entrada[k]), REG(registradorArgumento[k]));
+    zerarQuadro(s, zeroInicio, zeroFim);
+
+    /* parâmetros escalares para os seus lugares, e locais lidas antes de
+       escritas zeradas, como no interpretador */
+    reservarMovimentos(s, nescalares);
+    {
+        int n = 0;
+
+        slot = 0;
+        for (uint32_t k = 1; k < s->t->n && quads[k].op == IR_PARAM; k++) {
+            const Lugar *l = &s->lugar[quads[k].a.v];
+
+            if (l->tipo == LUGAR_ARRAY_PARAM) {
+                slot += 2;
+                continue;
+            }
+            if (vivoEm(s->aloc, l->pos, POS_LEITURA(1))) {
+                s->para[n] = lugarVirtual(s, l->pos, POS_ESCRITA(0));
+                s->de[n++] = slot < NREG_ARGUMENTO ? REG(registradorArgumento[slot]) : MEM(RBP, s->pilha[l->pos]);
+            }
+            slot++;
+        }
+        moverEmParalelo(s, s->para, s->de, n);
+    }
+    for (uint32_t k = 1; k < s->t->n; k++) {
+        const Lugar *l = &s->lugar[quads[k].a.v];
+
+        if (quads[k].op != IR_VAR || l->tipo != LUGAR_ESCALAR) continue;
+        if (vivoEm(s->aloc, l->pos, POS_LEITURA(1))) mover(s, lugarVirtual(s, l->pos, POS_ESCRITA(0)), IMED(0));
+    }
+
+    s->npendentes = 0;
+    s->ntrampolins = 0;
+    for (uint32_t k = 0; k < s->t->n;) {
+        const Quad *seguinte = k + 1 < s->t->n ? &quads[k + 1] : NULL;
+
+        s->atual = k;
+        emitirMovimentos(s, k, MOV_ANTES);
+        emitirMovimentos(s, k, MOV_FIM);
+        k += (uint32_t)selecionarQuad(s, &quads[k], seguinte);
+    }
+    for (int k = 0; k < s->ntrampolins; k++) {
+        rotulo(s, s->trampolins[k].rotulo);
+        emitirMovimentos(s, s->trampolins[k].quad, MOV_DESVIO);
+        instr(s, X_JMP, ROTULO(s->trampolins[k].alvo), NENHUM_X64);
+    }
+}
+
+CodigoX64 *gerarX64(const CodigoIR *c, int alocar) {
+    Selecao s;
+    CodigoX64 *x;
+    int temMain = FALSE;
+    uint32_t nfuncoes = 0;
+
+    memset(&s, 0, sizeof(s));
+    s.c = c;
+    s.alocar = alocar;
+    s.lugar = (Lugar *)arenaAlloc((c->nsimbolos + 1) * sizeof(Lugar));
+    s.local = (int32_t *)arenaAlloc((c->ntemps + 1) * sizeof(int32_t));
+    s.vistoEm = (uint32_t *)arenaAlloc((c->ntemps + 1) * sizeof(uint32_t));
+
+    x = (CodigoX64 *)arenaAlloc(sizeof(CodigoX64));
+    x->ir = c;
+    x->globais = (uint32_t *)arenaAlloc((c->nsimbolos + 1) * sizeof(uint32_t));
+    x->tamanhos = (uint32_t *)arenaAlloc((c->nsimbolos + 1) * sizeof(uint32_t));
+    s.x = x;
+
+    /* globais, na ordem das declarações */
+    for (uint32_t i = 0; i < c->n; i++) {
+        const Quad *q = &c->quads[i];
+
+        if (q->op == IR_FUNC) {
+            if (c->simbolos[q->a.v]->name == sessaoAtual->analise.nomeMain) temMain = TRUE;
+            nfuncoes++;
+            while (i < c->n && c->quads[i].op != IR_ENDFUNC) i++;
+        } else if (q->op == IR_VAR) {
+            Lugar *l = &s.lugar[q->a.v];
+            l->tipo = q->b.tipo == OPR_CONST ? LUGAR_ARRAY_GLOBAL : LUGAR_GLOBAL;
+            l->tamanho = q->b.tipo == OPR_CONST ? q->b.v : 0;
+            x->globais[x->nglobais] = (uint32_t)q->a.v;
+            x->tamanhos[x->nglobais++] = 4 * (q->b.tipo == OPR_CONST ? (uint32_t)q->b.v : 1);
+        }
+    }
+    if (!temMain) return NULL;
+
+    x->funcoes = (RegistradoresX64 *)arenaAlloc((nfuncoes + 1) * sizeof(RegistradoresX64));
+    for (int m = 0; m < 3; m++) x->rotuloErro[m] = c->nlabels + m;
+    s.proximoRotulo = c->nlabels + 3;
+    for (uint32_t i = 0; i < c->n && !s.grande; i++) {
+        uint32_t fim = i;
+
+        if (c->quads[i].op != IR_FUNC) continue;
+        while (c->quads[fim].op != IR_ENDFUNC) fim++;
+        selecionarFuncao(&s, i, fim, x->nfuncoes++);
+        i = fim;
+    }
+    if (s.grande) return NULL;
+
+    /* cm_erro_execucao(motivo), com a pilha alinhada como no corpo */
+    for (int m = 0; m < 3; m++) {
+        if (!x->usaErro[m]) continue;
+        rotulo(&s, x->rotuloErro[m]);
+        instr(&s, X_MOV, REG(RDI), IMED(m));
+        instr(&s, X_CALL, FUNCAO(X64_ERRO), NENHUM_X64);
+    }
+    return x;
+}
+
+/* ---------------------- Assembly do GNU as ---------------------- */
+
+static const char *const nomes64[16] = {
+    "rax", "rcx", "rdx", "rbx", "rsp", "rbp", "rsi", "rdi",
+    "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15"
+};
+static const char *const nomes32[16] = {
+    "eax", "ecx", "edx", "ebx", "esp", "ebp", "esi", "edi",
+    "r8d", "r9d", "r10d", "r11d", "r12d", "r13d", "r14d", "r15d"
+};
+static const char *const nomes8[16] = {
+    "al", "cl", "dl", "bl", "spl", "bpl", "sil", "dil",
+    "r8b", "r9b", "r10b", "r11b", "r12b", "r13b", "r14b", "r15b"
+};
+static const char *const nomesCc[16] = {
+    "o", "no", "b", "ae", "e", "ne", "be", "a", "s", "ns", "p", "np", "l", "ge", "le", "g"
+};
+static const char *const mnemonicos[] = {
+    "mov", "lea", "add", "sub", "imul", "shl", "cmp", "xor"
+};
+
+/* bits: 8, 32 ou 64 (registradores) */
+static void escreverOperando(FILE *f, const CodigoX64 *x, OperandoX64 o, int bits) {
+    switch ((TipoOperandoX64)o.tipo) {
+    case XO_REG:
+        fprintf(f, "%%%s", bits == 64 ? nomes64[o.base] : bits == 8 ? nomes8[o.base] : nomes32[o.base]);
+        break;
+    case XO_IMED:
+        fprintf(f, "$%d", o.v);
+        break;
+    case XO_MEM:
+        if (o.v != 0) fprintf(f, "%d", o.v);
+        fprintf(f, "(%%%s", nomes64[o.base]);
+        if (o.indice != SEM_REG) fprintf(f, ",%%%s,4", nomes64[o.indice]);
+        fprintf(f, ")");
+        break;
+    case XO_GLOBAL:
+        fprintf(f, "cm_%s(%%rip)", x->ir->simbolos[o.v]->name);
+        break;
+    case XO_ROTULO:
+        fprintf(f, ".L%d", o.v);
+        break;
+    case XO_FUNCAO:
+        if (o.v == X64_ERRO) fprintf(f, "cm_erro_execucao");
+        else fprintf(f, "cm_%s", x->ir->simbolos[o.v]->name);
+        break;
+    default:
+        break;
+    }
+}
+
+static void escreverInstr(FILE *f, const CodigoX64 *x, const InstrX64 *i) {
+    int bits = i->q ? 64 : 32;
+
+    switch ((OpX64)i->op) {
+    case X_ROTULO:
+        fprintf(f, ".L%d:\n", i->d.v);
+        return;
+    case X_FUNCAO: {
+        const char *nome = x->ir->simbolos[i->d.v]->name;
+        fprintf(f, "\n");
+        if (nome == sessaoAtual->analise.nomeMain) fprintf(f, "\t.globl\tcm_%s\n", nome);
+        const RegistradoresX64 *r = &x->funcoes[i->s.v];
+        fprintf(f, "\t.p2align 4\n\t.type\tcm_%s, @function\ncm_%s:\n", nome, nome);
+        fprintf(f, "\t# registradores: %d virtuais, %d na pilha, %d divisoes, %d salvos\n",
+                r->virtuais, r->derramados, r->divisoes, r->salvos);
+        return;
+    }
+    case X_CLTD:    fprintf(f, "\tcltd\n"); return;
+    case X_RET:     fprintf(f, "\tret\n"); return;
+    case X_LEAVE:   fprintf(f, "\tleave\n"); return;
+    case X_REPSTOS: fprintf(f, "\trep stosq\n"); return;
+    case X_PUSH: case X_POP: case X_IDIV:
+        fprintf(f, "\t%s\t", i->op == X_PUSH ? "pushq" : i->op == X_POP ? "popq" : "idivl");
+        escreverOperando(f, x, i->d, bits);
+        break;
+    case X_JMP: case X_JCC: case X_CALL:
+        if (i->op == X_JCC) fprintf(f, "\tj%s\t", nomesCc[i->cc]);
+        else fprintf(f, "\t%s\t", i->op == X_JMP ? "jmp" : "call");
+        escreverOperando(f, x, i->d, 64);
+        break;
+    case X_SET:
+        fprintf(f, "\tset%s\t", nomesCc[i->cc]);
+        escreverOperando(f, x, i->d, 8);
+        break;
+    case X_MOVZB:
+        fprintf(f, "\tmovzbl\t");
+        escreverOperando(f, x, i->s, 8);
+        fprintf(f, ", ");
+        escreverOperando(f, x, i->d, 32);
+        break;
+    default:
+        fprintf(f, "\t%s%c\t", mnemonicos[i->op], i->q ? 'q' : 'l');
+        /* shl por cl; imul com imediato tem três operandos */
+        escreverOperando(f, x, i->s, i->op == X_SHL ? 8 : bits);
+        fprintf(f, ", ");
+        if (i->op == X_IMUL && i->s.tipo == XO_IMED) {
+            escreverOperando(f, x, i->d, bits);
+            fprintf(f, ", ");
+        }
+        escreverOperando(f, x, i->d, bits);
+        break;
+    }
+    fprintf(f, "\n");
+}
+
+void escreverGas(FILE *f, const CodigoX64 *x) {
+    fprintf(f, "# Gerado pelo compilador C- (x64.c); ligar com runtime.c\n");
+    fprintf(f, "\t.text\n");
+    for (uint32_t i = 0; i < x->n; i++) escreverInstr(f, x, &x->instrucoes[i]);
+    if (x->nglobais > 0) fprintf(f, "\n\t.bss\n");
+    for (uint32_t g = 0; g < x->nglobais; g++)
+        fprintf(f, "\t.p2align 2\ncm_%s:\n\t.zero\t%u\n", x->ir->simbolos[x->globais[g]]->name, x->tamanhos[g]);
+    fprintf(f, "\n\t.section\t.note.GNU-stack,\"\",@progbits\n");
+}
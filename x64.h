@@ -0,0 +1,119 @@
+/* x64.h - Código nativo x86-64 (System V) do código de três endereços */
+
+#ifndef X64_H
+#define X64_H
+
+#include "globals.h"
+#include "ir.h"
+
+#include <stdint.h>
+
+/*
+ * Cada função do código intermediário (ir.h) vira uma função x86-64 com a
+ * convenção do System V: os seis primeiros argumentos em rdi, rsi, rdx,
+ * rcx, r8 e r9, os demais na pilha, e o resultado em eax. Um array vai
+ * como dois argumentos, o endereço e o tamanho. As variáveis locais
+ * escalares e os temporários ficam em registradores pela varredura
+ * linear (alocador.h) ou, os que não cabem, no quadro (rbp); as locais
+ * são zeradas na entrada, como no interpretador. Os globais ficam em
+ * .bss. Sem alocação (a linha de base de cminus-bench nativo), tudo fica
+ * no quadro.
+ *
+ * A seleção produz uma lista de instruções de máquina (InstrX64), que
+ * escreverGas() escreve em assembly do GNU as (ou que jit.h codifica
+ * direto na memória, para --jit). Os nomes do programa
+ * ganham o prefixo cm_ (cm_main, cm_input, ...): input e output, e o
+ * main do C que chama cm_main, vêm do runtime (runtime.c):
+ *
+ *   ./cminus --asm=prog.s prog.cm && cc -o prog prog.s runtime.c
+ *
+ * Divisão por zero, INT32_MIN / -1 e índice fora do array chamam
+ * cm_erro_execucao, que termina o programa como o interpretador.
+ */
+
+/* Registradores, pelo número da codificação */
+typedef enum {
+    RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+    R8, R9, R10, R11, R12, R13, R14, R15,
+    SEM_REG = 0xFF
+} RegX64;
+
+/* Condições, pelo número da codificação (jcc, setcc) */
+typedef enum {
+    CC_B = 0x2, CC_AE = 0x3, CC_E = 0x4, CC_NE = 0x5,
+    CC_L = 0xC, CC_GE = 0xD, CC_LE = 0xE, CC_G = 0xF
+} CondX64;
+
+#define CC_INVERSA(cc) ((CondX64)((cc) ^ 1))
+
+typedef enum {
+    XO_NADA,
+    XO_REG,          /* base */
+    XO_IMED,         /* v */
+    XO_MEM,          /* v(base, indice, 4); indice pode ser SEM_REG */
+    XO_GLOBAL,       /* global de memloc v, relativo a rip */
+    XO_ROTULO,       /* label v */
+    XO_FUNCAO        /* função de memloc v, ou X64_ERRO */
+} TipoOperandoX64;
+
+#define X64_ERRO (-1)   /* cm_erro_execucao(motivo) do runtime */
+
+/* Motivos de cm_erro_execucao */
+#define ERRO_INDICE  0
+#define ERRO_DIVISAO 1
+#define ERRO_ESTOURO 2
+
+typedef struct {
+    uint8_t tipo;            /* TipoOperandoX64 */
+    uint8_t base, indice;    /* RegX64 */
+    int32_t v;
+} OperandoX64;
+
+typedef enum {
+    X_MOV, X_LEA, X_ADD, X_SUB, X_IMUL, X_SHL, X_CMP, X_XOR,
+    X_CLTD, X_IDIV, X_SET, X_MOVZB,
+    X_JMP, X_JCC, X_CALL, X_RET, X_LEAVE, X_PUSH, X_POP, X_REPSTOS,
+    X_ROTULO,        /* pseudo: d é o label */
+    X_FUNCAO         /* pseudo: início da função d, de índice s em funcoes */
+} OpX64;
+
+/* d = d op s (AT&T: op s, d); q: 64 bits. X_IMUL com s imediato é
+   d = d * s; X_SHL com s = cl desloca por cl; X_SET e X_JCC usam cc. */
+typedef struct {
+    uint8_t op;              /* OpX64 */
+    uint8_t cc;              /* CondX64 */
+    uint8_t q;
+    OperandoX64 d, s;
+} InstrX64;
+
+/* Registradores de uma função */
+typedef struct {
+    uint32_t funcao;         /* memloc */
+    int virtuais;            /* locais, temporários e argumentos */
+    int derramados;          /* com algum pedaço na pilha */
+    int divisoes;            /* intervalos divididos */
+    int salvos;              /* registradores salvos pela função */
+} RegistradoresX64;
+
+typedef struct CodigoX64 {
+    InstrX64 *instrucoes;
+    uint32_t n, capacidade;
+    const CodigoIR *ir;      /* nomes das funções e globais (simbolos) */
+    uint32_t *globais;       /* memloc de cada global, em ordem */
+    uint32_t *tamanhos;      /* bytes de cada global */
+    uint32_t nglobais;
+    int usaErro[3];          /* motivos com desvios para o erro */
+    int32_t rotuloErro[3];   /* label de cada motivo */
+    RegistradoresX64 *funcoes;   /* na ordem do programa */
+    uint32_t nfuncoes;
+} CodigoX64;
+
+/* Seleciona as instruções de c, que deve ter main, com os registradores
+   alocados ou (alocar FALSE) tudo no quadro; NULL se não tem main ou se
+   um quadro passa do limite da execução (memória da arena) */
+CodigoX64 *gerarX64(const CodigoIR *c, int alocar);
+
+/* Escreve o código em assembly do GNU as (AT&T) */
+void escreverGas(FILE *f, const CodigoX64 *x);
+
+#endif